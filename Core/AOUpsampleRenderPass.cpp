@@ -0,0 +1,110 @@
+#include "AOUpsampleRenderPass.h"
+
+namespace
+{
+	enum AOUpsampleRootParameterIdx : UINT
+	{
+		AOUpsampleConstantsIdx = 0,
+		GBufferTableIdx,
+		AOTraceTextureTableIdx,
+		AOTextureTableIdx,
+
+		AOUpsampleRootParameterCount
+	};
+}
+
+AOUpsampleRenderPass::AOUpsampleRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig)
+	: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_COMPUTE, false)
+{
+	// The pass has its own compute root signature, the raster one isn't used.
+	const CD3DX12_DESCRIPTOR_RANGE gBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, GlobalDescriptors::GetDescriptorCount(SRVGBuffers), 0);
+	const CD3DX12_DESCRIPTOR_RANGE aoTraceTextureRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, GlobalDescriptors::GetDescriptorCount(SRVAOTraceTexture), GBufferIDCount);
+	const CD3DX12_DESCRIPTOR_RANGE aoTextureRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, GlobalDescriptors::GetDescriptorCount(UAVAOTexture), 0);
+
+	std::array<CD3DX12_ROOT_PARAMETER, AOUpsampleRootParameterCount> rootParameters = {};
+	rootParameters[AOUpsampleConstantsIdx].InitAsConstants(sizeof(AOUpsampleConstants) / 4, 0);
+	rootParameters[GBufferTableIdx].InitAsDescriptorTable(1, &gBufferRange);
+	rootParameters[AOTraceTextureTableIdx].InitAsDescriptorTable(1, &aoTraceTextureRange);
+	rootParameters[AOTextureTableIdx].InitAsDescriptorTable(1, &aoTextureRange);
+
+	const CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc((UINT)rootParameters.size(), rootParameters.data());
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+	D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error) >> CHK_HR;
+	device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_upsampleRootSignature)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_upsampleRootSignature, AOUpsampleRenderPass);
+
+	ComPtr<ID3DBlob> csBlob;
+	D3DReadFileToBlob(L"../AOUpsampleCS.cso", &csBlob) >> CHK_HR;
+
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineStateDesc = {
+		.pRootSignature = m_upsampleRootSignature.Get(),
+		.CS = CD3DX12_SHADER_BYTECODE(csBlob.Get())
+	};
+	device->CreateComputePipelineState(&pipelineStateDesc, IID_PPV_ARGS(&m_pipelineState)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, AOUpsampleRenderPass);
+}
+
+void AOUpsampleRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Read(graphPass, FrameGraphGBufferNormal, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	frameGraph.Read(graphPass, FrameGraphGBufferWorldPos, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	frameGraph.Read(graphPass, FrameGraphAOTraceTexture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	frameGraph.Write(graphPass, FrameGraphAOTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+void AOUpsampleRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
+{
+	assert(pipelineArgs != nullptr);
+	const AOUpsampleRenderPassArgs& args = ToSpecificArgs<AOUpsampleRenderPassArgs>(pipelineArgs);
+
+	// At full resolution the ray traced AO pass writes the AO texture itself.
+	if (args.resolutionMode == AOResolutionMode::Full)
+	{
+		return;
+	}
+
+	auto commandList = GetCommandList(context, frameIndex);
+
+	std::array<ID3D12DescriptorHeap*, 1> descriptorHeaps = { args.commonArgs.cbvSrvUavHeapGlobal.Get() };
+	commandList->SetDescriptorHeaps((UINT)descriptorHeaps.size(), descriptorHeaps.data());
+
+	commandList->SetComputeRootSignature(m_upsampleRootSignature.Get());
+	commandList->SetPipelineState(m_pipelineState.Get());
+
+	const CD3DX12_GPU_DESCRIPTOR_HANDLE heapStart(args.commonArgs.cbvSrvUavHeapGlobal->GetGPUDescriptorHandleForHeapStart());
+	commandList->SetComputeRootDescriptorTable(GBufferTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(SRVGBuffers), args.commonArgs.cbvSrvUavDescSize));
+	commandList->SetComputeRootDescriptorTable(AOTraceTextureTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(SRVAOTraceTexture), args.commonArgs.cbvSrvUavDescSize));
+	commandList->SetComputeRootDescriptorTable(AOTextureTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(UAVAOTexture), args.commonArgs.cbvSrvUavDescSize));
+
+	const AOTraceSize traceSize = GetAOTraceSize(args.resolutionMode, args.screenWidth, args.screenHeight);
+	const AOUpsampleConstants constants = {
+		.width = args.screenWidth,
+		.height = args.screenHeight,
+		.traceWidth = traceSize.width,
+		.traceHeight = traceSize.height,
+		.resolutionMode = (UINT)args.resolutionMode,
+		.frameCount = args.frameCount
+	};
+	commandList->SetComputeRoot32BitConstants(AOUpsampleConstantsIdx, sizeof(AOUpsampleConstants) / 4, &constants, 0);
+
+	const UINT groupCountX = (args.screenWidth + AOUpsampleThreadGroupSize - 1) / AOUpsampleThreadGroupSize;
+	const UINT groupCountY = (args.screenHeight + AOUpsampleThreadGroupSize - 1) / AOUpsampleThreadGroupSize;
+	FlushBarriers(context, frameIndex);
+	commandList->Dispatch(groupCountX, groupCountY, 1);
+}
+
+void AOUpsampleRenderPass::PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
+
+void AOUpsampleRenderPass::PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
@@ -0,0 +1,35 @@
+#pragma once 
+
+#include "DX12RenderPass.h"
+
+// Root constants of shaders/AOUpsampleCS.hlsl.
+struct AOUpsampleConstants
+{
+	UINT width;
+	UINT height;
+	UINT traceWidth;
+	UINT traceHeight;
+	UINT resolutionMode;
+	UINT frameCount;
+};
+static_assert(sizeof(AOUpsampleConstants) == 6 * sizeof(UINT), "AOUpsampleConstants has to match the root constants of the upsample shader.");
+
+constexpr UINT AOUpsampleThreadGroupSize = 8;
+
+// Rebuilds the full resolution AO texture from the AO traced at a reduced resolution with the joint bilateral upsample of
+// AOUpsampler.h. Does nothing when the AO is traced at full resolution.
+class AOUpsampleRenderPass : public DX12RenderPass
+{
+public:
+	AOUpsampleRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
+
+	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
+
+protected:
+	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+	void PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+
+private:
+	ComPtr<ID3D12RootSignature> m_upsampleRootSignature;
+};
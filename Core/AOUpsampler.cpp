@@ -0,0 +1,350 @@
+#include "AOUpsampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "MathUtils.h"
+
+namespace
+{
+	// Most samples that a pixel is rebuilt from.
+	constexpr uint32_t MaxUpsampleSamples = 4u;
+
+	struct UpsampleSample
+	{
+		size_t traceIndex;
+		size_t pixel;
+		float spatialWeight;
+	};
+
+	// Width and height of the block of pixels that one pixel of the trace stands for.
+	uint32_t GetBlockSize(AOResolutionMode mode)
+	{
+		switch (mode)
+		{
+		case AOResolutionMode::Half:
+			return 2u;
+		case AOResolutionMode::Quarter:
+			return 4u;
+		default:
+			return 1u;
+		}
+	}
+
+	// Same as GetGeometryWeight() in the shader.
+	float GetGeometryWeight(const RTAOGBuffer& gBuffer, const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT3& position, size_t samplePixel)
+	{
+		using namespace MathUtils;
+
+		const DirectX::XMFLOAT4& samplePosition = gBuffer.positions[samplePixel];
+		if (samplePosition.w == 0.0f)
+		{
+			return 0.0f;
+		}
+
+		const DirectX::XMFLOAT4& sampleNormal = gBuffer.normals[samplePixel];
+		const float normalWeight = std::pow(std::max(0.0f, Dot(normal, Normalize({ sampleNormal.x, sampleNormal.y, sampleNormal.z }))), AOUpsampleNormalPower);
+
+		const DirectX::XMFLOAT3 offset = Subtract({ samplePosition.x, samplePosition.y, samplePosition.z }, position);
+		const float distance = Length(offset);
+		const float planeRatio = distance > 0.0f ? std::abs(Dot(normal, offset)) / distance : 0.0f;
+
+		return normalWeight * std::max(0.0f, 1.0f - planeRatio / AOUpsamplePlaneThreshold);
+	}
+}
+
+AOTraceSize GetAOTraceSize(AOResolutionMode mode, uint32_t width, uint32_t height)
+{
+	if (mode == AOResolutionMode::Checkerboard)
+	{
+		return { (width + 1) / 2, height };
+	}
+
+	const uint32_t blockSize = GetBlockSize(mode);
+	return { (width + blockSize - 1) / blockSize, (height + blockSize - 1) / blockSize };
+}
+
+void GetAOTracePixel(AOResolutionMode mode, uint32_t traceX, uint32_t traceY, uint32_t frameCount, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+	x = traceX;
+	y = traceY;
+
+	if (mode == AOResolutionMode::Half || mode == AOResolutionMode::Quarter)
+	{
+		// Each base four digit of the frame index picks a quadrant, from the whole block down to single pixels.
+		const uint32_t blockSize = GetBlockSize(mode);
+		uint32_t index = frameCount % (blockSize * blockSize);
+		uint32_t offsetX = 0;
+		uint32_t offsetY = 0;
+		for (uint32_t step = blockSize / 2; step > 0; step /= 2)
+		{
+			const uint32_t digit = index & 3u;
+			offsetX += step * ((digit & 1u) ^ (digit >> 1));
+			offsetY += step * (digit & 1u);
+			index >>= 2;
+		}
+
+		x = traceX * blockSize + offsetX;
+		y = traceY * blockSize + offsetY;
+	}
+	else if (mode == AOResolutionMode::Checkerboard)
+	{
+		x = traceX * 2 + ((traceY + frameCount) & 1u);
+	}
+
+	// Blocks on the right and bottom edges may stick out of the screen.
+	x = std::min(x, width - 1);
+	y = std::min(y, height - 1);
+}
+
+RTAOGBuffer CreateAOTraceGBuffer(const RTAOGBuffer& gBuffer, AOResolutionMode mode, uint32_t frameCount)
+{
+	const AOTraceSize traceSize = GetAOTraceSize(mode, gBuffer.width, gBuffer.height);
+
+	RTAOGBuffer traceGBuffer;
+	traceGBuffer.width = traceSize.width;
+	traceGBuffer.height = traceSize.height;
+	traceGBuffer.positions.resize((size_t)traceSize.width * traceSize.height);
+	traceGBuffer.normals.resize((size_t)traceSize.width * traceSize.height);
+
+	for (uint32_t traceY = 0; traceY < traceSize.height; traceY++)
+	{
+		for (uint32_t traceX = 0; traceX < traceSize.width; traceX++)
+		{
+			uint32_t x, y;
+			GetAOTracePixel(mode, traceX, traceY, frameCount, gBuffer.width, gBuffer.height, x, y);
+
+			const size_t tracePixel = (size_t)traceY * traceSize.width + traceX;
+			const size_t pixel = (size_t)y * gBuffer.width + x;
+			traceGBuffer.positions[tracePixel] = gBuffer.positions[pixel];
+			traceGBuffer.normals[tracePixel] = gBuffer.normals[pixel];
+		}
+	}
+
+	return traceGBuffer;
+}
+
+AOUpsampleStats UpsampleAmbientOcclusion(const RTAOGBuffer& gBuffer, std::span<const float> traceAO, AOResolutionMode mode, uint32_t frameCount, std::vector<float>& ao)
+{
+	const uint32_t width = gBuffer.width;
+	const uint32_t height = gBuffer.height;
+	const AOTraceSize traceSize = GetAOTraceSize(mode, width, height);
+	if (traceAO.size() != (size_t)traceSize.width * traceSize.height)
+	{
+		throw std::runtime_error("The traced AO doesn't match the trace size of the resolution mode.");
+	}
+
+	AOUpsampleStats stats;
+	stats.tracedPixelCount = traceSize.width * traceSize.height;
+
+	if (mode == AOResolutionMode::Full)
+	{
+		ao.assign(traceAO.begin(), traceAO.end());
+		return stats;
+	}
+
+	ao.assign((size_t)width * height, RTAOIsIlluminatedValue);
+
+	const uint32_t blockSize = GetBlockSize(mode);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const size_t pixel = (size_t)y * width + x;
+			const DirectX::XMFLOAT4& worldPos = gBuffer.positions[pixel];
+			if (worldPos.w == 0.0f)
+			{
+				continue;
+			}
+
+			UpsampleSample samples[MaxUpsampleSamples];
+			uint32_t sampleCount = 0;
+
+			auto addSample = [&](uint32_t traceX, uint32_t traceY, float spatialWeight)
+			{
+				uint32_t sampleX, sampleY;
+				GetAOTracePixel(mode, traceX, traceY, frameCount, width, height, sampleX, sampleY);
+				samples[sampleCount++] = { (size_t)traceY * traceSize.width + traceX, (size_t)sampleY * width + sampleX, spatialWeight };
+				return sampleX == x && sampleY == y;
+			};
+
+			if (mode == AOResolutionMode::Checkerboard)
+			{
+				// A pixel traced in the frame keeps its own AO, the others are rebuilt from the four pixels next to them.
+				if (addSample(x / 2, y, 1.0f))
+				{
+					ao[pixel] = traceAO[samples[0].traceIndex];
+					continue;
+				}
+
+				sampleCount = 0;
+				if (x > 0)
+				{
+					addSample((x - 1) / 2, y, 1.0f);
+				}
+				if (x + 1 < width)
+				{
+					addSample((x + 1) / 2, y, 1.0f);
+				}
+				if (y > 0)
+				{
+					addSample(x / 2, y - 1, 1.0f);
+				}
+				if (y + 1 < height)
+				{
+					addSample(x / 2, y + 1, 1.0f);
+				}
+			}
+			else
+			{
+				// The 2x2 blocks whose centers are closest to the pixel. One of them is the block of the pixel, whose sample
+				// is less than a block away, so the tent weights never all go to zero.
+				const float scale = 1.0f / (float)blockSize;
+				const int firstTraceX = (int)std::floor((x + 0.5f) * scale - 0.5f);
+				const int firstTraceY = (int)std::floor((y + 0.5f) * scale - 0.5f);
+				for (int traceY = firstTraceY; traceY <= firstTraceY + 1; traceY++)
+				{
+					for (int traceX = firstTraceX; traceX <= firstTraceX + 1; traceX++)
+					{
+						if (traceX < 0 || traceY < 0 || traceX >= (int)traceSize.width || traceY >= (int)traceSize.height)
+						{
+							continue;
+						}
+
+						addSample((uint32_t)traceX, (uint32_t)traceY, 0.0f);
+						UpsampleSample& sample = samples[sampleCount - 1];
+						const float distanceX = std::abs((float)(sample.pixel % width) - (float)x);
+						const float distanceY = std::abs((float)(sample.pixel / width) - (float)y);
+						sample.spatialWeight = std::max(0.0f, 1.0f - distanceX * scale) * std::max(0.0f, 1.0f - distanceY * scale);
+					}
+				}
+			}
+
+			const DirectX::XMFLOAT3 position = { worldPos.x, worldPos.y, worldPos.z };
+			const DirectX::XMFLOAT3 normal = MathUtils::Normalize({ gBuffer.normals[pixel].x, gBuffer.normals[pixel].y, gBuffer.normals[pixel].z });
+
+			float weightSum = 0.0f;
+			float aoSum = 0.0f;
+			float spatialWeightSum = 0.0f;
+			float spatialAOSum = 0.0f;
+			for (uint32_t i = 0; i < sampleCount; i++)
+			{
+				const UpsampleSample& sample = samples[i];
+				const float sampleAO = traceAO[sample.traceIndex];
+				const float weight = sample.spatialWeight * GetGeometryWeight(gBuffer, normal, position, sample.pixel);
+				weightSum += weight;
+				aoSum += weight * sampleAO;
+				spatialWeightSum += sample.spatialWeight;
+				spatialAOSum += sample.spatialWeight * sampleAO;
+			}
+
+			if (weightSum >= AOUpsampleMinWeight)
+			{
+				ao[pixel] = aoSum / weightSum;
+			}
+			else
+			{
+				ao[pixel] = spatialAOSum / spatialWeightSum;
+				stats.fallbackPixelCount++;
+			}
+		}
+	}
+
+	return stats;
+}
+
+std::vector<AOUpsampleBenchmarkResult> BenchmarkAOUpsampling(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, uint32_t frameCount, uint32_t referenceFrameCount, uint32_t threadCount)
+{
+	const size_t pixelCount = (size_t)gBuffer.width * gBuffer.height;
+
+	RTAOTraceSettings settings;
+	settings.threadCount = threadCount;
+
+	// The reference starts after the measured frames, so its noise isn't correlated with theirs.
+	std::vector<float> reference(pixelCount, 0.0f);
+	std::vector<float> ao;
+	for (uint32_t frame = 0; frame < referenceFrameCount; frame++)
+	{
+		TraceAmbientOcclusion(scene, gBuffer, frameCount + frame, ao, settings);
+		for (size_t pixel = 0; pixel < pixelCount; pixel++)
+		{
+			reference[pixel] += ao[pixel] / referenceFrameCount;
+		}
+	}
+
+	// Over the pixels with a surface.
+	const auto getMeanAbsoluteError = [&](const std::vector<float>& values)
+	{
+		double errorSum = 0.0;
+		uint32_t surfacePixelCount = 0;
+		for (size_t pixel = 0; pixel < pixelCount; pixel++)
+		{
+			if (gBuffer.positions[pixel].w != 0.0f)
+			{
+				errorSum += std::abs(values[pixel] - reference[pixel]);
+				surfacePixelCount++;
+			}
+		}
+		return surfacePixelCount > 0 ? (float)(errorSum / surfacePixelCount) : 0.0f;
+	};
+
+	std::vector<AOUpsampleBenchmarkResult> results;
+	std::vector<float> average;
+	std::vector<float> traceAO;
+	for (uint32_t mode = 0; mode < (uint32_t)AOResolutionMode::Count; mode++)
+	{
+		AOUpsampleBenchmarkResult result;
+		result.mode = (AOResolutionMode)mode;
+		result.rayCount = 0;
+		result.fallbackPixelCount = 0;
+		result.reconstructionError = 0.0f;
+
+		const AOTraceSize traceSize = GetAOTraceSize(result.mode, gBuffer.width, gBuffer.height);
+		average.assign(pixelCount, 0.0f);
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			const RTAOGBuffer traceGBuffer = CreateAOTraceGBuffer(gBuffer, result.mode, frame);
+			result.rayCount = (uint32_t)TraceAmbientOcclusion(scene, traceGBuffer, frame, traceAO, settings).rayCount;
+			result.fallbackPixelCount += UpsampleAmbientOcclusion(gBuffer, traceAO, result.mode, frame, ao).fallbackPixelCount;
+			for (size_t pixel = 0; pixel < pixelCount; pixel++)
+			{
+				average[pixel] += ao[pixel] / frameCount;
+			}
+
+			for (uint32_t traceY = 0; traceY < traceSize.height; traceY++)
+			{
+				for (uint32_t traceX = 0; traceX < traceSize.width; traceX++)
+				{
+					uint32_t x, y;
+					GetAOTracePixel(result.mode, traceX, traceY, frame, gBuffer.width, gBuffer.height, x, y);
+					traceAO[(size_t)traceY * traceSize.width + traceX] = reference[(size_t)y * gBuffer.width + x];
+				}
+			}
+			UpsampleAmbientOcclusion(gBuffer, traceAO, result.mode, frame, ao);
+			result.reconstructionError += getMeanAbsoluteError(ao) / frameCount;
+		}
+		result.meanAbsoluteError = getMeanAbsoluteError(average);
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+const char* GetAOResolutionModeName(AOResolutionMode mode)
+{
+	switch (mode)
+	{
+	case AOResolutionMode::Full:
+		return "Full";
+	case AOResolutionMode::Half:
+		return "Half";
+	case AOResolutionMode::Quarter:
+		return "Quarter";
+	case AOResolutionMode::Checkerboard:
+		return "Checkerboard";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "RTAOReference.h"
+
+/*
+	AO traced at a reduced resolution and the joint bilateral upsample that brings it back to full resolution, the CPU
+	version of shaders/AOUpsampleCS.hlsl and of the pixel mapping in shaders/AOResolution.hlsli.
+
+	Half and Quarter trace one pixel of every 2x2 or 4x4 block. Which pixel of the block is traced moves every frame in a
+	Bayer order, so the temporal accumulation still sees every pixel of the block over a few frames. Checkerboard traces every
+	other pixel of a row, alternating between rows and frames.
+
+	Every full resolution pixel is rebuilt from the traced samples around it. The weight of a sample is cut down by:
+	- The distance to the pixel the sample was traced at, as a tent over the size of a block.
+	- The angle between the normals, as the cosine to the power of AOUpsampleNormalPower.
+	- The distance of the sample from the plane of the pixel, relative to its distance from the pixel.
+	So AO doesn't bleed across edges of the geometry. When no sample is on the surface of the pixel, such as on thin geometry
+	that fell between the traced pixels, the samples are blended by distance alone.
+
+	The GPU stores the AO in half floats, so its results only differ from these by rounding.
+*/
+
+// Matches the RESOLUTION_MODE defines in AOResolution.hlsli.
+enum class AOResolutionMode : uint32_t
+{
+	Full,
+	// One pixel of every 2x2 block.
+	Half,
+	// One pixel of every 4x4 block.
+	Quarter,
+	// Every other pixel of each row.
+	Checkerboard,
+	Count
+};
+
+// Constants from AOUpsampleCS.hlsl. Keep them in sync with the shader.
+constexpr float AOUpsampleNormalPower = 32.0f;
+// Ratio of the distance from the plane of the pixel to the distance from the pixel at which a sample is cut off.
+constexpr float AOUpsamplePlaneThreshold = 0.2f;
+// Below this total weight the samples are blended by distance alone.
+constexpr float AOUpsampleMinWeight = 0.0001f;
+
+struct AOTraceSize
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Size of the ray dispatch for a screen of the given size.
+AOTraceSize GetAOTraceSize(AOResolutionMode mode, uint32_t width, uint32_t height);
+
+// Same as GetAOTracePixel() in the shader. The full resolution pixel that a pixel of the trace is traced at in the frame.
+void GetAOTracePixel(AOResolutionMode mode, uint32_t traceX, uint32_t traceY, uint32_t frameCount, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+
+// The G-buffer at the pixels traced in the frame. TraceAmbientOcclusion() traces it with the same rays as the GPU does.
+RTAOGBuffer CreateAOTraceGBuffer(const RTAOGBuffer& gBuffer, AOResolutionMode mode, uint32_t frameCount);
+
+struct AOUpsampleStats
+{
+	// Pixels traced in the frame, which is the ray count with one sample per pixel.
+	uint32_t tracedPixelCount = 0;
+	// Surface pixels that had no sample on their surface and were blended by distance alone.
+	uint32_t fallbackPixelCount = 0;
+};
+
+// Rebuilds the AO of every pixel of the G-buffer from the AO traced at the pixels of CreateAOTraceGBuffer(). Full copies the
+// AO as it is. Throws if the traced AO doesn't match the trace size.
+AOUpsampleStats UpsampleAmbientOcclusion(const RTAOGBuffer& gBuffer, std::span<const float> traceAO, AOResolutionMode mode, uint32_t frameCount, std::vector<float>& ao);
+
+struct AOUpsampleBenchmarkResult
+{
+	AOResolutionMode mode;
+	// Rays of one frame with one sample per pixel.
+	uint32_t rayCount;
+	// Surface pixels of all frames that were blended by distance alone.
+	uint32_t fallbackPixelCount;
+	// Mean absolute difference of the average of the upsampled frames to the reference, over the pixels with a surface.
+	float meanAbsoluteError;
+	// Same for the reference itself upsampled from the traced pixels of every frame, which leaves out the noise and only
+	// measures what the upsample gets wrong.
+	float reconstructionError;
+};
+
+// Traces one sample per pixel for the given number of frames in every mode, upsamples every frame and compares the average
+// with the average of the frames after them traced at full resolution, which stands in for the converged AO.
+std::vector<AOUpsampleBenchmarkResult> BenchmarkAOUpsampling(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, uint32_t frameCount, uint32_t referenceFrameCount, uint32_t threadCount = 0);
+
+const char* GetAOResolutionModeName(AOResolutionMode mode);
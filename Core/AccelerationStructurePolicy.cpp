@@ -0,0 +1,59 @@
+#include "AccelerationStructurePolicy.h"
+
+#include <algorithm>
+#include <sstream>
+
+D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS GetBottomLevelBuildFlags(const BottomLevelBuildPolicy& policy)
+{
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags = policy.preference == BottomLevelBuildPreference::FastTrace ?
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE :
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
+
+	if (policy.allowCompaction)
+	{
+		flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
+	}
+	if (policy.allowUpdate)
+	{
+		flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+	}
+
+	return flags;
+}
+
+uint64_t GetBottomLevelScratchBytes(const BottomLevelBuildPolicy& policy, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO& info)
+{
+	return policy.allowUpdate ? std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes) : info.ScratchDataSizeInBytes;
+}
+
+uint64_t BottomLevelASStats::GetResidentBytes() const
+{
+	return (compactedBytes > 0 ? compactedBytes : originalBytes) + (isScratchReleased ? 0 : scratchBytes);
+}
+
+std::string FormatBottomLevelASStats(std::span<const BottomLevelASStats> stats)
+{
+	std::ostringstream stream;
+
+	uint64_t originalBytes = 0;
+	uint64_t residentBytes = 0;
+	for (const BottomLevelASStats& stat : stats)
+	{
+		stream << "BLAS " << stat.name << ": " << stat.originalBytes << " bytes, ";
+		if (stat.compactedBytes > 0)
+		{
+			stream << stat.compactedBytes << " bytes compacted, ";
+		}
+		else
+		{
+			stream << "not compacted, ";
+		}
+		stream << stat.scratchBytes << " bytes scratch" << (stat.isScratchReleased ? " (released)" : "") << "\n";
+
+		originalBytes += stat.originalBytes + stat.scratchBytes;
+		residentBytes += stat.GetResidentBytes();
+	}
+
+	stream << "BLAS total: " << residentBytes << " bytes resident instead of " << originalBytes << " bytes\n";
+	return stream.str();
+}
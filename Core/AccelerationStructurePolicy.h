@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "PlatformIncludes.h"
+
+/*
+	Build flags and memory statistics of the bottom level acceleration structures.
+
+	The geometry of a bottom level acceleration structure is static for the lifetime of the program, so by default it is
+	built once for the fastest traversal and then compacted: the driver reports the compacted size after the build, the
+	structure is copied into a buffer of that size, and the original buffer and the scratch memory are released.
+*/
+
+enum class BottomLevelBuildPreference : uint32_t
+{
+	FastTrace = 0,
+	FastBuild
+};
+
+struct BottomLevelBuildPolicy
+{
+	BottomLevelBuildPreference preference = BottomLevelBuildPreference::FastTrace;
+	bool allowCompaction = true;
+	// Only needed for geometry that is refit after the first build, and keeps the scratch memory alive.
+	bool allowUpdate = false;
+};
+
+D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS GetBottomLevelBuildFlags(const BottomLevelBuildPolicy& policy);
+// Size of the scratch memory of a build. When updates are allowed the same scratch memory is used to refit, which can need
+// more than the build.
+uint64_t GetBottomLevelScratchBytes(const BottomLevelBuildPolicy& policy, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO& info);
+
+struct BottomLevelASStats
+{
+	std::string name;
+	// ResultDataMaxSizeInBytes of the prebuild info, which the build writes to.
+	uint64_t originalBytes = 0;
+	// Size of the buffer after compaction, zero when it isn't compacted.
+	uint64_t compactedBytes = 0;
+	uint64_t scratchBytes = 0;
+	// Whether the scratch memory has been released.
+	bool isScratchReleased = false;
+
+	// Memory that the acceleration structure holds on to now.
+	uint64_t GetResidentBytes() const;
+};
+
+// One line per acceleration structure followed by the totals, for the debug output.
+std::string FormatBottomLevelASStats(std::span<const BottomLevelASStats> stats);
@@ -23,7 +23,8 @@ AccumilationRenderPass::AccumilationRenderPass(ComPtr<ID3D12Device5> device, Com
 	accumilationPipelineStateStream.PrimtiveTopology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 	accumilationPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
 	accumilationPipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(psBlob.Get());
-	accumilationPipelineStateStream.RTVFormats = { { BackBufferFormat }, 1 };
+	// Only writes unordered access views.
+	accumilationPipelineStateStream.RTVFormats = { {}, 0 };
 	accumilationPipelineStateStream.DSVFormat = DXGI_FORMAT_UNKNOWN;
 
 	const D3D12_PIPELINE_STATE_STREAM_DESC pipelineStateStreamDesc = {
@@ -36,6 +37,21 @@ AccumilationRenderPass::AccumilationRenderPass(ComPtr<ID3D12Device5> device, Com
 	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, AccumilationRenderPass);
 }
 
+void AccumilationRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Read(graphPass, FrameGraphGBufferNormal, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	frameGraph.Read(graphPass, FrameGraphGBufferWorldPos, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	frameGraph.Write(graphPass, FrameGraphAccumulationTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	frameGraph.Write(graphPass, FrameGraphReprojectionTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// The history is only read, but through the same unordered access views as the textures that are written.
+	frameGraph.Write(graphPass, FrameGraphAccumulationHistory, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	frameGraph.Write(graphPass, FrameGraphReprojectionHistory, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// The AO of the frame is replaced by the accumulated AO.
+	frameGraph.Write(graphPass, FrameGraphAOTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// Pixels that traced no rays keep their history. Also only read.
+	frameGraph.Write(graphPass, FrameGraphSampleCountTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
 void AccumilationRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
 	assert(pipelineArgs != nullptr);
@@ -45,7 +61,7 @@ void AccumilationRenderPass::BuildRenderPass(const std::vector<RenderPackage>& r
 
 	SetCommonStates(args.commonArgs, m_pipelineState, commandList);
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	commandList->OMSetRenderTargets(1, &args.RTVTargetFrame, TRUE, nullptr);
+	commandList->OMSetRenderTargets(0, nullptr, FALSE, nullptr);
 
 	// Set the descriptor table for SRVs and UAVs
 	auto descHeapHandleBase = CD3DX12_GPU_DESCRIPTOR_HANDLE(
@@ -56,6 +72,7 @@ void AccumilationRenderPass::BuildRenderPass(const std::vector<RenderPackage>& r
 
 	commandList->SetGraphicsRootDescriptorTable(DefaultRootParameterIdx::UAVSRVTableIdx, descHeapHandleBase);
 
+	FlushBarriers(context, frameIndex);
 	commandList->DrawInstanced(6, 1, 0, 0);
 }
 
@@ -8,6 +8,7 @@ public:
 	AccumilationRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
 
 	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
 
 protected:
 	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
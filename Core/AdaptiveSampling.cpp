@@ -0,0 +1,209 @@
+#include "AdaptiveSampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "MathUtils.h"
+
+namespace
+{
+	// Marks the pixels without a history between the two steps, as their first ray can't be taken away. Same as
+	// REQUIRED_SAMPLE_FLAG in the shader.
+	constexpr uint8_t RequiredSampleFlag = 0x80u;
+
+	// 4x4 Bayer matrix, same as DitherMatrix in the shader.
+	constexpr uint32_t DitherMatrix[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+}
+
+uint32_t GetAdaptiveRayBudget(uint32_t width, uint32_t height, const AdaptiveSamplingSettings& settings)
+{
+	return (uint32_t)(std::max(settings.raysPerPixelBudget, 0.0f) * ((double)width * height));
+}
+
+uint32_t GetRequestedSampleCount(const DirectX::XMFLOAT4* history, uint32_t x, uint32_t y, uint32_t width, uint32_t frameCount, const AdaptiveSamplingSettings& settings)
+{
+	const uint32_t maxSamples = std::clamp(settings.maxSamplesPerPixel, 1u, AdaptiveMaxSamplesPerPixel);
+	if (!history)
+	{
+		return maxSamples;
+	}
+
+	const float variance = std::max(0.0f, history->z - history->x * history->x);
+	const float stdDev = std::sqrt((variance * history->y + AdaptiveMaxVariance * AdaptiveVariancePriorWeight) / (history->y + AdaptiveVariancePriorWeight));
+	if (stdDev < settings.convergedError * std::sqrt(history->y))
+	{
+		const bool isRefreshed = settings.refreshInterval > 0 && (x + y * width + frameCount) % settings.refreshInterval == 0;
+		return isRefreshed ? 1u : 0u;
+	}
+
+	return std::clamp((uint32_t)std::ceil(maxSamples * stdDev / settings.noisyStdDev), 1u, maxSamples);
+}
+
+uint32_t ScaleSampleCount(uint32_t sampleCount, uint32_t budget, uint32_t requestedRayCount, uint32_t x, uint32_t y, uint32_t frameCount)
+{
+	const uint32_t scaled = sampleCount * budget;
+	const uint32_t remainder = scaled % requestedRayCount;
+
+	// Adding a step coprime to 16 every frame moves every pixel through all the thresholds, and keeps them a Bayer pattern.
+	const uint32_t threshold = (DitherMatrix[(y & 3u) * 4u + (x & 3u)] + frameCount * 7u) & 15u;
+	const bool roundsUp = (uint64_t)remainder * 16u >= (uint64_t)(threshold + 1u) * requestedRayCount;
+	return scaled / requestedRayCount + (roundsUp ? 1u : 0u);
+}
+
+AdaptiveSamplingStats ComputeSampleCounts(const RTAOGBuffer& gBuffer, const TemporalCamera& previousCamera, const TemporalHistory* previous, uint32_t frameCount, const AdaptiveSamplingSettings& settings, std::vector<uint8_t>& sampleCounts, std::vector<float>& ao)
+{
+	const uint32_t width = gBuffer.width;
+	const uint32_t height = gBuffer.height;
+	const size_t pixelCount = (size_t)width * height;
+	if (previous && (previous->width != width || previous->height != height))
+	{
+		throw std::runtime_error("The history doesn't match the size of the G-buffer.");
+	}
+
+	sampleCounts.assign(pixelCount, 0);
+	ao.assign(pixelCount, RTAOIsIlluminatedValue);
+
+	AdaptiveSamplingStats stats;
+	stats.rayBudget = GetAdaptiveRayBudget(width, height, settings);
+
+	// The first step asks every pixel how many rays it wants, like the estimate dispatch.
+	uint32_t requiredPixelCount = 0;
+	uint32_t optionalRayCount = 0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const size_t pixel = (size_t)y * width + x;
+			const DirectX::XMFLOAT4& position = gBuffer.positions[pixel];
+			if (position.w == 0.0f)
+			{
+				continue;
+			}
+
+			const DirectX::XMFLOAT3 worldPos = { position.x, position.y, position.z };
+			const DirectX::XMFLOAT3 normal = MathUtils::Normalize({ gBuffer.normals[pixel].x, gBuffer.normals[pixel].y, gBuffer.normals[pixel].z });
+
+			DirectX::XMFLOAT4 history;
+			const bool hasHistory = previous && ReprojectHistory(*previous, previousCamera, worldPos, normal, history);
+			if (hasHistory)
+			{
+				ao[pixel] = history.x;
+			}
+
+			const uint32_t requested = GetRequestedSampleCount(hasHistory ? &history : nullptr, x, y, width, frameCount, settings);
+			const uint32_t required = hasHistory ? 0u : 1u;
+			stats.requestedRayCount += requested;
+			requiredPixelCount += required;
+			optionalRayCount += requested - required;
+			sampleCounts[pixel] = (uint8_t)(requested | (required ? RequiredSampleFlag : 0u));
+		}
+	}
+
+	// The second step scales the rays that can be taken away down to what is left of the budget, like the distribute dispatch.
+	const uint32_t budgetLeft = stats.rayBudget - std::min(stats.rayBudget, requiredPixelCount);
+	uint32_t grantedOptionalRayCount = 0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const size_t pixel = (size_t)y * width + x;
+			if (gBuffer.positions[pixel].w == 0.0f)
+			{
+				continue;
+			}
+
+			const uint32_t required = (sampleCounts[pixel] & RequiredSampleFlag) ? 1u : 0u;
+			uint32_t optional = (sampleCounts[pixel] & ~RequiredSampleFlag) - required;
+			if (optionalRayCount > budgetLeft)
+			{
+				optional = ScaleSampleCount(optional, budgetLeft, optionalRayCount, x, y, frameCount);
+
+				// The shader hands the rays out in the order its waves run in, this in scan order.
+				optional = std::min(optional, budgetLeft - std::min(budgetLeft, grantedOptionalRayCount));
+				grantedOptionalRayCount += optional;
+			}
+
+			const uint32_t sampleCount = required + optional;
+			sampleCounts[pixel] = (uint8_t)sampleCount;
+			stats.rayCount += sampleCount;
+			stats.histogram[sampleCount]++;
+		}
+	}
+
+	return stats;
+}
+
+std::vector<AdaptiveSamplingBenchmarkResult> BenchmarkAdaptiveSampling(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, const TemporalCamera& camera, uint32_t frameCount, uint32_t referenceFrameCount, const AdaptiveSamplingSettings& settings, uint32_t threadCount)
+{
+	const size_t pixelCount = (size_t)gBuffer.width * gBuffer.height;
+
+	RTAOTraceSettings traceSettings;
+	traceSettings.threadCount = threadCount;
+
+	// The reference starts after the measured frames, so its noise isn't correlated with theirs.
+	std::vector<double> reference(pixelCount, 0.0);
+	std::vector<float> ao;
+	for (uint32_t frame = 0; frame < referenceFrameCount; frame++)
+	{
+		TraceAmbientOcclusion(scene, gBuffer, frameCount + frame, ao, traceSettings);
+		for (size_t pixel = 0; pixel < pixelCount; pixel++)
+		{
+			reference[pixel] += (double)ao[pixel] / referenceFrameCount;
+		}
+	}
+
+	const uint32_t rayBudget = GetAdaptiveRayBudget(gBuffer.width, gBuffer.height, settings);
+
+	std::vector<AdaptiveSamplingBenchmarkResult> results;
+	std::vector<uint8_t> sampleCounts;
+	for (bool isAdaptive : { false, true })
+	{
+		AdaptiveSamplingBenchmarkResult result;
+		result.isAdaptive = isAdaptive;
+		result.rayCount = 0;
+		result.maxFrameRayCount = 0;
+		result.overBudgetFrameCount = 0;
+
+		TemporalHistory previous;
+		TemporalHistory next;
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			const TemporalHistory* history = frame > 0 ? &previous : nullptr;
+
+			RTAOTraceSettings frameTraceSettings = traceSettings;
+			if (isAdaptive)
+			{
+				// The AO of the pixels without rays is their history, which the trace leaves as it is.
+				ComputeSampleCounts(gBuffer, camera, history, frame, settings, sampleCounts, ao);
+				frameTraceSettings.sampleCounts = sampleCounts;
+			}
+
+			const uint32_t frameRayCount = (uint32_t)TraceAmbientOcclusion(scene, gBuffer, frame, ao, frameTraceSettings).rayCount;
+			AccumulateTemporal(gBuffer, ao, camera, camera, history, next, frameTraceSettings.sampleCounts);
+			std::swap(previous, next);
+
+			result.rayCount += frameRayCount;
+			result.maxFrameRayCount = std::max(result.maxFrameRayCount, frameRayCount);
+			result.overBudgetFrameCount += isAdaptive && frameRayCount > rayBudget ? 1u : 0u;
+		}
+
+		double squaredErrorSum = 0.0;
+		uint32_t surfacePixelCount = 0;
+		for (size_t pixel = 0; pixel < pixelCount && frameCount > 0; pixel++)
+		{
+			if (gBuffer.positions[pixel].w != 0.0f)
+			{
+				const double error = previous.values[pixel].x - reference[pixel];
+				squaredErrorSum += error * error;
+				surfacePixelCount++;
+			}
+		}
+		result.rootMeanSquaredError = surfacePixelCount > 0 ? (float)std::sqrt(squaredErrorSum / surfacePixelCount) : 0.0f;
+
+		results.push_back(result);
+	}
+
+	return results;
+}
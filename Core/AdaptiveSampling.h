@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "TemporalReprojection.h"
+
+/*
+	CPU reference of the adaptive sampling pass in shaders/AdaptiveSamplingCS.hlsl, which decides how many AO rays every
+	pixel traces in the frame.
+
+	The accumulation pass keeps the mean and the mean of the squared AO of every pixel, which give the variance of the AO
+	over its history. The AO of a single ray is zero or one, so a few frames of equal values say little about the variance: the
+	pass blends it with the largest variance there is, which the history outweighs as it grows. Every frame the pass
+	reprojects the history like the accumulation pass does and asks for:
+	- maxSamplesPerPixel rays for pixels without a history.
+	- No rays for converged pixels, whose standard error sqrt(variance / history length) is below convergedError. They keep
+	  their history, and still get one ray every refreshInterval frames so they notice when their AO changes.
+	- Between one and maxSamplesPerPixel rays for the others, in proportion to their standard deviation.
+	The requests are then scaled down to fit the ray budget of the frame. Rounding every pixel down would starve a screen of
+	pixels that all ask for the same few rays, so the fractions are rounded with a 4x4 Bayer dither that moves every frame,
+	and every pixel gets its share of rays over a few frames. The dither leans towards rounding down, and the rays are handed
+	out from a running total that stops at the budget for the frames it would still take over. Pixels without a history
+	keep one ray even when the budget is too small for them, as they have no AO otherwise, so only they can take a frame over
+	the budget. The GPU hands out the rays in the order its waves run in, so the pixels that the running total cuts off can
+	differ from the ones here.
+
+	Pixels without rays get their reprojected history AO, which the denoiser and the accumulation pass read in place of a
+	traced value.
+*/
+
+// Constants from AdaptiveSamplingCS.hlsl. Keep them in sync with the shader.
+// Most rays a pixel can get, which is also the last bin of the histogram.
+constexpr uint32_t AdaptiveMaxSamplesPerPixel = 8u;
+// The variance of a pixel is blended with the largest variance an AO value in [0, 1] can have, as if the history had this
+// many more frames. A short history of equal values then doesn't pass for converged.
+constexpr float AdaptiveVariancePriorWeight = 1.0f;
+constexpr float AdaptiveMaxVariance = 0.25f;
+
+struct AdaptiveSamplingSettings
+{
+	// Off traces NUM_SAMPLES rays for every pixel.
+	bool enabled = false;
+	// At most AdaptiveMaxSamplesPerPixel.
+	uint32_t maxSamplesPerPixel = 4;
+	// Rays the frame may trace, as an average over the pixels of the screen.
+	float raysPerPixelBudget = 1.0f;
+	// Standard deviation of the AO at which a pixel asks for maxSamplesPerPixel rays. The most an AO value can have is 0.5.
+	float noisyStdDev = 0.5f;
+	// Standard error of the accumulated AO below which a pixel is converged.
+	float convergedError = 0.01f;
+	// Converged pixels get one ray every this many frames.
+	uint32_t refreshInterval = 16;
+};
+
+struct AdaptiveSamplingStats
+{
+	// Most rays the frame could trace.
+	uint32_t rayBudget = 0;
+	// Rays the pixels asked for before they were fit to the budget.
+	uint32_t requestedRayCount = 0;
+	uint32_t rayCount = 0;
+	// Surface pixels by the number of rays they got.
+	std::array<uint32_t, AdaptiveMaxSamplesPerPixel + 1> histogram = {};
+};
+
+uint32_t GetAdaptiveRayBudget(uint32_t width, uint32_t height, const AdaptiveSamplingSettings& settings);
+
+// Same as GetRequestedSampleCount() in the shader, for a surface pixel. The history is nullptr when the pixel has none.
+uint32_t GetRequestedSampleCount(const DirectX::XMFLOAT4* history, uint32_t x, uint32_t y, uint32_t width, uint32_t frameCount, const AdaptiveSamplingSettings& settings);
+
+// Same as ScaleSampleCount() in the shader. Scales the rays of a pixel by budget / requestedRayCount, rounded up or down by
+// the dither threshold of the pixel in the frame. Rounds up for the fraction of the thresholds that the remainder reaches
+// in full, so a 4x4 block asking for equal rays never gets more than its share.
+uint32_t ScaleSampleCount(uint32_t sampleCount, uint32_t budget, uint32_t requestedRayCount, uint32_t x, uint32_t y, uint32_t frameCount);
+
+// Runs the adaptive sampling shader for every pixel. Writes the sample count of every pixel, which TraceAmbientOcclusion()
+// and AccumulateTemporal() take, and the AO of the pixels with a history. Without a history every surface pixel asks for
+// maxSamplesPerPixel rays.
+AdaptiveSamplingStats ComputeSampleCounts(const RTAOGBuffer& gBuffer, const TemporalCamera& previousCamera, const TemporalHistory* previous, uint32_t frameCount, const AdaptiveSamplingSettings& settings, std::vector<uint8_t>& sampleCounts, std::vector<float>& ao);
+
+struct AdaptiveSamplingBenchmarkResult
+{
+	// Whether the rays were handed out by ComputeSampleCounts() or every surface pixel traced one.
+	bool isAdaptive;
+	// Over all frames.
+	uint64_t rayCount;
+	uint32_t maxFrameRayCount;
+	// Frames that traced more rays than the budget, which only pixels without a history can cause.
+	uint32_t overBudgetFrameCount;
+	// Root mean squared difference of the accumulated AO after the last frame to the reference, over the pixels with a surface.
+	float rootMeanSquaredError;
+};
+
+// Accumulates the given number of frames of a static camera, once with one ray for every surface pixel and once with the
+// rays handed out by the adaptive sampling settings, and compares both with the average of the uniform frames after them,
+// which stands in for the converged AO.
+std::vector<AdaptiveSamplingBenchmarkResult> BenchmarkAdaptiveSampling(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, const TemporalCamera& camera, uint32_t frameCount, uint32_t referenceFrameCount, const AdaptiveSamplingSettings& settings, uint32_t threadCount = 0);
@@ -0,0 +1,147 @@
+#include "AdaptiveSamplingRenderPass.h"
+
+namespace
+{
+	enum AdaptiveSamplingRootParameterIdx : UINT
+	{
+		AdaptiveSamplingConstantsIdx = 0,
+		GlobalFrameDataIdx,
+		GBufferTableIdx,
+		// The AO, AO trace and sample count textures, followed by both copies of the accumulation and reprojection textures.
+		UAVTableIdx,
+		CounterBufferIdx,
+
+		AdaptiveSamplingRootParameterCount
+	};
+}
+
+AdaptiveSamplingRenderPass::AdaptiveSamplingRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig)
+	: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_COMPUTE, false)
+{
+	// The pass has its own compute root signature, the raster one isn't used.
+	const CD3DX12_DESCRIPTOR_RANGE gBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, GlobalDescriptors::GetDescriptorCount(SRVGBuffers), 0);
+	const CD3DX12_DESCRIPTOR_RANGE uavRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+		GlobalDescriptors::GetDescriptorCount(UAVAOTexture) +
+		GlobalDescriptors::GetDescriptorCount(UAVAOTraceTexture) +
+		GlobalDescriptors::GetDescriptorCount(UAVSampleCountTexture) +
+		GlobalDescriptors::GetDescriptorCount(UAVAccumulationTexture) +
+		GlobalDescriptors::GetDescriptorCount(UAVReprojectionTexture), 0);
+	const UINT counterRegister = uavRange.NumDescriptors;
+
+	std::array<CD3DX12_ROOT_PARAMETER, AdaptiveSamplingRootParameterCount> rootParameters = {};
+	rootParameters[AdaptiveSamplingConstantsIdx].InitAsConstants(sizeof(AdaptiveSamplingConstants) / 4, 0);
+	rootParameters[GlobalFrameDataIdx].InitAsConstantBufferView(1);
+	rootParameters[GBufferTableIdx].InitAsDescriptorTable(1, &gBufferRange);
+	rootParameters[UAVTableIdx].InitAsDescriptorTable(1, &uavRange);
+	rootParameters[CounterBufferIdx].InitAsUnorderedAccessView(counterRegister);
+
+	const CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc((UINT)rootParameters.size(), rootParameters.data());
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+	D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error) >> CHK_HR;
+	device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_adaptiveSamplingRootSignature)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_adaptiveSamplingRootSignature, AdaptiveSamplingRenderPass);
+
+	ComPtr<ID3DBlob> csBlob;
+	D3DReadFileToBlob(L"../AdaptiveSamplingCS.cso", &csBlob) >> CHK_HR;
+
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineStateDesc = {
+		.pRootSignature = m_adaptiveSamplingRootSignature.Get(),
+		.CS = CD3DX12_SHADER_BYTECODE(csBlob.Get())
+	};
+	device->CreateComputePipelineState(&pipelineStateDesc, IID_PPV_ARGS(&m_pipelineState)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, AdaptiveSamplingRenderPass);
+}
+
+void AdaptiveSamplingRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Read(graphPass, FrameGraphGBufferNormal, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	frameGraph.Read(graphPass, FrameGraphGBufferWorldPos, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	// Pixels without rays get their history AO in the AO texture.
+	frameGraph.Write(graphPass, FrameGraphAOTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	frameGraph.Write(graphPass, FrameGraphSampleCountTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// Only read, but through unordered access views.
+	frameGraph.Write(graphPass, FrameGraphAccumulationHistory, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	frameGraph.Write(graphPass, FrameGraphReprojectionHistory, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+void AdaptiveSamplingRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
+{
+	assert(pipelineArgs != nullptr);
+	const AdaptiveSamplingRenderPassArgs& args = ToSpecificArgs<AdaptiveSamplingRenderPassArgs>(pipelineArgs);
+
+	// The ray traced AO pass traces NUM_SAMPLES rays for every pixel then.
+	if (!args.isEnabled)
+	{
+		return;
+	}
+
+	assert(args.counterBuffer != nullptr && args.readbackBuffer != nullptr);
+
+	auto commandList = GetCommandList(context, frameIndex);
+
+	std::array<ID3D12DescriptorHeap*, 1> descriptorHeaps = { args.commonArgs.cbvSrvUavHeapGlobal.Get() };
+	commandList->SetDescriptorHeaps((UINT)descriptorHeaps.size(), descriptorHeaps.data());
+
+	commandList->SetComputeRootSignature(m_adaptiveSamplingRootSignature.Get());
+	commandList->SetPipelineState(m_pipelineState.Get());
+
+	const CD3DX12_GPU_DESCRIPTOR_HANDLE heapStart(args.commonArgs.cbvSrvUavHeapGlobal->GetGPUDescriptorHandleForHeapStart());
+	commandList->SetComputeRootConstantBufferView(GlobalFrameDataIdx, args.commonArgs.globalFrameDataAddress);
+	commandList->SetComputeRootDescriptorTable(GBufferTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(SRVGBuffers), args.commonArgs.cbvSrvUavDescSize));
+	commandList->SetComputeRootDescriptorTable(UAVTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(UAVAOTexture), args.commonArgs.cbvSrvUavDescSize));
+	commandList->SetComputeRootUnorderedAccessView(CounterBufferIdx, args.counterBuffer->resource->GetGPUVirtualAddress());
+
+	AdaptiveSamplingConstants constants = {
+		.width = args.screenWidth,
+		.height = args.screenHeight,
+		.frameCount = args.frameCount,
+		.passType = AdaptiveSamplingPassClear,
+		.maxSamplesPerPixel = args.settings.maxSamplesPerPixel,
+		.rayBudget = GetAdaptiveRayBudget(args.screenWidth, args.screenHeight, args.settings),
+		.refreshInterval = args.settings.refreshInterval,
+		.noisyStdDev = args.settings.noisyStdDev,
+		.convergedError = args.settings.convergedError
+	};
+
+	const UINT groupCountX = (args.screenWidth + AdaptiveSamplingThreadGroupSize - 1) / AdaptiveSamplingThreadGroupSize;
+	const UINT groupCountY = (args.screenHeight + AdaptiveSamplingThreadGroupSize - 1) / AdaptiveSamplingThreadGroupSize;
+
+	// Shares the batch with the frame graph barriers of the pass.
+	BarrierBatcher& barrierBatcher = GetBarrierBatcher(context, frameIndex);
+	args.counterBuffer->TransitionTo(D3D12_RESOURCE_STATE_UNORDERED_ACCESS, barrierBatcher);
+
+	commandList->SetComputeRoot32BitConstants(AdaptiveSamplingConstantsIdx, sizeof(AdaptiveSamplingConstants) / 4, &constants, 0);
+	FlushBarriers(context, frameIndex);
+	commandList->Dispatch(1, 1, 1);
+
+	// Every dispatch reads the counters and the sample counts that the one before wrote.
+	for (const AdaptiveSamplingPassType passType : { AdaptiveSamplingPassEstimate, AdaptiveSamplingPassDistribute })
+	{
+		barrierBatcher.UAV(nullptr);
+
+		constants.passType = passType;
+		commandList->SetComputeRoot32BitConstants(AdaptiveSamplingConstantsIdx, sizeof(AdaptiveSamplingConstants) / 4, &constants, 0);
+		FlushBarriers(context, frameIndex);
+		commandList->Dispatch(groupCountX, groupCountY, 1);
+	}
+
+	// The renderer reads the counters once the frame is done, see DX12Renderer::Update().
+	args.counterBuffer->TransitionTo(D3D12_RESOURCE_STATE_COPY_SOURCE, barrierBatcher);
+	FlushBarriers(context, frameIndex);
+	commandList->CopyBufferRegion(args.readbackBuffer->Get(), 0, args.counterBuffer->Get(), 0, AdaptiveSamplingCounterCount * sizeof(UINT));
+}
+
+void AdaptiveSamplingRenderPass::PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
+
+void AdaptiveSamplingRenderPass::PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
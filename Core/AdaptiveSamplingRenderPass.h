@@ -0,0 +1,64 @@
+#pragma once 
+
+#include "DX12RenderPass.h"
+
+// Root constants of shaders/AdaptiveSamplingCS.hlsl, set once per dispatch.
+struct AdaptiveSamplingConstants
+{
+	UINT width;
+	UINT height;
+	UINT frameCount;
+	UINT passType;
+	UINT maxSamplesPerPixel;
+	UINT rayBudget;
+	UINT refreshInterval;
+	float noisyStdDev;
+	float convergedError;
+};
+static_assert(sizeof(AdaptiveSamplingConstants) == 9 * sizeof(UINT), "AdaptiveSamplingConstants has to match the root constants of the adaptive sampling shader.");
+
+// What a dispatch of the adaptive sampling shader does.
+enum AdaptiveSamplingPassType : UINT
+{
+	AdaptiveSamplingPassClear = 0,
+	// Writes how many rays every pixel asks for and counts them.
+	AdaptiveSamplingPassEstimate,
+	// Scales the requests down to the ray budget and fills the histogram.
+	AdaptiveSamplingPassDistribute
+};
+
+// Layout of the counter buffer that the shader adds up and the renderer reads back.
+enum AdaptiveSamplingCounter : UINT
+{
+	AdaptiveSamplingCounterRequiredPixels = 0,
+	AdaptiveSamplingCounterOptionalRays,
+	AdaptiveSamplingCounterRequestedRays,
+	AdaptiveSamplingCounterRays,
+	AdaptiveSamplingCounterGrantedOptionalRays,
+	AdaptiveSamplingCounterRayBudget,
+	// One counter per sample count, from zero to AdaptiveMaxSamplesPerPixel.
+	AdaptiveSamplingCounterHistogram,
+
+	AdaptiveSamplingCounterCount = AdaptiveSamplingCounterHistogram + AdaptiveMaxSamplesPerPixel + 1
+};
+
+constexpr UINT AdaptiveSamplingThreadGroupSize = 8;
+static_assert(AdaptiveSamplingCounterCount <= AdaptiveSamplingThreadGroupSize * AdaptiveSamplingThreadGroupSize, "The clear dispatch is a single thread group.");
+
+// Writes the sample count texture that the ray traced AO pass traces with, see AdaptiveSampling.h. The counters are copied
+// to the readback buffer of the frame, which the renderer reads once the frame is done.
+class AdaptiveSamplingRenderPass : public DX12RenderPass
+{
+public:
+	AdaptiveSamplingRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
+
+	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
+
+protected:
+	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+	void PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+
+private:
+	ComPtr<ID3D12RootSignature> m_adaptiveSamplingRootSignature;
+};
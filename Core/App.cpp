@@ -8,6 +8,7 @@
 #include "GPUResource.h"
 #include "DX12AbstractionUtils.h"
 #include "DX12Renderer.h"
+#include "PlatformUtils.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DX12Abstractions;
@@ -19,12 +20,22 @@ bool RunApp(Core::Window& window)
 	DX12Renderer& renderer = DX12Renderer::Get();
 
 	// Main loop.
+	UINT frameCount = 0;
 	while (!window.Closed())
 	{
 		window.ProcessMessages();
 
 		renderer.Update();
 		renderer.Render();
+
+		// Shows that the moving instance takes the update path rather than rebuilding the acceleration structures.
+		if constexpr (AnimateRaytracedInstance)
+		{
+			if (++frameCount % TopLevelStatsLogInterval == 0)
+			{
+				OutputDebugMessage(FormatTopLevelUpdateStats(renderer.GetTopLevelUpdateStats(RTRenderObjectID)));
+			}
+		}
 	}
 
 	return true;
@@ -4,7 +4,7 @@
 #include <array>
 #include <unordered_map>
 
-#include "DirectXIncludes.h"
+#include "PlatformIncludes.h"
 
 /*
 	This file is used to define the common types and constants that are used throughout the application.
@@ -13,8 +13,11 @@
 // Common paths
 constexpr const char* AssetsPath = "../../../../assets/";
 
-// The number of contexts that the program uses.
-constexpr uint32_t NumContexts = 2u;
+// Upper limit for the number of command lists that one render pass records in parallel. The job system that records
+// them uses one thread per core, so this is only reached on machines with many cores.
+constexpr uint32_t MaxRecordingContexts = 16u;
+// Parallelizable passes use one recording context per this many instances, so small passes aren't split into tiny jobs.
+constexpr uint32_t MinInstancesPerRecordingContext = 64u;
 
 // How many back back buffers the program uses.
 constexpr UINT BackBufferCount = 2u;
@@ -41,6 +44,10 @@ enum RenderPassType : uint32_t
 	DeferredLightingPass,
 	RaytracedAOPass,
 	AccumulationPass,
+	DenoisePass,
+	CompositePass,
+	AOUpsamplePass,
+	AdaptiveSamplingPass,
 
 	NumRenderPasses // Keep this last!
 };
@@ -58,18 +65,73 @@ enum GBufferID : UINT
 // Array of formats for each gbuffer texture.
 constexpr std::array<DXGI_FORMAT, GBufferIDCount> GBufferFormats = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT };
 
+// The AO on its own, which the ray traced AO, denoise and accumulation passes work on and the composite pass multiplies
+// into the lit color. Half floats, as eight bits would round away the small steps of a long accumulated history.
+constexpr DXGI_FORMAT AOTextureFormat = DXGI_FORMAT_R16_FLOAT;
+
+// The accumulation pass ping-pongs between two copies of its textures: every frame reads the history that the frame
+// before wrote. See TemporalReprojection.h.
+constexpr uint32_t AccumulationTextureCount = 2u;
+// Accumulated AO, the history length and the accumulated squared AO, which the adaptive sampling pass gets the variance from.
+constexpr DXGI_FORMAT AccumulationTextureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+// Normal of the surface with its distance to the camera in alpha, which the history is checked against.
+constexpr DXGI_FORMAT ReprojectionTextureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+// The denoise pass ping-pongs the AO and its variance between two textures. See AtrousDenoiser.h.
+constexpr uint32_t DenoiseTextureCount = 2u;
+constexpr DXGI_FORMAT DenoiseTextureFormat = DXGI_FORMAT_R16G16_FLOAT;
+
+// How many AO rays every pixel traces when adaptive sampling is on. See AdaptiveSampling.h.
+constexpr DXGI_FORMAT SampleCountTextureFormat = DXGI_FORMAT_R8_UINT;
+
+// Resources that the render passes declare in the frame graph. The G-buffers are in the same order as GBufferID.
+enum FrameGraphResourceID : uint32_t
+{
+	FrameGraphGBufferDiffuse = 0,
+	FrameGraphGBufferNormal,
+	FrameGraphGBufferWorldPos,
+	FrameGraphMiddleTexture,
+	FrameGraphAOTexture,
+	// The AO traced at a reduced resolution, which the upsample pass rebuilds the AO texture from.
+	FrameGraphAOTraceTexture,
+	FrameGraphSampleCountTexture,
+	// The accumulation and reprojection textures that the frame writes, and the ones with the history of the frame before.
+	FrameGraphAccumulationTexture,
+	FrameGraphAccumulationHistory,
+	FrameGraphReprojectionTexture,
+	FrameGraphReprojectionHistory,
+	FrameGraphDenoiseTexture0,
+	FrameGraphDenoiseTexture1,
+	FrameGraphBackBuffer,
+	FrameGraphTopLevelAS,
+	FrameGraphDepthBuffer,
+
+	FrameGraphResourceCount // Keep last!
+};
+
 // The maximum number of instances that can be rendered in a single draw call.
 constexpr uint32_t MaxRenderInstances = 1024u;
 constexpr uint32_t MaxRTInstancesPerTopLevel = MaxRenderInstances;
 
+// Upload memory that the per frame constants and instance descs of one frame may use. The upload ring holds one frame more
+// than can be in flight, so that the end of the ring that is skipped when wrapping around never makes it run out.
+constexpr uint64_t UploadRingFrameSize = 512u * 1024u;
+constexpr uint64_t UploadRingSize = UploadRingFrameSize * (BackBufferCount + 1);
+
 
 // A enum with all unique global descriptor names.
 enum GlobalDescriptorNames
 {
 	SRVGBuffers,
 	SRVMiddleTexture,
-	UAVMiddleTexture,
+	SRVAOTexture,
+	SRVAOTraceTexture,
+	UAVAOTexture,
+	UAVAOTraceTexture,
+	UAVSampleCountTexture,
 	UAVAccumulationTexture,
+	UAVReprojectionTexture,
+	UAVDenoiseTextures,
 	RTVGBuffers,
 	RTVMiddleTexture,
 	RTVBackBuffers,
@@ -86,16 +148,29 @@ namespace GlobalDescriptors
 	{
 		SRVGBuffersCount			= GBufferIDCount,
 		SRVMiddleTextureCount		= 1,
-		UAVMiddleTextureCount		= 1,
-		UAVAccumulationTextureCount = 1
+		SRVAOTextureCount			= 1,
+		SRVAOTraceTextureCount		= 1,
+		UAVAOTextureCount			= 1,
+		UAVAOTraceTextureCount		= 1,
+		UAVSampleCountTextureCount	= 1,
+		UAVAccumulationTextureCount = AccumulationTextureCount,
+		UAVReprojectionTextureCount = AccumulationTextureCount,
+		UAVDenoiseTexturesCount		= DenoiseTextureCount
 	};
 
 	enum CBVSRVUAVOffsets : uint32_t
 	{
 		SRVGBuffersOffset				= 0,
 		SRVMiddleTextureOffset			= SRVGBuffersOffset				+ SRVGBuffersCount,
-		UAVMiddleTextureOffset			= SRVMiddleTextureOffset		+ SRVMiddleTextureCount,
-		UAVAccumulationTextureOffset	= UAVMiddleTextureOffset		+ UAVMiddleTextureCount
+		SRVAOTextureOffset				= SRVMiddleTextureOffset		+ SRVMiddleTextureCount,
+		SRVAOTraceTextureOffset			= SRVAOTextureOffset			+ SRVAOTextureCount,
+		UAVAOTextureOffset				= SRVAOTraceTextureOffset		+ SRVAOTraceTextureCount,
+		// Follow the AO texture UAV, so the raygen shader binds all three with one table.
+		UAVAOTraceTextureOffset			= UAVAOTextureOffset			+ UAVAOTextureCount,
+		UAVSampleCountTextureOffset		= UAVAOTraceTextureOffset		+ UAVAOTraceTextureCount,
+		UAVAccumulationTextureOffset	= UAVSampleCountTextureOffset	+ UAVSampleCountTextureCount,
+		UAVReprojectionTextureOffset	= UAVAccumulationTextureOffset	+ UAVAccumulationTextureCount,
+		UAVDenoiseTexturesOffset		= UAVReprojectionTextureOffset	+ UAVReprojectionTextureCount
 	};
 
 	enum RTVCounts : UINT
@@ -128,10 +203,16 @@ namespace GlobalDescriptors
 		// SRVs
 		{ SRVGBuffers,				SRVGBuffersCount			},
 		{ SRVMiddleTexture,			SRVMiddleTextureCount		},
+		{ SRVAOTexture,				SRVAOTextureCount			},
+		{ SRVAOTraceTexture,		SRVAOTraceTextureCount		},
 
 		// UAVs
-		{ UAVMiddleTexture,			UAVMiddleTextureCount		},
+		{ UAVAOTexture,				UAVAOTextureCount			},
+		{ UAVAOTraceTexture,		UAVAOTraceTextureCount		},
+		{ UAVSampleCountTexture,	UAVSampleCountTextureCount	},
 		{ UAVAccumulationTexture,	UAVAccumulationTextureCount	},
+		{ UAVReprojectionTexture,	UAVReprojectionTextureCount	},
+		{ UAVDenoiseTextures,		UAVDenoiseTexturesCount		},
 
 		// RTVs
 		{ RTVGBuffers,				RTVGBuffersCount			},
@@ -148,10 +229,16 @@ namespace GlobalDescriptors
 		// SRVs
 		{ SRVGBuffers,				SRVGBuffersOffset				},
 		{ SRVMiddleTexture,			SRVMiddleTextureOffset			},
+		{ SRVAOTexture,				SRVAOTextureOffset				},
+		{ SRVAOTraceTexture,		SRVAOTraceTextureOffset			},
 		
 		// UAVs
-		{ UAVMiddleTexture,			UAVMiddleTextureOffset			},
+		{ UAVAOTexture,				UAVAOTextureOffset				},
+		{ UAVAOTraceTexture,		UAVAOTraceTextureOffset			},
+		{ UAVSampleCountTexture,	UAVSampleCountTextureOffset		},
 		{ UAVAccumulationTexture,	UAVAccumulationTextureOffset	},
+		{ UAVReprojectionTexture,	UAVReprojectionTextureOffset	},
+		{ UAVDenoiseTextures,		UAVDenoiseTexturesOffset		},
 
 		// RTVs
 		{ RTVGBuffers,				RTVGBuffersOffset				},
@@ -183,39 +270,30 @@ namespace GlobalDescriptors
 	}
 }
 
+// The per frame constants are bound as root CBVs from the upload ring and need no descriptors.
 enum FrameDescriptorNames
 {
-	CBVRenderInstance,
-	CBVFrameData,
 	SRVTopLevelAS
 };
 
 namespace FrameDescriptors
 {
-	constexpr uint32_t MaxFrameCBVSRVUAVDescriptors = MaxRenderInstances * 2;
-
 	enum CBVSRVUAVCounts : uint32_t
 	{
-		CBVRenderInstanceCount	= MaxRenderInstances,
-		CBVFrameDataCount		= 1,
 		SRVTLASCount			= 1,
 	};
 
 	enum CBVSRVUAVOffsets : uint32_t
 	{
-		CBVRenderInstanceOffset = 0,
-		CBVFrameDataOffset = CBVRenderInstanceOffset + CBVRenderInstanceCount,
-		SRVTLASOffset = CBVFrameDataOffset + CBVFrameDataCount
+		SRVTLASOffset = 0
 	};
 
+	constexpr uint32_t MaxFrameCBVSRVUAVDescriptors = SRVTLASCount;
+
 
 	// A map that maps the descriptor names to the count of descriptors.
 	static const std::unordered_map<FrameDescriptorNames, uint32_t> DescriptorCountMap = {
 
-		// CBVs
-		{ CBVRenderInstance,	CBVRenderInstanceCount	},
-		{ CBVFrameData,			CBVFrameDataCount		},
-
 		// SRVs
 		{ SRVTopLevelAS,				SRVTLASCount	}
 	};
@@ -224,10 +302,6 @@ namespace FrameDescriptors
 	// A map that maps the descriptor names to the offset of the descriptors.
 	static const std::unordered_map<FrameDescriptorNames, uint32_t> DescriptorOffsetMap = {
 
-		// CBVs
-		{ CBVRenderInstance,	CBVRenderInstanceOffset	},
-		{ CBVFrameData,			CBVFrameDataOffset		},
-
 		// SRVs
 		{ SRVTopLevelAS,				SRVTLASOffset			}
 	};
@@ -252,11 +326,21 @@ struct InstanceConstants
 	DirectX::XMFLOAT4X4 modelMatrix;
 };
 
+// Laid out like the constant buffer in the shaders, where a float3 can't cross a 16 byte boundary.
 struct GlobalFrameData
 {
 	UINT frameCount;
 	UINT accumulatedFrames;
 	float time;
+	// The accumulation and reprojection textures that the frame writes.
+	UINT historyIndex;
+	// The camera of the frame before, which the accumulation pass reprojects the history with.
+	DirectX::XMFLOAT4X4 previousViewProjection;
+	DirectX::XMFLOAT3 cameraPosition;
+	float padding0;
+	DirectX::XMFLOAT3 previousCameraPosition;
+	// Nonzero when the AO was traced with the sample counts of the adaptive sampling pass.
+	UINT adaptiveSampling;
 };
 
 enum class RenderObjectID : uint32_t
@@ -266,22 +350,61 @@ enum class RenderObjectID : uint32_t
 	OBJModel1
 };
 
+// Where the vertex shaders read the constants of the instance they draw.
+enum class InstanceDataMode : uint32_t
+{
+	// Every instance is bound as its own root CBV and drawn with its own draw call.
+	ConstantBuffers = 0,
+	// All instances are in one structured buffer indexed by SV_InstanceID, so each render object is drawn with one
+	// instanced draw per draw arg.
+	StructuredBuffer
+};
+
+constexpr InstanceDataMode ActiveInstanceDataMode = InstanceDataMode::StructuredBuffer;
+
+// Where the instances of the G-buffer pass are culled against the camera frustum.
+enum class InstanceCullingMode : uint32_t
+{
+	None = 0,
+	// The renderer culls the instance store every frame and the pass only draws the visible instances.
+	CPU,
+	// A compute shader culls the instances and the visible ones are drawn with ExecuteIndirect. The shader reads the
+	// instance data as a structured buffer.
+	GPU
+};
+
+// Independent of the instance data mode, except that GPU culling needs the structured buffer.
+constexpr InstanceCullingMode ActiveInstanceCullingMode = InstanceCullingMode::GPU;
+
+constexpr bool UseGPUCulling = ActiveInstanceCullingMode == InstanceCullingMode::GPU;
+static_assert(!UseGPUCulling || ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer, "GPU culling needs the instance data in a structured buffer.");
+
 // The program only supports one raytraced render object at the moment.
 // This is to ensure all parts of the program that uses it uses the same object.
 constexpr RenderObjectID RTRenderObjectID = RenderObjectID::OBJModel1;
 
+// Debug toggle. Moves the first raytraced instance up and down, so its top level acceleration structures are refit every
+// frame instead of skipped, and logs the path they took every TopLevelStatsLogInterval frames.
+constexpr bool AnimateRaytracedInstance = false;
+constexpr UINT TopLevelStatsLogInterval = 600u;
+
 namespace RasterShaderRegisters {
 
 	enum CBVRegisters : uint32_t {
 		CBMatrixConstants		= 0,
 		CBVDescriptorGlobals	= 1,
-		CBVDescriptorRange		= 2
+		CBVInstanceConstants	= 2,
+		CBFirstInstance			= 3
 	};
 
 	enum SRVRegisters : uint32_t {
-		SRVDescriptorRange = 0
+		SRVDescriptorRange = 0,
+		// In its own register space, the descriptor range uses space 0.
+		SRVInstanceData = 0
 	};
 
+	constexpr uint32_t SRVInstanceDataSpace = 1;
+
 	enum UAVRegisters : uint32_t {
 		UAVDescriptorRange = 0
 	};
@@ -309,8 +432,10 @@ enum DefaultRootParameterIdx
 {
 	MatrixIdx = 0,
 	CBVGlobalFrameDataIdx,
-	CBVTableIdx,
+	CBVInstanceIdx,
 	UAVSRVTableIdx,
+	FirstInstanceIdx,
+	SRVInstanceDataIdx,
 
 	DefaultRootParameterCount // Keep last!
 };
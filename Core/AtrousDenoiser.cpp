@@ -0,0 +1,398 @@
+#include "AtrousDenoiser.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include "MathUtils.h"
+#include "ParallelUtils.h"
+#include "SimdUtils.h"
+
+namespace
+{
+	// Rows per task when filtering in parallel.
+	constexpr uint32_t RowsPerTask = 4u;
+
+	// The B3 spline that the taps of every iteration are weighted with.
+	constexpr float AtrousKernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+	constexpr float FalloffScale = 1.0f / 256.0f;
+
+	/*
+		The G-buffer and the AO as planes of floats. Every row is padded to a multiple of the SIMD width and the image has a
+		border wide enough for the widest iteration, so no tap needs a bounds check. The padding has no surface, which gives
+		its taps a weight of zero.
+	*/
+	struct FilterPlanes
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t border = 0;
+		uint32_t stride = 0;
+
+		std::vector<float> normalX;
+		std::vector<float> normalY;
+		std::vector<float> normalZ;
+		std::vector<float> positionX;
+		std::vector<float> positionY;
+		std::vector<float> positionZ;
+		// One where the pixel has a surface, zero elsewhere.
+		std::vector<float> surface;
+
+		// Two of each, which the iterations ping-pong between.
+		std::array<std::vector<float>, 2> ao;
+		std::array<std::vector<float>, 2> variance;
+
+		size_t GetIndex(uint32_t x, uint32_t y) const
+		{
+			return (size_t)(y + border) * stride + border + x;
+		}
+	};
+
+	FilterPlanes CreateFilterPlanes(const RTAOGBuffer& gBuffer, std::span<const float> ao, uint32_t iterationCount)
+	{
+		FilterPlanes planes;
+		planes.width = gBuffer.width;
+		planes.height = gBuffer.height;
+		// Two taps of the widest iteration on either side.
+		planes.border = 2u << (iterationCount - 1);
+		planes.stride = planes.border + (gBuffer.width + SimdFloat8::Width - 1) / SimdFloat8::Width * SimdFloat8::Width + planes.border;
+
+		const size_t planeSize = (size_t)planes.stride * (gBuffer.height + 2 * planes.border);
+		for (std::vector<float>* plane : { &planes.normalX, &planes.normalY, &planes.normalZ, &planes.positionX, &planes.positionY, &planes.positionZ, &planes.surface,
+			&planes.ao[0], &planes.ao[1], &planes.variance[0], &planes.variance[1] })
+		{
+			plane->assign(planeSize, 0.0f);
+		}
+
+		for (uint32_t y = 0; y < gBuffer.height; y++)
+		{
+			for (uint32_t x = 0; x < gBuffer.width; x++)
+			{
+				const size_t pixel = (size_t)y * gBuffer.width + x;
+				const size_t index = planes.GetIndex(x, y);
+
+				planes.ao[0][index] = ao[pixel];
+
+				const DirectX::XMFLOAT4& position = gBuffer.positions[pixel];
+				if (position.w == 0.0f)
+				{
+					continue;
+				}
+
+				const DirectX::XMFLOAT3 normal = MathUtils::Normalize({ gBuffer.normals[pixel].x, gBuffer.normals[pixel].y, gBuffer.normals[pixel].z });
+				planes.normalX[index] = normal.x;
+				planes.normalY[index] = normal.y;
+				planes.normalZ[index] = normal.z;
+				planes.positionX[index] = position.x;
+				planes.positionY[index] = position.y;
+				planes.positionZ[index] = position.z;
+				planes.surface[index] = 1.0f;
+			}
+		}
+
+		return planes;
+	}
+
+	// Same as EstimateVariance() in the shader. Shared by both modes, as it's a small part of the work.
+	void EstimateVariance(FilterPlanes& planes, uint32_t row)
+	{
+		for (uint32_t x = 0; x < planes.width; x++)
+		{
+			const size_t index = planes.GetIndex(x, row);
+			if (planes.surface[index] == 0.0f)
+			{
+				continue;
+			}
+
+			float sum = 0.0f;
+			float sumOfSquares = 0.0f;
+			float count = 0.0f;
+			for (int offsetY = -1; offsetY <= 1; offsetY++)
+			{
+				for (int offsetX = -1; offsetX <= 1; offsetX++)
+				{
+					const size_t tap = index + (ptrdiff_t)offsetY * planes.stride + offsetX;
+					const float surface = planes.surface[tap];
+					const float ao = planes.ao[0][tap];
+					sum += surface * ao;
+					sumOfSquares += surface * ao * ao;
+					count += surface;
+				}
+			}
+
+			const float mean = sum / count;
+			planes.variance[0][index] = std::max(0.0f, sumOfSquares / count - mean * mean);
+		}
+	}
+
+	float RaiseNormalWeight(float cosine)
+	{
+		for (uint32_t power = 1; power < DenoiseNormalPower; power *= 2)
+		{
+			cosine *= cosine;
+		}
+		return cosine;
+	}
+
+	float Falloff(float x)
+	{
+		float base = std::max(0.0f, 1.0f - x * FalloffScale);
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			base *= base;
+		}
+		return base;
+	}
+
+	SimdFloat8 RaiseNormalWeight(SimdFloat8 cosine)
+	{
+		for (uint32_t power = 1; power < DenoiseNormalPower; power *= 2)
+		{
+			cosine = cosine * cosine;
+		}
+		return cosine;
+	}
+
+	SimdFloat8 Falloff(SimdFloat8 x)
+	{
+		SimdFloat8 base = Max(SimdFloat8::Broadcast(0.0f), SimdFloat8::Broadcast(1.0f) - x * SimdFloat8::Broadcast(FalloffScale));
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			base = base * base;
+		}
+		return base;
+	}
+
+	SimdFloat8 Abs(SimdFloat8 x)
+	{
+		return Max(x, SimdFloat8::Broadcast(0.0f) - x);
+	}
+
+	// Same as the iteration in the shader.
+	void FilterRowScalar(FilterPlanes& planes, uint32_t row, uint32_t step, const DenoiseSettings& settings, uint32_t source)
+	{
+		const std::vector<float>& sourceAO = planes.ao[source];
+		const std::vector<float>& sourceVariance = planes.variance[source];
+		std::vector<float>& destAO = planes.ao[source ^ 1];
+		std::vector<float>& destVariance = planes.variance[source ^ 1];
+		const float inversePhiPosition = 1.0f / settings.phiPosition;
+
+		for (uint32_t x = 0; x < planes.width; x++)
+		{
+			const size_t index = planes.GetIndex(x, row);
+			if (planes.surface[index] == 0.0f)
+			{
+				destAO[index] = sourceAO[index];
+				destVariance[index] = sourceVariance[index];
+				continue;
+			}
+
+			const float normalX = planes.normalX[index];
+			const float normalY = planes.normalY[index];
+			const float normalZ = planes.normalZ[index];
+			const float positionX = planes.positionX[index];
+			const float positionY = planes.positionY[index];
+			const float positionZ = planes.positionZ[index];
+			const float ao = sourceAO[index];
+			const float aoScale = 1.0f / (settings.phiColor * std::sqrt(std::max(0.0f, sourceVariance[index])) + DenoiseColorEpsilon);
+
+			float weightSum = 0.0f;
+			float aoSum = 0.0f;
+			float varianceSum = 0.0f;
+			for (int offsetY = -2; offsetY <= 2; offsetY++)
+			{
+				for (int offsetX = -2; offsetX <= 2; offsetX++)
+				{
+					const size_t tap = index + ((ptrdiff_t)offsetY * planes.stride + offsetX) * step;
+
+					const float cosine = std::max(0.0f, normalX * planes.normalX[tap] + normalY * planes.normalY[tap] + normalZ * planes.normalZ[tap]);
+					const float planeDistance = std::abs(
+						normalX * (planes.positionX[tap] - positionX) +
+						normalY * (planes.positionY[tap] - positionY) +
+						normalZ * (planes.positionZ[tap] - positionZ)) * inversePhiPosition;
+					const float aoDistance = std::abs(ao - sourceAO[tap]) * aoScale;
+
+					const float weight = AtrousKernel[offsetX + 2] * AtrousKernel[offsetY + 2] * planes.surface[tap] * RaiseNormalWeight(cosine) * Falloff(planeDistance + aoDistance);
+					weightSum += weight;
+					aoSum += weight * sourceAO[tap];
+					varianceSum += weight * weight * sourceVariance[tap];
+				}
+			}
+
+			destAO[index] = aoSum / weightSum;
+			destVariance[index] = varianceSum / (weightSum * weightSum);
+		}
+	}
+
+	// The same operations as FilterRowScalar() on eight pixels at a time. The padding at the end of the row is filtered as
+	// well and keeps its zeros, since it has no surface.
+	void FilterRowSimd(FilterPlanes& planes, uint32_t row, uint32_t step, const DenoiseSettings& settings, uint32_t source)
+	{
+		const float* sourceAO = planes.ao[source].data();
+		const float* sourceVariance = planes.variance[source].data();
+		float* destAO = planes.ao[source ^ 1].data();
+		float* destVariance = planes.variance[source ^ 1].data();
+
+		const SimdFloat8 zero = SimdFloat8::Broadcast(0.0f);
+		const SimdFloat8 phiColor = SimdFloat8::Broadcast(settings.phiColor);
+		const SimdFloat8 colorEpsilon = SimdFloat8::Broadcast(DenoiseColorEpsilon);
+		const SimdFloat8 inversePhiPosition = SimdFloat8::Broadcast(1.0f / settings.phiPosition);
+
+		for (uint32_t x = 0; x < planes.width; x += SimdFloat8::Width)
+		{
+			const size_t index = planes.GetIndex(x, row);
+
+			const SimdFloat8 normalX = SimdFloat8::Load(&planes.normalX[index]);
+			const SimdFloat8 normalY = SimdFloat8::Load(&planes.normalY[index]);
+			const SimdFloat8 normalZ = SimdFloat8::Load(&planes.normalZ[index]);
+			const SimdFloat8 positionX = SimdFloat8::Load(&planes.positionX[index]);
+			const SimdFloat8 positionY = SimdFloat8::Load(&planes.positionY[index]);
+			const SimdFloat8 positionZ = SimdFloat8::Load(&planes.positionZ[index]);
+			const SimdFloat8 ao = SimdFloat8::Load(sourceAO + index);
+			const SimdFloat8 variance = SimdFloat8::Load(sourceVariance + index);
+			const SimdFloat8 aoScale = SimdFloat8::Broadcast(1.0f) / (phiColor * Sqrt(Max(zero, variance)) + colorEpsilon);
+
+			SimdFloat8 weightSum = zero;
+			SimdFloat8 aoSum = zero;
+			SimdFloat8 varianceSum = zero;
+			for (int offsetY = -2; offsetY <= 2; offsetY++)
+			{
+				for (int offsetX = -2; offsetX <= 2; offsetX++)
+				{
+					const size_t tap = index + ((ptrdiff_t)offsetY * planes.stride + offsetX) * step;
+
+					const SimdFloat8 tapAO = SimdFloat8::Load(sourceAO + tap);
+					const SimdFloat8 cosine = Max(zero, normalX * SimdFloat8::Load(&planes.normalX[tap]) + normalY * SimdFloat8::Load(&planes.normalY[tap]) + normalZ * SimdFloat8::Load(&planes.normalZ[tap]));
+					const SimdFloat8 planeDistance = Abs(
+						normalX * (SimdFloat8::Load(&planes.positionX[tap]) - positionX) +
+						normalY * (SimdFloat8::Load(&planes.positionY[tap]) - positionY) +
+						normalZ * (SimdFloat8::Load(&planes.positionZ[tap]) - positionZ)) * inversePhiPosition;
+					const SimdFloat8 aoDistance = Abs(ao - tapAO) * aoScale;
+
+					const SimdFloat8 weight = SimdFloat8::Broadcast(AtrousKernel[offsetX + 2] * AtrousKernel[offsetY + 2]) * SimdFloat8::Load(&planes.surface[tap]) * RaiseNormalWeight(cosine) * Falloff(planeDistance + aoDistance);
+					weightSum = weightSum + weight;
+					aoSum = aoSum + weight * tapAO;
+					varianceSum = varianceSum + weight * weight * SimdFloat8::Load(sourceVariance + tap);
+				}
+			}
+
+			// Pixels without a surface keep their values. Their weight sum may be zero, which the mask drops.
+			const SimdFloat8 hasSurface = SimdFloat8::Load(&planes.surface[index]) != zero;
+			const SimdFloat8 filteredAO = (aoSum / weightSum) & hasSurface;
+			const SimdFloat8 filteredVariance = (varianceSum / (weightSum * weightSum)) & hasSurface;
+			(filteredAO | AndNot(ao, hasSurface)).Store(destAO + index);
+			(filteredVariance | AndNot(variance, hasSurface)).Store(destVariance + index);
+		}
+	}
+}
+
+DenoiseStats DenoiseAmbientOcclusion(const RTAOGBuffer& gBuffer, std::span<const float> ao, std::vector<float>& denoised, const DenoiseSettings& settings, DenoiseMode mode, uint32_t threadCount)
+{
+	const size_t pixelCount = (size_t)gBuffer.width * gBuffer.height;
+	if (ao.size() != pixelCount)
+	{
+		throw std::runtime_error("The AO doesn't match the size of the G-buffer.");
+	}
+
+	DenoiseStats stats;
+	stats.threadCount = threadCount == 0 ? GetDefaultThreadCount() : threadCount;
+
+	if (settings.iterationCount == 0)
+	{
+		denoised.assign(ao.begin(), ao.end());
+		return stats;
+	}
+
+	FilterPlanes planes = CreateFilterPlanes(gBuffer, ao, settings.iterationCount);
+	const uint32_t taskCount = (gBuffer.height + RowsPerTask - 1) / RowsPerTask;
+
+	const auto filterStart = std::chrono::steady_clock::now();
+
+	ParallelFor(taskCount, [&](uint32_t task)
+	{
+		const uint32_t endY = std::min((task + 1) * RowsPerTask, gBuffer.height);
+		for (uint32_t y = task * RowsPerTask; y < endY; y++)
+		{
+			EstimateVariance(planes, y);
+		}
+	}, stats.threadCount);
+
+	uint32_t source = 0;
+	for (uint32_t iteration = 0; iteration < settings.iterationCount; iteration++)
+	{
+		const uint32_t step = 1u << iteration;
+
+		ParallelFor(taskCount, [&](uint32_t task)
+		{
+			const uint32_t endY = std::min((task + 1) * RowsPerTask, gBuffer.height);
+			for (uint32_t y = task * RowsPerTask; y < endY; y++)
+			{
+				if (mode == DenoiseMode::Simd)
+				{
+					FilterRowSimd(planes, y, step, settings, source);
+				}
+				else
+				{
+					FilterRowScalar(planes, y, step, settings, source);
+				}
+			}
+		}, stats.threadCount);
+
+		source ^= 1;
+	}
+
+	stats.filterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - filterStart).count();
+
+	denoised.resize(pixelCount);
+	for (uint32_t y = 0; y < gBuffer.height; y++)
+	{
+		for (uint32_t x = 0; x < gBuffer.width; x++)
+		{
+			denoised[(size_t)y * gBuffer.width + x] = planes.ao[source][planes.GetIndex(x, y)];
+		}
+	}
+
+	return stats;
+}
+
+std::vector<DenoiseBenchmarkResult> BenchmarkDenoiser(const RTAOGBuffer& gBuffer, std::span<const float> ao, const DenoiseSettings& settings, uint32_t threadCount)
+{
+	std::vector<DenoiseBenchmarkResult> results;
+	std::vector<float> referenceAO;
+	std::vector<float> denoised;
+
+	for (uint32_t mode = 0; mode < (uint32_t)DenoiseMode::Count; mode++)
+	{
+		// Scalar is the first mode, so its result is the reference for the other ones.
+		std::vector<float>& result = (DenoiseMode)mode == DenoiseMode::Scalar ? referenceAO : denoised;
+
+		DenoiseBenchmarkResult benchmarkResult;
+		benchmarkResult.mode = (DenoiseMode)mode;
+		benchmarkResult.stats = DenoiseAmbientOcclusion(gBuffer, ao, result, settings, (DenoiseMode)mode, threadCount);
+		benchmarkResult.maxDifference = 0.0f;
+		for (size_t pixel = 0; pixel < result.size(); pixel++)
+		{
+			benchmarkResult.maxDifference = std::max(benchmarkResult.maxDifference, std::abs(result[pixel] - referenceAO[pixel]));
+		}
+
+		results.push_back(benchmarkResult);
+	}
+
+	return results;
+}
+
+const char* GetDenoiseModeName(DenoiseMode mode)
+{
+	switch (mode)
+	{
+	case DenoiseMode::Scalar:
+		return "Scalar";
+	case DenoiseMode::Simd:
+		return "Simd";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "RTAOReference.h"
+
+/*
+	Edge-aware à-trous wavelet filter for the AO, the CPU version of shaders/DenoiseCS.hlsl.
+
+	The filter first estimates the variance of every pixel from its 3x3 neighborhood. Every iteration then blends each pixel
+	with a sparse 5x5 B3 spline kernel whose taps are 2^iteration pixels apart, so a few iterations cover a wide radius. The
+	weight of a tap is cut down by:
+	- The angle between the normals, as the cosine to the power of DenoiseNormalPower.
+	- The distance of the tap from the plane of the pixel, relative to phiPosition.
+	- The difference of the AO values, relative to phiColor standard deviations of the pixel. Noisy pixels are smoothed
+	  more, while edges of the AO that stand out from the noise are kept.
+	The variance is filtered along with the AO, so later iterations get less aggressive as the noise goes away.
+
+	The falloff of the edge stopping terms is max(0, 1 - x / 256)^256 in place of exp(-x). It only needs multiplies, so the SIMD
+	version of the filter computes the same weights as the scalar one, and the shader uses it as well.
+
+	The GPU stores the AO and the intermediate results in half floats, so its results only differ from these by rounding.
+*/
+
+// Constants from DenoiseCS.hlsl. Keep them in sync with the shader.
+// Applied by squaring the cosine, so it has to be a power of two.
+constexpr uint32_t DenoiseNormalPower = 128u;
+// Keeps the AO weights finite when the variance is zero.
+constexpr float DenoiseColorEpsilon = 0.0001f;
+
+struct DenoiseSettings
+{
+	// Iteration n samples taps 2^n pixels apart. Zero leaves the AO as it is.
+	uint32_t iterationCount = 4;
+	// How many standard deviations of the pixel two AO values may differ by before the tap is cut off.
+	float phiColor = 4.0f;
+	// World distance from the plane of the pixel at which a tap is cut off.
+	float phiPosition = 0.1f;
+};
+
+enum class DenoiseMode
+{
+	// One pixel at a time.
+	Scalar,
+	// Eight pixels of a row at a time, one in each SIMD lane.
+	Simd,
+	Count
+};
+
+struct DenoiseStats
+{
+	uint32_t threadCount = 0;
+	double filterMilliseconds = 0.0;
+};
+
+// Filters the AO of every pixel of the G-buffer. Both modes give the same result, they only differ in speed. Pixels without
+// a surface are copied as they are. Throws if the AO doesn't match the size of the G-buffer.
+DenoiseStats DenoiseAmbientOcclusion(const RTAOGBuffer& gBuffer, std::span<const float> ao, std::vector<float>& denoised, const DenoiseSettings& settings = {}, DenoiseMode mode = DenoiseMode::Simd, uint32_t threadCount = 0);
+
+struct DenoiseBenchmarkResult
+{
+	DenoiseMode mode;
+	DenoiseStats stats;
+	// Largest difference to the Scalar result.
+	float maxDifference;
+};
+
+// Filters the AO with every mode and reports the time each one took.
+std::vector<DenoiseBenchmarkResult> BenchmarkDenoiser(const RTAOGBuffer& gBuffer, std::span<const float> ao, const DenoiseSettings& settings = {}, uint32_t threadCount = 0);
+
+const char* GetDenoiseModeName(DenoiseMode mode);
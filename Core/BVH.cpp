@@ -0,0 +1,610 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+
+#include "MathUtils.h"
+#include "ParallelUtils.h"
+
+namespace
+{
+	// Primitives per task when computing the primitive bounds in parallel.
+	constexpr uint32_t PrimitiveBatchSize = 16u * 1024u;
+	// Subtrees per thread that are built in parallel. More subtrees balance better.
+	constexpr uint32_t SubtreesPerThread = 4u;
+
+	struct BuildPrimitive
+	{
+		BoundingBox bounds;
+		DirectX::XMFLOAT3 centroid;
+	};
+
+	struct Bin
+	{
+		BoundingBox bounds;
+		uint32_t count;
+	};
+
+	struct NodeTask
+	{
+		uint32_t nodeIndex;
+		uint32_t begin;
+		uint32_t end;
+		uint32_t depth;
+	};
+
+	float GetComponent(const DirectX::XMFLOAT3& v, uint32_t axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	BoundingBox EmptyBounds()
+	{
+		constexpr float inf = std::numeric_limits<float>::infinity();
+		return { { inf, inf, inf }, { -inf, -inf, -inf } };
+	}
+
+	void Grow(BoundingBox& bounds, const DirectX::XMFLOAT3& point)
+	{
+		bounds.min = { std::min(bounds.min.x, point.x), std::min(bounds.min.y, point.y), std::min(bounds.min.z, point.z) };
+		bounds.max = { std::max(bounds.max.x, point.x), std::max(bounds.max.y, point.y), std::max(bounds.max.z, point.z) };
+	}
+
+	void Grow(BoundingBox& bounds, const BoundingBox& other)
+	{
+		Grow(bounds, other.min);
+		Grow(bounds, other.max);
+	}
+
+	float SurfaceArea(const BoundingBox& bounds)
+	{
+		const float x = bounds.max.x - bounds.min.x;
+		const float y = bounds.max.y - bounds.min.y;
+		const float z = bounds.max.z - bounds.min.z;
+		return (x < 0.0f || y < 0.0f || z < 0.0f) ? 0.0f : 2.0f * (x * y + y * z + z * x);
+	}
+
+	DirectX::XMFLOAT3 ReadPosition(const BVHGeometryDesc& desc, uint32_t vertexIndex)
+	{
+		DirectX::XMFLOAT3 position;
+		memcpy(&position, static_cast<const uint8_t*>(desc.vertexData) + (size_t)desc.vertexStride * vertexIndex, sizeof(position));
+		return position;
+	}
+
+	uint32_t ReadIndex(const BVHGeometryDesc& desc, uint32_t i)
+	{
+		if (desc.indexData == nullptr)
+		{
+			return i;
+		}
+
+		if (desc.indexFormat == DXGI_FORMAT_R16_UINT)
+		{
+			return static_cast<const uint16_t*>(desc.indexData)[i];
+		}
+
+		return static_cast<const uint32_t*>(desc.indexData)[i];
+	}
+
+	// Recursive top down builder working on a shared array of primitive indices. Disjoint ranges can be built concurrently.
+	class BVHBuilder
+	{
+	public:
+		BVHBuilder(const BVHBuildSettings& settings, std::span<const BuildPrimitive> primitives, std::vector<uint32_t>& primitiveOrder) :
+			m_settings(settings),
+			m_primitives(primitives),
+			m_primitiveOrder(primitiveOrder)
+		{
+		}
+
+		// Sets the bounds of the node and either makes it a leaf or appends its two children.
+		// Returns false if the node became a leaf.
+		bool SplitNode(std::vector<BVHNode>& nodes, const NodeTask& task, NodeTask& leftTask, NodeTask& rightTask) const
+		{
+			const uint32_t count = task.end - task.begin;
+
+			BoundingBox bounds = EmptyBounds();
+			BoundingBox centroidBounds = EmptyBounds();
+			for (uint32_t i = task.begin; i < task.end; i++)
+			{
+				const BuildPrimitive& primitive = m_primitives[m_primitiveOrder[i]];
+				Grow(bounds, primitive.bounds);
+				Grow(centroidBounds, primitive.centroid);
+			}
+
+			nodes[task.nodeIndex].boundsMin = bounds.min;
+			nodes[task.nodeIndex].boundsMax = bounds.max;
+
+			// Nodes at the maximum depth become leaves so that the traversal stack can't overflow.
+			uint32_t split = task.begin;
+			if (count > 1 && task.depth + 1 < MaxBVHDepth)
+			{
+				split = FindAndPartition(task.begin, task.end, bounds, centroidBounds);
+			}
+
+			if (split == task.begin)
+			{
+				nodes[task.nodeIndex].leftOrFirst = task.begin;
+				nodes[task.nodeIndex].primitiveCount = count;
+				return false;
+			}
+
+			const uint32_t leftIndex = (uint32_t)nodes.size();
+			nodes.push_back({});
+			nodes.push_back({});
+
+			nodes[task.nodeIndex].leftOrFirst = leftIndex;
+			nodes[task.nodeIndex].primitiveCount = 0;
+
+			leftTask = { leftIndex, task.begin, split, task.depth + 1 };
+			rightTask = { leftIndex + 1, split, task.end, task.depth + 1 };
+			return true;
+		}
+
+		// Builds the full subtree below the root of the given node array. Returns the maximum depth.
+		uint32_t BuildSubtree(std::vector<BVHNode>& nodes, const NodeTask& rootTask) const
+		{
+			uint32_t maxDepth = rootTask.depth;
+
+			std::vector<NodeTask> stack = { rootTask };
+			while (!stack.empty())
+			{
+				const NodeTask task = stack.back();
+				stack.pop_back();
+				maxDepth = std::max(maxDepth, task.depth);
+
+				NodeTask leftTask, rightTask;
+				if (SplitNode(nodes, task, leftTask, rightTask))
+				{
+					stack.push_back(rightTask);
+					stack.push_back(leftTask);
+				}
+			}
+
+			return maxDepth;
+		}
+
+	private:
+		// Returns the first primitive of the right child, or begin if the node should be a leaf.
+		uint32_t FindAndPartition(uint32_t begin, uint32_t end, const BoundingBox& bounds, const BoundingBox& centroidBounds) const
+		{
+			const uint32_t count = end - begin;
+			const uint32_t binCount = m_settings.binCount;
+
+			float bestCost = std::numeric_limits<float>::infinity();
+			uint32_t bestAxis = 0;
+			uint32_t bestBin = 0;
+
+			std::vector<Bin> bins(binCount);
+			std::vector<float> rightAreas(binCount);
+			std::vector<uint32_t> rightCounts(binCount);
+
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float axisMin = GetComponent(centroidBounds.min, axis);
+				const float axisExtent = GetComponent(centroidBounds.max, axis) - axisMin;
+				if (axisExtent <= 0.0f)
+				{
+					continue;
+				}
+
+				std::fill(bins.begin(), bins.end(), Bin{ EmptyBounds(), 0 });
+
+				const float binScale = binCount / axisExtent;
+				for (uint32_t i = begin; i < end; i++)
+				{
+					const BuildPrimitive& primitive = m_primitives[m_primitiveOrder[i]];
+					Bin& bin = bins[GetBin(primitive.centroid, axis, axisMin, binScale)];
+					Grow(bin.bounds, primitive.bounds);
+					bin.count++;
+				}
+
+				// Sweep from the right to get the cost of every right side, then from the left to evaluate the splits.
+				BoundingBox rightBounds = EmptyBounds();
+				uint32_t rightCount = 0;
+				for (uint32_t i = binCount - 1; i > 0; i--)
+				{
+					Grow(rightBounds, bins[i].bounds);
+					rightCount += bins[i].count;
+					rightAreas[i] = SurfaceArea(rightBounds);
+					rightCounts[i] = rightCount;
+				}
+
+				BoundingBox leftBounds = EmptyBounds();
+				uint32_t leftCount = 0;
+				for (uint32_t i = 1; i < binCount; i++)
+				{
+					Grow(leftBounds, bins[i - 1].bounds);
+					leftCount += bins[i - 1].count;
+					if (leftCount == 0 || rightCounts[i] == 0)
+					{
+						continue;
+					}
+
+					const float cost = SurfaceArea(leftBounds) * leftCount + rightAreas[i] * rightCounts[i];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = i;
+					}
+				}
+			}
+
+			const float nodeArea = SurfaceArea(bounds);
+			const float splitCost = m_settings.traversalCost + m_settings.intersectionCost * bestCost / std::max(nodeArea, std::numeric_limits<float>::min());
+			const float leafCost = m_settings.intersectionCost * count;
+
+			if (count <= m_settings.maxLeafSize && splitCost >= leafCost)
+			{
+				return begin;
+			}
+
+			if (bestCost == std::numeric_limits<float>::infinity())
+			{
+				// All centroids are in the same spot, any split is as good as another.
+				return begin + count / 2;
+			}
+
+			const float axisMin = GetComponent(centroidBounds.min, bestAxis);
+			const float binScale = binCount / (GetComponent(centroidBounds.max, bestAxis) - axisMin);
+
+			auto middle = std::partition(m_primitiveOrder.begin() + begin, m_primitiveOrder.begin() + end, [&](uint32_t primitiveIndex)
+			{
+				return GetBin(m_primitives[primitiveIndex].centroid, bestAxis, axisMin, binScale) < bestBin;
+			});
+
+			return (uint32_t)(middle - m_primitiveOrder.begin());
+		}
+
+		uint32_t GetBin(const DirectX::XMFLOAT3& centroid, uint32_t axis, float axisMin, float binScale) const
+		{
+			const uint32_t bin = (uint32_t)((GetComponent(centroid, axis) - axisMin) * binScale);
+			return std::min(bin, m_settings.binCount - 1);
+		}
+
+	private:
+		const BVHBuildSettings& m_settings;
+		std::span<const BuildPrimitive> m_primitives;
+		std::vector<uint32_t>& m_primitiveOrder;
+	};
+
+	// Builds the node hierarchy over the primitives and fills in the node related stats.
+	void BuildHierarchy(std::span<const BuildPrimitive> primitives, const BVHBuildSettings& settings, uint32_t threadCount, std::vector<BVHNode>& nodes, std::vector<uint32_t>& primitiveOrder, BVHStats& stats)
+	{
+		const uint32_t primitiveCount = (uint32_t)primitives.size();
+
+		primitiveOrder.resize(primitiveCount);
+		for (uint32_t i = 0; i < primitiveCount; i++)
+		{
+			primitiveOrder[i] = i;
+		}
+
+		BVHBuilder builder(settings, primitives, primitiveOrder);
+
+		// Split the upper levels on this thread until the subtrees are small enough to balance over all threads.
+		const uint32_t subtreeSize = threadCount > 1 ? std::max(settings.maxLeafSize, primitiveCount / (threadCount * SubtreesPerThread)) : primitiveCount;
+
+		nodes.reserve(2 * (size_t)primitiveCount);
+		nodes.push_back({});
+
+		std::vector<NodeTask> subtreeTasks;
+		std::deque<NodeTask> pendingTasks = { { 0, 0, primitiveCount, 0 } };
+		while (!pendingTasks.empty())
+		{
+			const NodeTask task = pendingTasks.front();
+			pendingTasks.pop_front();
+
+			if (task.end - task.begin <= subtreeSize)
+			{
+				subtreeTasks.push_back(task);
+				continue;
+			}
+
+			stats.maxDepth = std::max(stats.maxDepth, task.depth);
+
+			NodeTask leftTask, rightTask;
+			if (builder.SplitNode(nodes, task, leftTask, rightTask))
+			{
+				pendingTasks.push_back(leftTask);
+				pendingTasks.push_back(rightTask);
+			}
+		}
+
+		// Build every subtree into its own node array, with its root at index 0.
+		std::vector<std::vector<BVHNode>> subtreeNodes(subtreeTasks.size());
+		std::vector<uint32_t> subtreeDepths(subtreeTasks.size());
+
+		ParallelFor((uint32_t)subtreeTasks.size(), [&](uint32_t subtree)
+		{
+			NodeTask rootTask = subtreeTasks[subtree];
+			rootTask.nodeIndex = 0;
+
+			subtreeNodes[subtree].push_back({});
+			subtreeDepths[subtree] = builder.BuildSubtree(subtreeNodes[subtree], rootTask);
+		}, threadCount);
+
+		// Stitch the subtrees into the final array. The root replaces the node it was built for and the rest is appended.
+		for (size_t subtree = 0; subtree < subtreeTasks.size(); subtree++)
+		{
+			const std::vector<BVHNode>& localNodes = subtreeNodes[subtree];
+			const uint32_t base = (uint32_t)nodes.size() - 1;
+
+			for (size_t i = 0; i < localNodes.size(); i++)
+			{
+				BVHNode node = localNodes[i];
+				if (!node.IsLeaf())
+				{
+					node.leftOrFirst += base;
+				}
+
+				if (i == 0)
+				{
+					nodes[subtreeTasks[subtree].nodeIndex] = node;
+				}
+				else
+				{
+					nodes.push_back(node);
+				}
+			}
+
+			stats.maxDepth = std::max(stats.maxDepth, subtreeDepths[subtree]);
+		}
+
+		// Surface area heuristic cost of the final tree.
+		const float rootArea = SurfaceArea({ nodes[0].boundsMin, nodes[0].boundsMax });
+		const float inverseRootArea = rootArea > 0.0f ? 1.0f / rootArea : 0.0f;
+		for (const BVHNode& node : nodes)
+		{
+			const float relativeArea = SurfaceArea({ node.boundsMin, node.boundsMax }) * inverseRootArea;
+			if (node.IsLeaf())
+			{
+				stats.sahCost += settings.intersectionCost * node.primitiveCount * relativeArea;
+				stats.leafCount++;
+			}
+			else
+			{
+				stats.sahCost += settings.traversalCost * relativeArea;
+			}
+		}
+
+		stats.nodeCount = (uint32_t)nodes.size();
+	}
+}
+
+void BVH::Build(const BVHGeometryDesc& geometryDesc, const BVHBuildSettings& settings)
+{
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	if (geometryDesc.vertexFormat != DXGI_FORMAT_R32G32B32_FLOAT)
+	{
+		throw std::runtime_error("BVH only supports DXGI_FORMAT_R32G32B32_FLOAT vertices.");
+	}
+
+	if (geometryDesc.indexData != nullptr && geometryDesc.indexFormat != DXGI_FORMAT_R32_UINT && geometryDesc.indexFormat != DXGI_FORMAT_R16_UINT)
+	{
+		throw std::runtime_error("BVH only supports 16 and 32 bit indices.");
+	}
+
+	if (settings.binCount < 2 || settings.maxLeafSize == 0)
+	{
+		throw std::runtime_error("Invalid BVH build settings.");
+	}
+
+	const uint32_t threadCount = settings.threadCount == 0 ? GetDefaultThreadCount() : settings.threadCount;
+	const uint32_t triangleCount = (geometryDesc.indexData != nullptr ? geometryDesc.indexCount : geometryDesc.vertexCount) / 3;
+
+	m_nodes.clear();
+	m_triangles.clear();
+	m_primitiveIndices.clear();
+	m_stats = {};
+	m_stats.triangleCount = triangleCount;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Fetch the triangles and their bounds.
+	std::vector<BVHTriangle> sourceTriangles(triangleCount);
+	std::vector<BuildPrimitive> primitives(triangleCount);
+	std::vector<uint8_t> hasInvalidIndex((triangleCount + PrimitiveBatchSize - 1) / PrimitiveBatchSize, 0);
+
+	ParallelFor((uint32_t)hasInvalidIndex.size(), [&](uint32_t batch)
+	{
+		const uint32_t begin = batch * PrimitiveBatchSize;
+		const uint32_t end = std::min(begin + PrimitiveBatchSize, triangleCount);
+		for (uint32_t t = begin; t < end; t++)
+		{
+			// Exceptions can't leave the worker threads, so out of range indices are reported afterwards.
+			const uint32_t i0 = ReadIndex(geometryDesc, 3 * t + 0);
+			const uint32_t i1 = ReadIndex(geometryDesc, 3 * t + 1);
+			const uint32_t i2 = ReadIndex(geometryDesc, 3 * t + 2);
+			if (std::max({ i0, i1, i2 }) >= geometryDesc.vertexCount)
+			{
+				hasInvalidIndex[batch] = 1;
+				continue;
+			}
+
+			BVHTriangle& triangle = sourceTriangles[t];
+			triangle = { ReadPosition(geometryDesc, i0), ReadPosition(geometryDesc, i1), ReadPosition(geometryDesc, i2) };
+
+			BuildPrimitive& primitive = primitives[t];
+			primitive.bounds = EmptyBounds();
+			Grow(primitive.bounds, triangle.v0);
+			Grow(primitive.bounds, triangle.v1);
+			Grow(primitive.bounds, triangle.v2);
+			primitive.centroid = {
+				(primitive.bounds.min.x + primitive.bounds.max.x) * 0.5f,
+				(primitive.bounds.min.y + primitive.bounds.max.y) * 0.5f,
+				(primitive.bounds.min.z + primitive.bounds.max.z) * 0.5f
+			};
+		}
+	}, threadCount);
+
+	if (std::find(hasInvalidIndex.begin(), hasInvalidIndex.end(), 1) != hasInvalidIndex.end())
+	{
+		throw std::runtime_error("BVH geometry references a vertex out of range.");
+	}
+
+	BuildHierarchy(primitives, settings, threadCount, m_nodes, m_primitiveIndices, m_stats);
+
+	// Store the triangles in leaf order so that leaves reference contiguous ranges.
+	m_triangles.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		m_triangles[i] = sourceTriangles[m_primitiveIndices[i]];
+	}
+
+	m_stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+}
+
+void BVH::BuildFromBounds(std::span<const BoundingBox> bounds, const BVHBuildSettings& settings)
+{
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	if (settings.binCount < 2 || settings.maxLeafSize == 0)
+	{
+		throw std::runtime_error("Invalid BVH build settings.");
+	}
+
+	m_nodes.clear();
+	m_triangles.clear();
+	m_primitiveIndices.clear();
+	m_stats = {};
+
+	if (bounds.empty())
+	{
+		return;
+	}
+
+	std::vector<BuildPrimitive> primitives(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		primitives[i].bounds = bounds[i];
+		primitives[i].centroid = {
+			(bounds[i].min.x + bounds[i].max.x) * 0.5f,
+			(bounds[i].min.y + bounds[i].max.y) * 0.5f,
+			(bounds[i].min.z + bounds[i].max.z) * 0.5f
+		};
+	}
+
+	const uint32_t threadCount = settings.threadCount == 0 ? GetDefaultThreadCount() : settings.threadCount;
+	BuildHierarchy(primitives, settings, threadCount, m_nodes, m_primitiveIndices, m_stats);
+
+	m_stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+}
+
+bool BVH::IntersectAny(const BVHRay& ray) const
+{
+	bool isHit = false;
+	Traverse(ray, [&](uint32_t leafPrimitive, float& tMax)
+	{
+		float t;
+		if (IntersectTriangle(ray, m_triangles[leafPrimitive], tMax, t))
+		{
+			isHit = true;
+			return true;
+		}
+
+		return false;
+	});
+
+	return isHit;
+}
+
+bool BVH::IntersectClosest(const BVHRay& ray, BVHHit& hit) const
+{
+	bool isHit = false;
+	Traverse(ray, [&](uint32_t leafPrimitive, float& tMax)
+	{
+		float t;
+		if (IntersectTriangle(ray, m_triangles[leafPrimitive], tMax, t))
+		{
+			tMax = t;
+			hit.t = t;
+			hit.primitiveIndex = m_primitiveIndices[leafPrimitive];
+			hit.leafPrimitive = leafPrimitive;
+			isHit = true;
+		}
+
+		return false;
+	});
+
+	return isHit;
+}
+
+std::span<const BVHNode> BVH::GetNodes() const
+{
+	return m_nodes;
+}
+
+std::span<const BVHTriangle> BVH::GetTriangles() const
+{
+	return m_triangles;
+}
+
+std::span<const uint32_t> BVH::GetPrimitiveIndices() const
+{
+	return m_primitiveIndices;
+}
+
+const BVHStats& BVH::GetStats() const
+{
+	return m_stats;
+}
+
+bool IntersectTriangle(const BVHRay& ray, const BVHTriangle& triangle, float tMax, float& t)
+{
+	using namespace MathUtils;
+
+	// Moller-Trumbore without backface culling, since the BLAS geometry isn't culled either.
+	const DirectX::XMFLOAT3 edge1 = Subtract(triangle.v1, triangle.v0);
+	const DirectX::XMFLOAT3 edge2 = Subtract(triangle.v2, triangle.v0);
+	const DirectX::XMFLOAT3 p = Cross(ray.direction, edge2);
+	const float determinant = Dot(edge1, p);
+	if (determinant == 0.0f)
+	{
+		return false;
+	}
+
+	const float inverseDeterminant = 1.0f / determinant;
+	const DirectX::XMFLOAT3 toOrigin = Subtract(ray.origin, triangle.v0);
+	const float u = Dot(toOrigin, p) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	const DirectX::XMFLOAT3 q = Cross(toOrigin, edge1);
+	const float v = Dot(ray.direction, q) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	t = Dot(edge2, q) * inverseDeterminant;
+	return t >= ray.tMin && t <= tMax;
+}
+
+BVHGeometryDesc CreateBVHGeometryDesc(std::span<const Vertex> vertices, std::span<const VertexIndex> indices)
+{
+	BVHGeometryDesc desc;
+	desc.vertexData = vertices.data();
+	desc.vertexStride = sizeof(Vertex);
+	desc.vertexCount = (UINT)vertices.size();
+	desc.vertexFormat = Vertex::sVertexFormat;
+
+	if (!indices.empty())
+	{
+		desc.indexData = indices.data();
+		desc.indexCount = (UINT)indices.size();
+		desc.indexFormat = sizeof(VertexIndex) == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+
+	return desc;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "PlatformIncludes.h"
+#include "SceneTypes.h"
+
+/*
+	CPU reference bounding volume hierarchy over a triangle mesh.
+
+	The builder takes the same inputs as the D3D12_RAYTRACING_GEOMETRY_DESC that is used for the bottom level acceleration
+	structure, which makes it possible to reason about acceleration structure quality and cost without a GPU. The tree is
+	built top down with a binned surface area heuristic. The upper levels are split on the calling thread until there are
+	enough independent subtrees, which are then built in parallel.
+
+	The same tree can also be built over bounding boxes, which is used for the instances of a top level structure.
+*/
+
+// Deeper nodes are turned into leaves, which bounds the traversal stack.
+constexpr uint32_t MaxBVHDepth = 64u;
+
+// CPU side equivalent of D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC.
+struct BVHGeometryDesc
+{
+	const void* vertexData = nullptr;
+	UINT vertexStride = 0;
+	UINT vertexCount = 0;
+	DXGI_FORMAT vertexFormat = DXGI_FORMAT_UNKNOWN;
+
+	// Null for non indexed geometry.
+	const void* indexData = nullptr;
+	UINT indexCount = 0;
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_UNKNOWN;
+};
+
+// 32 byte node. Leaves have a primitiveCount above zero and reference a range of triangles, inner nodes have their two
+// children next to each other starting at leftOrFirst.
+struct BVHNode
+{
+	DirectX::XMFLOAT3 boundsMin;
+	uint32_t leftOrFirst;
+	DirectX::XMFLOAT3 boundsMax;
+	uint32_t primitiveCount;
+
+	bool IsLeaf() const { return primitiveCount > 0; }
+};
+
+struct BVHTriangle
+{
+	DirectX::XMFLOAT3 v0;
+	DirectX::XMFLOAT3 v1;
+	DirectX::XMFLOAT3 v2;
+};
+
+struct BVHRay
+{
+	DirectX::XMFLOAT3 origin;
+	float tMin;
+	DirectX::XMFLOAT3 direction;
+	float tMax;
+};
+
+struct BVHHit
+{
+	float t;
+	// Index in the source geometry, the same value as PrimitiveIndex() in a hit shader.
+	uint32_t primitiveIndex;
+	// Index into GetTriangles().
+	uint32_t leafPrimitive;
+};
+
+struct BVHBuildSettings
+{
+	uint32_t binCount = 16u;
+	uint32_t maxLeafSize = 4u;
+	// Number of threads to use. Zero means one thread per core.
+	uint32_t threadCount = 0u;
+
+	float traversalCost = 1.0f;
+	float intersectionCost = 1.0f;
+};
+
+struct BVHStats
+{
+	uint32_t triangleCount = 0;
+	uint32_t nodeCount = 0;
+	uint32_t leafCount = 0;
+	uint32_t maxDepth = 0;
+	// Expected cost of a random ray hitting the root, using the costs from the build settings.
+	float sahCost = 0.0f;
+	double buildMilliseconds = 0.0;
+};
+
+class BVH
+{
+public:
+	// Builds the tree. Throws a runtime error for vertex or index formats that the BLAS path doesn't use.
+	void Build(const BVHGeometryDesc& geometryDesc, const BVHBuildSettings& settings = {});
+	// Builds the tree over arbitrary bounding boxes. There are no triangles afterwards, only primitive indices.
+	void BuildFromBounds(std::span<const BoundingBox> bounds, const BVHBuildSettings& settings = {});
+
+	// True if any triangle is hit within [tMin, tMax]. Matches RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH on opaque geometry.
+	bool IntersectAny(const BVHRay& ray) const;
+	// Finds the closest triangle hit within [tMin, tMax]. Returns false on a miss.
+	bool IntersectClosest(const BVHRay& ray, BVHHit& hit) const;
+
+	// Visits the leaves overlapped by the ray front to back. The visitor is called as visitor(leafPrimitive, tMax) for every
+	// primitive of a visited leaf, may shorten tMax, and returns true to end the traversal.
+	template <typename Visitor>
+	void Traverse(const BVHRay& ray, const Visitor& visitor) const;
+
+	std::span<const BVHNode> GetNodes() const;
+	// Triangles in leaf order.
+	std::span<const BVHTriangle> GetTriangles() const;
+	// Index of each triangle in the source geometry, the same value as PrimitiveIndex() in a hit shader.
+	std::span<const uint32_t> GetPrimitiveIndices() const;
+
+	const BVHStats& GetStats() const;
+
+private:
+	std::vector<BVHNode> m_nodes;
+	std::vector<BVHTriangle> m_triangles;
+	std::vector<uint32_t> m_primitiveIndices;
+	BVHStats m_stats;
+};
+
+bool IntersectTriangle(const BVHRay& ray, const BVHTriangle& triangle, float tMax, float& t);
+
+// Slab test. Returns the entry distance, or infinity if the box is missed.
+inline float IntersectBounds(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& inverseDirection, float tMin, float tMax)
+{
+	const float tx0 = (boundsMin.x - origin.x) * inverseDirection.x;
+	const float tx1 = (boundsMax.x - origin.x) * inverseDirection.x;
+	const float ty0 = (boundsMin.y - origin.y) * inverseDirection.y;
+	const float ty1 = (boundsMax.y - origin.y) * inverseDirection.y;
+	const float tz0 = (boundsMin.z - origin.z) * inverseDirection.z;
+	const float tz1 = (boundsMax.z - origin.z) * inverseDirection.z;
+
+	const float tNear = std::max({ std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), tMin });
+	const float tFar = std::min({ std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1), tMax });
+
+	return tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+}
+
+template <typename Visitor>
+void BVH::Traverse(const BVHRay& ray, const Visitor& visitor) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	const DirectX::XMFLOAT3 inverseDirection = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+	float tMax = ray.tMax;
+
+	if (IntersectBounds(m_nodes[0].boundsMin, m_nodes[0].boundsMax, ray.origin, inverseDirection, ray.tMin, tMax) == std::numeric_limits<float>::infinity())
+	{
+		return;
+	}
+
+	uint32_t stack[MaxBVHDepth];
+	uint32_t stackSize = 0;
+	uint32_t nodeIndex = 0;
+
+	while (true)
+	{
+		const BVHNode& node = m_nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.primitiveCount; i++)
+			{
+				if (visitor(i, tMax))
+				{
+					return;
+				}
+			}
+		}
+		else
+		{
+			// Visit the closer child first and push the other one.
+			const uint32_t left = node.leftOrFirst;
+			const float tLeft = IntersectBounds(m_nodes[left].boundsMin, m_nodes[left].boundsMax, ray.origin, inverseDirection, ray.tMin, tMax);
+			const float tRight = IntersectBounds(m_nodes[left + 1].boundsMin, m_nodes[left + 1].boundsMax, ray.origin, inverseDirection, ray.tMin, tMax);
+
+			const bool isLeftHit = tLeft != std::numeric_limits<float>::infinity();
+			const bool isRightHit = tRight != std::numeric_limits<float>::infinity();
+			if (isLeftHit && isRightHit)
+			{
+				nodeIndex = tLeft <= tRight ? left : left + 1;
+				stack[stackSize++] = tLeft <= tRight ? left + 1 : left;
+				continue;
+			}
+			else if (isLeftHit || isRightHit)
+			{
+				nodeIndex = isLeftHit ? left : left + 1;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+		{
+			return;
+		}
+
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+// Describes the geometry the same way DX12Renderer::CreateBottomLevelAccelerationStructure() does.
+BVHGeometryDesc CreateBVHGeometryDesc(std::span<const Vertex> vertices, std::span<const VertexIndex> indices);
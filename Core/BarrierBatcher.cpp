@@ -0,0 +1,344 @@
+#include "BarrierBatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	constexpr uint32_t AllSubresources = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+	bool OverlapsSubresource(uint32_t subresource, uint32_t otherSubresource)
+	{
+		return subresource == otherSubresource || subresource == AllSubresources || otherSubresource == AllSubresources;
+	}
+
+	D3D12_RESOURCE_BARRIER CreateTransitionBarrier(ID3D12Resource* resource, uint32_t subresource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter, D3D12_RESOURCE_BARRIER_FLAGS flags)
+	{
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = flags;
+		barrier.Transition = { resource, subresource, stateBefore, stateAfter };
+		return barrier;
+	}
+
+	D3D12_RESOURCE_BARRIER CreateUAVBarrier(ID3D12Resource* resource)
+	{
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+		barrier.UAV.pResource = resource;
+		return barrier;
+	}
+}
+
+void BarrierBatcher::Track(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresourceCount)
+{
+	if (subresourceCount == 0)
+	{
+		throw std::runtime_error("A tracked resource needs at least one subresource.");
+	}
+
+	const auto isSplit = [resource](const SplitTransition& split) { return split.resource == resource; };
+	if (std::any_of(m_splitTransitions.begin(), m_splitTransitions.end(), isSplit))
+	{
+		throw std::runtime_error("Can't reset the state of a resource with a split transition in flight.");
+	}
+
+	m_states[resource].assign(subresourceCount, state);
+}
+
+bool BarrierBatcher::IsTracked(ID3D12Resource* resource) const
+{
+	return m_states.find(resource) != m_states.end();
+}
+
+D3D12_RESOURCE_STATES BarrierBatcher::GetState(ID3D12Resource* resource, uint32_t subresource) const
+{
+	const auto it = m_states.find(resource);
+	if (it == m_states.end())
+	{
+		throw std::runtime_error("The resource isn't tracked by the barrier batcher.");
+	}
+
+	const std::vector<D3D12_RESOURCE_STATES>& states = it->second;
+	if (subresource != AllSubresources)
+	{
+		return states.at(subresource);
+	}
+
+	if (std::any_of(states.begin(), states.end(), [&](D3D12_RESOURCE_STATES state) { return state != states[0]; }))
+	{
+		throw std::runtime_error("The subresources of the resource are in different states.");
+	}
+	return states[0];
+}
+
+void BarrierBatcher::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresource)
+{
+	m_stats.requestedCount++;
+	const bool endedSplit = EndSplitTransitions(resource, subresource);
+	if (!TransitionSubresources(resource, state, subresource, D3D12_RESOURCE_BARRIER_FLAG_NONE) && !endedSplit)
+	{
+		m_stats.skippedCount++;
+	}
+}
+
+void BarrierBatcher::BeginTransition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresource)
+{
+	m_stats.requestedCount++;
+	EndSplitTransitions(resource, subresource);
+	if (!TransitionSubresources(resource, state, subresource, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY))
+	{
+		m_stats.skippedCount++;
+	}
+}
+
+void BarrierBatcher::UAV(ID3D12Resource* resource)
+{
+	m_stats.requestedCount++;
+	if (resource != nullptr)
+	{
+		EndSplitTransitions(resource, AllSubresources);
+	}
+
+	m_pendingBarriers.push_back({ CreateUAVBarrier(resource), false });
+}
+
+void BarrierBatcher::Aliasing(ID3D12Resource* resourceBefore, ID3D12Resource* resourceAfter)
+{
+	m_stats.requestedCount++;
+	if (resourceBefore != nullptr)
+	{
+		EndSplitTransitions(resourceBefore, AllSubresources);
+	}
+	if (resourceAfter != nullptr)
+	{
+		EndSplitTransitions(resourceAfter, AllSubresources);
+	}
+
+	D3D12_RESOURCE_BARRIER barrier = {};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+	barrier.Aliasing = { resourceBefore, resourceAfter };
+	m_pendingBarriers.push_back({ barrier, false });
+}
+
+bool BarrierBatcher::HasPendingBarriers() const
+{
+	return std::any_of(m_pendingBarriers.begin(), m_pendingBarriers.end(), [](const PendingBarrier& pending) { return !pending.isCancelled; });
+}
+
+bool BarrierBatcher::HasSplitTransitions() const
+{
+	return !m_splitTransitions.empty();
+}
+
+void BarrierBatcher::EndSplitTransitions()
+{
+	for (const SplitTransition& split : m_splitTransitions)
+	{
+		AddTransition(split.resource, split.subresource, split.stateBefore, split.stateAfter, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+	}
+	m_splitTransitions.clear();
+}
+
+const BarrierBatcherStats& BarrierBatcher::GetStats() const
+{
+	return m_stats;
+}
+
+std::vector<D3D12_RESOURCE_STATES>& BarrierBatcher::GetSubresourceStates(ID3D12Resource* resource)
+{
+	const auto it = m_states.find(resource);
+	if (it == m_states.end())
+	{
+		throw std::runtime_error("The resource isn't tracked by the barrier batcher.");
+	}
+	return it->second;
+}
+
+bool BarrierBatcher::TransitionSubresources(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresource, D3D12_RESOURCE_BARRIER_FLAGS flags)
+{
+	std::vector<D3D12_RESOURCE_STATES>& states = GetSubresourceStates(resource);
+
+	// A single barrier for the whole resource if that's possible, one for each subresource that differs otherwise.
+	const bool isUniform = std::all_of(states.begin(), states.end(), [&](D3D12_RESOURCE_STATES other) { return other == states[0]; });
+	if (subresource == AllSubresources && !isUniform)
+	{
+		bool hasTransition = false;
+		for (uint32_t i = 0; i < (uint32_t)states.size(); i++)
+		{
+			hasTransition |= TransitionSubresources(resource, state, i, flags);
+		}
+		return hasTransition;
+	}
+
+	D3D12_RESOURCE_STATES& currentState = subresource == AllSubresources ? states[0] : states.at(subresource);
+	if (currentState == state)
+	{
+		return false;
+	}
+
+	AddTransition(resource, subresource, currentState, state, flags);
+	if (flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY)
+	{
+		m_splitTransitions.push_back({ resource, subresource, currentState, state });
+		m_stats.splitCount++;
+	}
+
+	if (subresource == AllSubresources)
+	{
+		std::fill(states.begin(), states.end(), state);
+	}
+	else
+	{
+		currentState = state;
+	}
+	return true;
+}
+
+void BarrierBatcher::AddTransition(ID3D12Resource* resource, uint32_t subresource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter, D3D12_RESOURCE_BARRIER_FLAGS flags)
+{
+	// Merge with the latest pending barrier that touches the same subresources, if it's a plain transition of exactly them.
+	for (size_t i = m_pendingBarriers.size(); flags == D3D12_RESOURCE_BARRIER_FLAG_NONE && i-- > 0;)
+	{
+		PendingBarrier& pending = m_pendingBarriers[i];
+		D3D12_RESOURCE_BARRIER& barrier = pending.barrier;
+		if (pending.isCancelled || barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+		{
+			continue;
+		}
+
+		if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING)
+		{
+			// Changes which resource owns the memory, nothing may move across it.
+			const D3D12_RESOURCE_ALIASING_BARRIER& aliasing = barrier.Aliasing;
+			if (aliasing.pResourceBefore == nullptr || aliasing.pResourceBefore == resource || aliasing.pResourceAfter == resource)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if (barrier.Transition.pResource != resource || !OverlapsSubresource(barrier.Transition.Subresource, subresource))
+		{
+			continue;
+		}
+
+		if (barrier.Transition.Subresource != subresource || barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE)
+		{
+			break;
+		}
+
+		barrier.Transition.StateAfter = stateAfter;
+		if (barrier.Transition.StateBefore != stateAfter)
+		{
+			m_stats.mergedCount++;
+		}
+		else if (stateAfter == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+		{
+			barrier = CreateUAVBarrier(resource);
+			m_stats.cancelledCount++;
+		}
+		else
+		{
+			pending.isCancelled = true;
+			m_stats.cancelledCount++;
+		}
+		return;
+	}
+
+	m_pendingBarriers.push_back({ CreateTransitionBarrier(resource, subresource, stateBefore, stateAfter, flags), false });
+}
+
+bool BarrierBatcher::EndSplitTransitions(ID3D12Resource* resource, uint32_t subresource)
+{
+	bool hasEnded = false;
+	for (size_t i = 0; i < m_splitTransitions.size();)
+	{
+		const SplitTransition split = m_splitTransitions[i];
+		if (split.resource == resource && OverlapsSubresource(split.subresource, subresource))
+		{
+			AddTransition(split.resource, split.subresource, split.stateBefore, split.stateAfter, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+			m_splitTransitions.erase(m_splitTransitions.begin() + i);
+			hasEnded = true;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return hasEnded;
+}
+
+const std::vector<D3D12_RESOURCE_BARRIER>& BarrierBatcher::ResolvePendingBarriers()
+{
+	m_resolvedBarriers.clear();
+
+	// Subresources whose earlier unordered accesses are already ordered by a barrier of this batch. A UAV barrier covers the
+	// whole resource, so it can only be dropped once every subresource is ordered.
+	std::vector<std::pair<ID3D12Resource*, uint32_t>> orderedSubresources;
+	bool hasGlobalUAVBarrier = false;
+
+	const auto isOrdered = [&](ID3D12Resource* resource, uint32_t subresource)
+	{
+		return std::find(orderedSubresources.begin(), orderedSubresources.end(), std::make_pair(resource, subresource)) != orderedSubresources.end();
+	};
+
+	const auto isResourceOrdered = [&](ID3D12Resource* resource)
+	{
+		if (isOrdered(resource, AllSubresources))
+		{
+			return true;
+		}
+
+		const auto it = m_states.find(resource);
+		if (it == m_states.end())
+		{
+			return false;
+		}
+		for (uint32_t subresource = 0; subresource < (uint32_t)it->second.size(); subresource++)
+		{
+			if (!isOrdered(resource, subresource))
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	for (const PendingBarrier& pending : m_pendingBarriers)
+	{
+		if (pending.isCancelled)
+		{
+			continue;
+		}
+
+		const D3D12_RESOURCE_BARRIER& barrier = pending.barrier;
+		if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+		{
+			ID3D12Resource* resource = barrier.UAV.pResource;
+			if (hasGlobalUAVBarrier || (resource != nullptr && isResourceOrdered(resource)))
+			{
+				m_stats.skippedCount++;
+				continue;
+			}
+
+			if (resource == nullptr)
+			{
+				hasGlobalUAVBarrier = true;
+			}
+			else
+			{
+				orderedSubresources.push_back({ resource, AllSubresources });
+			}
+		}
+		else if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY)
+		{
+			orderedSubresources.push_back({ barrier.Transition.pResource, barrier.Transition.Subresource });
+		}
+
+		m_resolvedBarriers.push_back(barrier);
+	}
+
+	return m_resolvedBarriers;
+}
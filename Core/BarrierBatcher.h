@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "PlatformIncludes.h"
+
+/*
+	Collects the resource barriers of one command list and records them with a single ResourceBarrier() call, right before
+	the next draw, dispatch or copy.
+
+	The batcher tracks the state of every subresource, so a transition only needs the state it goes to. Since no GPU work
+	happens between barriers of the same batch:
+	- Transitions to the state a subresource already is in are dropped.
+	- Consecutive transitions of the same subresource are merged, and a round trip back to the original state cancels out.
+	  A round trip through a UAV state is replaced by a UAV barrier, since it still has to order the unordered accesses.
+	- UAV barriers of a resource whose subresources all have a transition or UAV barrier in the batch are dropped.
+
+	Split barriers are started with BeginTransition() and ended by the next Transition() of the subresource, which lets the
+	GPU do the transition while the work in between runs. Both halves have to be recorded to the same command list.
+
+	Flush() only needs a ResourceBarrier() member, so any recording mock can stand in for the command list.
+*/
+
+struct BarrierBatcherStats
+{
+	// Transitions, UAV and aliasing barriers asked for.
+	uint32_t requestedCount = 0;
+	// Barriers passed to ResourceBarrier().
+	uint32_t recordedCount = 0;
+	// ResourceBarrier() calls.
+	uint32_t flushCount = 0;
+	// Transitions to the current state and redundant UAV barriers.
+	uint32_t skippedCount = 0;
+	// Transitions that were merged into an earlier transition of the same batch.
+	uint32_t mergedCount = 0;
+	// Transitions that undid an earlier transition of the same batch.
+	uint32_t cancelledCount = 0;
+	uint32_t splitCount = 0;
+};
+
+class BarrierBatcher
+{
+public:
+	// Starts tracking a resource with every subresource in the given state, or sets the state of a tracked resource. Throws
+	// if the resource has a split transition in flight.
+	void Track(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresourceCount = 1);
+	bool IsTracked(ID3D12Resource* resource) const;
+	// State after the pending barriers. For all subresources, throws if they are in different states.
+	D3D12_RESOURCE_STATES GetState(ID3D12Resource* resource, uint32_t subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) const;
+
+	// The resource has to be tracked. Transitioning all subresources when they are in different states adds one transition
+	// per subresource that isn't in the state yet.
+	void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	// Starts a split transition. The subresource may not be used until Transition() to the same state ends it.
+	void BeginTransition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	// A null resource orders the unordered accesses of every resource.
+	void UAV(ID3D12Resource* resource);
+	void Aliasing(ID3D12Resource* resourceBefore, ID3D12Resource* resourceAfter);
+
+	bool HasPendingBarriers() const;
+	bool HasSplitTransitions() const;
+	// Ends every split transition that is still in flight, which has to happen before the command list is closed.
+	void EndSplitTransitions();
+
+	// Records the pending barriers with one call, if there are any.
+	template <typename CommandList>
+	void Flush(CommandList* commandList)
+	{
+		const std::vector<D3D12_RESOURCE_BARRIER>& barriers = ResolvePendingBarriers();
+		if (!barriers.empty())
+		{
+			commandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+			m_stats.recordedCount += (uint32_t)barriers.size();
+			m_stats.flushCount++;
+		}
+		m_pendingBarriers.clear();
+	}
+
+	const BarrierBatcherStats& GetStats() const;
+
+private:
+	struct PendingBarrier
+	{
+		D3D12_RESOURCE_BARRIER barrier;
+		bool isCancelled;
+	};
+
+	struct SplitTransition
+	{
+		ID3D12Resource* resource;
+		uint32_t subresource;
+		D3D12_RESOURCE_STATES stateBefore;
+		D3D12_RESOURCE_STATES stateAfter;
+	};
+
+	std::vector<D3D12_RESOURCE_STATES>& GetSubresourceStates(ID3D12Resource* resource);
+	// Returns false if the subresources already are in the state.
+	bool TransitionSubresources(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t subresource, D3D12_RESOURCE_BARRIER_FLAGS flags);
+	void AddTransition(ID3D12Resource* resource, uint32_t subresource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter, D3D12_RESOURCE_BARRIER_FLAGS flags);
+	// Ends the split transitions that overlap the subresource. Returns false if there were none.
+	bool EndSplitTransitions(ID3D12Resource* resource, uint32_t subresource);
+	const std::vector<D3D12_RESOURCE_BARRIER>& ResolvePendingBarriers();
+
+	std::unordered_map<ID3D12Resource*, std::vector<D3D12_RESOURCE_STATES>> m_states;
+	std::vector<PendingBarrier> m_pendingBarriers;
+	std::vector<SplitTransition> m_splitTransitions;
+	std::vector<D3D12_RESOURCE_BARRIER> m_resolvedBarriers;
+	BarrierBatcherStats m_stats;
+};
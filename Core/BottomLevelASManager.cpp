@@ -0,0 +1,214 @@
+#include "BottomLevelASManager.h"
+
+#include <stdexcept>
+
+#include "GraphicsErrorHandling.h"
+#include "DX12AbstractionUtils.h"
+
+using DX12Abstractions::GPUResource;
+
+typedef D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC CompactedSizeDesc;
+
+BottomLevelASManager::BottomLevelASManager(ComPtr<ID3D12Device5> device, const BottomLevelBuildPolicy& policy, UINT maxAccelerationStructureCount)
+	: m_device(device), m_policy(policy), m_maxAccelerationStructureCount(maxAccelerationStructureCount)
+{
+	if (!m_policy.allowCompaction)
+	{
+		return;
+	}
+
+	const UINT64 postbuildInfoSize = sizeof(CompactedSizeDesc) * maxAccelerationStructureCount;
+
+	m_postbuildInfo = DX12Abstractions::CreateResource(
+		m_device,
+		CD3DX12_RESOURCE_DESC::Buffer(postbuildInfoSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_HEAP_TYPE_DEFAULT
+	);
+	NAME_D3D12_OBJECT_MEMBER(m_postbuildInfo, BottomLevelASManager);
+
+	m_postbuildInfoReadback = DX12Abstractions::CreateResource(
+		m_device,
+		CD3DX12_RESOURCE_DESC::Buffer(postbuildInfoSize),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_HEAP_TYPE_READBACK
+	);
+	NAME_D3D12_OBJECT_MEMBER(m_postbuildInfoReadback, BottomLevelASManager);
+}
+
+void BottomLevelASManager::Build(RenderObjectID renderObjectID, const std::string& name, std::span<const D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescs, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	if (m_entriesByID.contains(renderObjectID))
+	{
+		throw std::runtime_error("The render object already has a bottom level acceleration structure.");
+	}
+	if (m_buildOrder.size() >= m_maxAccelerationStructureCount)
+	{
+		throw std::runtime_error("Too many bottom level acceleration structures for the manager.");
+	}
+
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+	inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+	inputs.Flags = GetBottomLevelBuildFlags(m_policy);
+	inputs.NumDescs = (UINT)geometryDescs.size();
+	inputs.pGeometryDescs = geometryDescs.data();
+	inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+	m_device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+
+	Entry& entry = m_entriesByID[renderObjectID];
+	entry.postbuildInfoIndex = (UINT)m_buildOrder.size();
+	entry.stats.name = name;
+	entry.stats.originalBytes = info.ResultDataMaxSizeInBytes;
+	entry.stats.scratchBytes = GetBottomLevelScratchBytes(m_policy, info);
+	m_buildOrder.push_back(renderObjectID);
+
+	entry.buffers.scratch = DX12Abstractions::CreateResource(
+		m_device,
+		CD3DX12_RESOURCE_DESC::Buffer(entry.stats.scratchBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_HEAP_TYPE_DEFAULT
+	);
+	NAME_D3D12_OBJECT_MEMBER(entry.buffers.scratch, BottomLevelASManager);
+
+	entry.buffers.result = DX12Abstractions::CreateResource(
+		m_device,
+		CD3DX12_RESOURCE_DESC::Buffer(info.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
+		D3D12_HEAP_TYPE_DEFAULT
+	);
+	NAME_D3D12_OBJECT_MEMBER(entry.buffers.result, BottomLevelASManager);
+
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC asDesc = {};
+	asDesc.Inputs = inputs;
+	asDesc.DestAccelerationStructureData = entry.buffers.result.resource->GetGPUVirtualAddress();
+	asDesc.ScratchAccelerationStructureData = entry.buffers.scratch.resource->GetGPUVirtualAddress();
+
+	// The build writes the compacted size itself, so no extra pass over the acceleration structure is needed.
+	if (m_policy.allowCompaction)
+	{
+		const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildInfoDesc = {
+			.DestBuffer = m_postbuildInfo.resource->GetGPUVirtualAddress() + entry.postbuildInfoIndex * sizeof(CompactedSizeDesc),
+			.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE
+		};
+		commandList->BuildRaytracingAccelerationStructure(&asDesc, 1, &postbuildInfoDesc);
+	}
+	else
+	{
+		commandList->BuildRaytracingAccelerationStructure(&asDesc, 0, nullptr);
+	}
+}
+
+void BottomLevelASManager::RecordCompactedSizeReadback(ComPtr<ID3D12GraphicsCommandList4> commandList, BarrierBatcher& barrierBatcher)
+{
+	if (!m_policy.allowCompaction || m_buildOrder.empty())
+	{
+		return;
+	}
+
+	m_postbuildInfo.TransitionTo(D3D12_RESOURCE_STATE_COPY_SOURCE, barrierBatcher);
+	barrierBatcher.Flush(commandList.Get());
+
+	commandList->CopyBufferRegion(m_postbuildInfoReadback.Get(), 0, m_postbuildInfo.Get(), 0, sizeof(CompactedSizeDesc) * m_buildOrder.size());
+}
+
+void BottomLevelASManager::RecordCompaction(ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	if (!m_policy.allowCompaction || m_buildOrder.empty())
+	{
+		return;
+	}
+
+	const CD3DX12_RANGE readRange(0, sizeof(CompactedSizeDesc) * m_buildOrder.size());
+	CompactedSizeDesc* compactedSizes = nullptr;
+	m_postbuildInfoReadback.resource->Map(0, &readRange, reinterpret_cast<void**>(&compactedSizes)) >> CHK_HR;
+
+	for (RenderObjectID renderObjectID : m_buildOrder)
+	{
+		Entry& entry = GetEntry(renderObjectID);
+		const UINT64 compactedSize = compactedSizes[entry.postbuildInfoIndex].CompactedSizeInBytes;
+
+		entry.compacted = DX12Abstractions::CreateResource(
+			m_device,
+			CD3DX12_RESOURCE_DESC::Buffer(compactedSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
+			D3D12_HEAP_TYPE_DEFAULT
+		);
+		NAME_D3D12_OBJECT_MEMBER(entry.compacted, BottomLevelASManager);
+		entry.stats.compactedBytes = compactedSize;
+
+		commandList->CopyRaytracingAccelerationStructure(
+			entry.compacted.resource->GetGPUVirtualAddress(),
+			entry.buffers.result.resource->GetGPUVirtualAddress(),
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT
+		);
+	}
+
+	const CD3DX12_RANGE writtenRange(0, 0);
+	m_postbuildInfoReadback.resource->Unmap(0, &writtenRange);
+}
+
+void BottomLevelASManager::ReleaseBuildMemory()
+{
+	for (RenderObjectID renderObjectID : m_buildOrder)
+	{
+		Entry& entry = GetEntry(renderObjectID);
+
+		if (entry.compacted.resource)
+		{
+			entry.buffers.result = entry.compacted;
+			entry.compacted = GPUResource();
+		}
+
+		// Updates would need the scratch memory again.
+		if (!m_policy.allowUpdate)
+		{
+			entry.buffers.scratch = GPUResource();
+			entry.stats.isScratchReleased = true;
+		}
+	}
+
+	m_postbuildInfo = GPUResource();
+	m_postbuildInfoReadback = GPUResource();
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS BottomLevelASManager::GetAddress(RenderObjectID renderObjectID) const
+{
+	return GetEntry(renderObjectID).buffers.result.resource->GetGPUVirtualAddress();
+}
+
+const BottomLevelBuildPolicy& BottomLevelASManager::GetPolicy() const
+{
+	return m_policy;
+}
+
+std::vector<BottomLevelASStats> BottomLevelASManager::GetStats() const
+{
+	std::vector<BottomLevelASStats> stats;
+	for (RenderObjectID renderObjectID : m_buildOrder)
+	{
+		stats.push_back(GetEntry(renderObjectID).stats);
+	}
+	return stats;
+}
+
+BottomLevelASManager::Entry& BottomLevelASManager::GetEntry(RenderObjectID renderObjectID)
+{
+	const auto it = m_entriesByID.find(renderObjectID);
+	if (it == m_entriesByID.end())
+	{
+		throw std::runtime_error("The render object has no bottom level acceleration structure.");
+	}
+	return it->second;
+}
+
+const BottomLevelASManager::Entry& BottomLevelASManager::GetEntry(RenderObjectID renderObjectID) const
+{
+	const auto it = m_entriesByID.find(renderObjectID);
+	if (it == m_entriesByID.end())
+	{
+		throw std::runtime_error("The render object has no bottom level acceleration structure.");
+	}
+	return it->second;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DirectXIncludes.h"
+#include "AccelerationStructurePolicy.h"
+#include "AppDefines.h"
+#include "DXRAbstractions.h"
+#include "GPUResource.h"
+
+using Microsoft::WRL::ComPtr;
+
+/*
+	Builds and owns the bottom level acceleration structures.
+
+	With compaction, the acceleration structures are ready after three steps that each need the GPU work of the step before
+	it to be finished:
+	1. Build() records the builds, which also write the compacted sizes, and RecordCompactedSizeReadback() copies the sizes
+	   to the CPU.
+	2. RecordCompaction() creates buffers of the compacted sizes and records the copies into them.
+	3. ReleaseBuildMemory() releases the original buffers and the scratch memory.
+	Without compaction only the scratch memory is released in the last step, unless the policy allows updates.
+*/
+class BottomLevelASManager
+{
+public:
+	BottomLevelASManager(ComPtr<ID3D12Device5> device, const BottomLevelBuildPolicy& policy, UINT maxAccelerationStructureCount);
+
+	void Build(RenderObjectID renderObjectID, const std::string& name, std::span<const D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescs, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	// Queues the barrier of the sizes into the caller's batch, which is flushed right before the copy.
+	void RecordCompactedSizeReadback(ComPtr<ID3D12GraphicsCommandList4> commandList, BarrierBatcher& barrierBatcher);
+	void RecordCompaction(ComPtr<ID3D12GraphicsCommandList4> commandList);
+	void ReleaseBuildMemory();
+
+	// Throws if the render object has no acceleration structure.
+	D3D12_GPU_VIRTUAL_ADDRESS GetAddress(RenderObjectID renderObjectID) const;
+	const BottomLevelBuildPolicy& GetPolicy() const;
+	std::vector<BottomLevelASStats> GetStats() const;
+
+private:
+	struct Entry
+	{
+		DX12Abstractions::AccelerationStructureBuffers buffers;
+		// Replaces the result once the compaction has been recorded.
+		DX12Abstractions::GPUResource compacted;
+		// Slot of the compacted size in the postbuild info buffers.
+		UINT postbuildInfoIndex;
+		BottomLevelASStats stats;
+	};
+
+	Entry& GetEntry(RenderObjectID renderObjectID);
+	const Entry& GetEntry(RenderObjectID renderObjectID) const;
+
+private:
+	ComPtr<ID3D12Device5> m_device;
+	BottomLevelBuildPolicy m_policy;
+	UINT m_maxAccelerationStructureCount;
+
+	std::unordered_map<RenderObjectID, Entry> m_entriesByID;
+	// In build order, so the stats come out in a stable order.
+	std::vector<RenderObjectID> m_buildOrder;
+
+	// The builds write the compacted sizes here, and they are copied to the readback buffer for the CPU.
+	DX12Abstractions::GPUResource m_postbuildInfo;
+	DX12Abstractions::GPUResource m_postbuildInfoReadback;
+};
@@ -43,6 +43,11 @@ DirectX::XMMATRIX Camera::GetViewProjectionMatrix() const
 	return m_data.viewProjectionMatrix;
 }
 
+DirectX::XMVECTOR Camera::GetPosition() const
+{
+	return m_position;
+}
+
 void Camera::SetPosAndDir(std::array<float, 3> pos, std::array<float, 3> dir)
 {
 	m_position = dx::XMVectorSet(pos[0], pos[1], pos[2], 1.0f);
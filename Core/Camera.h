@@ -31,6 +31,11 @@ struct CameraData
 	DirectX::XMMATRIX viewProjectionMatrix;
 };
 
+/*
+	Renderer camera. It is part of the Core executable rather than RTAOCore only because it is written against the
+	DirectXMath SIMD types, which the non-Windows build doesn't have, see PlatformIncludes.h. CPU code that needs the
+	camera transforms builds them with the scalar MathUtils helpers instead, see CreateTemporalCamera().
+*/
 class Camera
 {
 public:
@@ -44,6 +49,7 @@ public:
 	DirectX::XMMATRIX GetViewMatrix() const;
 	DirectX::XMMATRIX GetProjectionMatrix() const;
 	DirectX::XMMATRIX GetViewProjectionMatrix() const;
+	DirectX::XMVECTOR GetPosition() const;
 
 	void SetPosAndDir(std::array<float, 3> pos, std::array<float, 3> dir);
 	void SetPosAndLookAt(std::array<float, 3> pos, std::array<float, 3> dir);
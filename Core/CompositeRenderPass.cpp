@@ -0,0 +1,78 @@
+#include "CompositeRenderPass.h"
+
+CompositeRenderPass::CompositeRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig)
+	: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_DIRECT, false)
+{
+	struct CompositePipelineStateStream
+	{
+		CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE RootSignature;
+		CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimtiveTopology;
+		CD3DX12_PIPELINE_STATE_STREAM_VS VS;
+		CD3DX12_PIPELINE_STATE_STREAM_PS PS;
+		CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+		CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
+	} compositePipelineStateStream;
+
+	ComPtr<ID3DBlob> vsBlob;
+	D3DReadFileToBlob(L"../FullScreenQuadVS.cso", &vsBlob) >> CHK_HR;
+
+	ComPtr<ID3DBlob> psBlob;
+	D3DReadFileToBlob(L"../CompositePS.cso", &psBlob) >> CHK_HR;
+
+	compositePipelineStateStream.RootSignature = rootSig.Get();
+	compositePipelineStateStream.PrimtiveTopology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	compositePipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
+	compositePipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(psBlob.Get());
+	compositePipelineStateStream.RTVFormats = { { BackBufferFormat }, 1 };
+	compositePipelineStateStream.DSVFormat = DXGI_FORMAT_UNKNOWN;
+
+	const D3D12_PIPELINE_STATE_STREAM_DESC pipelineStateStreamDesc = {
+			.SizeInBytes = sizeof(CompositePipelineStateStream),
+			.pPipelineStateSubobjectStream = &compositePipelineStateStream
+	};
+
+	device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_pipelineState)) >> CHK_HR;
+
+	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, CompositeRenderPass);
+}
+
+void CompositeRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Read(graphPass, FrameGraphMiddleTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	frameGraph.Read(graphPass, FrameGraphAOTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	frameGraph.Write(graphPass, FrameGraphBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+}
+
+void CompositeRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
+{
+	assert(pipelineArgs != nullptr);
+	const CompositeRenderPassArgs& args = ToSpecificArgs<CompositeRenderPassArgs>(pipelineArgs);
+
+	auto commandList = GetCommandList(context, frameIndex);
+
+	SetCommonStates(args.commonArgs, m_pipelineState, commandList);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->OMSetRenderTargets(1, &args.RTV, TRUE, nullptr);
+
+	// Set the descriptor table for SRVs and UAVs
+	auto descHeapHandleBase = CD3DX12_GPU_DESCRIPTOR_HANDLE(
+		args.commonArgs.cbvSrvUavHeapGlobal->GetGPUDescriptorHandleForHeapStart(),
+		GlobalDescriptors::GetDescriptorOffset(SRVGBuffers),
+		args.commonArgs.cbvSrvUavDescSize
+	);
+
+	commandList->SetGraphicsRootDescriptorTable(DefaultRootParameterIdx::UAVSRVTableIdx, descHeapHandleBase);
+
+	FlushBarriers(context, frameIndex);
+	commandList->DrawInstanced(6, 1, 0, 0);
+}
+
+void CompositeRenderPass::PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
+
+void CompositeRenderPass::PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
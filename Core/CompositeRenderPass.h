@@ -0,0 +1,17 @@
+#pragma once 
+
+#include "DX12RenderPass.h"
+
+// Multiplies the AO texture into the lit color of the middle texture and writes the result to the back buffer.
+class CompositeRenderPass : public DX12RenderPass
+{
+public:
+	CompositeRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
+
+	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
+
+protected:
+	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+	void PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+};
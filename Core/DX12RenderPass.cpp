@@ -3,16 +3,28 @@
 #include "GraphicsErrorHandling.h"
 #include "DX12AbstractionUtils.h"
 
+#include <algorithm>
+
 
 DX12RenderPass::DX12RenderPass(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE commandType, bool parallelizable) 
-	: m_pipelineState(nullptr), m_renderableObjects({}), m_parallelizable(parallelizable)
+	: m_pipelineState(nullptr), m_renderableObjects({}), m_parallelizable(parallelizable), m_commandType(commandType), m_activeContextCounts({})
+{
+}
+
+void DX12RenderPass::CreateCommandLists(ComPtr<ID3D12Device5> device, UINT maxContextCount)
 {
+	const UINT contextCount = m_parallelizable ? std::max(maxContextCount, 1u) : 1u;
+
 	for (UINT bb = 0; bb < commandLists.size(); bb++)
 	{
-		for (UINT i = 0; i < NumContexts; i++)
+		commandAllocators[bb].resize(contextCount);
+		commandLists[bb].resize(contextCount);
+		m_barrierBatchers[bb].resize(contextCount);
+
+		for (UINT i = 0; i < contextCount; i++)
 		{
 			device->CreateCommandAllocator(
-				commandType,
+				m_commandType,
 				IID_PPV_ARGS(&commandAllocators[bb][i])
 			) >> CHK_HR;
 
@@ -20,7 +32,7 @@ DX12RenderPass::DX12RenderPass(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_
 
 			device->CreateCommandList(
 				0,
-				commandType,
+				m_commandType,
 				commandAllocators[bb][i].Get(),
 				m_pipelineState.Get(),
 				IID_PPV_ARGS(&commandLists[bb][i])
@@ -33,24 +45,50 @@ DX12RenderPass::DX12RenderPass(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_
 	}
 }
 
-void DX12RenderPass::Init(UINT frameIndex)
+UINT DX12RenderPass::PrepareContexts(UINT frameIndex, const std::vector<RenderPackage>& renderPackages)
 {
-	// Reset the command lists and allocators.
-	for (UINT i = 0; i < NumContexts; i++)
+	UINT instanceCount = 0;
+	for (const RenderPackage& renderPackage : renderPackages)
 	{
-		commandAllocators[frameIndex][i]->Reset() >> CHK_HR;
-		commandLists[frameIndex][i]->Reset(commandAllocators[frameIndex][i].Get(), m_pipelineState.Get()) >> CHK_HR;
+		if (renderPackage.visibleInstances)
+		{
+			instanceCount += (UINT)renderPackage.visibleInstances->size();
+		}
+		else if (renderPackage.renderInstances)
+		{
+			instanceCount += (UINT)renderPackage.renderInstances->size();
+		}
 	}
+
+	// Small passes aren't split, the cost of an extra job and command list would outweigh the recording work.
+	const UINT wantedContextCount = std::max(instanceCount / MinInstancesPerRecordingContext, 1u);
+	m_activeContextCounts[frameIndex] = std::min(wantedContextCount, (UINT)commandLists[frameIndex].size());
+
+	return m_activeContextCounts[frameIndex];
 }
 
-void DX12RenderPass::Close(UINT frameIndex, UINT context)
+UINT DX12RenderPass::GetActiveContextCount(UINT frameIndex) const
 {
-	commandLists[frameIndex][context]->Close() >> CHK_HR;
+	return m_activeContextCounts[frameIndex];
 }
 
-bool DX12RenderPass::IsContextAllowedToBuild(const UINT context) const
+void DX12RenderPass::Init(UINT frameIndex, UINT context)
 {
-	return m_parallelizable || context == 0;
+	// Reset the command list and allocator.
+	commandAllocators[frameIndex][context]->Reset() >> CHK_HR;
+	commandLists[frameIndex][context]->Reset(commandAllocators[frameIndex][context].Get(), m_pipelineState.Get()) >> CHK_HR;
+
+	// The states of the previous recording are stale, the frame graph tracks the resources again.
+	m_barrierBatchers[frameIndex][context] = BarrierBatcher();
+}
+
+void DX12RenderPass::Close(UINT frameIndex, UINT context)
+{
+	BarrierBatcher& barrierBatcher = m_barrierBatchers[frameIndex][context];
+	barrierBatcher.EndSplitTransitions();
+	barrierBatcher.Flush(commandLists[frameIndex][context].Get());
+
+	commandLists[frameIndex][context]->Close() >> CHK_HR;
 }
 
 const std::vector<RenderObjectID>& DX12RenderPass::GetRenderableObjects() const
@@ -58,6 +96,11 @@ const std::vector<RenderObjectID>& DX12RenderPass::GetRenderableObjects() const
 	return m_renderableObjects;
 }
 
+FrameGraphQueue DX12RenderPass::GetQueue() const
+{
+	return m_commandType == D3D12_COMMAND_LIST_TYPE_COMPUTE ? FrameGraphQueue::Compute : FrameGraphQueue::Direct;
+}
+
 ComPtr<ID3D12GraphicsCommandList4> DX12RenderPass::GetCommandList(UINT context, UINT frameIndex)
 {
 	return commandLists[frameIndex][context];
@@ -68,9 +111,29 @@ ComPtr<ID3D12GraphicsCommandList4> DX12RenderPass::GetFirstCommandList(UINT fram
 	return commandLists[frameIndex][0];
 }
 
-ComPtr<ID3D12GraphicsCommandList4> DX12RenderPass::GetLastCommandList(UINT frameIndex)
+BarrierBatcher& DX12RenderPass::GetBarrierBatcher(UINT context, UINT frameIndex)
+{
+	return m_barrierBatchers[frameIndex][context];
+}
+
+void DX12RenderPass::FlushBarriers(UINT context, UINT frameIndex)
+{
+	m_barrierBatchers[frameIndex][context].Flush(commandLists[frameIndex][context].Get());
+}
+
+bool DX12RenderPass::HasPrologue() const
+{
+	return false;
+}
+
+void DX12RenderPass::RecordPrologue(const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
-	return commandLists[frameIndex][NumContexts - 1];
+}
+
+std::pair<UINT, UINT> DX12RenderPass::GetContextRange(UINT context, UINT frameIndex, UINT itemCount) const
+{
+	const UINT contextCount = m_activeContextCounts[frameIndex];
+	return { (UINT)((uint64_t)itemCount * context / contextCount), (UINT)((uint64_t)itemCount * (context + 1) / contextCount) };
 }
 
 void SetCommonStates(CommonRenderPassArgs commonArgs, ComPtr<ID3D12PipelineState> pipelineState, ComPtr<ID3D12GraphicsCommandList4> commandList)
@@ -99,11 +162,19 @@ void SetCommonStates(CommonRenderPassArgs commonArgs, ComPtr<ID3D12PipelineState
 
 	commandList->SetGraphicsRootConstantBufferView(
 		DefaultRootParameterIdx::CBVGlobalFrameDataIdx,
-		commonArgs.globalFrameDataResource->GetGPUVirtualAddress()
+		commonArgs.globalFrameDataAddress
 	);
+
+	if constexpr (ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer)
+	{
+		commandList->SetGraphicsRootShaderResourceView(
+			DefaultRootParameterIdx::SRVInstanceDataIdx,
+			commonArgs.instanceConstantsAddress
+		);
+	}
 }
 
-void DrawInstanceIndexed(UINT context, const std::vector<DrawArgs>& drawArgs, ComPtr<ID3D12GraphicsCommandList> commandList)
+void DrawInstanceIndexed(UINT context, const std::vector<DrawArgs>& drawArgs, ComPtr<ID3D12GraphicsCommandList> commandList, UINT instanceCount)
 {
 	for (UINT i = 0; i < drawArgs.size(); i++)
 	{
@@ -111,7 +182,7 @@ void DrawInstanceIndexed(UINT context, const std::vector<DrawArgs>& drawArgs, Co
 
 		commandList->DrawIndexedInstanced(
 			drawArg.indexCount,
-			1,
+			instanceCount,
 			drawArg.startIndex,
 			drawArg.baseVertex,
 			drawArg.startInstance
@@ -121,15 +192,13 @@ void DrawInstanceIndexed(UINT context, const std::vector<DrawArgs>& drawArgs, Co
 
 void SetInstanceCB(CommonRenderPassArgs& args, const UINT frameIndex, const RenderInstance& renderInstance, ComPtr<ID3D12GraphicsCommandList> commandList)
 {
-	auto cbvHeapHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(
-		args.cbvSrvUavHeapGlobal->GetGPUDescriptorHandleForHeapStart(),
-		FrameDescriptors::GetDescriptorOffsetCBVSRVUAV(CBVRenderInstance, frameIndex),
-		args.cbvSrvUavDescSize
+	commandList->SetGraphicsRootConstantBufferView(
+		DefaultRootParameterIdx::CBVInstanceIdx,
+		args.instanceConstantsAddress + renderInstance.CBIndex * InstanceConstantsStride
 	);
-	cbvHeapHandle.Offset(renderInstance.CBIndex, args.cbvSrvUavDescSize);
+}
 
-	commandList->SetGraphicsRootDescriptorTable(
-		DefaultRootParameterIdx::CBVTableIdx,
-		cbvHeapHandle
-	);
+void SetFirstInstance(const RenderInstance& firstInstance, ComPtr<ID3D12GraphicsCommandList> commandList)
+{
+	commandList->SetGraphicsRoot32BitConstant(DefaultRootParameterIdx::FirstInstanceIdx, firstInstance.CBIndex, 0);
 }
@@ -2,9 +2,13 @@
 
 #include "DirectXIncludes.h"
 #include <array>
+#include <utility>
 #include <vector>
 
+#include "BarrierBatcher.h"
+#include "FrameGraph.h"
 #include "GPUResource.h"
+#include "DX12AbstractionUtils.h"
 #include "AppDefines.h"
 #include "RenderObject.h"
 #include "RenderPassArgs.h"
@@ -13,8 +17,15 @@ using namespace Microsoft::WRL;
 using namespace DirectX;
 using DX12Abstractions::GPUResource;
 
-typedef std::array<ComPtr<ID3D12CommandAllocator>, NumContexts> CommandAllocatorArray;
-typedef std::array<ComPtr<ID3D12GraphicsCommandList4>, NumContexts> CommandListArray;
+// One command allocator and command list per recording context.
+typedef std::vector<ComPtr<ID3D12CommandAllocator>> CommandAllocatorArray;
+typedef std::vector<ComPtr<ID3D12GraphicsCommandList4>> CommandListArray;
+
+// Distance between the constants of two instances in the instance data. Constant buffers have to start at the constant
+// buffer alignment, the elements of a structured buffer are packed.
+constexpr UINT InstanceConstantsStride = ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer ?
+	(UINT)sizeof(InstanceConstants) :
+	DX12Abstractions::CalculateConstantBufferByteSize(sizeof(InstanceConstants));
 
 void SetCommonStates(CommonRenderPassArgs commonArgs, ComPtr<ID3D12PipelineState> pipelineState, ComPtr<ID3D12GraphicsCommandList4> commandList);
 
@@ -29,25 +40,43 @@ T& ToSpecificArgs(RenderPassArgs* pipelineSpecificArgs)
 }
 
 // Abstract class for a direct render pass.
+// Each recording context of a pass has its own command list, and every context of a frame is recorded by its own job.
 class DX12RenderPass
 {
 public:
 	DX12RenderPass(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE commandType, bool parallelizable);
 	~DX12RenderPass() = default;
 
-	void Init(UINT frameIndex);
-	void Close(UINT frameIndex, UINT context);
+	// Creates the pooled command lists. Passes that aren't parallelizable only create one context.
+	void CreateCommandLists(ComPtr<ID3D12Device5> device, UINT maxContextCount);
 
-	// Returns if a given context is allowed to build the render pass or not.
-	// If the render pass is parallelizable, then it can be built in any context.
-	// Context 0 is always allowed to build.
-	bool IsContextAllowedToBuild(const UINT context) const;
+	// Decides how many contexts record the pass this frame, based on the number of instances to draw. Only the visible
+	// instances count when the render packages have been culled.
+	UINT PrepareContexts(UINT frameIndex, const std::vector<RenderPackage>& renderPackages);
+	UINT GetActiveContextCount(UINT frameIndex) const;
+
+	// Resets the command list and the barrier batcher of a context. Called by the job that records the context.
+	void Init(UINT frameIndex, UINT context);
+	// Ends the split transitions and flushes the barriers that are still queued before closing the command list.
+	void Close(UINT frameIndex, UINT context);
 
 	const std::vector<RenderObjectID>& GetRenderableObjects() const;
+	// Compute passes run on the compute queue, every other pass on the direct queue.
+	FrameGraphQueue GetQueue() const;
+
+	// Declares the resources that the pass reads and writes. The last pass of the pipeline renders to the back buffer.
+	virtual void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const = 0;
 
 	ComPtr<ID3D12GraphicsCommandList4> GetCommandList(UINT context, UINT frameIndex);
 	ComPtr<ID3D12GraphicsCommandList4> GetFirstCommandList(UINT frameIndex);
-	ComPtr<ID3D12GraphicsCommandList4> GetLastCommandList(UINT frameIndex);
+	// Every command list has one batcher. Barriers are queued into it and flushed right before the work that needs them.
+	BarrierBatcher& GetBarrierBatcher(UINT context, UINT frameIndex);
+	void FlushBarriers(UINT context, UINT frameIndex);
+
+	// Work of the first context that doesn't use the frame graph resources of the pass, like culling. It's recorded while
+	// the frame graph transitions of the pass are split, so the GPU does them while the work runs.
+	virtual bool HasPrologue() const;
+	virtual void RecordPrologue(const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs);
 
 	virtual void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) = 0;
 
@@ -56,6 +85,9 @@ protected:
 	virtual void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) = 0;
 	virtual void PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) = 0;
 
+	// Returns the contiguous range [first, last) of the items that the context records.
+	std::pair<UINT, UINT> GetContextRange(UINT context, UINT frameIndex, UINT itemCount) const;
+
 public:
 	std::array<CommandAllocatorArray, BackBufferCount> commandAllocators;
 	std::array<CommandListArray, BackBufferCount> commandLists;
@@ -66,8 +98,16 @@ protected:
 
 	// Set to true if the render pass can have its work parallelized.
 	bool m_parallelizable;
+	D3D12_COMMAND_LIST_TYPE m_commandType;
+
+	std::array<UINT, BackBufferCount> m_activeContextCounts;
+	std::array<std::vector<BarrierBatcher>, BackBufferCount> m_barrierBatchers;
 };
 
 void SetCommonStates(CommonRenderPassArgs commonArgs, ComPtr<ID3D12PipelineState> pipelineState, ComPtr<ID3D12GraphicsCommandList4> commandList);
-void DrawInstanceIndexed(UINT context, const std::vector<DrawArgs>& drawArgs, ComPtr<ID3D12GraphicsCommandList> commandList);
-void SetInstanceCB(CommonRenderPassArgs& args, const UINT frameIndex, const RenderInstance& renderInstance, ComPtr<ID3D12GraphicsCommandList> commandList);
\ No newline at end of file
+// Draws every draw arg with the given number of instances.
+void DrawInstanceIndexed(UINT context, const std::vector<DrawArgs>& drawArgs, ComPtr<ID3D12GraphicsCommandList> commandList, UINT instanceCount = 1);
+void SetInstanceCB(CommonRenderPassArgs& args, const UINT frameIndex, const RenderInstance& renderInstance, ComPtr<ID3D12GraphicsCommandList> commandList);
+// Sets the instance that SV_InstanceID counts from when the instance data is a structured buffer. The instances of the draw
+// have to be consecutive in the instance data.
+void SetFirstInstance(const RenderInstance& firstInstance, ComPtr<ID3D12GraphicsCommandList> commandList);
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "DX12Renderer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <vector>
 
@@ -10,7 +12,10 @@
 #include "GraphicsErrorHandling.h"
 #include "DX12AbstractionUtils.h"
 #include "AppDefines.h"
-#include "tiny_obj_loader.h"
+#include "MeshCache.h"
+#include "SceneUtils.h"
+#include "FrustumCulling.h"
+#include "PlatformUtils.h"
 
 #include "RenderPassIncludes.h"
 
@@ -23,8 +28,12 @@ namespace dx = DirectX;
 static std::vector<RenderPassType> sPassesToRegister = {
 	RenderPassType::DeferredGBufferPass,
 	RenderPassType::DeferredLightingPass,
+	RenderPassType::AdaptiveSamplingPass,
 	RenderPassType::RaytracedAOPass,
-	RenderPassType::AccumulationPass
+	RenderPassType::AOUpsamplePass,
+	RenderPassType::DenoisePass,
+	RenderPassType::AccumulationPass,
+	RenderPassType::CompositePass
 };
 
 constexpr UINT InvalidIndex = UINT_MAX;
@@ -32,53 +41,30 @@ constexpr UINT InvalidIndex = UINT_MAX;
 static std::vector<RenderObjectID> sRTRenderObjectIDs = { RTRenderObjectID };
 
 //static std::vector<RenderPassType> sRenderPassOrder = { DeferredGBufferPass, DeferredLightingPass, RaytracedAOPass };
-static std::vector<RenderPassType> sRenderPassOrder = { DeferredGBufferPass, DeferredLightingPass, RaytracedAOPass, AccumulationPass };
+static std::vector<RenderPassType> sRenderPassOrder = { DeferredGBufferPass, DeferredLightingPass, AdaptiveSamplingPass, RaytracedAOPass, AOUpsamplePass, DenoisePass, AccumulationPass, CompositePass };
 
 bool HasRenderPass(std::vector<RenderPassType>& renderPassOrder, const RenderPassType pass)
 {
 	return std::find(renderPassOrder.begin(), renderPassOrder.end(), pass) != renderPassOrder.end();
 }
 
-void ReadObjFile(std::string modelPath, tinyobj::ObjReader& reader, tinyobj::ObjReaderConfig config)
+bool IsAOOnlyPass(const RenderPassType pass)
 {
-	if (!reader.ParseFromFile(modelPath, config))
-	{
-		if (!reader.Error().empty())
-		{
-			throw std::runtime_error(reader.Error());
-		}
-		else
-		{
-			throw std::runtime_error("Failed to load model");
-		}
-	}
-
-	if (!reader.Warning().empty())
-	{
-		OutputDebugStringA(reader.Warning().c_str());
-	}
+	return pass == AdaptiveSamplingPass || pass == RaytracedAOPass || pass == AOUpsamplePass || pass == DenoisePass || pass == AccumulationPass;
 }
 
-template <typename T>
-void GetObjVertexIndices(std::vector<T>& vertexIndices, tinyobj::ObjReader& reader)
-{
-	auto& attrib = reader.GetAttrib();
-	auto& shapes = reader.GetShapes();
-	auto& materials = reader.GetMaterials();
+// The clears of the pre command list are the first pass of the frame graph, followed by the render passes in order.
+constexpr UINT ClearGraphPass = 0;
 
-	for (const auto& shape : shapes)
-	{
-		for (const auto& index : shape.mesh.indices)
-		{
-			vertexIndices.push_back((T)index.vertex_index);
-		}
-	}
+UINT GetRenderPassGraphPass(UINT renderPassIndex)
+{
+	return ClearGraphPass + 1 + renderPassIndex;
 }
 
-D3D12_UNORDERED_ACCESS_VIEW_DESC CreateBackbufferUAVDesc()
+D3D12_UNORDERED_ACCESS_VIEW_DESC CreateTexture2DUAVDesc(DXGI_FORMAT format)
 {
 	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-	uavDesc.Format = BackBufferFormat;
+	uavDesc.Format = format;
 	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 	uavDesc.Texture2D = {
 		.MipSlice = 0,
@@ -88,10 +74,10 @@ D3D12_UNORDERED_ACCESS_VIEW_DESC CreateBackbufferUAVDesc()
 	return uavDesc;
 }
 
-D3D12_SHADER_RESOURCE_VIEW_DESC CreateBackbufferSRVDesc()
+D3D12_SHADER_RESOURCE_VIEW_DESC CreateTexture2DSRVDesc(DXGI_FORMAT format)
 {
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	srvDesc.Format = BackBufferFormat;
+	srvDesc.Format = format;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.Texture2D = {
@@ -104,6 +90,11 @@ D3D12_SHADER_RESOURCE_VIEW_DESC CreateBackbufferSRVDesc()
 	return srvDesc;
 }
 
+D3D12_SHADER_RESOURCE_VIEW_DESC CreateBackbufferSRVDesc()
+{
+	return CreateTexture2DSRVDesc(BackBufferFormat);
+}
+
 CD3DX12_RESOURCE_DESC CreateBackbufferResourceDesc(const UINT width, const UINT height)
 {
 	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(
@@ -156,31 +147,63 @@ void DX12Renderer::Update()
 
 	// Wait for the frame to finish if its still in flight.
 	m_directCommandQueue->WaitForFenceValue(m_currentFrameResource->fenceValue);
+	m_uploadRing->Retire(m_directCommandQueue->GetCompletedFenceValue());
+	ReadAdaptiveSamplingStats(currentBackBufferIndex);
 
 	UpdateCamera();
 
+	if constexpr (AnimateRaytracedInstance)
+	{
+		UpdateAnimatedInstance();
+	}
+
+	DirectX::XMFLOAT4X4 viewProjection;
+	dx::XMStoreFloat4x4(&viewProjection, m_activeCamera->GetViewProjectionMatrix());
+	DirectX::XMFLOAT3 cameraPosition;
+	dx::XMStoreFloat3(&cameraPosition, m_activeCamera->GetPosition());
+
+	// Nothing has been accumulated yet, so there is no history to reproject.
+	if (m_accumulatedFrames == 0)
+	{
+		m_previousViewProjection = viewProjection;
+		m_previousCameraPosition = cameraPosition;
+	}
+
+	if constexpr (ActiveInstanceCullingMode == InstanceCullingMode::CPU)
+	{
+		CullRenderInstances();
+	}
+
 	FrameResource::FrameResourceUpdateInputs inputs = {
 		.camera = m_activeCamera,
 		.renderInstancesByID = m_renderInstancesByID,
-		.bottomAccStructByID = m_bottomAccStructByID,
+		.instanceStore = m_instanceStore,
+		.bottomLevelASManager = *m_bottomLevelASManager,
+		.topLevelTrackersByID = m_topLevelTrackersByID,
 
 		.globalFrameData = {
 			.frameCount = m_frameCount,
 			.accumulatedFrames = m_accumulatedFrames,
-			.time = m_time
-		}
+			.time = m_time,
+			.historyIndex = GetHistoryIndex(),
+			.previousViewProjection = m_previousViewProjection,
+			.cameraPosition = cameraPosition,
+			.previousCameraPosition = m_previousCameraPosition,
+			.adaptiveSampling = IsAdaptiveSamplingActive() ? 1u : 0u
+		},
+		.uploadRing = *m_uploadRing
 	};
 
 	m_currentFrameResource->UpdateFrameResources(inputs);
+
+	m_previousViewProjection = viewProjection;
+	m_previousCameraPosition = cameraPosition;
 }
 
 void DX12Renderer::Render()
 {
 	UINT currentFrameIndex = m_currentFrameResource->GetFrameIndex();
 
-	// Store command lists for each render pass.
-	CommandListVector combinedCommandLists;
-
 	m_currentFrameResource->Init();
 	ComPtr<ID3D12GraphicsCommandList4> preCommandList = m_currentFrameResource->commandLists[PreCommandList];
 	ComPtr<ID3D12GraphicsCommandList4> postCommandList = m_currentFrameResource->commandLists[PostCommandList];
@@ -191,100 +214,156 @@ void DX12Renderer::Render()
 	// Get RTV handle for the current back buffer.
 	const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVBackBuffers, currentFrameIndex);
 
-	const CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVMiddleTexture);
+	// The frame starts with the states that the previous frame left the resources in. The graph only has to be compiled
+	// again when they differ from the last frame, which in practice only happens during the first frames.
+	for (UINT resourceID = 0; resourceID < FrameGraphResourceCount; resourceID++)
+	{
+		m_frameGraph.SetInitialState(resourceID, GetFrameGraphResource((FrameGraphResourceID)resourceID, currentFrameIndex).currentState);
+	}
+
+	if (!m_frameGraph.IsCompiled())
+	{
+		m_frameGraph.Compile();
+	}
 
-	// Get DSV handle.
-	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = GetGlobalDSVHandle(GlobalDescriptorNames::DSVScene);
+	// Command lists of every graph pass.
+	std::vector<CommandListVector> commandListsByGraphPass(m_frameGraph.GetPassCount());
 
 	// Pre render pass setup.
 	{
-		ClearBuffers(currentBackBuffer, preCommandList, bbRTV, middleTextureRTV, dsvHandle);
+		const FrameGraphCompiledPass& clearPass = m_frameGraph.GetCompiledPass(ClearGraphPass);
+
+		BarrierBatcher preBarrierBatcher;
+		AddFrameGraphBarriers(preBarrierBatcher, clearPass.barriersBefore, currentFrameIndex);
+		InitializeTransientResources(preCommandList, preBarrierBatcher, clearPass.initializations, currentFrameIndex);
+		preBarrierBatcher.Flush(preCommandList.Get());
+		ClearBuffers(preCommandList, bbRTV);
+		AddFrameGraphBarriers(preBarrierBatcher, clearPass.barriersAfter, currentFrameIndex);
+		preBarrierBatcher.Flush(preCommandList.Get());
 
 		// Close pre-command list.
 		preCommandList->Close();
 
-		// Add command list to list of command lists.
-		combinedCommandLists.push_back(preCommandList);
+		commandListsByGraphPass[ClearGraphPass].push_back(preCommandList);
 	}
 
-	// Initialize all render passes (resetting).
-	for (auto& renderPass : sRenderPassOrder)
+	// Record all render passes. Every context of every pass is its own job, so parallelizable passes are spread over
+	// all cores while the other passes are recorded next to them. The render packages and context counts are set up
+	// before the first job starts, since the jobs read them.
+	std::vector<std::vector<RenderPackage>> renderPackagesByPass(sRenderPassOrder.size());
+	for (UINT passIndex = 0; passIndex < sRenderPassOrder.size(); passIndex++)
 	{
-		m_renderPasses[renderPass]->Init(currentFrameIndex);
-	}
+		DX12RenderPass& renderPass = *m_renderPasses[sRenderPassOrder[passIndex]];
 
-	// Start all render passes.
-	m_syncHandler.SetStartAll();	
+		renderPackagesByPass[passIndex] = CreateRenderPackages(renderPass);
+		renderPass.PrepareContexts(currentFrameIndex, renderPackagesByPass[passIndex]);
+	}
 
-#if defined(SINGLE_THREAD)
-	// This is supposed to be ran by different threads.
-	for (UINT context = 0; context < NumContexts; context++)
+	JobCounter recordingCounter = 0;
+	for (UINT passIndex = 0; passIndex < sRenderPassOrder.size(); passIndex++)
 	{
-		BuildRenderPipeline(context);
+		const RenderPassType renderPassType = sRenderPassOrder[passIndex];
+		const UINT graphPass = GetRenderPassGraphPass(passIndex);
+		const bool isLastRenderPass = passIndex == (sRenderPassOrder.size() - 1);
+		const std::vector<RenderPackage>& renderPackages = renderPackagesByPass[passIndex];
+
+		const UINT contextCount = m_renderPasses[renderPassType]->GetActiveContextCount(currentFrameIndex);
+		for (UINT context = 0; context < contextCount; context++)
+		{
+			m_jobSystem->Dispatch(recordingCounter, [this, renderPassType, graphPass, isLastRenderPass, &renderPackages, context, currentFrameIndex]()
+			{
+				RecordRenderPass(renderPassType, graphPass, isLastRenderPass, renderPackages, context, currentFrameIndex);
+			});
+		}
 	}
-#endif
 
-	// Wait for all passes to finish on the CPU.
-	m_syncHandler.WaitEndAll();
+	// Wait for all passes to finish on the CPU. The main thread records passes as well while it waits.
+	m_jobSystem->Wait(recordingCounter);
 
-	// If the Raytraced AO pass is the last pass, copy the middle texture to the back buffer.
-	if (HasRenderPass(sRenderPassOrder, RaytracedAOPass))
+	// The barriers after the copy and the final barriers have no work between them, so they share a batch.
+	BarrierBatcher postBarrierBatcher;
+
+	// If a pass that only writes the AO is the last pass, copy the middle texture to the back buffer.
+	if (m_copyGraphPass != InvalidIndex)
 	{
-		if (sRenderPassOrder.back() == RaytracedAOPass)
-		{
-			// Copy middle texture to back buffer.
-			m_middleTexture.TransitionTo(D3D12_RESOURCE_STATE_COPY_SOURCE, postCommandList);
-			currentBackBuffer.TransitionTo(D3D12_RESOURCE_STATE_COPY_DEST, postCommandList);
-			postCommandList->CopyResource(currentBackBuffer.Get(), m_middleTexture.Get());
-		}
+		const FrameGraphCompiledPass& copyPass = m_frameGraph.GetCompiledPass(m_copyGraphPass);
+
+		AddFrameGraphBarriers(postBarrierBatcher, copyPass.barriersBefore, currentFrameIndex);
+		InitializeTransientResources(postCommandList, postBarrierBatcher, copyPass.initializations, currentFrameIndex);
+		postBarrierBatcher.Flush(postCommandList.Get());
+		postCommandList->CopyResource(currentBackBuffer.Get(), m_middleTexture.Get());
+		AddFrameGraphBarriers(postBarrierBatcher, copyPass.barriersAfter, currentFrameIndex);
 	}
 
 	// Prepare back buffer for present.
-	currentBackBuffer.TransitionTo(D3D12_RESOURCE_STATE_PRESENT, postCommandList);
+	AddFrameGraphBarriers(postBarrierBatcher, m_frameGraph.GetFinalBarriers(), currentFrameIndex);
+	postBarrierBatcher.Flush(postCommandList.Get());
 
 	// Close post command list.
 	postCommandList->Close() >> CHK_HR;
 
-	// Add all command lists to the main command list.
-	UINT rtCommandListIndex = InvalidIndex;
-	for (RenderPassType renderPass : sRenderPassOrder)
+	for (UINT passIndex = 0; passIndex < sRenderPassOrder.size(); passIndex++)
 	{
-		// Save index of ray tracing pass for usage in compute queue.
-		if (renderPass == RaytracedAOPass)
+		DX12RenderPass& renderPass = *m_renderPasses[sRenderPassOrder[passIndex]];
+		const UINT contextCount = renderPass.GetActiveContextCount(currentFrameIndex);
+
+		for (UINT context = 0; context < contextCount; context++)
 		{
-			rtCommandListIndex = (UINT)combinedCommandLists.size();
+			commandListsByGraphPass[GetRenderPassGraphPass(passIndex)].push_back(renderPass.GetCommandList(context, currentFrameIndex));
 		}
+	}
+
+	// Submit the command lists in pass order. Lists are collected per queue and only submitted when the queue has to
+	// signal or wait for the other queue, as the frame graph decided.
+	std::array<CommandQueueHandler*, (size_t)FrameGraphQueue::Count> queues = { m_directCommandQueue.get(), m_computeCommandQueue.get() };
+	std::array<CommandListVector, (size_t)FrameGraphQueue::Count> pendingCommandLists;
+	std::vector<UINT64> graphPassFenceValues(m_frameGraph.GetPassCount(), 0);
 
-		const auto& renderPassPtr = m_renderPasses[renderPass];
-		for (UINT context = 0; context < NumContexts; context++)
+	const auto submit = [&](FrameGraphQueue queue)
+	{
+		CommandListVector& commandLists = pendingCommandLists[(size_t)queue];
+		if (!commandLists.empty())
 		{
-			combinedCommandLists.push_back(renderPassPtr->GetCommandList(context, currentFrameIndex));
+			queues[(size_t)queue]->ExecuteCommandLists(commandLists);
+			commandLists.clear();
 		}
-	}
+	};
 
-	// Add post command list to list of command lists.
-	combinedCommandLists.push_back(postCommandList);
+	const auto wait = [&](FrameGraphQueue queue, const std::vector<FrameGraphWait>& waits)
+	{
+		for (const FrameGraphWait& graphWait : waits)
+		{
+			submit(queue);
+			queues[(size_t)queue]->GPUWait(queues[(size_t)graphWait.queue]->GetFence(), graphPassFenceValues[graphWait.pass]);
+		}
+	};
 
-	// Check if there actually is a ray tracing pass.
-	if (rtCommandListIndex == InvalidIndex)
+	for (UINT graphPass = 0; graphPass < m_frameGraph.GetPassCount(); graphPass++)
 	{
-		m_directCommandQueue->ExecuteCommandLists(combinedCommandLists);
+		const FrameGraphCompiledPass& compiledPass = m_frameGraph.GetCompiledPass(graphPass);
+		const FrameGraphQueue queue = m_frameGraph.GetPassQueue(graphPass);
+
+		wait(queue, compiledPass.waits);
+
+		CommandListVector& commandLists = pendingCommandLists[(size_t)queue];
+		commandLists.insert(commandLists.end(), commandListsByGraphPass[graphPass].begin(), commandListsByGraphPass[graphPass].end());
+
+		if (compiledPass.signalAfter)
+		{
+			submit(queue);
+			graphPassFenceValues[graphPass] = queues[(size_t)queue]->Signal();
+		}
 	}
-	else
-	{
-		// Execute all command lists up to the ray tracing pass.
-		m_directCommandQueue->ExecuteCommandLists(combinedCommandLists, rtCommandListIndex);
 
-		// Make sure the ray tracing pass waits for the previous passes to finish as it relies on the output of it.
-		m_computeCommandQueue->GPUWaitForOtherQueue(*m_directCommandQueue);
-		// Execute the ray tracing pass.
-		m_computeCommandQueue->ExecuteCommandLists(combinedCommandLists, NumContexts, rtCommandListIndex);
+	// The post command list holds the final barriers, which have to wait for every queue.
+	wait(FrameGraphQueue::Direct, m_frameGraph.GetFrameEndWaits());
+	pendingCommandLists[(size_t)FrameGraphQueue::Direct].push_back(postCommandList);
+	submit(FrameGraphQueue::Direct);
 
-		// Wait yet again for the ray tracing pass to finish.
-		m_directCommandQueue->GPUWaitForOtherQueue(*m_computeCommandQueue);
-		UINT finalIndex = (NumContexts + rtCommandListIndex);
-		// Execute final command lists.
-		m_directCommandQueue->ExecuteCommandLists(combinedCommandLists, (UINT)combinedCommandLists.size() - finalIndex, finalIndex);
+	// The resources are in the final states of the graph once the frame has been executed.
+	for (UINT resourceID = 0; resourceID < FrameGraphResourceCount; resourceID++)
+	{
+		GetFrameGraphResource((FrameGraphResourceID)resourceID, currentFrameIndex).currentState = m_frameGraph.GetFinalState(resourceID);
 	}
 
 	// Present
@@ -293,44 +372,28 @@ void DX12Renderer::Render()
 	// Signal end of frame.
 	UINT64 fenceVal = m_directCommandQueue->Signal();
 	m_currentFrameResource->fenceValue = fenceVal; // Save the fence val for this frame.
+	m_uploadRing->FinishFrame(fenceVal);
 
 	// Increment frame count.
 	m_frameCount++;
 }
 
 
-void DX12Renderer::ClearBuffers(GPUResource& currentBackBuffer, ComPtr<ID3D12GraphicsCommandList4> preCommandList, const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV, const CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureRTV, CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle)
+void DX12Renderer::ClearBuffers(ComPtr<ID3D12GraphicsCommandList4> preCommandList, const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV)
 {
+	// The render target transitions are recorded by the frame graph before the clears. The G-buffers, the middle, AO and
+	// denoise textures and the depth buffer are transient and initialized by the pass that uses them first.
+
 	// Clear back buffer and prime for rendering.
 	{
-		currentBackBuffer.TransitionTo(D3D12_RESOURCE_STATE_RENDER_TARGET, preCommandList);
-
 		float clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f }; // Specific known clear color for easier debugging.
 		preCommandList->ClearRenderTargetView(bbRTV, clearColor, 0, nullptr);
 	}
+}
 
-	// Clear middle texture.
-	{
-		m_middleTexture.TransitionTo(D3D12_RESOURCE_STATE_RENDER_TARGET, preCommandList);
-		preCommandList->ClearRenderTargetView(middleTextureRTV, OptimizedClearColor, 0, nullptr);
-	}
-
-	// Setup gbuffers.
-	if (HasRenderPass(sRenderPassOrder, RenderPassType::DeferredGBufferPass))
-	{
-		TransitionGBuffers(preCommandList, D3D12_RESOURCE_STATE_RENDER_TARGET);
-		ClearGBuffers(preCommandList);
-	}
-
-	// Clear depth buffer.
-	preCommandList->ClearDepthStencilView(
-		dsvHandle,
-		D3D12_CLEAR_FLAG_DEPTH,
-		1.0f,
-		0,
-		0,
-		nullptr
-	);
+const TransientHeapLayout& DX12Renderer::GetTransientHeapLayout() const
+{
+	return m_transientHeapLayout;
 }
 
 DX12Renderer::~DX12Renderer()
@@ -339,16 +402,6 @@ DX12Renderer::~DX12Renderer()
 	m_directCommandQueue->SignalAndWait();
 	m_copyCommandQueue->SignalAndWait();
 
-	m_forceExitThread = true;
-	m_syncHandler.SetStartAll();
-	for (std::thread& thread : m_threadWorkers)
-	{
-		if (thread.joinable())
-		{
-			thread.join();
-		}	
-	}
-
 	s_instance = nullptr;
 }
 
@@ -362,11 +415,11 @@ DX12Renderer::DX12Renderer(UINT width, UINT height, HWND windowHandle) :
 	m_rtvDescriptorSize(0),
 	m_dsvDescriptorSize(0),
 	m_cbvSrvUavDescriptorSize(0),
-	m_syncHandler({}),
+	m_copyGraphPass(InvalidIndex),
 	m_frameCount(0),
 	m_accumulatedFrames(0),
 	m_time(0.0f),
-	m_forceExitThread(false)
+	m_aoResolutionMode(AOResolutionMode::Full)
 {
 	s_instance = this;
 
@@ -376,35 +429,30 @@ DX12Renderer::DX12Renderer(UINT width, UINT height, HWND windowHandle) :
 	srand(time(0));
 #endif
 
+#if defined(SINGLE_THREAD)
+	m_jobSystem = std::make_unique<JobSystem>(1);
+#else
+	m_jobSystem = std::make_unique<JobSystem>();
+#endif
+
 	InitPipeline();
 	InitAssets();
+	InitTransientResources();
 	InitRaytracing();
 	InitFrameResources();
-
-#if !defined(SINGLE_THREAD)
-	InitThreads();
-#endif
 }
 
 
 void DX12Renderer::InitPipeline()
 {
 	CreateDeviceAndSwapChain();
-	CreateAccumulationTexture();
+	CreateAccumulationTextures();
+	CreateAdaptiveSamplingBuffers();
 	CreateBackBuffers();
-	CreateDepthBuffer();
-	CreateGBuffers();
-	CreateMiddleTexture();
 
 	CreateDSVHeap();
 	CreateRTVHeap();
 	CreateCBVSRVUAVHeapGlobal();
-
-	CreateRTVs();
-	CreateDSV();
-	CreateSRVs();
-	CreateUAVs();
-
 }
 
 void DX12Renderer::CreateDeviceAndSwapChain()
@@ -506,76 +554,45 @@ void DX12Renderer::CreateDeviceAndSwapChain()
 
 void DX12Renderer::CreateGBuffers()
 {
-	CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
-	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-		DXGI_FORMAT_UNKNOWN,
-		m_width,
-		m_height
-	);
-	resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-
-	// Diffuse gbuffer.
+	for (UINT i = 0; i < GBufferIDCount; i++)
 	{
-		resourceDesc.Format = GBufferFormats[GBufferDiffuse];
-
-		m_gBuffers[GBufferDiffuse] = CreateResource(
-			m_device,
-			resourceDesc, 
-			D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_HEAP_TYPE_DEFAULT
-		);
+		m_gBuffers[i] = CreateTransientResource((FrameGraphResourceID)(FrameGraphGBufferDiffuse + i), D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_gBuffers, GBufferDiffuse, DX12Renderer);
-	}
-	
-	// Surface normal gbuffer.
-	{
-		resourceDesc.Format = GBufferFormats[GBufferNormal];
-		
-		m_gBuffers[GBufferNormal] = CreateResource(
-			m_device,
-			resourceDesc,
-			D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_HEAP_TYPE_DEFAULT
-		);
-
-		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_gBuffers, GBufferNormal, DX12Renderer);
+		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_gBuffers, i, DX12Renderer);
 	}
+}
 
-	// World position gbuffer.
-	{
-		resourceDesc.Format = GBufferFormats[GBufferWorldPos];
+void DX12Renderer::CreateMiddleTexture()
+{
+	m_middleTexture = CreateTransientResource(FrameGraphMiddleTexture, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-		m_gBuffers[GBufferWorldPos] = CreateResource(
-			m_device,
-			resourceDesc,
-			D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_HEAP_TYPE_DEFAULT
-		);
+	NAME_D3D12_OBJECT_MEMBER(m_middleTexture, DX12Renderer);
+}
 
-		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_gBuffers, GBufferWorldPos, DX12Renderer);
-	}
+void DX12Renderer::CreateAOTexture()
+{
+	m_aoTexture = CreateTransientResource(FrameGraphAOTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	m_aoTraceTexture = CreateTransientResource(FrameGraphAOTraceTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-	
+	NAME_D3D12_OBJECT_MEMBER(m_aoTexture, DX12Renderer);
+	NAME_D3D12_OBJECT_MEMBER(m_aoTraceTexture, DX12Renderer);
 }
 
-void DX12Renderer::CreateMiddleTexture()
+void DX12Renderer::CreateSampleCountTexture()
 {
-	CD3DX12_RESOURCE_DESC resourceDesc = CreateBackbufferResourceDesc(m_width, m_height);
+	m_sampleCountTexture = CreateTransientResource(FrameGraphSampleCountTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-	// Render target when writing gbuffer info to it and unordered access in ray tracing shader when writing and reading to it.
-	resourceDesc.Flags = 
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS | 
-		D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+	NAME_D3D12_OBJECT_MEMBER(m_sampleCountTexture, DX12Renderer);
+}
 
-	m_middleTexture = CreateResource(
-		m_device,
-		resourceDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		D3D12_HEAP_TYPE_DEFAULT
-	);
+void DX12Renderer::CreateDenoiseTextures()
+{
+	for (UINT i = 0; i < DenoiseTextureCount; i++)
+	{
+		m_denoiseTextures[i] = CreateTransientResource((FrameGraphResourceID)(FrameGraphDenoiseTexture0 + i), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-	NAME_D3D12_OBJECT_MEMBER(m_middleTexture, DX12Renderer);
+		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_denoiseTextures, i, DX12Renderer);
+	}
 }
 
 void FrameResource::CreateTopLevelASs(ComPtr<ID3D12Device5> device)
@@ -586,24 +603,62 @@ void FrameResource::CreateTopLevelASs(ComPtr<ID3D12Device5> device)
 	}
 }
 
-void DX12Renderer::CreateAccumulationTexture()
+void DX12Renderer::CreateAccumulationTextures()
 {
-	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-		BackBufferFormat,
-		m_width,
-		m_height
-	);
-	resourceDesc.MipLevels = 1; // Match back buffer.
-	resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+	// Both copies stay unordered access views, so swapping them never needs a transition.
+	for (UINT i = 0; i < AccumulationTextureCount; i++)
+	{
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+			AccumulationTextureFormat,
+			m_width,
+			m_height
+		);
+		resourceDesc.MipLevels = 1; // Match back buffer.
+		resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-	m_accumulationTexture = CreateResource(
+		m_accumulationTextures[i] = CreateResource(
+			m_device,
+			resourceDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			D3D12_HEAP_TYPE_DEFAULT
+		);
+		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_accumulationTextures, i, DX12Renderer);
+
+		resourceDesc.Format = ReprojectionTextureFormat;
+		m_reprojectionTextures[i] = CreateResource(
+			m_device,
+			resourceDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			D3D12_HEAP_TYPE_DEFAULT
+		);
+		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_reprojectionTextures, i, DX12Renderer);
+	}
+}
+
+void DX12Renderer::CreateAdaptiveSamplingBuffers()
+{
+	const UINT64 counterBufferSize = AdaptiveSamplingCounterCount * sizeof(UINT);
+
+	m_adaptiveSamplingCounterBuffer = CreateResource(
 		m_device,
-		resourceDesc,
+		CD3DX12_RESOURCE_DESC::Buffer(counterBufferSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
 		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
 		D3D12_HEAP_TYPE_DEFAULT
 	);
+	NAME_D3D12_OBJECT_MEMBER(m_adaptiveSamplingCounterBuffer, DX12Renderer);
+
+	for (UINT i = 0; i < BackBufferCount; i++)
+	{
+		m_adaptiveSamplingReadbackBuffers[i] = CreateResource(
+			m_device,
+			CD3DX12_RESOURCE_DESC::Buffer(counterBufferSize),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			D3D12_HEAP_TYPE_READBACK
+		);
+		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_adaptiveSamplingReadbackBuffers, i, DX12Renderer);
+	}
 
-	NAME_D3D12_OBJECT_MEMBER(m_accumulationTexture, DX12Renderer);
+	m_hasAdaptiveSamplingStats.fill(false);
 }
 
 void DX12Renderer::CreateBackBuffers()
@@ -683,29 +738,7 @@ void DX12Renderer::CreateRTVs()
 
 void DX12Renderer::CreateDepthBuffer()
 {
-	const CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
-
-	const CD3DX12_RESOURCE_DESC depthBufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-		DXGI_FORMAT_D32_FLOAT,
-		m_width,
-		m_height,
-		1, 0, 1, 0,
-		D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL
-	);
-
-	const D3D12_CLEAR_VALUE depthOptimizedClearValue = {
-		.Format = DXGI_FORMAT_D32_FLOAT,
-		.DepthStencil = { 1.0f, 0 }
-	};
-
-	m_device->CreateCommittedResource(
-		&heapProps,
-		D3D12_HEAP_FLAG_NONE,
-		&depthBufferDesc,
-		D3D12_RESOURCE_STATE_DEPTH_WRITE,
-		&depthOptimizedClearValue,
-		IID_PPV_ARGS(&m_depthBuffer)
-	) >> CHK_HR;
+	m_depthBuffer = CreateTransientResource(FrameGraphDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
 	NAME_D3D12_OBJECT_MEMBER(m_depthBuffer, DX12Renderer);
 }
@@ -733,55 +766,6 @@ void DX12Renderer::CreateDSV()
 	m_device->CreateDepthStencilView(m_depthBuffer.Get(), nullptr, dsvHandle);
 }
 
-void FrameResource::CreateConstantBuffers(ComPtr<ID3D12Device5> device)
-{
-	// Create instances CBs.
-	{
-		constexpr UINT instanceElementSize = DX12Abstractions::CalculateConstantBufferByteSize(sizeof(InstanceConstants));
-		const UINT instanceBufferSize = instanceElementSize * MaxRenderInstances;
-
-		const CD3DX12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(instanceBufferSize);
-
-		perInstanceCB = CreateUploadResource(device, constantBufferDesc);
-		NAME_D3D12_OBJECT_MEMBER(perInstanceCB, FrameResource);
-
-		// Map and initialize the constant buffer.
-		{
-			InstanceConstants* pConstantBufferData;
-			perInstanceCB.resource->Map(0, nullptr, reinterpret_cast<void**>(&pConstantBufferData)) >> CHK_HR;
-
-			dx::XMMATRIX modelMatrix = dx::XMMatrixIdentity();
-
-			for (UINT i = 0; i < MaxRenderInstances; i++)
-			{
-				// No need to transpose the matrix since it's identity.
-				dx::XMStoreFloat4x4(&pConstantBufferData[i].modelMatrix, modelMatrix);
-			}
-
-			perInstanceCB.resource->Unmap(0, nullptr);
-		}
-	}
-
-	// Create global frame data CB.
-	{
-		constexpr UINT globalFrameDataSize = DX12Abstractions::CalculateConstantBufferByteSize(sizeof(GlobalFrameData));
-		
-		const CD3DX12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(globalFrameDataSize * 1); // Only one instance.
-
-		globalFrameDataCB = CreateUploadResource(device, constantBufferDesc);
-		NAME_D3D12_OBJECT_MEMBER(globalFrameDataCB, FrameResource);
-
-		// Initialize some values.
-		GlobalFrameData globalFrameData = {
-			.frameCount = 0,
-			.accumulatedFrames = 0,
-			.time = 0.0f
-		};
-		MapDataToBuffer(globalFrameDataCB, &globalFrameData, sizeof(GlobalFrameData));
-	}
-
-}
-
 void DX12Renderer::CreateCBVSRVUAVHeapGlobal()
 {
 	UINT frameCBVSRVUAVDescriptors = GlobalDescriptors::MaxGlobalCBVSRVUAVDescriptors + FrameDescriptors::MaxFrameCBVSRVUAVDescriptors * BackBufferCount;
@@ -799,47 +783,6 @@ void DX12Renderer::CreateCBVSRVUAVHeapGlobal()
 	NAME_D3D12_OBJECT_MEMBER(m_cbvSrvUavHeapGlobal, DX12Renderer);
 }
 
-void FrameResource::CreateFrameCBVs(ComPtr<ID3D12Device5> device, ComPtr<ID3D12DescriptorHeap> cbvSrvUavHeapGlobal, UINT cbvSrvUavDescriptorSize)
-{
-	// Create all CBV descriptors for render instances.
-	for (UINT i = 0; i < MaxRenderInstances; i++)
-	{
-		constexpr UINT instanceDataSize = DX12Abstractions::CalculateConstantBufferByteSize(sizeof(InstanceConstants));
-
-		D3D12_GPU_VIRTUAL_ADDRESS instanceCBAddress = perInstanceCB.resource->GetGPUVirtualAddress();
-		// Set the offset for the data location inside the upload buffer.
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {
-			.BufferLocation = instanceCBAddress + i * instanceDataSize,
-			.SizeInBytes = instanceDataSize
-		};
-
-		CD3DX12_CPU_DESCRIPTOR_HANDLE instanceCBVHandle(cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
-		instanceCBVHandle.Offset(
-			FrameDescriptors::GetDescriptorOffsetCBVSRVUAV(CBVRenderInstance, m_frameIndex) + i,
-			cbvSrvUavDescriptorSize
-		);
-
-		device->CreateConstantBufferView(&cbvDesc, instanceCBVHandle);
-	} 
-
-	// For global data.
-	{
-		constexpr UINT globalFrameDataSize = DX12Abstractions::CalculateConstantBufferByteSize(sizeof(GlobalFrameData));
-
-		D3D12_GPU_VIRTUAL_ADDRESS frameDataCBAddress = perInstanceCB.resource->GetGPUVirtualAddress();
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {
-			.BufferLocation = frameDataCBAddress,
-			.SizeInBytes = globalFrameDataSize
-		};
-
-		// Calculate offset of CBV.
-		CD3DX12_CPU_DESCRIPTOR_HANDLE frameDataCBVHandle(cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
-		frameDataCBVHandle.Offset(FrameDescriptors::GetDescriptorOffsetCBVSRVUAV(CBVFrameData, m_frameIndex), cbvSrvUavDescriptorSize);
-
-		device->CreateConstantBufferView(&cbvDesc, frameDataCBVHandle);
-	}
-}
-
 void DX12Renderer::CreateSRVs()
 {
 	// SRVs for gbuffers.
@@ -871,46 +814,101 @@ void DX12Renderer::CreateSRVs()
 
 		m_device->CreateShaderResourceView(m_middleTexture.Get(), &srvDesc, middleTextureSRVHandle);
 	}
+
+	// SRV for the AO texture.
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = CreateTexture2DSRVDesc(AOTextureFormat);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE aoTextureSRVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		aoTextureSRVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(SRVAOTexture), m_cbvSrvUavDescriptorSize);
+
+		m_device->CreateShaderResourceView(m_aoTexture.Get(), &srvDesc, aoTextureSRVHandle);
+	}
+
+	// SRV for the AO trace texture, which the upsample pass reads.
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = CreateTexture2DSRVDesc(AOTextureFormat);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE aoTraceTextureSRVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		aoTraceTextureSRVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(SRVAOTraceTexture), m_cbvSrvUavDescriptorSize);
+
+		m_device->CreateShaderResourceView(m_aoTraceTexture.Get(), &srvDesc, aoTraceTextureSRVHandle);
+	}
 }
 
 
 
 FrameResource::FrameResource(UINT frameIndex, ComPtr<ID3D12Resource> backBuffer, FrameResourceInputs inputs)
-	: fenceValue(0), m_frameIndex(frameIndex)
+	: instanceConstantsAddress(0), globalFrameDataAddress(0), fenceValue(0), m_frameIndex(frameIndex)
 {
 	const UINT width = (UINT)inputs.viewPort.Width;
 	const UINT height = (UINT)inputs.viewPort.Height;
 
 	CreateCommandResources(inputs.device);
 	CreateTopLevelASs(inputs.device);
-	CreateConstantBuffers(inputs.device);
-
-	CreateFrameCBVs(inputs.device, inputs.cbvSrvUavHeapGlobal, inputs.cbvSrvUavDescriptorSize);
-
 	CreateTopLevelASDescriptors(inputs.device, inputs.cbvSrvUavHeapGlobal, inputs.cbvSrvUavDescriptorSize);
 	CreateShaderTables(inputs);
 }
 
 void DX12Renderer::CreateUAVs()
 {
-	// UAV for middle texture.
+	// UAV for the AO texture.
+	{
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateTexture2DUAVDesc(AOTextureFormat);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE aoTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		aoTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVAOTexture), m_cbvSrvUavDescriptorSize);
+
+		m_device->CreateUnorderedAccessView(m_aoTexture.Get(), nullptr, &uavDesc, aoTextureUAVHandle);
+	}
+
+	// UAV for the AO trace texture, which the raygen shader writes outside of the full resolution mode.
+	{
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateTexture2DUAVDesc(AOTextureFormat);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE aoTraceTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		aoTraceTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVAOTraceTexture), m_cbvSrvUavDescriptorSize);
+
+		m_device->CreateUnorderedAccessView(m_aoTraceTexture.Get(), nullptr, &uavDesc, aoTraceTextureUAVHandle);
+	}
+
+	// UAV for the sample count texture, which the adaptive sampling pass writes.
 	{
-		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateBackbufferUAVDesc();
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateTexture2DUAVDesc(SampleCountTextureFormat);
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
-		middleTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVMiddleTexture), m_cbvSrvUavDescriptorSize);
+		CD3DX12_CPU_DESCRIPTOR_HANDLE sampleCountTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		sampleCountTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVSampleCountTexture), m_cbvSrvUavDescriptorSize);
 
-		m_device->CreateUnorderedAccessView(m_middleTexture.Get(), nullptr, &uavDesc, middleTextureUAVHandle);
+		m_device->CreateUnorderedAccessView(m_sampleCountTexture.Get(), nullptr, &uavDesc, sampleCountTextureUAVHandle);
 	}
 
-	// UAV for accumulation texture.
+	// UAVs for both copies of the accumulation and reprojection textures, indexed by the history index in the shader.
+	for (UINT i = 0; i < AccumulationTextureCount; i++)
 	{
-		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateBackbufferUAVDesc();
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateTexture2DUAVDesc(AccumulationTextureFormat);
 
 		CD3DX12_CPU_DESCRIPTOR_HANDLE accumulationTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
-		accumulationTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVAccumulationTexture), m_cbvSrvUavDescriptorSize);
+		accumulationTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVAccumulationTexture) + i, m_cbvSrvUavDescriptorSize);
 
-		m_device->CreateUnorderedAccessView(m_accumulationTexture.Get(), nullptr, &uavDesc, accumulationTextureUAVHandle);
+		m_device->CreateUnorderedAccessView(m_accumulationTextures[i].Get(), nullptr, &uavDesc, accumulationTextureUAVHandle);
+
+		uavDesc = CreateTexture2DUAVDesc(ReprojectionTextureFormat);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE reprojectionTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		reprojectionTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVReprojectionTexture) + i, m_cbvSrvUavDescriptorSize);
+
+		m_device->CreateUnorderedAccessView(m_reprojectionTextures[i].Get(), nullptr, &uavDesc, reprojectionTextureUAVHandle);
+	}
+
+	// UAVs for the denoise textures, indexed by the source index in the shader.
+	for (UINT i = 0; i < DenoiseTextureCount; i++)
+	{
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = CreateTexture2DUAVDesc(DenoiseTextureFormat);
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE denoiseTextureUAVHandle(m_cbvSrvUavHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+		denoiseTextureUAVHandle.Offset(GlobalDescriptors::GetDescriptorOffset(UAVDenoiseTextures) + i, m_cbvSrvUavDescriptorSize);
+
+		m_device->CreateUnorderedAccessView(m_denoiseTextures[i].Get(), nullptr, &uavDesc, denoiseTextureUAVHandle);
 	}
 }
 
@@ -918,6 +916,7 @@ void DX12Renderer::InitAssets()
 {
 	CreateRootSignatures();
 	RegisterRenderPasses();
+	BuildFrameGraph();
 	CreateRenderObjects();
 	CreateCamera();
 	CreateRenderInstances();
@@ -938,12 +937,10 @@ void DX12Renderer::CreateRootSignatures()
 
 	rootParameters[DefaultRootParameterIdx::CBVGlobalFrameDataIdx].InitAsConstantBufferView(RasterShaderRegisters::CBVRegisters::CBVDescriptorGlobals);
 
-	// Add descriptor table for instance specific constants.
-	CD3DX12_DESCRIPTOR_RANGE instanceCBVRange;
-	instanceCBVRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, RasterShaderRegisters::CBVRegisters::CBVDescriptorRange);
-	rootParameters[DefaultRootParameterIdx::CBVTableIdx].InitAsDescriptorTable(
-		1, 
-		&instanceCBVRange, 
+	// Instance specific constants, bound straight from the upload ring for every instance.
+	rootParameters[DefaultRootParameterIdx::CBVInstanceIdx].InitAsConstantBufferView(
+		RasterShaderRegisters::CBVRegisters::CBVInstanceConstants,
+		0,
 		D3D12_SHADER_VISIBILITY_VERTEX
 	);
 
@@ -965,7 +962,17 @@ void DX12Renderer::CreateRootSignatures()
 		GlobalDescriptors::GetDescriptorRelativeOffset(SRVGBuffers, SRVMiddleTexture)
 	);
 
-	// Descriptor range for accumulation UAV.
+	// Descriptor range for the AO texture SRV.
+	CD3DX12_DESCRIPTOR_RANGE aoTextureSRVRange;
+	aoTextureSRVRange.Init(
+		D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+		GlobalDescriptors::GetDescriptorCount(SRVAOTexture),
+		middleTextureSRVRange.BaseShaderRegister + middleTextureSRVRange.NumDescriptors,
+		0,
+		GlobalDescriptors::GetDescriptorRelativeOffset(SRVGBuffers, SRVAOTexture)
+	);
+
+	// Descriptor range for accumulation UAVs.
 	CD3DX12_DESCRIPTOR_RANGE accumulationUAVRange;
 	accumulationUAVRange.Init(
 		D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
@@ -975,12 +982,59 @@ void DX12Renderer::CreateRootSignatures()
 		GlobalDescriptors::GetDescriptorRelativeOffset(SRVGBuffers, UAVAccumulationTexture)
 	);
 
-	std::array<CD3DX12_DESCRIPTOR_RANGE, 3> UAVSRVTable = { { gBufferSRVRange, middleTextureSRVRange, accumulationUAVRange } };
+	// Descriptor range for reprojection UAVs.
+	CD3DX12_DESCRIPTOR_RANGE reprojectionUAVRange;
+	reprojectionUAVRange.Init(
+		D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+		GlobalDescriptors::GetDescriptorCount(UAVReprojectionTexture),
+		accumulationUAVRange.BaseShaderRegister + accumulationUAVRange.NumDescriptors,
+		0,
+		GlobalDescriptors::GetDescriptorRelativeOffset(SRVGBuffers, UAVReprojectionTexture)
+	);
+
+	// Descriptor range for the AO texture UAV, which the accumulation pass overwrites with the accumulated AO.
+	CD3DX12_DESCRIPTOR_RANGE aoTextureUAVRange;
+	aoTextureUAVRange.Init(
+		D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+		GlobalDescriptors::GetDescriptorCount(UAVAOTexture),
+		reprojectionUAVRange.BaseShaderRegister + reprojectionUAVRange.NumDescriptors,
+		0,
+		GlobalDescriptors::GetDescriptorRelativeOffset(SRVGBuffers, UAVAOTexture)
+	);
+
+	// Descriptor range for the sample count texture UAV, which tells the accumulation pass the pixels that traced no rays.
+	CD3DX12_DESCRIPTOR_RANGE sampleCountUAVRange;
+	sampleCountUAVRange.Init(
+		D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+		GlobalDescriptors::GetDescriptorCount(UAVSampleCountTexture),
+		aoTextureUAVRange.BaseShaderRegister + aoTextureUAVRange.NumDescriptors,
+		0,
+		GlobalDescriptors::GetDescriptorRelativeOffset(SRVGBuffers, UAVSampleCountTexture)
+	);
+
+	std::array<CD3DX12_DESCRIPTOR_RANGE, 7> UAVSRVTable = { {
+		gBufferSRVRange, middleTextureSRVRange, aoTextureSRVRange, accumulationUAVRange, reprojectionUAVRange, aoTextureUAVRange, sampleCountUAVRange
+	} };
 	rootParameters[DefaultRootParameterIdx::UAVSRVTableIdx].InitAsDescriptorTable(
 		(UINT)UAVSRVTable.size(), 
 		UAVSRVTable.data(), 
 		D3D12_SHADER_VISIBILITY_PIXEL
 	);
+
+	// Index of the first instance of an instanced draw in the instance data, which SV_InstanceID is relative to.
+	rootParameters[DefaultRootParameterIdx::FirstInstanceIdx].InitAsConstants(
+		1,
+		RasterShaderRegisters::CBVRegisters::CBFirstInstance,
+		0,
+		D3D12_SHADER_VISIBILITY_VERTEX
+	);
+
+	// The instance data as a structured buffer, bound straight from the upload ring.
+	rootParameters[DefaultRootParameterIdx::SRVInstanceDataIdx].InitAsShaderResourceView(
+		RasterShaderRegisters::SRVRegisters::SRVInstanceData,
+		RasterShaderRegisters::SRVInstanceDataSpace,
+		D3D12_SHADER_VISIBILITY_VERTEX
+	);
 	
 
 	// Static general sampler for all shaders.
@@ -1004,7 +1058,9 @@ void DX12Renderer::RegisterRenderPasses()
 	for (RenderPassType passType : sPassesToRegister)
 	{
 		RegisterRenderPass(passType);
-		m_syncHandler.AddUniquePassSync(passType);
+
+		// One pooled command list per thread that can record the pass.
+		m_renderPasses[passType]->CreateCommandLists(m_device, std::min(m_jobSystem->GetThreadCount(), MaxRecordingContexts));
 	}
 }
 
@@ -1019,7 +1075,7 @@ void DX12Renderer::CreateRenderObjects()
 			{ { -0.43f, -0.25f, 0.0f }, { 0.0f, 1.0f, 0.0f } } // left
 		} };
 
-		m_renderObjectsByID[RenderObjectID::Triangle] = CreateRenderObject(&triangleData, nullptr, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		m_renderObjectsByID[RenderObjectID::Triangle] = CreateRenderObject(triangleData, {}, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	}
 
 	{
@@ -1049,8 +1105,9 @@ void DX12Renderer::CreateRenderObjects()
 
 	// Add obj model.
 	{
+		// The model is instanced many times and doesn't use vertex colors, so it uses the compact layout.
 		std::string modelPath = std::string(AssetsPath) + "Sphere.obj";
-		m_renderObjectsByID[RenderObjectID::OBJModel1] = CreateRenderObjectFromOBJ(modelPath, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		m_renderObjectsByID[RenderObjectID::OBJModel1] = CreateRenderObjectFromOBJ(modelPath, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, CompactVertexLayout);
 	}
 }
 
@@ -1067,89 +1124,256 @@ void DX12Renderer::CreateCamera()
 	m_activeCamera->SetPosAndDir({ 0.0f, 0.0f, -10.0f }, { 0.0f, 0.0f, 1.0f });
 }
 
-void DX12Renderer::CreateRenderInstances()
+void DX12Renderer::CreateRenderInstances()
+{
+	CreateSceneRenderInstances(m_renderInstancesByID);
+
+	std::unordered_map<RenderObjectID, BoundingBox> objectBoundsByID;
+	for (const auto& [renderObjectID, renderObject] : m_renderObjectsByID)
+	{
+		objectBoundsByID[renderObjectID] = renderObject.bounds;
+	}
+	m_instanceStore.Build(m_renderInstancesByID, objectBoundsByID);
+
+	for (RenderObjectID objectID : sRTRenderObjectIDs)
+	{
+		m_topLevelTrackersByID.emplace(objectID, BackBufferCount);
+	}
+
+	m_animatedInstanceOrigin = m_renderInstancesByID.at(RTRenderObjectID).front().instanceData.modelMatrix;
+}
+
+void DX12Renderer::SetRenderInstanceTransform(RenderObjectID renderObjectID, UINT instanceIndex, const DirectX::XMFLOAT4X4& model)
+{
+	m_renderInstancesByID.at(renderObjectID).at(instanceIndex).instanceData.modelMatrix = model;
+	m_instanceStore.SetTransform(renderObjectID, instanceIndex, model);
+
+	const auto trackerIt = m_topLevelTrackersByID.find(renderObjectID);
+	if (trackerIt != m_topLevelTrackersByID.end())
+	{
+		trackerIt->second.MarkTransformsDirty();
+	}
+}
+
+const TopLevelUpdateStats& DX12Renderer::GetTopLevelUpdateStats(RenderObjectID renderObjectID) const
+{
+	return m_topLevelTrackersByID.at(renderObjectID).GetStats();
+}
+
+void DX12Renderer::SetDenoiseSettings(const DenoiseSettings& settings)
+{
+	m_denoiseSettings = settings;
+}
+
+const DenoiseSettings& DX12Renderer::GetDenoiseSettings() const
+{
+	return m_denoiseSettings;
+}
+
+void DX12Renderer::SetAOResolutionMode(AOResolutionMode mode)
+{
+	m_aoResolutionMode = mode;
+}
+
+AOResolutionMode DX12Renderer::GetAOResolutionMode() const
+{
+	return m_aoResolutionMode;
+}
+
+void DX12Renderer::SetAdaptiveSamplingSettings(const AdaptiveSamplingSettings& settings)
+{
+	m_adaptiveSamplingSettings = settings;
+}
+
+const AdaptiveSamplingSettings& DX12Renderer::GetAdaptiveSamplingSettings() const
+{
+	return m_adaptiveSamplingSettings;
+}
+
+const AdaptiveSamplingStats& DX12Renderer::GetAdaptiveSamplingStats() const
+{
+	return m_adaptiveSamplingStats;
+}
+
+bool DX12Renderer::IsAdaptiveSamplingActive() const
+{
+	return m_adaptiveSamplingSettings.enabled && m_aoResolutionMode == AOResolutionMode::Full;
+}
+
+void DX12Renderer::ReadAdaptiveSamplingStats(UINT frameIndex)
+{
+	if (!m_hasAdaptiveSamplingStats[frameIndex])
+	{
+		return;
+	}
+
+	const CD3DX12_RANGE readRange(0, AdaptiveSamplingCounterCount * sizeof(UINT));
+	UINT* counters = nullptr;
+	m_adaptiveSamplingReadbackBuffers[frameIndex].resource->Map(0, &readRange, reinterpret_cast<void**>(&counters)) >> CHK_HR;
+
+	m_adaptiveSamplingStats.rayBudget = counters[AdaptiveSamplingCounterRayBudget];
+	m_adaptiveSamplingStats.requestedRayCount = counters[AdaptiveSamplingCounterRequestedRays];
+	m_adaptiveSamplingStats.rayCount = counters[AdaptiveSamplingCounterRays];
+	for (UINT bin = 0; bin < (UINT)m_adaptiveSamplingStats.histogram.size(); bin++)
+	{
+		m_adaptiveSamplingStats.histogram[bin] = counters[AdaptiveSamplingCounterHistogram + bin];
+	}
+
+	const CD3DX12_RANGE writtenRange(0, 0);
+	m_adaptiveSamplingReadbackBuffers[frameIndex].resource->Unmap(0, &writtenRange);
+	m_hasAdaptiveSamplingStats[frameIndex] = false;
+}
+
+void DX12Renderer::InitTransientResources()
+{
+	CreateTransientHeap();
+	CreateDepthBuffer();
+	CreateGBuffers();
+	CreateMiddleTexture();
+	CreateAOTexture();
+	CreateSampleCountTexture();
+	CreateDenoiseTextures();
+
+	// The views are created once every texture exists.
+	CreateRTVs();
+	CreateDSV();
+	CreateSRVs();
+	CreateUAVs();
+}
+
+void DX12Renderer::CreateTransientHeap()
 {
-	static UINT renderInstanceCount = 0;
+	// The lifetimes only depend on the passes, so the states that the graph is compiled with here don't matter.
+	m_frameGraph.Compile();
 
-	// Triangles.
+	std::vector<TransientResourceRequest> requests;
+	for (UINT resourceID = 0; resourceID < FrameGraphResourceCount; resourceID++)
 	{
-		std::vector<RenderInstance>& renderInstances = m_renderInstancesByID[RenderObjectID::Triangle];
+		if (!m_frameGraph.IsTransient(resourceID))
+		{
+			continue;
+		}
 
-		RenderInstance renderInstance = {};
+		const CD3DX12_RESOURCE_DESC resourceDesc = GetTransientResourceDesc((FrameGraphResourceID)resourceID);
+		const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &resourceDesc);
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(3.0f, 0.0f, 0.0f));
-		renderInstances.push_back(renderInstance);
+		requests.push_back({ resourceID, allocationInfo.SizeInBytes, allocationInfo.Alignment });
+	}
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(-3.0f, 0.0f, 0.0f));
-		renderInstances.push_back(renderInstance);
+	m_transientHeapLayout = PackTransientResources(m_frameGraph, requests);
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(-6.0f, 0.0f, 0.0f));
-		renderInstances.push_back(renderInstance);
+	// Every transient is a render target or a depth buffer, which is the one heap category that they can share on every
+	// resource heap tier.
+	const D3D12_HEAP_DESC heapDesc = {
+		.SizeInBytes = m_transientHeapLayout.heapSize,
+		.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		.Alignment = m_transientHeapLayout.heapAlignment,
+		.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES
+	};
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(6.0f, 0.0f, 0.0f));
-		renderInstances.push_back(renderInstance);
+	m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_transientHeap)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_transientHeap, DX12Renderer);
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(0.0f, 0.0f, 0.0f));
-		renderInstances.push_back(renderInstance);
-	}
+	OutputDebugMessage("Transient heap: " + std::to_string(m_transientHeapLayout.heapSize >> 20) + " MiB instead of " +
+		std::to_string(m_transientHeapLayout.unaliasedSize >> 20) + " MiB, " + std::to_string(m_transientHeapLayout.GetSavedBytes() >> 20) + " MiB saved by aliasing\n");
+}
 
+GPUResource DX12Renderer::CreateTransientResource(FrameGraphResourceID resourceID, D3D12_RESOURCE_STATES initialState)
+{
+	const CD3DX12_RESOURCE_DESC resourceDesc = GetTransientResourceDesc(resourceID);
+
+	D3D12_CLEAR_VALUE optimizedClearValue = { .Format = resourceDesc.Format };
+	if (resourceDesc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+	{
+		optimizedClearValue.DepthStencil = { 1.0f, 0 };
+	}
+	else
 	{
-		std::vector<RenderInstance>& renderInstances = m_renderInstancesByID[RenderObjectID::OBJModel1];
+		std::copy(std::begin(OptimizedClearColor), std::end(OptimizedClearColor), optimizedClearValue.Color);
+	}
+
+	return CreatePlacedResource(
+		m_device,
+		m_transientHeap,
+		m_transientHeapLayout.GetPlacement(resourceID).offset,
+		resourceDesc,
+		initialState,
+		&optimizedClearValue
+	);
+}
 
-		RenderInstance renderInstance = {};
+CD3DX12_RESOURCE_DESC DX12Renderer::GetTransientResourceDesc(FrameGraphResourceID resourceID) const
+{
+	switch (resourceID)
+	{
+	case FrameGraphGBufferDiffuse:
+	case FrameGraphGBufferNormal:
+	case FrameGraphGBufferWorldPos:
+	{
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+			GBufferFormats[resourceID - FrameGraphGBufferDiffuse],
+			m_width,
+			m_height
+		);
+		resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(0.0f, 0.0f, -5.0f));
-		renderInstances.push_back(renderInstance);
+		return resourceDesc;
 	}
-
+	case FrameGraphMiddleTexture:
 	{
-		std::vector<RenderInstance>& renderInstances = m_renderInstancesByID[RenderObjectID::Cube];
+		CD3DX12_RESOURCE_DESC resourceDesc = CreateBackbufferResourceDesc(m_width, m_height);
 
-		RenderInstance renderInstance = {};
+		// Render target of the lighting pass, which the composite pass reads.
+		resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-		renderInstance.CBIndex = renderInstanceCount++;
-		dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(0.0f, 0.0f, -5.0f));
-		renderInstances.push_back(renderInstance);	
+		return resourceDesc;
 	}
+	case FrameGraphAOTexture:
+	// Full size, so the resolution mode can change without creating the transient resources again.
+	case FrameGraphAOTraceTexture:
+	{
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(AOTextureFormat, m_width, m_height);
+
+		// Only written as an unordered access view, the render target flag lets it share the heap with the other transients.
+		resourceDesc.Flags =
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS |
+			D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-	// Raytracing render objects.
+		return resourceDesc;
+	}
+	case FrameGraphSampleCountTexture:
 	{
-		std::vector<RenderInstance>& rtRenderInstances = m_renderInstancesByID[RTRenderObjectID];
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(SampleCountTextureFormat, m_width, m_height);
 
-		int offset = 2;
-		float scale = 8.0f;
-		int randomOffset = 5;
-		int halfRandomOffset = randomOffset / 2;
+		// Only used as an unordered access view, like the AO texture.
+		resourceDesc.Flags =
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS |
+			D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-		RenderInstance renderInstance = {};
-		int maxZ = 7;
-		int maxYX = 7;
-		for (int z = 0; z < maxZ; z++)
-		{
-			float zPos = (z - (maxZ / 2)) * scale;
-			for (int x = 0; x < maxYX; x++)
-			{
-				float xPos = (x - (maxYX / 2)) * scale;
-				for (int y = 0; y < maxYX; y++)
-				{
-					float yPos = (y - (maxYX / 2)) * scale;
+		return resourceDesc;
+	}
+	case FrameGraphDenoiseTexture0:
+	case FrameGraphDenoiseTexture1:
+	{
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DenoiseTextureFormat, m_width, m_height);
 
-					float zRandPos = zPos + ((rand() % randomOffset) - randomOffset);
-					float yRandPos = yPos + ((rand() % randomOffset) - randomOffset);
-					float xRandPos = xPos + ((rand() % randomOffset) - randomOffset);
+		// Only used as unordered access views, the render target flag lets them share the heap with the other transients.
+		resourceDesc.Flags =
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS |
+			D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-					renderInstance.CBIndex = renderInstanceCount++;
-					dx::XMStoreFloat4x4(&renderInstance.instanceData.modelMatrix, dx::XMMatrixTranslation(xRandPos, yRandPos, zRandPos));
-					rtRenderInstances.push_back(renderInstance);
-				}
-			}
-		}
+		return resourceDesc;
+	}
+	case FrameGraphDepthBuffer:
+		return CD3DX12_RESOURCE_DESC::Tex2D(
+			DXGI_FORMAT_D32_FLOAT,
+			m_width,
+			m_height,
+			1, 0, 1, 0,
+			D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL
+		);
+	default:
+		throw std::runtime_error("Frame graph resource is not transient.");
 	}
 }
 
@@ -1164,25 +1388,48 @@ void DX12Renderer::InitRaytracing()
 
 void DX12Renderer::CreateAccelerationStructures()
 {
-	m_directCommandQueue->ResetAllocator();
-	auto commandList = m_directCommandQueue->CreateCommandList(m_device);
+	CreateBottomLevelASs();
+}
 
-	CreateBottomLevelASs(commandList);
+void DX12Renderer::CreateBottomLevelASs()
+{
+	// The geometry never changes, so the acceleration structures are built for fast traces and compacted.
+	m_bottomLevelASManager = std::make_unique<BottomLevelASManager>(m_device, BottomLevelBuildPolicy(), (UINT)sRTRenderObjectIDs.size());
 
-	commandList->Close();
+	// Every step needs the GPU work of the step before it to be finished.
+	auto executeAndWait = [this](auto&& record)
+	{
+		m_directCommandQueue->ResetAllocator();
+		auto commandList = m_directCommandQueue->CreateCommandList(m_device);
 
-	DX12Abstractions::CommandListVector commandLists = { commandList };
-	m_directCommandQueue->ExecuteCommandLists(commandLists);
+		record(commandList);
 
-	m_directCommandQueue->SignalAndWait();
-}
+		commandList->Close();
 
-void DX12Renderer::CreateBottomLevelASs(ComPtr<ID3D12GraphicsCommandList4> commandList)
-{
-	for (const RenderObjectID objectID : sRTRenderObjectIDs)
+		DX12Abstractions::CommandListVector commandLists = { commandList };
+		m_directCommandQueue->ExecuteCommandLists(commandLists);
+
+		m_directCommandQueue->SignalAndWait();
+	};
+
+	executeAndWait([this](ComPtr<ID3D12GraphicsCommandList4> commandList)
 	{
-		CreateBottomLevelAccelerationStructure(objectID, commandList);
-	}
+		BarrierBatcher barrierBatcher;
+		for (const RenderObjectID objectID : sRTRenderObjectIDs)
+		{
+			CreateBottomLevelAccelerationStructure(objectID, commandList);
+		}
+		m_bottomLevelASManager->RecordCompactedSizeReadback(commandList, barrierBatcher);
+	});
+
+	executeAndWait([this](ComPtr<ID3D12GraphicsCommandList4> commandList)
+	{
+		m_bottomLevelASManager->RecordCompaction(commandList);
+	});
+
+	m_bottomLevelASManager->ReleaseBuildMemory();
+
+	OutputDebugMessage(FormatBottomLevelASStats(m_bottomLevelASManager->GetStats()));
 }
 
 void DX12Renderer::CreateBottomLevelAccelerationStructure(RenderObjectID objectID, ComPtr<ID3D12GraphicsCommandList4> commandList)
@@ -1200,67 +1447,14 @@ void DX12Renderer::CreateBottomLevelAccelerationStructure(RenderObjectID objectI
 	geomDesc[0].Triangles.IndexFormat = renderObject.indexBufferView.Format;
 	geomDesc[0].Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
 
-	// Get the size requirements for the scratch and AS buffers
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
-	inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-	inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
-	inputs.NumDescs = ARRAYSIZE(geomDesc);
-	inputs.pGeometryDescs = geomDesc;
-	inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-
-	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
-	m_device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
-
-	AccelerationStructureBuffers& bottomLevelAccStruct = m_bottomAccStructByID[objectID];
-
-	// Create scratch resource.
-	{
-		CD3DX12_RESOURCE_DESC bottomScratchResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(
-			info.ScratchDataSizeInBytes,
-			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
-		);
-
-		bottomLevelAccStruct.scratch = CreateResource(
-			m_device,
-			bottomScratchResourceDesc,
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-			D3D12_HEAP_TYPE_DEFAULT
-		);
-
-		NAME_D3D12_OBJECT_MEMBER(bottomLevelAccStruct.scratch, DX12Renderer);
-	}
-
-	// Create result resource.
-	{
-		CD3DX12_RESOURCE_DESC bottomResultResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(
-			info.ResultDataMaxSizeInBytes,
-			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
-		);
-
-		bottomLevelAccStruct.result = CreateResource(
-			m_device,
-			bottomResultResourceDesc,
-			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-			D3D12_HEAP_TYPE_DEFAULT
-		);
-
-		NAME_D3D12_OBJECT_MEMBER(bottomLevelAccStruct.result, DX12Renderer);
-	}
-
-	// Create the bottom-level AS
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC asDesc = {};
-	asDesc.Inputs = inputs;
-	asDesc.DestAccelerationStructureData = bottomLevelAccStruct.result.resource->GetGPUVirtualAddress();
-	asDesc.ScratchAccelerationStructureData = bottomLevelAccStruct.scratch.resource->GetGPUVirtualAddress();
-
-	commandList->BuildRaytracingAccelerationStructure(&asDesc, 0, nullptr);
+	m_bottomLevelASManager->Build(objectID, "RenderObject" + std::to_string((uint32_t)objectID), geomDesc, commandList);
 }
 
 void FrameResource::CreateTopLevelAS(ComPtr<ID3D12Device5> device, RenderObjectID renderObjectID)
 {
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
 	inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-	inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+	inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
 	inputs.NumDescs = MaxRTInstancesPerTopLevel;
 	inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 
@@ -1269,7 +1463,9 @@ void FrameResource::CreateTopLevelAS(ComPtr<ID3D12Device5> device, RenderObjectI
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
 	device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(info.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	// The same scratch buffer is used for full builds and for refits.
+	const UINT64 scratchSize = std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes);
+	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 	topAccStruct.scratch = CreateResource(
 		device,
 		resourceDesc,
@@ -1289,9 +1485,6 @@ void FrameResource::CreateTopLevelAS(ComPtr<ID3D12Device5> device, RenderObjectI
 
 	NAME_D3D12_OBJECT_MEMBER(topAccStruct.result, FrameResource);
 
-	resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * inputs.NumDescs);
-	topAccStruct.instanceDesc = CreateUploadResource(device, resourceDesc);
-
 	topAccStructByID[renderObjectID] = topAccStruct;
 }
 
@@ -1487,10 +1680,12 @@ void DX12Renderer::CreateRayGenLocalRootSignature(ComPtr<ID3D12RootSignature>& r
 		);
 		rootParameters[RTRayGenParameterIdx::RayGenSRVTableGbuffersIdx].InitAsDescriptorTable(1, &srvRangeGbuffers, D3D12_SHADER_VISIBILITY_ALL);
 
-		// Add root descriptor for UAV that is going to be written to.
+		// Add root descriptor for the UAVs that are going to be written to, the AO texture followed by the trace texture, and
+		// the sample count texture that is read.
 		uavRange.Init(
 			D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 
-			GlobalDescriptors::GetDescriptorCount(UAVMiddleTexture), 
+			GlobalDescriptors::GetDescriptorCount(UAVAOTexture) + GlobalDescriptors::GetDescriptorCount(UAVAOTraceTexture) +
+			GlobalDescriptors::GetDescriptorCount(UAVSampleCountTexture), 
 			RTShaderRegisters::UAVRegistersRayGen::UAVDescriptorRegister
 		);
 		rootParameters[RTRayGenParameterIdx::RayGenUAVTableIdx].InitAsDescriptorTable(1, &uavRange, D3D12_SHADER_VISIBILITY_ALL);
@@ -1534,7 +1729,7 @@ void DX12Renderer::CreateGlobalRootSignature(ComPtr<ID3D12RootSignature>& rootSi
 	std::array<CD3DX12_ROOT_PARAMETER, RTGlobalParameterIdx::RTGlobalParameterCount> rootParameters = {};
 	{
 		rootParameters[RTGlobalParameterIdx::Global32BitConstantIdx].InitAsConstants(
-			1,
+			sizeof(RaytracedAOConstants) / 4,
 			RTShaderRegisters::ConstantRegistersGlobal::ConstantRegister
 		);
 	}
@@ -1551,6 +1746,8 @@ void DX12Renderer::CreateGlobalRootSignature(ComPtr<ID3D12RootSignature>& rootSi
 
 void DX12Renderer::InitFrameResources()
 {
+	m_uploadRing = std::make_unique<UploadRingBuffer>(m_device, UploadRingSize);
+
 	FrameResource::FrameResourceInputs inputs = {
 		.device = m_device,
 		.viewPort = m_viewport,
@@ -1582,18 +1779,18 @@ void FrameResource::CreateShaderTables(FrameResourceInputs inputs)
 			unsigned char ShaderIdentifier[D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES];
 			UINT64 SRVDescriptorTableTopLevelAS;
 			UINT64 SRVDescriptorTableGbuffers;
-			UINT64 UAVDescriptorTableMiddleTexture;
+			UINT64 UAVDescriptorTableAOTexture;
 		} tableData;
 
-		// Set the descriptor table start for middle texture.
+		// Set the descriptor table start for the AO texture.
 		{
 			CD3DX12_GPU_DESCRIPTOR_HANDLE uavHandle(inputs.cbvSrvUavHeapGlobal->GetGPUDescriptorHandleForHeapStart());
 			uavHandle.Offset(
-				GlobalDescriptors::GetDescriptorOffset(UAVMiddleTexture),
+				GlobalDescriptors::GetDescriptorOffset(UAVAOTexture),
 				inputs.cbvSrvUavDescriptorSize
 			);
 		
-			tableData.UAVDescriptorTableMiddleTexture = uavHandle.ptr;
+			tableData.UAVDescriptorTableAOTexture = uavHandle.ptr;
 		}
 
 		// Set TLAS SRV.
@@ -1794,16 +1991,8 @@ void DX12Renderer::UpdateCamera()
 {
 	// Update camera before rendering.
 	dx::XMVECTOR startPos = dx::XMVectorSet(11.0f, 16.0f, -35.0f, 1.0f);
-	float angle;
-
-	if (HasRenderPass(sRenderPassOrder, AccumulationPass))
-	{
-		angle = 0.0f;
-	}
-	else
-	{
-		angle = m_time * dx::XM_2PI / 20.0f;
-	}
+	// The accumulation pass reprojects its history, so the camera keeps moving when it's enabled.
+	float angle = m_time * dx::XM_2PI / 20.0f;
 
 #if defined(TESTING) // Don't spin during testing, no matter what.
 	angle = 0.0f;
@@ -1817,267 +2006,307 @@ void DX12Renderer::UpdateCamera()
 	m_activeCamera->UpdateViewProjectionMatrix();
 }
 
-void DX12Renderer::BuildRenderPipeline(UINT context)
+void DX12Renderer::UpdateAnimatedInstance()
 {
-	bool validContext = context < NumContexts;
-	assert(validContext);
-
-#if !defined(SINGLE_THREAD)
-	while (validContext) // This looks like a busy wait but right below it will idle wait until woken up.
-	{
-#endif
-		// Wait for start sync.
-		m_syncHandler.WaitStart(context);
-
-#if !defined(SINGLE_THREAD)
-		if (m_forceExitThread)
-		{
-			break;
-		}
-#endif
-
-		UINT currentFrameIndex = m_currentFrameResource->GetFrameIndex();
+	// Only the transform changes, so the instance count stays the same and the copies are refit.
+	DirectX::XMFLOAT4X4 model = m_animatedInstanceOrigin;
+	model._42 += 4.0f * std::sin(m_time * dx::XM_2PI / 4.0f);
+	SetRenderInstanceTransform(RTRenderObjectID, 0, model);
+}
 
-		// Get RTV handle for the current back buffer.
-		const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVBackBuffers, currentFrameIndex);
+UINT DX12Renderer::GetHistoryIndex() const
+{
+	return m_frameCount % AccumulationTextureCount;
+}
 
-		const CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVMiddleTexture);
+void DX12Renderer::CullRenderInstances()
+{
+	DirectX::XMFLOAT4X4 viewProjection;
+	dx::XMStoreFloat4x4(&viewProjection, m_activeCamera->GetViewProjectionMatrix());
+	const FrustumPlanes frustum = ExtractFrustumPlanes(viewProjection);
 
-		// Common args for all passes.
-		CommonRenderPassArgs commonArgs = {
-			.depthStencilView = GetGlobalDSVHandle(GlobalDescriptorNames::DSVScene),
-			.rootSignature = m_rasterRootSignature,
-			.viewport = m_viewport,
-			.scissorRect = m_scissorRect,
+	for (const auto& it : m_renderInstancesByID)
+	{
+		CullInstanceRange(frustum, m_instanceStore, m_instanceStore.GetRange(it.first), m_visibleInstancesByID[it.first]);
+	}
+}
 
-			.cbvSrvUavHeapGlobal = m_cbvSrvUavHeapGlobal,
-			.cbvSrvUavDescSize = m_cbvSrvUavDescriptorSize,
+std::vector<RenderPackage> DX12Renderer::CreateRenderPackages(const DX12RenderPass& renderPass)
+{
+	// Build render packages to send to render.
+	std::vector<RenderPackage> renderPackages;
+	for (RenderObjectID renderID : renderPass.GetRenderableObjects())
+	{
+		RenderObject& renderObject = m_renderObjectsByID[renderID];
+		std::vector<RenderInstance>& instances = m_renderInstancesByID[renderID];
 
-			.globalFrameDataResource = m_currentFrameResource->globalFrameDataCB,
-			.viewProjectionMatrix = m_activeCamera->GetViewProjectionMatrix()
+		RenderPackage renderPackage = {
+			.renderObject = &renderObject,
+			.renderInstances = &instances
 		};
 
-		CommonRaytracingRenderPassArgs commonRTArgs = {
-			.cbvSrvUavHeap = m_cbvSrvUavHeapGlobal,
-			.cbvSrvUavDescSize = m_cbvSrvUavDescriptorSize,
+		if constexpr (ActiveInstanceCullingMode == InstanceCullingMode::CPU)
+		{
+			renderPackage.visibleInstances = &m_visibleInstancesByID[renderID];
+		}
 
-			.globalRootSig = m_RTGlobalRootSignature,
+		renderPackages.push_back(std::move(renderPackage));
+	}
 
-			.rayGenShaderTable = &m_currentFrameResource->rayGenShaderTable,
-			.hitGroupShaderTable = &m_currentFrameResource->hitGroupShaderTable,
-			.missShaderTable = &m_currentFrameResource->missShaderTable
-		};
+	return renderPackages;
+}
 
-		for (UINT passIndex = 0; passIndex < sRenderPassOrder.size(); passIndex++)
-		{
-			bool isLastRenderPass = passIndex == (sRenderPassOrder.size() - 1);
+void DX12Renderer::RecordRenderPass(RenderPassType renderPassType, UINT graphPass, bool isLastRenderPass, const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex)
+{
+	DX12RenderPass& renderPass = *m_renderPasses.at(renderPassType);
+	const std::vector<RenderObjectID>& passObjectIDs = renderPass.GetRenderableObjects();
+	const FrameGraphCompiledPass& compiledPass = m_frameGraph.GetCompiledPass(graphPass);
 
-			RenderPassType renderPassType = sRenderPassOrder[passIndex];
-			DX12RenderPass& renderPass = *m_renderPasses[renderPassType];
+	renderPass.Init(frameIndex, context);
 
-			if (renderPass.IsContextAllowedToBuild(context))
-			{
-				const std::vector<RenderObjectID>& passObjectIDs = renderPass.GetRenderableObjects();
+	// Get RTV handle for the current back buffer.
+	const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVBackBuffers, frameIndex);
 
-				// Build render packages to send to render.
-				std::vector<RenderPackage> renderPackages;
-				for (RenderObjectID renderID : passObjectIDs)
-				{
-					RenderObject& renderObject = m_renderObjectsByID[renderID];
-					std::vector<RenderInstance>& instances = m_renderInstancesByID[renderID];
+	const CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVMiddleTexture);
 
-					RenderPackage renderPackage = {
-						.renderObject = &renderObject,
-						.renderInstances = &instances
-					};
+	// Common args for all passes.
+	CommonRenderPassArgs commonArgs = {
+		.depthStencilView = GetGlobalDSVHandle(GlobalDescriptorNames::DSVScene),
+		.rootSignature = m_rasterRootSignature,
+		.viewport = m_viewport,
+		.scissorRect = m_scissorRect,
 
-					renderPackages.push_back(std::move(renderPackage));
-				}
+		.cbvSrvUavHeapGlobal = m_cbvSrvUavHeapGlobal,
+		.cbvSrvUavDescSize = m_cbvSrvUavDescriptorSize,
 
-				// Only try to render if there actually is anything to render.
-				// If the render pass does not have any objects at all then it is assumed it doesn't need them to fulfill its task.
-				if (renderPackages.size() > 0 || passObjectIDs.size() == 0)
-				{
-					RenderPassArgs renderPassArgs;
+		.globalFrameDataAddress = m_currentFrameResource->globalFrameDataAddress,
+		.instanceConstantsAddress = m_currentFrameResource->instanceConstantsAddress,
+		.viewProjectionMatrix = m_activeCamera->GetViewProjectionMatrix()
+	};
 
-					if (renderPassType == NonIndexedPass)
-					{
-						renderPassArgs = NonIndexedRenderPassArgs{
-							.commonArgs = commonArgs,
-							.RTV = bbRTV
-						};
-					}
-					else if (renderPassType == IndexedPass)
-					{
-						renderPassArgs = IndexedRenderPassArgs{
-							.commonArgs = commonArgs,
-							.RTV = bbRTV
-						};
-					}
-					else if (renderPassType == DeferredGBufferPass)
-					{
-						// Get RTV handle for the first GBuffer.
-						const CD3DX12_CPU_DESCRIPTOR_HANDLE firstGBufferRTVHandle = GetGlobalRTVHandle(GlobalDescriptorNames::RTVGBuffers);
+	CommonRaytracingRenderPassArgs commonRTArgs = {
+		.cbvSrvUavHeap = m_cbvSrvUavHeapGlobal,
+		.cbvSrvUavDescSize = m_cbvSrvUavDescriptorSize,
 
-						renderPassArgs = DeferredGBufferRenderPassArgs{
-							.commonArgs = commonArgs,
-							.firstGBufferRTVHandle = firstGBufferRTVHandle
-						};
-					}
-					else if (renderPassType == DeferredLightingPass)
-					{
-						if (context == 0)
-						{
-							auto commandList = renderPass.GetFirstCommandList(currentFrameIndex);
-
-							D3D12_RESOURCE_STATES gBufferResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-							// Using the concept of better resource transitions depending on what type of render pipeline we have.
-							// If we know that a raytraced AO pass will come, we make sure that it also can be used outside of a pixel shader.
-							if (HasRenderPass(sRenderPassOrder, RaytracedAOPass))
-							{
-								gBufferResourceState |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
-							}
-
-							// Resource barrier for g buffers.
-							TransitionGBuffers(commandList, gBufferResourceState);
-						}
-
-						renderPassArgs = DeferredLightingRenderPassArgs{
-							.commonArgs = commonArgs,
-							.RTV = isLastRenderPass ? bbRTV : middleTextureRTV
-						};
-					}
-					else if (renderPassType == RaytracedAOPass)
-					{
-						if (context == 0)
-						{
-							auto commandList = renderPass.GetFirstCommandList(currentFrameIndex);
-
-							// Put resource barrier.
-							CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(m_middleTexture.Get());
-							commandList->ResourceBarrier(1, &uavBarrier);
-						}
-
-						std::vector<RayTracingRenderPackage> rayTracingRenderPackages;
-						for (RenderObjectID renderObjectID : passObjectIDs)
-						{
-							RayTracingRenderPackage rtRenderPackage;
-
-							rtRenderPackage.topLevelASBuffers = &m_currentFrameResource->topAccStructByID[renderObjectID];
-							rtRenderPackage.instanceCount = (UINT)m_renderInstancesByID[renderObjectID].size();
-
-							rayTracingRenderPackages.push_back(rtRenderPackage);
-						}
-
-						renderPassArgs = RaytracedAORenderPassArgs{
-							.commonRTArgs = commonRTArgs,
-							.stateObject = m_RTPipelineState,
-							.frameCount = m_frameCount,
-							.screenWidth = m_width,
-							.screenHeight = m_height,
-							.renderPackages = rayTracingRenderPackages
-						};
-					}
-					else if (renderPassType == AccumulationPass)
-					{
-						if (context == 0)
-						{
-							auto commandList = renderPass.GetFirstCommandList(currentFrameIndex);
+		.globalRootSig = m_RTGlobalRootSignature,
 
-							m_middleTexture.TransitionTo(D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, commandList);
+		.rayGenShaderTable = &m_currentFrameResource->rayGenShaderTable,
+		.hitGroupShaderTable = &m_currentFrameResource->hitGroupShaderTable,
+		.missShaderTable = &m_currentFrameResource->missShaderTable
+	};
+
+	// Only try to render if there actually is anything to render.
+	// If the render pass does not have any objects at all then it is assumed it doesn't need them to fulfill its task.
+	const bool hasWork = renderPackages.size() > 0 || passObjectIDs.size() == 0;
+	RenderPassArgs renderPassArgs;
+	if (hasWork)
+	{
+		if (renderPassType == NonIndexedPass)
+		{
+			renderPassArgs = NonIndexedRenderPassArgs{
+				.commonArgs = commonArgs,
+				.RTV = bbRTV
+			};
+		}
+		else if (renderPassType == IndexedPass)
+		{
+			renderPassArgs = IndexedRenderPassArgs{
+				.commonArgs = commonArgs,
+				.RTV = bbRTV
+			};
+		}
+		else if (renderPassType == DeferredGBufferPass)
+		{
+			// Get RTV handle for the first GBuffer.
+			const CD3DX12_CPU_DESCRIPTOR_HANDLE firstGBufferRTVHandle = GetGlobalRTVHandle(GlobalDescriptorNames::RTVGBuffers);
 
-							// Put UAV barrier before use.
-							CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(m_accumulationTexture.Get());
-							commandList->ResourceBarrier(1, &uavBarrier);
+			renderPassArgs = DeferredGBufferRenderPassArgs{
+				.commonArgs = commonArgs,
+				.firstGBufferRTVHandle = firstGBufferRTVHandle
+			};
+		}
+		else if (renderPassType == DeferredLightingPass)
+		{
+			renderPassArgs = DeferredLightingRenderPassArgs{
+				.commonArgs = commonArgs,
+				.RTV = isLastRenderPass ? bbRTV : middleTextureRTV
+			};
+		}
+		else if (renderPassType == RaytracedAOPass)
+		{
+			std::vector<RayTracingRenderPackage> rayTracingRenderPackages;
+			for (RenderObjectID renderObjectID : passObjectIDs)
+			{
+				RayTracingRenderPackage rtRenderPackage;
 
-							// This only affects the frame AFTER as the original value has already been uploaded to a constant buffer.
-							m_accumulatedFrames += 1;
-						}
+				rtRenderPackage.topLevelASBuffers = &m_currentFrameResource->topAccStructByID[renderObjectID];
+				rtRenderPackage.instanceCount = (UINT)m_renderInstancesByID[renderObjectID].size();
+				rtRenderPackage.buildType = m_currentFrameResource->topLevelBuildTypesByID.at(renderObjectID);
 
-						renderPassArgs = AccumulationRenderPassArgs{
-							.commonArgs = commonArgs,
-							.RTVTargetFrame = bbRTV
-						};
-					}
-					else
-					{
-						throw std::runtime_error("Unknown render pass type.");
-					}
+				rayTracingRenderPackages.push_back(rtRenderPackage);
+			}
 
-					// Build the render pass.
-					renderPass.BuildRenderPass(renderPackages, context, currentFrameIndex, &renderPassArgs);
-				}
+			renderPassArgs = RaytracedAORenderPassArgs{
+				.commonRTArgs = commonRTArgs,
+				.stateObject = m_RTPipelineState,
+				.frameCount = m_frameCount,
+				.screenWidth = m_width,
+				.screenHeight = m_height,
+				.resolutionMode = m_aoResolutionMode,
+				.isAdaptiveSamplingEnabled = IsAdaptiveSamplingActive(),
+				.renderPackages = rayTracingRenderPackages
+			};
+		}
+		else if (renderPassType == AdaptiveSamplingPass)
+		{
+			// The pass has a single context, so this runs once per frame.
+			m_hasAdaptiveSamplingStats[frameIndex] = IsAdaptiveSamplingActive();
+
+			// GPUResource overloads operator& for out parameters, hence std::addressof().
+			renderPassArgs = AdaptiveSamplingRenderPassArgs{
+				.commonArgs = commonArgs,
+				.frameCount = m_frameCount,
+				.screenWidth = m_width,
+				.screenHeight = m_height,
+				.settings = m_adaptiveSamplingSettings,
+				.isEnabled = IsAdaptiveSamplingActive(),
+				.counterBuffer = std::addressof(m_adaptiveSamplingCounterBuffer),
+				.readbackBuffer = std::addressof(m_adaptiveSamplingReadbackBuffers[frameIndex])
+			};
+		}
+		else if (renderPassType == AOUpsamplePass)
+		{
+			renderPassArgs = AOUpsampleRenderPassArgs{
+				.commonArgs = commonArgs,
+				.frameCount = m_frameCount,
+				.screenWidth = m_width,
+				.screenHeight = m_height,
+				.resolutionMode = m_aoResolutionMode
+			};
+		}
+		else if (renderPassType == DenoisePass)
+		{
+			renderPassArgs = DenoiseRenderPassArgs{
+				.commonArgs = commonArgs,
+				.screenWidth = m_width,
+				.screenHeight = m_height,
+				.settings = m_denoiseSettings
+			};
+		}
+		else if (renderPassType == AccumulationPass)
+		{
+			if (context == 0)
+			{
+				// This only affects the frame AFTER as the original value has already been uploaded to a constant buffer.
+				m_accumulatedFrames += 1;
 			}
 
-			// Signal that pass is done.
-			m_syncHandler.SetPass(context, renderPassType);
-			
-			m_renderPasses[renderPassType]->Close(currentFrameIndex, context);
+			renderPassArgs = AccumulationRenderPassArgs{
+				.commonArgs = commonArgs
+			};
+		}
+		else if (renderPassType == CompositePass)
+		{
+			renderPassArgs = CompositeRenderPassArgs{
+				.commonArgs = commonArgs,
+				.RTV = bbRTV
+			};
+		}
+		else
+		{
+			throw std::runtime_error("Unknown render pass type.");
 		}
+	}
+
+	// The first context starts the pass and the last one ends it, as their command lists are executed in that order.
+	if (context == 0)
+	{
+		BeginRenderPass(renderPass, compiledPass, renderPackages, frameIndex, hasWork ? &renderPassArgs : nullptr);
+	}
 
-		// Signal end sync.
-		m_syncHandler.SetEnd(context);
+	// Build the render pass.
+	if (hasWork)
+	{
+		renderPass.BuildRenderPass(renderPackages, context, frameIndex, &renderPassArgs);
+	}
 
-#if !defined(SINGLE_THREAD)
+	// Flushed by Close().
+	if (context == renderPass.GetActiveContextCount(frameIndex) - 1)
+	{
+		AddFrameGraphBarriers(renderPass.GetBarrierBatcher(context, frameIndex), compiledPass.barriersAfter, frameIndex);
 	}
-#endif
+
+	renderPass.Close(frameIndex, context);
 }
 
-void FrameResource::UpdateInstanceConstantBuffers(const FrameResourceUpdateInputs& inputs)
+void DX12Renderer::BeginRenderPass(DX12RenderPass& renderPass, const FrameGraphCompiledPass& compiledPass, const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
-	// Copy through byte offsets.
-	uint8_t* instanceDataStart = nullptr;
-	perInstanceCB.resource->Map(0, nullptr, reinterpret_cast<void**>(&instanceDataStart)) >> CHK_HR;
-	constexpr UINT perInstanceSize = DX12Abstractions::CalculateConstantBufferByteSize(sizeof(InstanceConstants));
+	BarrierBatcher& barrierBatcher = renderPass.GetBarrierBatcher(0, frameIndex);
 
-	for (const auto& it : inputs.renderInstancesByID)
+	// The transitions before the pass are split around the prologue. Its first flush begins them and the flush after it
+	// ends them, so the GPU does them while the prologue runs.
+	const bool hasPrologue = pipelineArgs != nullptr && renderPass.HasPrologue();
+	AddFrameGraphBarriers(barrierBatcher, compiledPass.barriersBefore, frameIndex, hasPrologue);
+	if (hasPrologue)
 	{
-		RenderObjectID renderObjectID = it.first;
-		const std::vector<RenderInstance>& renderInstances = it.second;
+		renderPass.RecordPrologue(renderPackages, frameIndex, pipelineArgs);
+		barrierBatcher.EndSplitTransitions();
+	}
 
-		for (const RenderInstance& renderInstance : renderInstances)
-		{
-			uint8_t* instanceData = instanceDataStart + renderInstance.CBIndex * perInstanceSize;
-			memcpy(instanceData, &renderInstance.instanceData, sizeof(InstanceConstants));
-		}
+	InitializeTransientResources(renderPass.GetFirstCommandList(frameIndex), barrierBatcher, compiledPass.initializations, frameIndex);
+}
+
+void FrameResource::UpdateInstanceConstantBuffers(const FrameResourceUpdateInputs& inputs)
+{
+	const UINT instanceCount = inputs.instanceStore.GetInstanceCount();
+	if (instanceCount == 0)
+	{
+		instanceConstantsAddress = 0;
+		return;
 	}
 
-	perInstanceCB.resource->Unmap(0, nullptr);
+	// The ring stays mapped, so the constants are written with plain stores through byte offsets. The store keeps the
+	// transforms and CB indices in flat arrays, so this is a linear walk without any map lookups.
+	UploadAllocation allocation = inputs.uploadRing.Allocate(instanceCount * InstanceConstantsStride);
+	instanceConstantsAddress = allocation.gpuAddress;
+
+	static_assert(sizeof(InstanceConstants) == sizeof(DirectX::XMFLOAT4X4), "The store only holds the model matrix of the instance constants.");
+	const std::span<const DirectX::XMFLOAT4X4> transforms = inputs.instanceStore.GetTransforms();
+	const std::span<const UINT> cbIndices = inputs.instanceStore.GetCBIndices();
+	for (UINT i = 0; i < instanceCount; i++)
+	{
+		uint8_t* instanceData = allocation.cpuAddress + cbIndices[i] * InstanceConstantsStride;
+		memcpy(instanceData, &transforms[i], sizeof(InstanceConstants));
+	}
 }
 
 void FrameResource::UpdateGlobalFrameDataBuffer(const FrameResourceUpdateInputs& inputs)
 {
-	GlobalFrameData globalFrameData = inputs.globalFrameData;
-	MapDataToBuffer<GlobalFrameData>(globalFrameDataCB, &globalFrameData, sizeof(GlobalFrameData));
+	globalFrameDataAddress = inputs.uploadRing.Upload(inputs.globalFrameData);
 }
 
 void FrameResource::UpdateTopLevelAccelerationStructure(const FrameResourceUpdateInputs& inputs, RenderObjectID objectID)
 {
 	AccelerationStructureBuffers& topAccStruct = topAccStructByID[objectID];
-	const D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAddress = inputs.bottomAccStructByID.at(objectID).result.resource->GetGPUVirtualAddress();
+	const D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAddress = inputs.bottomLevelASManager.GetAddress(objectID);
 	const std::vector<RenderInstance>& renderInstances = inputs.renderInstancesByID.at(objectID);
 
-	D3D12_RAYTRACING_INSTANCE_DESC* instanceDesc = nullptr;
-	topAccStruct.instanceDesc.resource->Map(0, nullptr, reinterpret_cast<void**>(&instanceDesc)) >> CHK_HR;
-
-	for (UINT i = 0; i < renderInstances.size(); i++)
+	// Nothing moved since this copy was last built, so its instance descs don't have to be written again.
+	const TopLevelBuildType buildType = inputs.topLevelTrackersByID.at(objectID).PrepareCopy(m_frameIndex, (uint32_t)renderInstances.size());
+	topLevelBuildTypesByID[objectID] = buildType;
+	if (buildType == TopLevelBuildType::Skip)
 	{
-		const RenderInstance& renderInstance = renderInstances[i];
-		instanceDesc->InstanceID = i;
-		instanceDesc->InstanceContributionToHitGroupIndex = 0;
-		instanceDesc->Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-
-		dx::XMFLOAT3X4 transfM;
-		dx::XMStoreFloat3x4(&transfM, dx::XMLoadFloat4x4(&renderInstance.instanceData.modelMatrix));
-		memcpy(instanceDesc->Transform, &transfM, sizeof(instanceDesc->Transform));
-
-		instanceDesc->AccelerationStructure = bottomLevelAddress;
-		instanceDesc->InstanceMask = 0xFF;
-
-		instanceDesc++;
+		topAccStruct.instanceDescs = 0;
+		return;
 	}
 
-	topAccStruct.instanceDesc.resource->Unmap(0, nullptr);
+	UploadAllocation allocation = inputs.uploadRing.Allocate(
+		sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * renderInstances.size(),
+		D3D12_RAYTRACING_INSTANCE_DESCS_BYTE_ALIGNMENT
+	);
+	topAccStruct.instanceDescs = allocation.gpuAddress;
+
+	WriteRaytracingInstanceDescs(renderInstances, bottomLevelAddress, reinterpret_cast<D3D12_RAYTRACING_INSTANCE_DESC*>(allocation.cpuAddress));
 }
 
 
@@ -2117,8 +2346,15 @@ void DX12Renderer::RegisterRenderPass(const RenderPassType renderPassType)
 
 		CaseRegisterRenderPass(RaytracedAOPass, RaytracedAORenderPass);
 
+		CaseRegisterRenderPass(AdaptiveSamplingPass, AdaptiveSamplingRenderPass);
+		CaseRegisterRenderPass(AOUpsamplePass, AOUpsampleRenderPass);
+
 		CaseRegisterRenderPass(AccumulationPass, AccumilationRenderPass);
 
+		CaseRegisterRenderPass(DenoisePass, DenoiseRenderPass);
+
+		CaseRegisterRenderPass(CompositePass, CompositeRenderPass);
+
 	default:
 		// TODO: Handle this error better.
 		assert(false);
@@ -2127,36 +2363,174 @@ void DX12Renderer::RegisterRenderPass(const RenderPassType renderPassType)
 
 }
 
-void DX12Renderer::InitThreads()
+void DX12Renderer::InitializeTransientResources(ComPtr<ID3D12GraphicsCommandList> commandList, BarrierBatcher& barrierBatcher, const std::vector<FrameGraphInitialization>& initializations, UINT frameIndex)
 {
-#if !defined(SINGLE_THREAD)
-	for (UINT i = 0; i < NumContexts; i++)
+	if (initializations.empty())
 	{
-		m_threadWorkers[i] = std::thread(&DX12Renderer::BuildRenderPipeline, this, i);
+		return;
+	}
+	barrierBatcher.Flush(commandList.Get());
+
+	// Memory that was used by another resource has to be cleared, discarded or copied to before its first use.
+	for (const FrameGraphInitialization& initialization : initializations)
+	{
+		const FrameGraphResourceID resourceID = (FrameGraphResourceID)initialization.resource;
+
+		if (resourceID <= FrameGraphGBufferWorldPos &&
+			initialization.state == D3D12_RESOURCE_STATE_RENDER_TARGET)
+		{
+			const CD3DX12_CPU_DESCRIPTOR_HANDLE gBufferRTVHandle = GetGlobalRTVHandle(GlobalDescriptorNames::RTVGBuffers, resourceID - FrameGraphGBufferDiffuse);
+			commandList->ClearRenderTargetView(gBufferRTVHandle, OptimizedClearColor, 0, nullptr);
+		}
+		else if (resourceID == FrameGraphMiddleTexture && initialization.state == D3D12_RESOURCE_STATE_RENDER_TARGET)
+		{
+			const CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureRTV = GetGlobalRTVHandle(GlobalDescriptorNames::RTVMiddleTexture);
+			commandList->ClearRenderTargetView(middleTextureRTV, OptimizedClearColor, 0, nullptr);
+		}
+		else if (resourceID == FrameGraphDepthBuffer && initialization.state == D3D12_RESOURCE_STATE_DEPTH_WRITE)
+		{
+			const CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = GetGlobalDSVHandle(GlobalDescriptorNames::DSVScene);
+			commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+		}
+		else
+		{
+			// The pass overwrites the resource itself, for example as an unordered access view.
+			commandList->DiscardResource(GetFrameGraphResource(resourceID, frameIndex).Get(), nullptr);
+		}
 	}
-#endif
 }
 
-void DX12Renderer::ClearGBuffers(ComPtr<ID3D12GraphicsCommandList> commandList)
+void DX12Renderer::BuildFrameGraph()
 {
+	m_frameGraph = {};
+
+	// The initial states are set from the resources at the start of every frame.
+	const std::array<std::string, FrameGraphResourceCount> resourceNames = {
+		"GBufferDiffuse", "GBufferNormal", "GBufferWorldPos", "MiddleTexture", "AOTexture", "AOTraceTexture", "SampleCountTexture", "AccumulationTexture", "AccumulationHistory",
+		"ReprojectionTexture", "ReprojectionHistory", "DenoiseTexture0", "DenoiseTexture1", "BackBuffer", "TopLevelAS", "DepthBuffer"
+	};
+	for (const std::string& resourceName : resourceNames)
+	{
+		m_frameGraph.AddResource(resourceName, D3D12_RESOURCE_STATE_COMMON);
+	}
+	m_frameGraph.SetFinalState(FrameGraphBackBuffer, D3D12_RESOURCE_STATE_PRESENT);
+
+	// Placed in a shared heap by CreateTransientHeap() and cleared by the pass that uses them first.
 	for (UINT i = 0; i < GBufferIDCount; i++)
 	{
-		// Get RTV handle for GBuffer.
-		const CD3DX12_CPU_DESCRIPTOR_HANDLE gBufferRTVHandle = GetGlobalRTVHandle(GlobalDescriptorNames::RTVGBuffers, i);
+		m_frameGraph.SetTransient(FrameGraphGBufferDiffuse + i);
+	}
+	m_frameGraph.SetTransient(FrameGraphMiddleTexture);
+	m_frameGraph.SetTransient(FrameGraphAOTexture);
+	m_frameGraph.SetTransient(FrameGraphAOTraceTexture);
+	m_frameGraph.SetTransient(FrameGraphSampleCountTexture);
+	for (UINT i = 0; i < DenoiseTextureCount; i++)
+	{
+		m_frameGraph.SetTransient(FrameGraphDenoiseTexture0 + i);
+	}
+	m_frameGraph.SetTransient(FrameGraphDepthBuffer);
 
-		commandList->ClearRenderTargetView(gBufferRTVHandle, OptimizedClearColor, 0, nullptr);
+	const UINT clearPass = m_frameGraph.AddPass("Clear", FrameGraphQueue::Direct);
+	assert(clearPass == ClearGraphPass);
+	m_frameGraph.Write(clearPass, FrameGraphBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	const std::array<std::string, NumRenderPasses> renderPassNames = {
+		"NonIndexed", "Indexed", "DeferredGBuffer", "DeferredLighting", "RaytracedAO", "Accumulation", "Denoise", "Composite", "AOUpsample", "AdaptiveSampling"
+	};
+	for (UINT passIndex = 0; passIndex < sRenderPassOrder.size(); passIndex++)
+	{
+		const DX12RenderPass& renderPass = *m_renderPasses.at(sRenderPassOrder[passIndex]);
+		const bool isLastRenderPass = passIndex == (sRenderPassOrder.size() - 1);
+
+		const UINT graphPass = m_frameGraph.AddPass(renderPassNames[sRenderPassOrder[passIndex]], renderPass.GetQueue());
+		assert(graphPass == GetRenderPassGraphPass(passIndex));
+		renderPass.DeclareResourceAccesses(m_frameGraph, graphPass, isLastRenderPass);
+	}
+
+	// The passes that only write the AO texture don't render to the back buffer, so the lit color is copied when one of
+	// them is the last pass. The AO is only applied by the composite pass.
+	m_copyGraphPass = InvalidIndex;
+	if (!sRenderPassOrder.empty() && IsAOOnlyPass(sRenderPassOrder.back()))
+	{
+		m_copyGraphPass = m_frameGraph.AddPass("CopyToBackBuffer", FrameGraphQueue::Direct);
+		m_frameGraph.Read(m_copyGraphPass, FrameGraphMiddleTexture, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		m_frameGraph.Write(m_copyGraphPass, FrameGraphBackBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+	}
+}
+
+GPUResource& DX12Renderer::GetFrameGraphResource(FrameGraphResourceID resourceID, UINT frameIndex)
+{
+	switch (resourceID)
+	{
+	case FrameGraphGBufferDiffuse:
+	case FrameGraphGBufferNormal:
+	case FrameGraphGBufferWorldPos:
+		return m_gBuffers[resourceID - FrameGraphGBufferDiffuse];
+	case FrameGraphMiddleTexture:
+		return m_middleTexture;
+	case FrameGraphAOTexture:
+		return m_aoTexture;
+	case FrameGraphAOTraceTexture:
+		return m_aoTraceTexture;
+	case FrameGraphSampleCountTexture:
+		return m_sampleCountTexture;
+	case FrameGraphAccumulationTexture:
+		return m_accumulationTextures[GetHistoryIndex()];
+	case FrameGraphAccumulationHistory:
+		return m_accumulationTextures[(GetHistoryIndex() + 1) % AccumulationTextureCount];
+	case FrameGraphReprojectionTexture:
+		return m_reprojectionTextures[GetHistoryIndex()];
+	case FrameGraphReprojectionHistory:
+		return m_reprojectionTextures[(GetHistoryIndex() + 1) % AccumulationTextureCount];
+	case FrameGraphDenoiseTexture0:
+	case FrameGraphDenoiseTexture1:
+		return m_denoiseTextures[resourceID - FrameGraphDenoiseTexture0];
+	case FrameGraphBackBuffer:
+		return m_backBuffers[frameIndex];
+	case FrameGraphTopLevelAS:
+		// Read only, this may be called by the recording jobs.
+		return m_frameResources[frameIndex]->topAccStructByID.at(RTRenderObjectID).result;
+	case FrameGraphDepthBuffer:
+		return m_depthBuffer;
+	default:
+		throw std::runtime_error("Unknown frame graph resource.");
 	}
 }
 
-void DX12Renderer::TransitionGBuffers(ComPtr<ID3D12GraphicsCommandList> commandList, D3D12_RESOURCE_STATES newResourceState)
+void DX12Renderer::AddFrameGraphBarriers(BarrierBatcher& barrierBatcher, const std::vector<FrameGraphBarrier>& barriers, UINT frameIndex, bool splitTransitions)
 {
-	for (GPUResource& gBuffer : m_gBuffers)
+	for (const FrameGraphBarrier& barrier : barriers)
 	{
-		gBuffer.TransitionTo(newResourceState, commandList);
+		ID3D12Resource* resource = GetFrameGraphResource((FrameGraphResourceID)barrier.resource, frameIndex).Get();
+
+		if (barrier.type == FrameGraphBarrierType::UAV)
+		{
+			barrierBatcher.UAV(resource);
+		}
+		else if (barrier.type == FrameGraphBarrierType::Aliasing)
+		{
+			barrierBatcher.Aliasing(nullptr, resource);
+		}
+		else
+		{
+			if (!barrierBatcher.IsTracked(resource))
+			{
+				barrierBatcher.Track(resource, barrier.stateBefore);
+			}
+
+			if (splitTransitions)
+			{
+				barrierBatcher.BeginTransition(resource, barrier.stateAfter);
+			}
+			else
+			{
+				barrierBatcher.Transition(resource, barrier.stateAfter);
+			}
+		}
 	}
 }
 
-RenderObject DX12Renderer::CreateRenderObject(const std::vector<Vertex>* vertices, const std::vector<VertexIndex>* indices, D3D12_PRIMITIVE_TOPOLOGY topology)
+RenderObject DX12Renderer::CreateRenderObject(std::span<const Vertex> vertices, std::span<const VertexIndex> indices, D3D12_PRIMITIVE_TOPOLOGY topology, const VertexLayout& vertexLayout)
 {
 	RenderObject renderObject;
 
@@ -2169,20 +2543,32 @@ RenderObject DX12Renderer::CreateRenderObject(const std::vector<Vertex>* vertice
 	m_directCommandQueue->ResetAllocator();
 	ComPtr<ID3D12GraphicsCommandList1> directCommandList = m_directCommandQueue->CreateCommandList(m_device);
 
+	// The buffers are transitioned together once both are uploaded.
+	BarrierBatcher barrierBatcher;
+
 	UINT vertexCount = 0;
 	GPUResource vertexUploadBuffer;
-	if(vertices != nullptr)
+	if(!vertices.empty())
 	{
-		vertexCount = (UINT)vertices->size();
-		UINT vertexSize = sizeof(vertices->at(0));
+		vertexCount = (UINT)vertices.size();
+		UINT vertexSize = GetVertexStride(vertexLayout);
 		UINT vertexBufferSize = vertexSize * vertexCount;
 
-		UploadResource<Vertex>(
+		// The full layout matches the Vertex struct and is uploaded as is.
+		std::vector<uint8_t> encodedVertices;
+		const uint8_t* vertexData = reinterpret_cast<const uint8_t*>(vertices.data());
+		if (vertexLayout != FullVertexLayout)
+		{
+			EncodeVertices(vertices, vertexLayout, encodedVertices);
+			vertexData = encodedVertices.data();
+		}
+
+		UploadResource<uint8_t>(
 			m_device,
 			copyCommandList,
 			renderObject.vertexBuffer,
 			vertexUploadBuffer,
-			vertices->data(),
+			vertexData,
 			vertexBufferSize
 		);
 
@@ -2194,15 +2580,15 @@ RenderObject DX12Renderer::CreateRenderObject(const std::vector<Vertex>* vertice
 			vbView.SizeInBytes = vertexBufferSize;
 		}
 
-		renderObject.vertexBuffer.TransitionTo(D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, directCommandList);
+		renderObject.vertexBuffer.TransitionTo(D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, barrierBatcher);
 	}
 
 	UINT indexCount = 0;
 	GPUResource indexUploadBuffer;
-	if(indices != nullptr)
+	if(!indices.empty())
 	{
-		indexCount = (UINT)indices->size();
-		UINT indexSize = sizeof(indices->at(0));
+		indexCount = (UINT)indices.size();
+		UINT indexSize = sizeof(VertexIndex);
 		UINT indexBufferSize = indexSize * indexCount;
 
 		UploadResource<VertexIndex>(
@@ -2210,7 +2596,7 @@ RenderObject DX12Renderer::CreateRenderObject(const std::vector<Vertex>* vertice
 			copyCommandList,
 			renderObject.indexBuffer,
 			indexUploadBuffer,
-			indices->data(),
+			indices.data(),
 			indexBufferSize
 		);
 
@@ -2222,9 +2608,11 @@ RenderObject DX12Renderer::CreateRenderObject(const std::vector<Vertex>* vertice
 			ibView.SizeInBytes = indexBufferSize;
 		}
 
-		renderObject.indexBuffer.TransitionTo(D3D12_RESOURCE_STATE_INDEX_BUFFER, directCommandList);
+		renderObject.indexBuffer.TransitionTo(D3D12_RESOURCE_STATE_INDEX_BUFFER, barrierBatcher);
 	}
 
+	barrierBatcher.Flush(directCommandList.Get());
+
 	// Close when done.
 	copyCommandList->Close() >> CHK_HR;
 	directCommandList->Close() >> CHK_HR;
@@ -2255,64 +2643,27 @@ RenderObject DX12Renderer::CreateRenderObject(const std::vector<Vertex>* vertice
 
 	renderObject.drawArgs.push_back(drawArgs);
 	renderObject.topology = topology;
+	renderObject.vertexLayout = vertexLayout;
+	renderObject.bounds = CalculateBounds(vertices);
 
 	return renderObject;
 }
 
-RenderObject DX12Renderer::CreateRenderObjectFromOBJ(const std::string& objPath, D3D12_PRIMITIVE_TOPOLOGY topology)
+RenderObject DX12Renderer::CreateRenderObjectFromOBJ(const std::string& objPath, D3D12_PRIMITIVE_TOPOLOGY topology, const VertexLayout& vertexLayout)
 {
-	tinyobj::ObjReaderConfig readerConfig = {};
-	readerConfig.triangulate = true;
-	tinyobj::ObjReader reader;
-
-	ReadObjFile(objPath, reader, readerConfig);
+	// The mesh is memory mapped from its binary cache. With the full vertex layout the spans are uploaded without any
+	// intermediate copies, other layouts are first encoded into a temporary buffer by CreateRenderObject().
+	MeshCacheView meshView;
+	LoadMeshCached(objPath, meshView);
 
-	auto& attrib = reader.GetAttrib();
-	auto& shapes = reader.GetShapes();
-	auto& materials = reader.GetMaterials();
+	RenderObject renderObject = CreateRenderObject(meshView.GetVertices(), meshView.GetIndices(), topology, vertexLayout);
+	renderObject.drawArgs.assign(meshView.GetDrawArgs().begin(), meshView.GetDrawArgs().end());
+	renderObject.meshletData.meshlets.assign(meshView.GetMeshlets().begin(), meshView.GetMeshlets().end());
+	renderObject.meshletData.meshletVertices.assign(meshView.GetMeshletVertices().begin(), meshView.GetMeshletVertices().end());
+	renderObject.meshletData.meshletPrimitives.assign(meshView.GetMeshletPrimitives().begin(), meshView.GetMeshletPrimitives().end());
+	renderObject.bounds = meshView.GetBounds();
 
-	std::vector<VertexIndex> indices;
-	GetObjVertexIndices(indices, reader);
-
-	std::vector<Vertex> vertices;
-	vertices.resize(attrib.vertices.size() / 3);
-	std::set<UINT> createdVertexIndices;
-
-	for (size_t s = 0; s < shapes.size(); s++)
-	{
-		for (auto& indexInfo : shapes[s].mesh.indices)
-		{
-			auto vertexIndex = indexInfo.vertex_index;
-			auto normalIndex = indexInfo.normal_index;
-
-			if (createdVertexIndices.find(vertexIndex) == createdVertexIndices.end())
-			{
-				Vertex vertex = {};
-				vertex.position = {
-					attrib.vertices[3 * vertexIndex + 0],
-					attrib.vertices[3 * vertexIndex + 1],
-					attrib.vertices[3 * vertexIndex + 2]
-				};
-
-				if (normalIndex != -1)
-				{
-					vertex.normal = {
-						attrib.normals[3 * normalIndex + 0],
-						attrib.normals[3 * normalIndex + 1],
-						attrib.normals[3 * normalIndex + 2]
-					};
-				}
-
-				vertex.color = { 1.0f, 1.0f, 1.0f };
-
-				vertices[vertexIndex] = vertex;
-				createdVertexIndices.insert(vertexIndex);
-			}
-		}
-
-	}
-
-	return CreateRenderObject(&vertices, &indices, topology);
+	return renderObject;
 }
 
 CommandQueueHandler::CommandQueueHandler(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type)
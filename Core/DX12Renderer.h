@@ -6,11 +6,17 @@
 #include <unordered_map>
 #include <memory>
 #include <thread>
+#include <span>
 
 #include "GPUResource.h"
 #include "RenderObject.h"
-#include "DX12SyncHandler.h"
+#include "JobSystem.h"
 #include "DX12RenderPass.h"
+#include "FrameGraph.h"
+#include "InstanceStore.h"
+#include "BottomLevelASManager.h"
+#include "TopLevelUpdateTracker.h"
+#include "TransientHeap.h"
 #include "AppDefines.h"
 #include "Camera.h"
 #include "DX12AbstractionUtils.h"
@@ -24,7 +30,6 @@ constexpr LPCWSTR AnyHitShaderName = L"anyhit";
 constexpr LPCWSTR HitGroupName = L"HitGroup";
  
 typedef std::unordered_map<RenderObjectID, DX12Abstractions::AccelerationStructureBuffers> AccelerationStructureMap;
-typedef std::unordered_map<RenderObjectID, std::vector<RenderInstance>> RenderInstanceMap;
 typedef std::unordered_map<RenderPassType, std::unique_ptr<DX12RenderPass>> RenderPassMap;
 
 struct FrameResource; // Forward declaration.
@@ -95,7 +100,30 @@ public:
 	void Render();
 
 	// Clears relevant buffers for each frame.
-	void ClearBuffers(GPUResource& currentBackBuffer, ComPtr<ID3D12GraphicsCommandList4> preCommandList, const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV, const CD3DX12_CPU_DESCRIPTOR_HANDLE middleTextureRTV, CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle);
+	void ClearBuffers(ComPtr<ID3D12GraphicsCommandList4> preCommandList, const CD3DX12_CPU_DESCRIPTOR_HANDLE bbRTV);
+
+	// Placement of the G-buffers, the middle, AO and denoise textures and the depth buffer, which share one heap where their
+	// lifetimes allow.
+	const TransientHeapLayout& GetTransientHeapLayout() const;
+
+	// Moves a render instance. The top level acceleration structures of the render object are refit in the next frames.
+	void SetRenderInstanceTransform(RenderObjectID renderObjectID, UINT instanceIndex, const DirectX::XMFLOAT4X4& model);
+	// Which path the top level acceleration structure of a raytraced render object took in every frame so far.
+	const TopLevelUpdateStats& GetTopLevelUpdateStats(RenderObjectID renderObjectID) const;
+
+	// Settings of the denoise pass, used from the next recorded frame on.
+	void SetDenoiseSettings(const DenoiseSettings& settings);
+	const DenoiseSettings& GetDenoiseSettings() const;
+
+	// Traces the AO at a reduced resolution and upsamples it, from the next frame on.
+	void SetAOResolutionMode(AOResolutionMode mode);
+	AOResolutionMode GetAOResolutionMode() const;
+
+	// Picks the AO rays of every pixel from the variance of its history, from the next frame on. Only at full resolution.
+	void SetAdaptiveSamplingSettings(const AdaptiveSamplingSettings& settings);
+	const AdaptiveSamplingSettings& GetAdaptiveSamplingSettings() const;
+	// Rays of the last frame whose counters were read back, which is BackBufferCount frames behind the one being recorded.
+	const AdaptiveSamplingStats& GetAdaptiveSamplingStats() const;
 
 private:
 
@@ -109,11 +137,9 @@ private:
 
 	void InitPipeline();
 	void CreateDeviceAndSwapChain();
-	void CreateAccumulationTexture();
+	void CreateAccumulationTextures();
+	void CreateAdaptiveSamplingBuffers();
 	void CreateBackBuffers();
-	void CreateDepthBuffer();
-	void CreateGBuffers();
-	void CreateMiddleTexture();
 
 	void CreateRTVHeap();
 	void CreateDSVHeap();
@@ -131,9 +157,21 @@ private:
 	void CreateCamera();
 	void CreateRenderInstances();
 
+	// Creates the resources that are transient in the frame graph, and their views, once the graph is built.
+	void InitTransientResources();
+	void CreateTransientHeap();
+	void CreateDepthBuffer();
+	void CreateGBuffers();
+	void CreateMiddleTexture();
+	void CreateAOTexture();
+	void CreateSampleCountTexture();
+	void CreateDenoiseTextures();
+	GPUResource CreateTransientResource(FrameGraphResourceID resourceID, D3D12_RESOURCE_STATES initialState);
+	CD3DX12_RESOURCE_DESC GetTransientResourceDesc(FrameGraphResourceID resourceID) const;
+
 	void InitRaytracing();
 	void CreateAccelerationStructures();
-	void CreateBottomLevelASs(ComPtr<ID3D12GraphicsCommandList4> commandList);
+	void CreateBottomLevelASs();
 	void CreateBottomLevelAccelerationStructure(RenderObjectID objectID, ComPtr<ID3D12GraphicsCommandList4> commandList);
 	void CreateRaytracingPipelineState();
 	void CreateRayGenLocalRootSignature(ComPtr<ID3D12RootSignature>& rootSig);
@@ -144,17 +182,41 @@ private:
 	void InitFrameResources();
 
 	void RegisterRenderPass(const RenderPassType renderPassType);
-	void InitThreads();
 
 	void UpdateCamera();
-
-	void BuildRenderPipeline(UINT context);
-
-	void ClearGBuffers(ComPtr<ID3D12GraphicsCommandList> commandList);
-	void TransitionGBuffers(ComPtr<ID3D12GraphicsCommandList> commandList, D3D12_RESOURCE_STATES newResourceState);
-
-	RenderObject CreateRenderObject(const std::vector<Vertex>* vertices, const std::vector<VertexIndex>* indices, D3D12_PRIMITIVE_TOPOLOGY topology);
-	RenderObject CreateRenderObjectFromOBJ(const std::string& objPath, D3D12_PRIMITIVE_TOPOLOGY topology);
+	// Moves the first raytraced instance around where it was created, see AnimateRaytracedInstance.
+	void UpdateAnimatedInstance();
+	// The accumulation and reprojection textures that the current frame writes. The other ones hold the history.
+	UINT GetHistoryIndex() const;
+	// Culls the instance store against the camera and keeps the visible instances of every render object for the render
+	// packages. Only used when the instances are culled on the CPU.
+	void CullRenderInstances();
+	// Adaptive sampling is only used when the AO is traced at full resolution.
+	bool IsAdaptiveSamplingActive() const;
+	// Copies the counters that the adaptive sampling pass of the frame wrote to its readback buffer. The frame has to be done.
+	void ReadAdaptiveSamplingStats(UINT frameIndex);
+
+	std::vector<RenderPackage> CreateRenderPackages(const DX12RenderPass& renderPass);
+	// Records one context of a render pass into its command list. Runs as a job, so it may run at the same time as the
+	// other contexts of the same pass and the contexts of the other passes.
+	void RecordRenderPass(RenderPassType renderPassType, UINT graphPass, bool isLastRenderPass, const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex);
+	// Queues the barriers before the pass into its first command list, records the prologue of the pass and initializes
+	// its transient resources. The pipeline args are null when the pass has nothing to render.
+	void BeginRenderPass(DX12RenderPass& renderPass, const FrameGraphCompiledPass& compiledPass, const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs);
+
+	// Declares the passes of the frame and the resources they use. The barriers and queue waits are derived from it.
+	void BuildFrameGraph();
+	GPUResource& GetFrameGraphResource(FrameGraphResourceID resourceID, UINT frameIndex);
+	// Adds frame graph barriers to a batch that the caller flushes. Resources start out in the state the graph expects.
+	// Split transitions have to be ended before the resources are used.
+	void AddFrameGraphBarriers(BarrierBatcher& barrierBatcher, const std::vector<FrameGraphBarrier>& barriers, UINT frameIndex, bool splitTransitions = false);
+
+	// Clears or discards transient resources at the start of their lifetime. Flushes the barriers before the pass first.
+	void InitializeTransientResources(ComPtr<ID3D12GraphicsCommandList> commandList, BarrierBatcher& barrierBatcher, const std::vector<FrameGraphInitialization>& initializations, UINT frameIndex);
+
+	// Uploads the given vertices and indices. Either span may be empty. The spans are only read during the call.
+	RenderObject CreateRenderObject(std::span<const Vertex> vertices, std::span<const VertexIndex> indices, D3D12_PRIMITIVE_TOPOLOGY topology, const VertexLayout& vertexLayout = FullVertexLayout);
+	RenderObject CreateRenderObjectFromOBJ(const std::string& objPath, D3D12_PRIMITIVE_TOPOLOGY topology, const VertexLayout& vertexLayout = FullVertexLayout);
 	void SerializeAndCreateRootSig(CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc, ComPtr<ID3D12RootSignature>& rootSig);
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE GetGlobalRTVHandle(GlobalDescriptorNames globalRTVDescriptorName, UINT offset = 0);
@@ -188,12 +250,31 @@ private:
 	std::unique_ptr<CommandQueueHandler> m_copyCommandQueue;
 
 	std::array<DX12Abstractions::GPUResource, BackBufferCount> m_backBuffers;
-	DX12Abstractions::GPUResource m_accumulationTexture;
+	// Ping-ponged by GetHistoryIndex(), so the accumulation pass can read the history while it writes the new one.
+	std::array<DX12Abstractions::GPUResource, AccumulationTextureCount> m_accumulationTextures;
+	std::array<DX12Abstractions::GPUResource, AccumulationTextureCount> m_reprojectionTextures;
 	std::array<DX12Abstractions::GPUResource, GBufferIDCount> m_gBuffers;
+	// Lit color of the lighting pass.
 	DX12Abstractions::GPUResource m_middleTexture;
-	ComPtr<ID3D12Resource> m_depthBuffer;
+	DX12Abstractions::GPUResource m_aoTexture;
+	DX12Abstractions::GPUResource m_aoTraceTexture;
+	DX12Abstractions::GPUResource m_sampleCountTexture;
+	std::array<DX12Abstractions::GPUResource, DenoiseTextureCount> m_denoiseTextures;
+	DX12Abstractions::GPUResource m_depthBuffer;
+
+	// Per frame upload data of every frame in flight, retired by the fence value of the frame that wrote it.
+	std::unique_ptr<DX12Abstractions::UploadRingBuffer> m_uploadRing;
+
+	// Holds the transient resources above.
+	ComPtr<ID3D12Heap> m_transientHeap;
+	TransientHeapLayout m_transientHeapLayout;
 
 	RenderPassMap m_renderPasses;
+
+	// Graph passes in submission order: the clears of the pre command list, one pass per entry of the render pass order
+	// and the copy to the back buffer when that is needed.
+	FrameGraph m_frameGraph;
+	UINT m_copyGraphPass;
 	ComPtr<ID3D12RootSignature> m_rasterRootSignature;
 
 	ComPtr<ID3D12RootSignature> m_RTGlobalRootSignature;
@@ -201,23 +282,42 @@ private:
 
 	std::unordered_map<RenderObjectID, RenderObject> m_renderObjectsByID;
 	RenderInstanceMap m_renderInstancesByID;
+	// Copy of the render instances that is walked every frame.
+	InstanceStore m_instanceStore;
+	std::unordered_map<RenderObjectID, std::vector<uint32_t>> m_visibleInstancesByID;
+	// One tracker per raytraced render object, covering its top level acceleration structure in every frame resource.
+	std::unordered_map<RenderObjectID, TopLevelUpdateTracker> m_topLevelTrackersByID;
+	DirectX::XMFLOAT4X4 m_animatedInstanceOrigin;
 
-	AccelerationStructureMap m_bottomAccStructByID;
+	std::unique_ptr<BottomLevelASManager> m_bottomLevelASManager;
 
 	std::array<std::unique_ptr<FrameResource>, BackBufferCount> m_frameResources;
 	FrameResource* m_currentFrameResource;
 
-	std::array<std::thread, NumContexts> m_threadWorkers;
-	DX12SyncHandler m_syncHandler;
-	bool m_forceExitThread; // Used to make a thread jump out of its loop.
+	// Records the command lists of the render passes.
+	std::unique_ptr<JobSystem> m_jobSystem;
 
 	Camera* m_activeCamera;
 	std::vector<Camera> m_cameras;
 
 	UINT m_frameCount;
 	UINT m_accumulatedFrames;
+	// The camera of the frame before, which the accumulation pass reprojects the history with.
+	DirectX::XMFLOAT4X4 m_previousViewProjection;
+	DirectX::XMFLOAT3 m_previousCameraPosition;
 	float m_time;
 
+	DenoiseSettings m_denoiseSettings;
+	AOResolutionMode m_aoResolutionMode;
+
+	AdaptiveSamplingSettings m_adaptiveSamplingSettings;
+	AdaptiveSamplingStats m_adaptiveSamplingStats;
+	// Counters of the adaptive sampling pass, which every frame copies to its own readback buffer.
+	DX12Abstractions::GPUResource m_adaptiveSamplingCounterBuffer;
+	std::array<DX12Abstractions::GPUResource, BackBufferCount> m_adaptiveSamplingReadbackBuffers;
+	// Whether the frame of a readback buffer ran the adaptive sampling pass.
+	std::array<bool, BackBufferCount> m_hasAdaptiveSamplingStats;
+
 	static DX12Renderer* s_instance;
 };
 
@@ -238,8 +338,11 @@ struct FrameResource
 	{
 		const Camera* camera;
 		const RenderInstanceMap& renderInstancesByID;
-		const AccelerationStructureMap& bottomAccStructByID;
+		const InstanceStore& instanceStore;
+		const BottomLevelASManager& bottomLevelASManager;
+		std::unordered_map<RenderObjectID, TopLevelUpdateTracker>& topLevelTrackersByID;
 		GlobalFrameData globalFrameData;
+		DX12Abstractions::UploadRingBuffer& uploadRing;
 	};
 
 	FrameResource(UINT frameIndex, ComPtr<ID3D12Resource> backBuffer, FrameResourceInputs inputs);
@@ -253,9 +356,6 @@ public:
 	void CreateCommandResources(ComPtr<ID3D12Device5> device);
 
 private:
-	
-	void CreateFrameCBVs(ComPtr<ID3D12Device5> device, ComPtr<ID3D12DescriptorHeap> cbvSrvUavHeap, UINT cbvSrvUavDescriptorSize);
-	void CreateConstantBuffers(ComPtr<ID3D12Device5> device);
 
 	void CreateTopLevelASs(ComPtr<ID3D12Device5> device);
 	void CreateTopLevelAS(ComPtr<ID3D12Device5> device, RenderObjectID renderObjectID);
@@ -272,10 +372,14 @@ private:
 	void UpdateTopLevelAccelerationStructure(const FrameResourceUpdateInputs& inputs, RenderObjectID objectID);
 	
 public:
-	GPUResource perInstanceCB; 
-	GPUResource globalFrameDataCB;
+	// Upload ring addresses of this frame's constants. Instances are laid out by their CB index, InstanceConstantsStride
+	// bytes apart.
+	D3D12_GPU_VIRTUAL_ADDRESS instanceConstantsAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS globalFrameDataAddress;
 
 	AccelerationStructureMap topAccStructByID;
+	// How the top level acceleration structures are brought up to date this frame.
+	std::unordered_map<RenderObjectID, TopLevelBuildType> topLevelBuildTypesByID;
 
 	DX12Abstractions::ShaderTableData rayGenShaderTable;
 	DX12Abstractions::ShaderTableData hitGroupShaderTable;
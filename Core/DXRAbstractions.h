@@ -9,7 +9,8 @@ namespace DX12Abstractions
 	{
 		GPUResource scratch;
 		GPUResource result;
-		GPUResource instanceDesc;
+		// Upload ring address of the instance descs that the next top level build reads.
+		D3D12_GPU_VIRTUAL_ADDRESS instanceDescs = 0;
 	};
 
 	struct ShaderTableData
@@ -1,13 +1,77 @@
 #include "DeferredGBufferRenderPass.h"
 
 DeferredGBufferRenderPass::DeferredGBufferRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig)
-	: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_DIRECT, true)
+	: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_DIRECT, !UseGPUCulling), m_device(device)
 {
 	// White list render objects.
 	{
 		m_renderableObjects.push_back(RTRenderObjectID);
 	}
 
+	// One pipeline state per vertex layout. The input layout is generated from the same description that is used to
+	// encode the vertex buffers, and layouts that need decoding in the shader use their own vertex shader permutation.
+	for (uint32_t layoutIndex = 0; layoutIndex < VertexLayoutCount; layoutIndex++)
+	{
+		m_layoutPipelineStates[layoutIndex] = CreatePipelineState(device, rootSig, GetVertexLayoutFromIndex(layoutIndex));
+		NAME_D3D12_OBJECT_MEMBER_INDEXED(m_layoutPipelineStates, layoutIndex, DeferredGBufferRenderPass);
+	}
+
+	m_pipelineState = m_layoutPipelineStates[GetVertexLayoutIndex(FullVertexLayout)];
+
+	// With GPU culling a single command list culls and draws everything, so there's nothing to split between contexts.
+	if constexpr (UseGPUCulling)
+	{
+		CreateCullingObjects(device, rootSig);
+	}
+}
+
+void DeferredGBufferRenderPass::CreateCullingObjects(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig)
+{
+	// Culling root signature. Everything is bound directly, the argument buffer as two root UAVs since the counts and
+	// the commands have different layouts.
+	std::array<CD3DX12_ROOT_PARAMETER, 4> rootParameters = {};
+	rootParameters[0].InitAsConstants(sizeof(CullConstants) / 4, 0);
+	rootParameters[1].InitAsShaderResourceView(0);
+	rootParameters[2].InitAsUnorderedAccessView(0);
+	rootParameters[3].InitAsUnorderedAccessView(1);
+
+	const CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc((UINT)rootParameters.size(), rootParameters.data());
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+	D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error) >> CHK_HR;
+	device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_cullRootSignature)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_cullRootSignature, DeferredGBufferRenderPass);
+
+	ComPtr<ID3DBlob> csBlob;
+	D3DReadFileToBlob(L"../CullInstancesCS.cso", &csBlob) >> CHK_HR;
+
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC cullPipelineStateDesc = {
+		.pRootSignature = m_cullRootSignature.Get(),
+		.CS = CD3DX12_SHADER_BYTECODE(csBlob.Get())
+	};
+	device->CreateComputePipelineState(&cullPipelineStateDesc, IID_PPV_ARGS(&m_cullPipelineState)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_cullPipelineState, DeferredGBufferRenderPass);
+
+	// Every command sets the first instance root constant of the raster root signature and then draws one instance.
+	std::array<D3D12_INDIRECT_ARGUMENT_DESC, 2> argumentDescs = {};
+	argumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	argumentDescs[0].Constant.RootParameterIndex = DefaultRootParameterIdx::FirstInstanceIdx;
+	argumentDescs[0].Constant.DestOffsetIn32BitValues = 0;
+	argumentDescs[0].Constant.Num32BitValuesToSet = 1;
+	argumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	const D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {
+		.ByteStride = sizeof(IndirectDrawCommand),
+		.NumArgumentDescs = (UINT)argumentDescs.size(),
+		.pArgumentDescs = argumentDescs.data()
+	};
+	device->CreateCommandSignature(&commandSignatureDesc, rootSig.Get(), IID_PPV_ARGS(&m_commandSignature)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_commandSignature, DeferredGBufferRenderPass);
+}
+
+ComPtr<ID3D12PipelineState> DeferredGBufferRenderPass::CreatePipelineState(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig, const VertexLayout& vertexLayout)
+{
 	struct PipelineStateStream
 	{
 		CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE RootSignature;
@@ -20,20 +84,24 @@ DeferredGBufferRenderPass::DeferredGBufferRenderPass(ComPtr<ID3D12Device5> devic
 		CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
 	} pipelineStateStream;
 
-	const D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+	const std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout = CreateInputElementDescs(GetVertexLayoutDesc(vertexLayout));
+
+	// Every vertex layout also has a permutation that reads the instance data from a structured buffer.
+	std::string shaderSuffix = GetVertexLayoutShaderSuffix(vertexLayout);
+	if constexpr (ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer)
+	{
+		shaderSuffix += "_InstanceBuffer";
+	}
+	const std::wstring vsPath = L"../DeferredRenderVS" + std::wstring(shaderSuffix.begin(), shaderSuffix.end()) + L".cso";
 
 	ComPtr<ID3DBlob> vsBlob;
-	D3DReadFileToBlob(L"../DeferredRenderVS.cso", &vsBlob) >> CHK_HR;
+	D3DReadFileToBlob(vsPath.c_str(), &vsBlob) >> CHK_HR;
 
 	ComPtr<ID3DBlob> psBlob;
 	D3DReadFileToBlob(L"../DeferredRenderPS.cso", &psBlob) >> CHK_HR;
 
 	pipelineStateStream.RootSignature = rootSig.Get();
-	pipelineStateStream.InputLayout = { inputLayout, (UINT)std::size(inputLayout) };
+	pipelineStateStream.InputLayout = { inputLayout.data(), (UINT)inputLayout.size() };
 	pipelineStateStream.PrimtiveTopology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 	pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
 	pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(psBlob.Get());
@@ -58,9 +126,19 @@ DeferredGBufferRenderPass::DeferredGBufferRenderPass(ComPtr<ID3D12Device5> devic
 		.pPipelineStateSubobjectStream = &pipelineStateStream
 	};
 
-	device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_pipelineState)) >> CHK_HR;
+	ComPtr<ID3D12PipelineState> pipelineState;
+	device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&pipelineState)) >> CHK_HR;
 
-	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, DeferredGBufferRenderPass);
+	return pipelineState;
+}
+
+void DeferredGBufferRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	for (UINT i = 0; i < GBufferIDCount; i++)
+	{
+		frameGraph.Write(graphPass, FrameGraphGBufferDiffuse + i, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	}
+	frameGraph.Write(graphPass, FrameGraphDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 }
 
 void DeferredGBufferRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
@@ -68,6 +146,12 @@ void DeferredGBufferRenderPass::BuildRenderPass(const std::vector<RenderPackage>
 	assert(pipelineArgs != nullptr);
 	DeferredGBufferRenderPassArgs& args = ToSpecificArgs<DeferredGBufferRenderPassArgs>(pipelineArgs);
 
+	if constexpr (UseGPUCulling)
+	{
+		BuildCulledRenderPass(renderPackages, frameIndex, pipelineArgs);
+		return;
+	}
+
 	auto commandList = GetCommandList(context, frameIndex);
 	SetCommonStates(args.commonArgs, m_pipelineState, commandList);
 
@@ -76,6 +160,7 @@ void DeferredGBufferRenderPass::BuildRenderPass(const std::vector<RenderPackage>
 	commandList->OMSetRenderTargets(GBufferIDCount, &args.firstGBufferRTVHandle, TRUE, &args.commonArgs.depthStencilView);
 
 	// Draw.
+	FlushBarriers(context, frameIndex);
 	for (const RenderPackage& renderPackage : renderPackages)
 	{
 		if (renderPackage.renderObject)
@@ -86,23 +171,214 @@ void DeferredGBufferRenderPass::BuildRenderPass(const std::vector<RenderPackage>
 
 			const std::vector<DrawArgs>& drawArgs = renderObject.drawArgs;
 
-			if (renderPackage.renderInstances)
+			if (renderPackage.renderInstances && renderPackage.visibleInstances)
 			{
 				const std::vector<RenderInstance>& renderInstances = *renderPackage.renderInstances;
+				const std::vector<uint32_t>& visibleInstances = *renderPackage.visibleInstances;
 
-				for (UINT i = context; i < renderInstances.size(); i += NumContexts)
+				// Each context draws its own contiguous chunk of the visible instances.
+				const auto [firstVisible, lastVisible] = GetContextRange(context, frameIndex, (UINT)visibleInstances.size());
+				if constexpr (ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer)
 				{
-					PerRenderInstance(renderInstances[i], drawArgs, pipelineArgs, context, frameIndex);
+					// Runs of visible instances with consecutive indices are drawn with one draw per draw arg.
+					UINT runStart = firstVisible;
+					for (UINT i = firstVisible + 1; i <= lastVisible; i++)
+					{
+						if (i == lastVisible || visibleInstances[i] != visibleInstances[i - 1] + 1)
+						{
+							SetFirstInstance(renderInstances[visibleInstances[runStart]], commandList);
+							DrawInstanceIndexed(context, drawArgs, commandList, i - runStart);
+							runStart = i;
+						}
+					}
+				}
+				else
+				{
+					for (UINT i = firstVisible; i < lastVisible; i++)
+					{
+						PerRenderInstance(renderInstances[visibleInstances[i]], drawArgs, pipelineArgs, context, frameIndex);
+					}
 				}
 			}
+			else if (renderPackage.renderInstances)
+			{
+				const std::vector<RenderInstance>& renderInstances = *renderPackage.renderInstances;
+
+				// Each context draws its own contiguous chunk of the instances.
+				const auto [firstInstance, lastInstance] = GetContextRange(context, frameIndex, (UINT)renderInstances.size());
+				if constexpr (ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer)
+				{
+					// The shader finds the constants of each instance of the chunk, so one draw per draw arg covers it.
+					if (firstInstance < lastInstance)
+					{
+						SetFirstInstance(renderInstances[firstInstance], commandList);
+						DrawInstanceIndexed(context, drawArgs, commandList, lastInstance - firstInstance);
+					}
+				}
+				else
+				{
+					for (UINT i = firstInstance; i < lastInstance; i++)
+					{
+						PerRenderInstance(renderInstances[i], drawArgs, pipelineArgs, context, frameIndex);
+					}
+				}
+			}
+		}
+	}
+}
+
+void DeferredGBufferRenderPass::ReserveArgumentBuffer(const std::vector<RenderPackage>& renderPackages, UINT frameIndex)
+{
+	UINT commandCount = 0;
+	for (const RenderPackage& renderPackage : renderPackages)
+	{
+		if (renderPackage.renderObject && renderPackage.renderInstances)
+		{
+			commandCount += (UINT)(renderPackage.renderInstances->size() * renderPackage.renderObject->drawArgs.size());
 		}
 	}
+
+	if (m_argumentBuffers[frameIndex].resource && commandCount <= m_argumentBufferCommandCapacities[frameIndex])
+	{
+		return;
+	}
+
+	const UINT64 bufferSize = ArgumentBufferCommandsOffset + (UINT64)commandCount * sizeof(IndirectDrawCommand);
+	m_argumentBuffers[frameIndex] = DX12Abstractions::CreateDefaultResource(
+		m_device,
+		CD3DX12_RESOURCE_DESC::Buffer(bufferSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
+	);
+	NAME_D3D12_OBJECT_MEMBER_INDEXED(m_argumentBuffers, frameIndex, DeferredGBufferRenderPass);
+	m_argumentBufferCommandCapacities[frameIndex] = commandCount;
+}
+
+bool DeferredGBufferRenderPass::HasPrologue() const
+{
+	return UseGPUCulling;
+}
+
+void DeferredGBufferRenderPass::RecordPrologue(const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs)
+{
+	assert(pipelineArgs != nullptr);
+	DeferredGBufferRenderPassArgs& args = ToSpecificArgs<DeferredGBufferRenderPassArgs>(pipelineArgs);
+	assert(renderPackages.size() <= MaxCulledRenderObjects);
+	ReserveArgumentBuffer(renderPackages, frameIndex);
+
+	auto commandList = GetCommandList(0, frameIndex);
+	BarrierBatcher& barrierBatcher = GetBarrierBatcher(0, frameIndex);
+	GPUResource& argumentBuffer = m_argumentBuffers[frameIndex];
+	const D3D12_GPU_VIRTUAL_ADDRESS argumentBufferAddress = argumentBuffer.resource->GetGPUVirtualAddress();
+
+	// Reset the command counts. The flush also begins the frame graph transitions of the pass.
+	argumentBuffer.TransitionTo(D3D12_RESOURCE_STATE_COPY_DEST, barrierBatcher);
+	FlushBarriers(0, frameIndex);
+
+	std::vector<D3D12_WRITEBUFFERIMMEDIATE_PARAMETER> countResets(renderPackages.size());
+	for (UINT i = 0; i < (UINT)countResets.size(); i++)
+	{
+		countResets[i] = { .Dest = argumentBufferAddress + i * sizeof(UINT), .Value = 0 };
+	}
+	if (!countResets.empty())
+	{
+		commandList->WriteBufferImmediate((UINT)countResets.size(), countResets.data(), nullptr);
+	}
+
+	argumentBuffer.TransitionTo(D3D12_RESOURCE_STATE_UNORDERED_ACCESS, barrierBatcher);
+
+	// Cull every draw arg of every render object. The draw args of a render object append to the same commands.
+	CullConstants cullConstants = {};
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMStoreFloat4x4(&viewProjection, args.commonArgs.viewProjectionMatrix);
+	cullConstants.frustum = ExtractFrustumPlanes(viewProjection);
+
+	commandList->SetComputeRootSignature(m_cullRootSignature.Get());
+	commandList->SetPipelineState(m_cullPipelineState.Get());
+	commandList->SetComputeRootShaderResourceView(1, args.commonArgs.instanceConstantsAddress);
+	commandList->SetComputeRootUnorderedAccessView(2, argumentBufferAddress + ArgumentBufferCommandsOffset);
+	commandList->SetComputeRootUnorderedAccessView(3, argumentBufferAddress);
+	FlushBarriers(0, frameIndex);
+
+	std::vector<UINT>& firstCommands = m_firstCommands[frameIndex];
+	firstCommands.assign(renderPackages.size(), 0);
+	UINT commandCount = 0;
+	for (UINT i = 0; i < (UINT)renderPackages.size(); i++)
+	{
+		const RenderPackage& renderPackage = renderPackages[i];
+		firstCommands[i] = commandCount;
+		if (!renderPackage.renderObject || !renderPackage.renderInstances || renderPackage.renderInstances->empty())
+		{
+			continue;
+		}
+
+		const RenderObject& renderObject = *renderPackage.renderObject;
+		const std::vector<RenderInstance>& renderInstances = *renderPackage.renderInstances;
+
+		cullConstants.boundsMin = renderObject.bounds.min;
+		cullConstants.boundsMax = renderObject.bounds.max;
+		cullConstants.firstInstance = renderInstances.front().CBIndex;
+		cullConstants.instanceCount = (UINT)renderInstances.size();
+		cullConstants.firstCommand = commandCount;
+		cullConstants.countIndex = i;
+
+		for (const DrawArgs& drawArgs : renderObject.drawArgs)
+		{
+			cullConstants.indexCount = drawArgs.indexCount;
+			cullConstants.startIndex = drawArgs.startIndex;
+			cullConstants.baseVertex = (INT)drawArgs.baseVertex;
+
+			commandList->SetComputeRoot32BitConstants(0, sizeof(CullConstants) / 4, &cullConstants, 0);
+			commandList->Dispatch((cullConstants.instanceCount + CullThreadGroupSize - 1) / CullThreadGroupSize, 1, 1);
+		}
+
+		commandCount += (UINT)(renderInstances.size() * renderObject.drawArgs.size());
+	}
+
+	// Flushed with the end of the frame graph transitions before the draws.
+	argumentBuffer.TransitionTo(D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, barrierBatcher);
+}
+
+void DeferredGBufferRenderPass::BuildCulledRenderPass(const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs)
+{
+	DeferredGBufferRenderPassArgs& args = ToSpecificArgs<DeferredGBufferRenderPassArgs>(pipelineArgs);
+	const std::vector<UINT>& firstCommands = m_firstCommands[frameIndex];
+	assert(firstCommands.size() == renderPackages.size());
+
+	auto commandList = GetCommandList(0, frameIndex);
+	GPUResource& argumentBuffer = m_argumentBuffers[frameIndex];
+
+	// Draw the commands that survived culling.
+	SetCommonStates(args.commonArgs, m_pipelineState, commandList);
+	commandList->OMSetRenderTargets(GBufferIDCount, &args.firstGBufferRTVHandle, TRUE, &args.commonArgs.depthStencilView);
+	FlushBarriers(0, frameIndex);
+
+	for (UINT i = 0; i < (UINT)renderPackages.size(); i++)
+	{
+		const RenderPackage& renderPackage = renderPackages[i];
+		if (!renderPackage.renderObject || !renderPackage.renderInstances || renderPackage.renderInstances->empty())
+		{
+			continue;
+		}
+
+		const RenderObject& renderObject = *renderPackage.renderObject;
+		PerRenderObject(renderObject, pipelineArgs, 0, frameIndex);
+
+		const UINT maxCommandCount = (UINT)(renderPackage.renderInstances->size() * renderObject.drawArgs.size());
+		commandList->ExecuteIndirect(
+			m_commandSignature.Get(),
+			maxCommandCount,
+			argumentBuffer.Get(),
+			ArgumentBufferCommandsOffset + (UINT64)firstCommands[i] * sizeof(IndirectDrawCommand),
+			argumentBuffer.Get(),
+			i * sizeof(UINT)
+		);
+	}
 }
 
 void DeferredGBufferRenderPass::PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
 {
 	auto commandList = GetCommandList(context, frameIndex);
 
+	commandList->SetPipelineState(m_layoutPipelineStates[GetVertexLayoutIndex(renderObject.vertexLayout)].Get());
 	commandList->IASetPrimitiveTopology(renderObject.topology);
 	commandList->IASetVertexBuffers(0, 1, &renderObject.vertexBufferView);
 	commandList->IASetIndexBuffer(&renderObject.indexBufferView);
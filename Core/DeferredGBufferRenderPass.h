@@ -1,15 +1,74 @@
 #pragma once 
 
 #include "DX12RenderPass.h"
+#include "FrustumCulling.h"
+
+// Root constants of shaders/CullInstancesCS.hlsl, culls the instances of one render object for one of its draw args.
+struct CullConstants
+{
+	FrustumPlanes frustum;
+	DirectX::XMFLOAT3 boundsMin;
+	UINT firstInstance;
+	DirectX::XMFLOAT3 boundsMax;
+	UINT instanceCount;
+	UINT indexCount;
+	UINT startIndex;
+	INT baseVertex;
+	// First command of the render object in the argument buffer. The draw args of a render object share its commands.
+	UINT firstCommand;
+	// Index of the command count of the render object.
+	UINT countIndex;
+};
+static_assert(sizeof(CullConstants) == 37 * sizeof(UINT), "CullConstants has to match the root constants of the culling shader.");
+
+// One command of the argument buffer. The first instance root constant followed by the draw.
+struct IndirectDrawCommand
+{
+	UINT firstInstance;
+	D3D12_DRAW_INDEXED_ARGUMENTS drawArgs;
+};
+
+constexpr UINT CullThreadGroupSize = 64;
+// The argument buffer starts with one command count per render object, which leaves room for this many.
+constexpr UINT MaxCulledRenderObjects = 64;
+constexpr UINT64 ArgumentBufferCommandsOffset = MaxCulledRenderObjects * sizeof(UINT);
 
 class DeferredGBufferRenderPass : public DX12RenderPass
 {
 public:
 	DeferredGBufferRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
 
+	// With GPU culling, the culling is the prologue. It runs while the G-buffers and the depth buffer are transitioned.
+	bool HasPrologue() const override final;
+	void RecordPrologue(const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
 	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
 
 protected:
 	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
 	void PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+
+private:
+	ComPtr<ID3D12PipelineState> CreatePipelineState(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig, const VertexLayout& vertexLayout);
+	void CreateCullingObjects(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
+	// Grows the argument buffer of the frame to fit one command per instance and draw arg. The frame's previous use has
+	// finished on the GPU when it's recorded again, so the old buffer can be released.
+	void ReserveArgumentBuffer(const std::vector<RenderPackage>& renderPackages, UINT frameIndex);
+
+	// Draws the instances that RecordPrologue() culled into the argument buffer with one ExecuteIndirect per render object.
+	void BuildCulledRenderPass(const std::vector<RenderPackage>& renderPackages, UINT frameIndex, RenderPassArgs* pipelineArgs);
+
+private:
+	std::array<ComPtr<ID3D12PipelineState>, VertexLayoutCount> m_layoutPipelineStates;
+
+	ComPtr<ID3D12Device5> m_device;
+	ComPtr<ID3D12RootSignature> m_cullRootSignature;
+	ComPtr<ID3D12PipelineState> m_cullPipelineState;
+	ComPtr<ID3D12CommandSignature> m_commandSignature;
+
+	// The command counts of the render objects, followed by the commands. Written by the culling shader every frame.
+	std::array<GPUResource, BackBufferCount> m_argumentBuffers;
+	std::array<UINT, BackBufferCount> m_argumentBufferCommandCapacities = {};
+	// First command of every render package, written by the culling and read by the draws.
+	std::array<std::vector<UINT>, BackBufferCount> m_firstCommands;
 };
\ No newline at end of file
@@ -36,6 +36,17 @@ DeferredLightingRenderPass::DeferredLightingRenderPass(ComPtr<ID3D12Device5> dev
 	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, DeferredLightingStateStream);
 }
 
+void DeferredLightingRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	for (UINT i = 0; i < GBufferIDCount; i++)
+	{
+		frameGraph.Read(graphPass, FrameGraphGBufferDiffuse + i, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
+
+	// Renders to the middle texture unless there is no pass after it.
+	frameGraph.Write(graphPass, isLastRenderPass ? FrameGraphBackBuffer : FrameGraphMiddleTexture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+}
+
 void DeferredLightingRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
 	assert(pipelineArgs != nullptr);
@@ -55,6 +66,7 @@ void DeferredLightingRenderPass::BuildRenderPass(const std::vector<RenderPackage
 
 	commandList->OMSetRenderTargets(1, &args.RTV, TRUE, nullptr);
 
+	FlushBarriers(context, frameIndex);
 	commandList->DrawInstanced(6, 1, 0, 0);
 }
 
@@ -0,0 +1,129 @@
+#include "DenoiseRenderPass.h"
+
+namespace
+{
+	enum DenoiseRootParameterIdx : UINT
+	{
+		DenoiseConstantsIdx = 0,
+		GBufferTableIdx,
+		AOTextureTableIdx,
+		DenoiseTexturesTableIdx,
+
+		DenoiseRootParameterCount
+	};
+}
+
+DenoiseRenderPass::DenoiseRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig)
+	: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_COMPUTE, false)
+{
+	// The pass has its own compute root signature, the raster one isn't used.
+	const CD3DX12_DESCRIPTOR_RANGE gBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, GlobalDescriptors::GetDescriptorCount(SRVGBuffers), 0);
+	const CD3DX12_DESCRIPTOR_RANGE aoTextureRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, GlobalDescriptors::GetDescriptorCount(UAVAOTexture), 0);
+	const CD3DX12_DESCRIPTOR_RANGE denoiseTexturesRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, GlobalDescriptors::GetDescriptorCount(UAVDenoiseTextures), 1);
+
+	std::array<CD3DX12_ROOT_PARAMETER, DenoiseRootParameterCount> rootParameters = {};
+	rootParameters[DenoiseConstantsIdx].InitAsConstants(sizeof(DenoiseConstants) / 4, 0);
+	rootParameters[GBufferTableIdx].InitAsDescriptorTable(1, &gBufferRange);
+	rootParameters[AOTextureTableIdx].InitAsDescriptorTable(1, &aoTextureRange);
+	rootParameters[DenoiseTexturesTableIdx].InitAsDescriptorTable(1, &denoiseTexturesRange);
+
+	const CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc((UINT)rootParameters.size(), rootParameters.data());
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+	D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error) >> CHK_HR;
+	device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_denoiseRootSignature)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_denoiseRootSignature, DenoiseRenderPass);
+
+	ComPtr<ID3DBlob> csBlob;
+	D3DReadFileToBlob(L"../DenoiseCS.cso", &csBlob) >> CHK_HR;
+
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineStateDesc = {
+		.pRootSignature = m_denoiseRootSignature.Get(),
+		.CS = CD3DX12_SHADER_BYTECODE(csBlob.Get())
+	};
+	device->CreateComputePipelineState(&pipelineStateDesc, IID_PPV_ARGS(&m_pipelineState)) >> CHK_HR;
+	NAME_D3D12_OBJECT_MEMBER(m_pipelineState, DenoiseRenderPass);
+}
+
+void DenoiseRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Read(graphPass, FrameGraphGBufferNormal, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	frameGraph.Read(graphPass, FrameGraphGBufferWorldPos, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	frameGraph.Write(graphPass, FrameGraphAOTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	for (UINT i = 0; i < DenoiseTextureCount; i++)
+	{
+		frameGraph.Write(graphPass, FrameGraphDenoiseTexture0 + i, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	}
+}
+
+void DenoiseRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
+{
+	assert(pipelineArgs != nullptr);
+	const DenoiseRenderPassArgs& args = ToSpecificArgs<DenoiseRenderPassArgs>(pipelineArgs);
+
+	// Without iterations the AO is left as it is.
+	if (args.settings.iterationCount == 0)
+	{
+		return;
+	}
+
+	auto commandList = GetCommandList(context, frameIndex);
+
+	std::array<ID3D12DescriptorHeap*, 1> descriptorHeaps = { args.commonArgs.cbvSrvUavHeapGlobal.Get() };
+	commandList->SetDescriptorHeaps((UINT)descriptorHeaps.size(), descriptorHeaps.data());
+
+	commandList->SetComputeRootSignature(m_denoiseRootSignature.Get());
+	commandList->SetPipelineState(m_pipelineState.Get());
+
+	const CD3DX12_GPU_DESCRIPTOR_HANDLE heapStart(args.commonArgs.cbvSrvUavHeapGlobal->GetGPUDescriptorHandleForHeapStart());
+	commandList->SetComputeRootDescriptorTable(GBufferTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(SRVGBuffers), args.commonArgs.cbvSrvUavDescSize));
+	commandList->SetComputeRootDescriptorTable(AOTextureTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(UAVAOTexture), args.commonArgs.cbvSrvUavDescSize));
+	commandList->SetComputeRootDescriptorTable(DenoiseTexturesTableIdx,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, GlobalDescriptors::GetDescriptorOffset(UAVDenoiseTextures), args.commonArgs.cbvSrvUavDescSize));
+
+	DenoiseConstants constants = {
+		.width = args.screenWidth,
+		.height = args.screenHeight,
+		.stepSize = 1,
+		.passType = DenoisePassVariance,
+		.sourceIndex = 0,
+		.phiColor = args.settings.phiColor,
+		.phiPosition = args.settings.phiPosition
+	};
+
+	const UINT groupCountX = (args.screenWidth + DenoiseThreadGroupSize - 1) / DenoiseThreadGroupSize;
+	const UINT groupCountY = (args.screenHeight + DenoiseThreadGroupSize - 1) / DenoiseThreadGroupSize;
+
+	// The variance pass, then one pass per iteration. Every pass reads what the one before wrote around its pixels.
+	for (UINT pass = 0; pass <= args.settings.iterationCount; pass++)
+	{
+		if (pass > 0)
+		{
+			const UINT iteration = pass - 1;
+			constants.stepSize = 1u << iteration;
+			constants.passType = iteration + 1 == args.settings.iterationCount ? DenoisePassLastIteration : DenoisePassIteration;
+			constants.sourceIndex = iteration % DenoiseTextureCount;
+
+			// Covers the denoise textures and the AO texture at once.
+			GetBarrierBatcher(context, frameIndex).UAV(nullptr);
+		}
+
+		commandList->SetComputeRoot32BitConstants(DenoiseConstantsIdx, sizeof(DenoiseConstants) / 4, &constants, 0);
+		FlushBarriers(context, frameIndex);
+		commandList->Dispatch(groupCountX, groupCountY, 1);
+	}
+}
+
+void DenoiseRenderPass::PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
+
+void DenoiseRenderPass::PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex)
+{
+	// NO OP
+}
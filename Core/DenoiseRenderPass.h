@@ -0,0 +1,47 @@
+#pragma once 
+
+#include "DX12RenderPass.h"
+
+// Root constants of shaders/DenoiseCS.hlsl, set once per dispatch.
+struct DenoiseConstants
+{
+	UINT width;
+	UINT height;
+	// Distance in pixels between the taps of the iteration.
+	UINT stepSize;
+	UINT passType;
+	// Which of the two denoise textures the iteration reads, it writes the other one.
+	UINT sourceIndex;
+	float phiColor;
+	float phiPosition;
+};
+static_assert(sizeof(DenoiseConstants) == 7 * sizeof(UINT), "DenoiseConstants has to match the root constants of the denoise shader.");
+
+// What a dispatch of the denoise shader does.
+enum DenoisePassType : UINT
+{
+	// Estimates the variance of the AO.
+	DenoisePassVariance = 0,
+	DenoisePassIteration,
+	// Writes the filtered AO back to the AO texture instead of a denoise texture.
+	DenoisePassLastIteration
+};
+
+constexpr UINT DenoiseThreadGroupSize = 8;
+
+// Filters the AO texture with the edge-aware à-trous filter of AtrousDenoiser.h, one dispatch per iteration.
+class DenoiseRenderPass : public DX12RenderPass
+{
+public:
+	DenoiseRenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
+
+	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
+
+protected:
+	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+	void PerRenderInstance(const RenderInstance& renderInstance, const std::vector<DrawArgs>& drawArgs, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
+
+private:
+	ComPtr<ID3D12RootSignature> m_denoiseRootSignature;
+};
@@ -0,0 +1,568 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	constexpr uint32_t QueueCount = (uint32_t)FrameGraphQueue::Count;
+	constexpr uint32_t NoPass = FrameGraphNoPass;
+
+	// States that compute command lists can't transition from or to.
+	const D3D12_RESOURCE_STATES GraphicsOnlyStates =
+		D3D12_RESOURCE_STATE_INDEX_BUFFER |
+		D3D12_RESOURCE_STATE_RENDER_TARGET |
+		D3D12_RESOURCE_STATE_DEPTH_WRITE |
+		D3D12_RESOURCE_STATE_DEPTH_READ |
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+		D3D12_RESOURCE_STATE_STREAM_OUT |
+		D3D12_RESOURCE_STATE_RESOLVE_DEST |
+		D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+
+	const D3D12_RESOURCE_STATES WriteStates =
+		D3D12_RESOURCE_STATE_RENDER_TARGET |
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+		D3D12_RESOURCE_STATE_DEPTH_WRITE |
+		D3D12_RESOURCE_STATE_STREAM_OUT |
+		D3D12_RESOURCE_STATE_COPY_DEST |
+		D3D12_RESOURCE_STATE_RESOLVE_DEST;
+
+	// Read states that can be combined with other read states. COMMON (which is also PRESENT) and acceleration structures
+	// have to be used on their own.
+	bool IsMergeableRead(D3D12_RESOURCE_STATES state)
+	{
+		const D3D12_RESOURCE_STATES exclusiveStates = WriteStates | D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE;
+		return state != D3D12_RESOURCE_STATE_COMMON && (state & exclusiveStates) == 0;
+	}
+
+	bool HasGraphicsOnlyState(D3D12_RESOURCE_STATES state)
+	{
+		return (state & GraphicsOnlyStates) != 0;
+	}
+}
+
+uint32_t FrameGraph::AddResource(const std::string& name, D3D12_RESOURCE_STATES initialState)
+{
+	m_resources.push_back({ name, initialState, initialState, false, false });
+	m_isCompiled = false;
+	return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t FrameGraph::AddPass(const std::string& name, FrameGraphQueue queue)
+{
+	m_passes.push_back({ name, queue, {} });
+	m_isCompiled = false;
+	return (uint32_t)m_passes.size() - 1;
+}
+
+void FrameGraph::Read(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state)
+{
+	if ((state & (WriteStates & ~D3D12_RESOURCE_STATE_UNORDERED_ACCESS)) != 0)
+	{
+		throw std::runtime_error("Frame graph pass '" + GetPassName(pass) + "' reads '" + GetResourceName(resource) + "' in a write state.");
+	}
+
+	AddAccess(pass, resource, state, false);
+}
+
+void FrameGraph::Write(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state)
+{
+	AddAccess(pass, resource, state, true);
+}
+
+void FrameGraph::SetInitialState(uint32_t resource, D3D12_RESOURCE_STATES state)
+{
+	if (m_resources.at(resource).initialState != state)
+	{
+		m_resources[resource].initialState = state;
+		m_isCompiled = false;
+	}
+}
+
+void FrameGraph::SetFinalState(uint32_t resource, D3D12_RESOURCE_STATES state)
+{
+	m_resources.at(resource).finalState = state;
+	m_resources[resource].hasFinalState = true;
+	m_isCompiled = false;
+}
+
+void FrameGraph::SetTransient(uint32_t resource)
+{
+	m_resources.at(resource).isTransient = true;
+	m_isCompiled = false;
+}
+
+bool FrameGraph::IsTransient(uint32_t resource) const
+{
+	return m_resources.at(resource).isTransient;
+}
+
+void FrameGraph::ClearPasses()
+{
+	m_passes.clear();
+	m_isCompiled = false;
+}
+
+void FrameGraph::Compile()
+{
+	const uint32_t passCount = (uint32_t)m_passes.size();
+
+	m_compiledPasses.assign(passCount, {});
+	m_finalBarriers.clear();
+	m_frameEndWaits.clear();
+	m_finalStates.resize(m_resources.size());
+	m_lifetimes.assign(m_resources.size(), {});
+	m_stats = {};
+	m_isCompiled = false;
+
+	// For every pass and queue, one past the latest pass on that queue that the pass depends on. Zero means none.
+	std::vector<std::array<uint32_t, QueueCount>> dependencies(passCount);
+	for (uint32_t resource = 0; resource < (uint32_t)m_resources.size(); resource++)
+	{
+		CompileResource(resource, dependencies);
+	}
+
+	// A queue that already waited for a pass doesn't have to wait for it or any earlier pass of that queue again.
+	std::array<std::array<uint32_t, QueueCount>, QueueCount> waitedFor = {};
+	std::array<uint32_t, QueueCount> lastPassOnQueue = {};
+	for (uint32_t pass = 0; pass < passCount; pass++)
+	{
+		const uint32_t queue = (uint32_t)m_passes[pass].queue;
+		lastPassOnQueue[queue] = pass + 1;
+
+		for (uint32_t otherQueue = 0; otherQueue < QueueCount; otherQueue++)
+		{
+			const uint32_t dependency = dependencies[pass][otherQueue];
+			if (otherQueue != queue && dependency > waitedFor[queue][otherQueue])
+			{
+				m_compiledPasses[pass].waits.push_back({ (FrameGraphQueue)otherQueue, dependency - 1 });
+				m_compiledPasses[dependency - 1].signalAfter = true;
+				waitedFor[queue][otherQueue] = dependency;
+				m_stats.waitCount++;
+			}
+		}
+	}
+
+	const uint32_t directQueue = (uint32_t)FrameGraphQueue::Direct;
+	for (uint32_t otherQueue = 0; otherQueue < QueueCount; otherQueue++)
+	{
+		if (otherQueue != directQueue && lastPassOnQueue[otherQueue] > waitedFor[directQueue][otherQueue])
+		{
+			m_frameEndWaits.push_back({ (FrameGraphQueue)otherQueue, lastPassOnQueue[otherQueue] - 1 });
+			m_compiledPasses[lastPassOnQueue[otherQueue] - 1].signalAfter = true;
+			m_stats.waitCount++;
+		}
+	}
+
+	CompilePassOrder();
+
+	// Every transient has to be ordered after the previous frame, which only the direct queue is, through the frame end
+	// waits. The last frame's use of memory that a transient shares could still be running otherwise.
+	for (uint32_t resource = 0; resource < (uint32_t)m_resources.size(); resource++)
+	{
+		const uint32_t firstPass = m_lifetimes[resource].firstPass;
+		if (m_resources[resource].isTransient && firstPass != NoPass && m_passes[firstPass].queue != FrameGraphQueue::Direct &&
+			m_passOrder[firstPass][directQueue] == 0)
+		{
+			throw std::runtime_error("Frame graph pass '" + m_passes[firstPass].name + "' is the first to use the transient resource '" +
+				m_resources[resource].name + "' but doesn't wait for any direct pass.");
+		}
+	}
+
+	for (const FrameGraphCompiledPass& compiledPass : m_compiledPasses)
+	{
+		m_stats.barrierBatchCount += compiledPass.barriersBefore.empty() ? 0 : 1;
+		m_stats.barrierBatchCount += compiledPass.barriersAfter.empty() ? 0 : 1;
+	}
+	m_stats.barrierBatchCount += m_finalBarriers.empty() ? 0 : 1;
+
+	m_isCompiled = true;
+}
+
+bool FrameGraph::IsCompiled() const
+{
+	return m_isCompiled;
+}
+
+uint32_t FrameGraph::GetResourceCount() const
+{
+	return (uint32_t)m_resources.size();
+}
+
+uint32_t FrameGraph::GetPassCount() const
+{
+	return (uint32_t)m_passes.size();
+}
+
+const std::string& FrameGraph::GetResourceName(uint32_t resource) const
+{
+	return m_resources.at(resource).name;
+}
+
+const std::string& FrameGraph::GetPassName(uint32_t pass) const
+{
+	return m_passes.at(pass).name;
+}
+
+FrameGraphQueue FrameGraph::GetPassQueue(uint32_t pass) const
+{
+	return m_passes.at(pass).queue;
+}
+
+const FrameGraphCompiledPass& FrameGraph::GetCompiledPass(uint32_t pass) const
+{
+	return m_compiledPasses.at(pass);
+}
+
+const std::vector<FrameGraphBarrier>& FrameGraph::GetFinalBarriers() const
+{
+	return m_finalBarriers;
+}
+
+const std::vector<FrameGraphWait>& FrameGraph::GetFrameEndWaits() const
+{
+	return m_frameEndWaits;
+}
+
+D3D12_RESOURCE_STATES FrameGraph::GetFinalState(uint32_t resource) const
+{
+	return m_finalStates.at(resource);
+}
+
+const FrameGraphStats& FrameGraph::GetStats() const
+{
+	return m_stats;
+}
+
+FrameGraphLifetime FrameGraph::GetLifetime(uint32_t resource) const
+{
+	const ResourceLifetime& lifetime = m_lifetimes.at(resource);
+
+	FrameGraphLifetime result;
+	result.firstPass = lifetime.firstPass;
+	for (uint32_t lastPass : lifetime.lastPassOnQueue)
+	{
+		if (lastPass != NoPass && (result.lastPass == NoPass || lastPass > result.lastPass))
+		{
+			result.lastPass = lastPass;
+		}
+	}
+	return result;
+}
+
+bool FrameGraph::HappensBefore(uint32_t pass, uint32_t laterPass) const
+{
+	return pass < laterPass && m_passOrder.at(laterPass)[(uint32_t)m_passes[pass].queue] > pass;
+}
+
+bool FrameGraph::CanAlias(uint32_t resource, uint32_t otherResource) const
+{
+	if (resource == otherResource)
+	{
+		return false;
+	}
+
+	const ResourceLifetime& lifetime = m_lifetimes.at(resource);
+	const ResourceLifetime& otherLifetime = m_lifetimes.at(otherResource);
+	if (lifetime.firstPass == NoPass || otherLifetime.firstPass == NoPass)
+	{
+		return true;
+	}
+
+	return IsOrderedBefore(lifetime, otherLifetime) || IsOrderedBefore(otherLifetime, lifetime);
+}
+
+void FrameGraph::AddAccess(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state, bool isWrite)
+{
+	Pass& graphPass = m_passes.at(pass);
+	if (resource >= m_resources.size())
+	{
+		throw std::runtime_error("Frame graph pass '" + graphPass.name + "' accesses an unknown resource.");
+	}
+
+	const auto isSameResource = [resource](const Access& access) { return access.resource == resource; };
+	if (std::any_of(graphPass.accesses.begin(), graphPass.accesses.end(), isSameResource))
+	{
+		throw std::runtime_error("Frame graph pass '" + graphPass.name + "' accesses '" + m_resources[resource].name + "' more than once.");
+	}
+
+	graphPass.accesses.push_back({ resource, state, isWrite });
+	m_isCompiled = false;
+}
+
+void FrameGraph::CompileResource(uint32_t resource, std::vector<std::array<uint32_t, (size_t)FrameGraphQueue::Count>>& dependencies)
+{
+	const uint32_t passCount = (uint32_t)m_passes.size();
+
+	// Finds the access of this resource in a pass, if there is one.
+	const auto findAccess = [&](uint32_t pass) -> const Access*
+	{
+		for (const Access& access : m_passes[pass].accesses)
+		{
+			if (access.resource == resource)
+			{
+				return &access;
+			}
+		}
+		return nullptr;
+	};
+
+	const auto addDependency = [&](uint32_t pass, uint32_t dependency)
+	{
+		if (dependency != NoPass && m_passes[dependency].queue != m_passes[pass].queue)
+		{
+			uint32_t& latest = dependencies[pass][(uint32_t)m_passes[dependency].queue];
+			latest = std::max(latest, dependency + 1);
+		}
+	};
+
+	const Resource& graphResource = m_resources[resource];
+	D3D12_RESOURCE_STATES state = graphResource.initialState;
+
+	if (graphResource.isTransient && graphResource.hasFinalState)
+	{
+		throw std::runtime_error("The transient frame graph resource '" + graphResource.name + "' can't have a final state.");
+	}
+
+	ResourceLifetime& lifetime = m_lifetimes[resource];
+	lifetime.firstPass = NoPass;
+	lifetime.lastPassOnQueue.fill(NoPass);
+
+	// Latest pass per queue that accessed the resource since its last transition. All of them have to finish before the
+	// next transition.
+	std::array<uint32_t, QueueCount> lastAccess;
+	lastAccess.fill(NoPass);
+	// Latest pass that wrote or transitioned the resource.
+	uint32_t lastWrite = NoPass;
+
+	// Queues (one bit each) with unordered accesses and writes since the last barrier on that queue. Whatever happened in
+	// the previous frame is unknown, so a resource that starts as a UAV is treated as written on every queue.
+	const uint32_t allQueueBits = (1u << QueueCount) - 1u;
+	// Transients are initialized before their first use instead, so nothing is carried over.
+	const bool isUnknownUAV = state == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && !graphResource.isTransient;
+	uint32_t uavAccessQueues = isUnknownUAV ? allQueueBits : 0u;
+	uint32_t uavWriteQueues = uavAccessQueues;
+
+	for (uint32_t pass = 0; pass < passCount; pass++)
+	{
+		const Access* access = findAccess(pass);
+		if (access == nullptr)
+		{
+			continue;
+		}
+
+		const FrameGraphQueue queue = m_passes[pass].queue;
+		const uint32_t queueBit = 1u << (uint32_t)queue;
+
+		const bool isFirstUse = lifetime.firstPass == NoPass;
+		if (isFirstUse && graphResource.isTransient && !access->isWrite)
+		{
+			throw std::runtime_error("Frame graph pass '" + m_passes[pass].name + "' reads the transient resource '" +
+				graphResource.name + "' before any pass writes it.");
+		}
+
+		D3D12_RESOURCE_STATES targetState = access->state;
+		if (!access->isWrite && IsMergeableRead(access->state))
+		{
+			if (IsMergeableRead(state) && (state & access->state) == access->state)
+			{
+				// An earlier transition already covers this read.
+				targetState = state;
+				m_stats.mergedReadCount += state != access->state ? 1 : 0;
+			}
+			else
+			{
+				// Transition once for every read up to the next write.
+				for (uint32_t nextPass = pass + 1; nextPass < passCount; nextPass++)
+				{
+					const Access* nextAccess = findAccess(nextPass);
+					if (nextAccess == nullptr)
+					{
+						continue;
+					}
+					if (nextAccess->isWrite || !IsMergeableRead(nextAccess->state))
+					{
+						break;
+					}
+					targetState |= nextAccess->state;
+				}
+			}
+		}
+
+		if (targetState != state)
+		{
+			const FrameGraphBarrier transition = { resource, FrameGraphBarrierType::Transition, state, targetState };
+
+			uint32_t barrierPass = pass;
+			if (queue != FrameGraphQueue::Direct && HasGraphicsOnlyState(state | targetState))
+			{
+				// Let the latest direct pass before this one record the transition.
+				barrierPass = NoPass;
+				for (uint32_t previousPass = pass; previousPass-- > 0;)
+				{
+					if (m_passes[previousPass].queue == FrameGraphQueue::Direct)
+					{
+						barrierPass = previousPass;
+						break;
+					}
+				}
+
+				if (barrierPass == NoPass)
+				{
+					throw std::runtime_error("Frame graph pass '" + m_passes[pass].name + "' needs a transition of '" +
+						graphResource.name + "' that only a direct pass can record, but no direct pass comes before it.");
+				}
+
+				for (uint32_t accessPass : lastAccess)
+				{
+					if (accessPass != NoPass && accessPass > barrierPass)
+					{
+						throw std::runtime_error("Frame graph pass '" + m_passes[pass].name + "' needs a transition of '" +
+							graphResource.name + "' that only a direct pass can record, but '" + m_passes[accessPass].name +
+							"' still uses it after the last direct pass.");
+					}
+				}
+
+				if (isFirstUse)
+				{
+					lifetime.firstPass = barrierPass;
+					AddAliasingBarrier(resource, m_compiledPasses[barrierPass].barriersAfter);
+				}
+				m_compiledPasses[barrierPass].barriersAfter.push_back(transition);
+				addDependency(pass, barrierPass);
+
+				uint32_t& lastDirectPass = lifetime.lastPassOnQueue[(uint32_t)FrameGraphQueue::Direct];
+				lastDirectPass = lastDirectPass == NoPass ? barrierPass : std::max(lastDirectPass, barrierPass);
+			}
+			else
+			{
+				if (isFirstUse)
+				{
+					lifetime.firstPass = pass;
+					AddAliasingBarrier(resource, m_compiledPasses[pass].barriersBefore);
+				}
+				m_compiledPasses[pass].barriersBefore.push_back(transition);
+			}
+
+			// Every earlier use has to finish before the transition.
+			for (uint32_t accessPass : lastAccess)
+			{
+				addDependency(barrierPass, accessPass);
+			}
+
+			state = targetState;
+			lastAccess.fill(NoPass);
+			lastAccess[(uint32_t)m_passes[barrierPass].queue] = barrierPass;
+			lastWrite = barrierPass;
+			uavAccessQueues = 0u;
+			uavWriteQueues = 0u;
+			m_stats.transitionCount++;
+		}
+		else if (state == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+		{
+			// Unordered accesses on other queues are ordered by the fence waits instead.
+			if ((uavWriteQueues & queueBit) != 0 || (access->isWrite && (uavAccessQueues & queueBit) != 0))
+			{
+				m_compiledPasses[pass].barriersBefore.push_back({ resource, FrameGraphBarrierType::UAV, state, state });
+				uavAccessQueues &= ~queueBit;
+				uavWriteQueues &= ~queueBit;
+				m_stats.uavBarrierCount++;
+			}
+		}
+
+		if (isFirstUse)
+		{
+			if (lifetime.firstPass == NoPass)
+			{
+				lifetime.firstPass = pass;
+				AddAliasingBarrier(resource, m_compiledPasses[pass].barriersBefore);
+			}
+			if (graphResource.isTransient)
+			{
+				m_compiledPasses[pass].initializations.push_back({ resource, state });
+			}
+		}
+		lifetime.lastPassOnQueue[(uint32_t)queue] = pass;
+
+		// Read after write and write after write on another queue.
+		addDependency(pass, lastWrite);
+		if (access->isWrite)
+		{
+			// Write after read on another queue.
+			for (uint32_t accessPass : lastAccess)
+			{
+				addDependency(pass, accessPass);
+			}
+		}
+
+		lastAccess[(uint32_t)queue] = pass;
+		if (access->isWrite)
+		{
+			lastWrite = pass;
+		}
+		if (state == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+		{
+			uavAccessQueues |= queueBit;
+			uavWriteQueues |= access->isWrite ? queueBit : 0u;
+		}
+	}
+
+	// The final barriers are recorded after the frame end waits, so every queue is done with the resource by then.
+	if (graphResource.hasFinalState && graphResource.finalState != state)
+	{
+		m_finalBarriers.push_back({ resource, FrameGraphBarrierType::Transition, state, graphResource.finalState });
+		state = graphResource.finalState;
+		m_stats.transitionCount++;
+	}
+
+	m_finalStates[resource] = state;
+}
+
+void FrameGraph::AddAliasingBarrier(uint32_t resource, std::vector<FrameGraphBarrier>& barriers)
+{
+	// Every transient gets one, whether or not it ends up sharing memory, so the graph doesn't depend on the heap layout.
+	if (m_resources[resource].isTransient)
+	{
+		barriers.push_back({ resource, FrameGraphBarrierType::Aliasing, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON });
+		m_stats.aliasingBarrierCount++;
+	}
+}
+
+void FrameGraph::CompilePassOrder()
+{
+	const uint32_t passCount = (uint32_t)m_passes.size();
+	m_passOrder.assign(passCount, {});
+
+	// What the latest pass on each queue is ordered after. A wait orders the queue after everything that the waited for
+	// pass was ordered after as well.
+	std::array<std::array<uint32_t, QueueCount>, QueueCount> queueOrder = {};
+	for (uint32_t pass = 0; pass < passCount; pass++)
+	{
+		const uint32_t queue = (uint32_t)m_passes[pass].queue;
+		std::array<uint32_t, QueueCount>& order = queueOrder[queue];
+
+		for (const FrameGraphWait& wait : m_compiledPasses[pass].waits)
+		{
+			for (uint32_t otherQueue = 0; otherQueue < QueueCount; otherQueue++)
+			{
+				order[otherQueue] = std::max(order[otherQueue], m_passOrder[wait.pass][otherQueue]);
+			}
+			order[(uint32_t)wait.queue] = std::max(order[(uint32_t)wait.queue], wait.pass + 1);
+		}
+		order[queue] = pass;
+
+		m_passOrder[pass] = order;
+	}
+}
+
+bool FrameGraph::IsOrderedBefore(const ResourceLifetime& lifetime, const ResourceLifetime& laterLifetime) const
+{
+	for (uint32_t lastPass : lifetime.lastPassOnQueue)
+	{
+		if (lastPass != NoPass && !HappensBefore(lastPass, laterLifetime.firstPass))
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PlatformIncludes.h"
+
+/*
+	Declarative description of the passes of a frame and the resources that they read and write.
+
+	Compile() walks the passes in submission order and derives everything that used to be written by hand:
+	- The transition barriers, where consecutive reads of a resource share a single transition to the union of their read
+	  states, so a G-buffer that is read by a pixel shader and then by a ray generation shader is only transitioned once.
+	- UAV barriers between dependent unordered accesses on the same queue.
+	- Fence waits between the direct and compute queues, reduced to the latest pass that each queue has to wait for.
+	Barriers that belong before the same pass are batched into one list.
+
+	Compute command lists can't transition resources from or to graphics only states like RENDER_TARGET. Such transitions
+	are moved to the end of the latest direct pass before the compute pass, which then waits for that pass.
+
+	Transient resources only hold data within a frame. Compiling also finds the lifetime of every resource and which passes
+	are ordered before which, so that transients whose lifetimes can't overlap on the GPU may share memory. The first use
+	of a transient starts with an aliasing barrier and has to initialize the resource.
+
+	Compiling only needs the declarations, no device, so it runs on any platform.
+*/
+
+enum class FrameGraphQueue : uint32_t
+{
+	Direct = 0,
+	Compute,
+
+	Count // Keep last!
+};
+
+enum class FrameGraphBarrierType : uint32_t
+{
+	Transition = 0,
+	UAV,
+	// Activates a transient resource that may share its memory with others. Recorded with a null resource before.
+	Aliasing
+};
+
+struct FrameGraphBarrier
+{
+	uint32_t resource;
+	FrameGraphBarrierType type;
+	// Only used by transitions.
+	D3D12_RESOURCE_STATES stateBefore;
+	D3D12_RESOURCE_STATES stateAfter;
+};
+
+// A transient resource whose content is undefined at this point, in the state it's in when it has to be initialized.
+struct FrameGraphInitialization
+{
+	uint32_t resource;
+	D3D12_RESOURCE_STATES state;
+};
+
+// A GPU side wait for the given pass on another queue to finish.
+struct FrameGraphWait
+{
+	FrameGraphQueue queue;
+	uint32_t pass;
+};
+
+struct FrameGraphCompiledPass
+{
+	// Recorded at the start of the pass on its own queue.
+	std::vector<FrameGraphBarrier> barriersBefore;
+	// Recorded at the end of the pass. Holds transitions that a later pass on another queue can't record itself.
+	std::vector<FrameGraphBarrier> barriersAfter;
+	// Waits that the queue of the pass does before the pass starts.
+	std::vector<FrameGraphWait> waits;
+	// Transient resources that start their lifetime in the pass. They have to be cleared, discarded or copied to after the
+	// barriers before and before anything else uses them.
+	std::vector<FrameGraphInitialization> initializations;
+	// The pass is waited for by another queue, so its queue has to signal once the pass is done.
+	bool signalAfter = false;
+};
+
+struct FrameGraphStats
+{
+	uint32_t transitionCount = 0;
+	uint32_t uavBarrierCount = 0;
+	uint32_t aliasingBarrierCount = 0;
+	// Number of non-empty barrier lists, each of which is recorded with one ResourceBarrier() call.
+	uint32_t barrierBatchCount = 0;
+	uint32_t waitCount = 0;
+	// Reads that didn't need a transition because an earlier transition already included their state.
+	uint32_t mergedReadCount = 0;
+};
+
+constexpr uint32_t FrameGraphNoPass = UINT32_MAX;
+
+// First and last pass that use a resource, FrameGraphNoPass for both when no pass does. Includes the passes that record
+// transitions of the resource for other queues.
+struct FrameGraphLifetime
+{
+	uint32_t firstPass = FrameGraphNoPass;
+	uint32_t lastPass = FrameGraphNoPass;
+};
+
+class FrameGraph
+{
+public:
+	// Resources and passes are identified by the index that these return, in the order they were added.
+	uint32_t AddResource(const std::string& name, D3D12_RESOURCE_STATES initialState);
+	uint32_t AddPass(const std::string& name, FrameGraphQueue queue);
+
+	// Every pass accesses a resource at most once. Reads may only use read states, which is what allows them to be merged.
+	void Read(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state);
+	void Write(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state);
+
+	// The state of the resource when the frame starts, which usually is the final state of the previous frame.
+	void SetInitialState(uint32_t resource, D3D12_RESOURCE_STATES state);
+	// Adds a transition to the given state after the last pass. Resources without a final state keep their last state.
+	void SetFinalState(uint32_t resource, D3D12_RESOURCE_STATES state);
+	// The content of a transient resource doesn't survive the frame, so the first pass that uses it has to write it. Transient
+	// resources can't have a final state.
+	void SetTransient(uint32_t resource);
+	bool IsTransient(uint32_t resource) const;
+
+	// Removes all passes but keeps the resources.
+	void ClearPasses();
+
+	// Throws if the passes can't be scheduled, for example when a compute pass needs a graphics only transition and no
+	// direct pass comes before it, or when a transient resource is read before it's written.
+	void Compile();
+	// False after any change to the passes or the resource states since the last Compile().
+	bool IsCompiled() const;
+
+	uint32_t GetResourceCount() const;
+	uint32_t GetPassCount() const;
+	const std::string& GetResourceName(uint32_t resource) const;
+	const std::string& GetPassName(uint32_t pass) const;
+	FrameGraphQueue GetPassQueue(uint32_t pass) const;
+
+	const FrameGraphCompiledPass& GetCompiledPass(uint32_t pass) const;
+	// Recorded on the direct queue after every pass and the frame end waits.
+	const std::vector<FrameGraphBarrier>& GetFinalBarriers() const;
+	// Waits of the direct queue for the last pass of every other queue, so that a fence on the direct queue covers the frame.
+	const std::vector<FrameGraphWait>& GetFrameEndWaits() const;
+	// State of the resource after the final barriers.
+	D3D12_RESOURCE_STATES GetFinalState(uint32_t resource) const;
+
+	const FrameGraphStats& GetStats() const;
+
+	// The functions below are valid after Compile().
+	FrameGraphLifetime GetLifetime(uint32_t resource) const;
+	// True if the GPU finishes the pass before it starts the later pass. Passes on the same queue count as ordered, since
+	// every barrier between them, including the aliasing barriers, waits for the earlier work.
+	bool HappensBefore(uint32_t pass, uint32_t laterPass) const;
+	// True if the two resources are never in use at the same time on any queue, so placing them in the same memory is safe.
+	// A resource that no pass uses can alias any other.
+	bool CanAlias(uint32_t resource, uint32_t otherResource) const;
+
+private:
+	struct Access
+	{
+		uint32_t resource;
+		D3D12_RESOURCE_STATES state;
+		bool isWrite;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		FrameGraphQueue queue;
+		std::vector<Access> accesses;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		D3D12_RESOURCE_STATES initialState;
+		D3D12_RESOURCE_STATES finalState;
+		bool hasFinalState;
+		bool isTransient;
+	};
+
+	struct ResourceLifetime
+	{
+		uint32_t firstPass;
+		// Uses can overlap on different queues, so every queue has to be done with the resource before it ends.
+		std::array<uint32_t, (size_t)FrameGraphQueue::Count> lastPassOnQueue;
+	};
+
+	void AddAccess(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state, bool isWrite);
+	void CompileResource(uint32_t resource, std::vector<std::array<uint32_t, (size_t)FrameGraphQueue::Count>>& dependencies);
+	void AddAliasingBarrier(uint32_t resource, std::vector<FrameGraphBarrier>& barriers);
+	void CompilePassOrder();
+	bool IsOrderedBefore(const ResourceLifetime& lifetime, const ResourceLifetime& laterLifetime) const;
+
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+
+	std::vector<FrameGraphCompiledPass> m_compiledPasses;
+	std::vector<FrameGraphBarrier> m_finalBarriers;
+	std::vector<FrameGraphWait> m_frameEndWaits;
+	std::vector<D3D12_RESOURCE_STATES> m_finalStates;
+	std::vector<ResourceLifetime> m_lifetimes;
+	// For every pass and queue, one past the latest pass of that queue that is ordered before the pass.
+	std::vector<std::array<uint32_t, (size_t)FrameGraphQueue::Count>> m_passOrder;
+	FrameGraphStats m_stats;
+	bool m_isCompiled = false;
+};
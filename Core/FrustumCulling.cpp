@@ -0,0 +1,349 @@
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <random>
+
+#include "MathUtils.h"
+#include "SimdUtils.h"
+
+namespace
+{
+	// Plane components in SoA form, one plane per lane. The two lanes after the six planes hold a plane that every box
+	// passes.
+	struct SimdFrustum
+	{
+		alignas(32) float a[8];
+		alignas(32) float b[8];
+		alignas(32) float c[8];
+		alignas(32) float d[8];
+		alignas(32) float absA[8];
+		alignas(32) float absB[8];
+		alignas(32) float absC[8];
+	};
+
+	SimdFrustum CreateSimdFrustum(const FrustumPlanes& frustum)
+	{
+		SimdFrustum simdFrustum = {};
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const DirectX::XMFLOAT4 plane = i < frustum.planes.size() ? frustum.planes[i] : DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			simdFrustum.a[i] = plane.x;
+			simdFrustum.b[i] = plane.y;
+			simdFrustum.c[i] = plane.z;
+			simdFrustum.d[i] = plane.w;
+			simdFrustum.absA[i] = std::abs(plane.x);
+			simdFrustum.absB[i] = std::abs(plane.y);
+			simdFrustum.absC[i] = std::abs(plane.z);
+		}
+		return simdFrustum;
+	}
+
+	bool IsBoxInFrustum(const FrustumPlanes& frustum, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents)
+	{
+		for (const DirectX::XMFLOAT4& plane : frustum.planes)
+		{
+			// Signed distance of the center and the largest distance of any corner from the center, along the normal.
+			const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			const float radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+			if (distance + radius < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool IsBoxInFrustumSimd(const SimdFrustum& frustum, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents)
+	{
+		const SimdFloat8 distance =
+			SimdFloat8::Load(frustum.a) * SimdFloat8::Broadcast(center.x) +
+			SimdFloat8::Load(frustum.b) * SimdFloat8::Broadcast(center.y) +
+			SimdFloat8::Load(frustum.c) * SimdFloat8::Broadcast(center.z) +
+			SimdFloat8::Load(frustum.d);
+		const SimdFloat8 radius =
+			SimdFloat8::Load(frustum.absA) * SimdFloat8::Broadcast(extents.x) +
+			SimdFloat8::Load(frustum.absB) * SimdFloat8::Broadcast(extents.y) +
+			SimdFloat8::Load(frustum.absC) * SimdFloat8::Broadcast(extents.z);
+
+		return MoveMask(distance + radius < SimdFloat8::Broadcast(0.0f)) == 0;
+	}
+
+	// Row vector perspective projection of a camera at the origin that looks down +z, with D3D depth from 0 to 1.
+	DirectX::XMFLOAT4X4 PerspectiveProjection(float fovY, float aspectRatio, float nearZ, float farZ)
+	{
+		const float yScale = 1.0f / std::tan(fovY * 0.5f);
+		const float xScale = yScale / aspectRatio;
+		const float zRange = farZ / (farZ - nearZ);
+
+		DirectX::XMFLOAT4X4 projection = {};
+		projection._11 = xScale;
+		projection._22 = yScale;
+		projection._33 = zRange;
+		projection._34 = 1.0f;
+		projection._43 = -nearZ * zRange;
+		return projection;
+	}
+
+	DirectX::XMFLOAT4 AddColumns(const DirectX::XMFLOAT4X4& m, int column, int otherColumn, float sign)
+	{
+		return {
+			m.m[0][column] + sign * m.m[0][otherColumn],
+			m.m[1][column] + sign * m.m[1][otherColumn],
+			m.m[2][column] + sign * m.m[2][otherColumn],
+			m.m[3][column] + sign * m.m[3][otherColumn]
+		};
+	}
+}
+
+FrustumPlanes ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& viewProjection)
+{
+	// With row vectors, clip space coordinate i is the dot product of the point with column i. Each plane bounds one clip
+	// coordinate by w: -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+	const DirectX::XMFLOAT4X4& m = viewProjection;
+
+	FrustumPlanes frustum;
+	frustum.planes[0] = AddColumns(m, 3, 0, 1.0f);
+	frustum.planes[1] = AddColumns(m, 3, 0, -1.0f);
+	frustum.planes[2] = AddColumns(m, 3, 1, 1.0f);
+	frustum.planes[3] = AddColumns(m, 3, 1, -1.0f);
+	frustum.planes[4] = { m._13, m._23, m._33, m._43 };
+	frustum.planes[5] = AddColumns(m, 3, 2, -1.0f);
+	return frustum;
+}
+
+void TransformBoundsToWorld(const BoundingBox& objectBounds, const DirectX::XMFLOAT4X4& model, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents)
+{
+	const DirectX::XMFLOAT3 objectCenter = {
+		(objectBounds.min.x + objectBounds.max.x) * 0.5f,
+		(objectBounds.min.y + objectBounds.max.y) * 0.5f,
+		(objectBounds.min.z + objectBounds.max.z) * 0.5f
+	};
+	const DirectX::XMFLOAT3 objectExtents = {
+		(objectBounds.max.x - objectBounds.min.x) * 0.5f,
+		(objectBounds.max.y - objectBounds.min.y) * 0.5f,
+		(objectBounds.max.z - objectBounds.min.z) * 0.5f
+	};
+
+	center = {
+		objectCenter.x * model._11 + objectCenter.y * model._21 + objectCenter.z * model._31 + model._41,
+		objectCenter.x * model._12 + objectCenter.y * model._22 + objectCenter.z * model._32 + model._42,
+		objectCenter.x * model._13 + objectCenter.y * model._23 + objectCenter.z * model._33 + model._43
+	};
+	extents = {
+		objectExtents.x * std::abs(model._11) + objectExtents.y * std::abs(model._21) + objectExtents.z * std::abs(model._31),
+		objectExtents.x * std::abs(model._12) + objectExtents.y * std::abs(model._22) + objectExtents.z * std::abs(model._32),
+		objectExtents.x * std::abs(model._13) + objectExtents.y * std::abs(model._23) + objectExtents.z * std::abs(model._33)
+	};
+}
+
+bool IsInstanceVisible(const FrustumPlanes& frustum, const BoundingBox& objectBounds, const DirectX::XMFLOAT4X4& model)
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 extents;
+	TransformBoundsToWorld(objectBounds, model, center, extents);
+
+	return IsBoxInFrustum(frustum, center, extents);
+}
+
+uint32_t CullInstances(const FrustumPlanes& frustum, const BoundingBox& objectBounds, std::span<const RenderInstance> instances, std::vector<uint32_t>& visibleInstances, CullingMode mode)
+{
+	visibleInstances.clear();
+
+	const SimdFrustum simdFrustum = CreateSimdFrustum(frustum);
+	for (uint32_t i = 0; i < (uint32_t)instances.size(); i++)
+	{
+		DirectX::XMFLOAT3 center;
+		DirectX::XMFLOAT3 extents;
+		TransformBoundsToWorld(objectBounds, instances[i].instanceData.modelMatrix, center, extents);
+
+		const bool isVisible = mode == CullingMode::Simd ?
+			IsBoxInFrustumSimd(simdFrustum, center, extents) :
+			IsBoxInFrustum(frustum, center, extents);
+
+		if (isVisible)
+		{
+			visibleInstances.push_back(i);
+		}
+	}
+
+	return (uint32_t)visibleInstances.size();
+}
+
+uint32_t CullInstanceRange(const FrustumPlanes& frustum, const InstanceStore& instanceStore, InstanceRange range, std::vector<uint32_t>& visibleInstances)
+{
+	visibleInstances.clear();
+
+	struct SimdPlane
+	{
+		SimdFloat8 a, b, c, d;
+		SimdFloat8 absA, absB, absC;
+	};
+
+	std::array<SimdPlane, 6> planes;
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		const DirectX::XMFLOAT4& plane = frustum.planes[i];
+		planes[i] = {
+			SimdFloat8::Broadcast(plane.x), SimdFloat8::Broadcast(plane.y), SimdFloat8::Broadcast(plane.z), SimdFloat8::Broadcast(plane.w),
+			SimdFloat8::Broadcast(std::abs(plane.x)), SimdFloat8::Broadcast(std::abs(plane.y)), SimdFloat8::Broadcast(std::abs(plane.z))
+		};
+	}
+
+	const SimdFloat8 zero = SimdFloat8::Broadcast(0.0f);
+
+	// The padding of the store keeps the loads of the last eight instances inside of the arrays, the lanes past the end of
+	// the range are masked out.
+	for (uint32_t i = 0; i < range.count; i += SimdFloat8::Width)
+	{
+		const uint32_t instance = range.first + i;
+		const SimdFloat8 centerX = SimdFloat8::Load(instanceStore.GetCentersX() + instance);
+		const SimdFloat8 centerY = SimdFloat8::Load(instanceStore.GetCentersY() + instance);
+		const SimdFloat8 centerZ = SimdFloat8::Load(instanceStore.GetCentersZ() + instance);
+		const SimdFloat8 extentX = SimdFloat8::Load(instanceStore.GetExtentsX() + instance);
+		const SimdFloat8 extentY = SimdFloat8::Load(instanceStore.GetExtentsY() + instance);
+		const SimdFloat8 extentZ = SimdFloat8::Load(instanceStore.GetExtentsZ() + instance);
+
+		// A mask with no lane set, since zero has no bits set.
+		SimdFloat8 outside = zero;
+		for (const SimdPlane& plane : planes)
+		{
+			const SimdFloat8 distance = plane.a * centerX + plane.b * centerY + plane.c * centerZ + plane.d;
+			const SimdFloat8 radius = plane.absA * extentX + plane.absB * extentY + plane.absC * extentZ;
+			outside = outside | (distance + radius < zero);
+		}
+
+		const uint32_t laneCount = std::min(range.count - i, SimdFloat8::Width);
+		uint32_t visibleMask = ~MoveMask(outside) & ((1u << laneCount) - 1u);
+		while (visibleMask != 0)
+		{
+			visibleInstances.push_back(i + (uint32_t)std::countr_zero(visibleMask));
+			visibleMask &= visibleMask - 1u;
+		}
+	}
+
+	return (uint32_t)visibleInstances.size();
+}
+
+std::vector<CullingBenchmarkResult> BenchmarkCulling(const FrustumPlanes& frustum, const BoundingBox& objectBounds, std::span<const RenderInstance> instances, uint32_t iterationCount)
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<CullingBenchmarkResult> results;
+	std::vector<uint8_t> referenceVisibility;
+	std::vector<uint32_t> visibleInstances;
+
+	for (uint32_t mode = 0; mode < (uint32_t)CullingMode::Count; mode++)
+	{
+		const auto start = Clock::now();
+		for (uint32_t iteration = 0; iteration < iterationCount; iteration++)
+		{
+			CullInstances(frustum, objectBounds, instances, visibleInstances, (CullingMode)mode);
+		}
+		const double microseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+		std::vector<uint8_t> visibility(instances.size(), 0);
+		for (uint32_t visibleInstance : visibleInstances)
+		{
+			visibility[visibleInstance] = 1;
+		}
+
+		// Scalar is the first mode, so its result is the reference for the other ones.
+		if ((CullingMode)mode == CullingMode::Scalar)
+		{
+			referenceVisibility = visibility;
+		}
+
+		CullingBenchmarkResult result;
+		result.mode = (CullingMode)mode;
+		result.instanceCount = (uint32_t)instances.size();
+		result.visibleCount = (uint32_t)visibleInstances.size();
+		result.microseconds = microseconds / std::max(iterationCount, 1u);
+		result.mismatchedCount = 0;
+		for (size_t i = 0; i < visibility.size(); i++)
+		{
+			result.mismatchedCount += visibility[i] != referenceVisibility[i] ? 1 : 0;
+		}
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+InstanceCullingBenchmarkResult BenchmarkInstanceCulling(const InstanceCullingBenchmarkSettings& settings)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Unit cubes in a box that is three times as wide as the far plane is far away.
+	std::mt19937 generator(1337u);
+	std::uniform_real_distribution<float> position(-1500.0f, 1500.0f);
+
+	RenderInstanceMap renderInstancesByID;
+	std::vector<RenderInstance>& renderInstances = renderInstancesByID[RenderObjectID::Cube];
+	renderInstances.resize(settings.instanceCount);
+	for (uint32_t i = 0; i < settings.instanceCount; i++)
+	{
+		renderInstances[i].CBIndex = i;
+		const float x = position(generator);
+		const float y = position(generator);
+		const float z = position(generator);
+		renderInstances[i].instanceData.modelMatrix = MathUtils::Translation4x4(x, y, z);
+	}
+
+	const BoundingBox bounds = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+	const FrustumPlanes frustum = ExtractFrustumPlanes(PerspectiveProjection(1.5708f, 16.0f / 9.0f, 0.1f, 1000.0f));
+
+	InstanceStore instanceStore;
+	instanceStore.Build(renderInstancesByID, { { RenderObjectID::Cube, bounds } });
+	const InstanceRange range = instanceStore.GetRange(RenderObjectID::Cube);
+
+	const uint32_t iterationCount = std::max(settings.iterationCount, 1u);
+	std::vector<uint32_t> referenceInstances;
+	std::vector<uint32_t> visibleInstances;
+
+	auto measure = [&](auto&& cull)
+	{
+		const auto start = Clock::now();
+		for (uint32_t iteration = 0; iteration < iterationCount; iteration++)
+		{
+			cull();
+		}
+		const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterationCount;
+		return milliseconds > 0.0 ? settings.instanceCount / milliseconds : 0.0;
+	};
+
+	InstanceCullingBenchmarkResult result;
+	result.instanceCount = settings.instanceCount;
+	result.scalarInstancesPerMillisecond = measure([&]() { CullInstances(frustum, bounds, renderInstances, referenceInstances, CullingMode::Scalar); });
+	result.simdInstancesPerMillisecond = measure([&]() { CullInstances(frustum, bounds, renderInstances, visibleInstances, CullingMode::Simd); });
+	result.storeInstancesPerMillisecond = measure([&]() { CullInstanceRange(frustum, instanceStore, range, visibleInstances); });
+	result.visibleCount = (uint32_t)visibleInstances.size();
+
+	// Both lists are sorted, so the instances that are in only one of them are the mismatches.
+	std::vector<uint32_t> mismatchedInstances;
+	std::set_symmetric_difference(
+		referenceInstances.begin(), referenceInstances.end(),
+		visibleInstances.begin(), visibleInstances.end(),
+		std::back_inserter(mismatchedInstances)
+	);
+	result.mismatchedCount = (uint32_t)mismatchedInstances.size();
+
+	return result;
+}
+
+const char* GetCullingModeName(CullingMode mode)
+{
+	switch (mode)
+	{
+	case CullingMode::Scalar:
+		return "Scalar";
+	case CullingMode::Simd:
+		return "Simd";
+	default:
+		return "Unknown";
+	}
+}
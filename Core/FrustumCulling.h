@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "InstanceStore.h"
+#include "PlatformIncludes.h"
+#include "SceneTypes.h"
+
+/*
+	CPU reference of the instance culling compute shader in shaders/CullInstancesCS.hlsl.
+
+	An instance is visible when the world space box around its transformed object bounds is at least partly on the inner
+	side of all six frustum planes. The box is found from the center and half extents of the object bounds, with the
+	extents transformed by the absolute value of the model matrix, so no corner has to be transformed. The test is
+	conservative: boxes that are outside of the frustum but cross the planes near an edge or corner stay visible.
+
+	The SIMD path tests all planes of one instance at once, with one plane per lane. It does the same operations in the
+	same order as the scalar path and the shader, so the three agree on every instance.
+
+	CullInstanceRange() works on the world space bounds of an InstanceStore instead, and tests eight instances at once
+	with one instance per lane. It also matches the scalar path on every instance.
+*/
+
+// A point is inside of the frustum when ax + by + cz + d >= 0 for every plane. The planes aren't normalized.
+struct FrustumPlanes
+{
+	std::array<DirectX::XMFLOAT4, 6> planes;
+};
+
+// Planes of the D3D clip volume, with z from 0 to w, of a row vector view projection matrix.
+FrustumPlanes ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& viewProjection);
+
+// Center and half extents of the world space box around an object space box transformed by a row vector model matrix.
+void TransformBoundsToWorld(const BoundingBox& objectBounds, const DirectX::XMFLOAT4X4& model, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents);
+
+bool IsInstanceVisible(const FrustumPlanes& frustum, const BoundingBox& objectBounds, const DirectX::XMFLOAT4X4& model);
+
+enum class CullingMode
+{
+	Scalar,
+	// All planes of an instance in one 8 wide register.
+	Simd,
+	Count
+};
+
+// Writes the indices of the visible instances, in order, and returns how many there are.
+uint32_t CullInstances(const FrustumPlanes& frustum, const BoundingBox& objectBounds, std::span<const RenderInstance> instances, std::vector<uint32_t>& visibleInstances, CullingMode mode = CullingMode::Simd);
+
+// Culls the instances of a range of the store. Writes the indices of the visible instances relative to the start of the
+// range, in order, and returns how many there are.
+uint32_t CullInstanceRange(const FrustumPlanes& frustum, const InstanceStore& instanceStore, InstanceRange range, std::vector<uint32_t>& visibleInstances);
+
+struct CullingBenchmarkResult
+{
+	CullingMode mode;
+	uint32_t instanceCount;
+	uint32_t visibleCount;
+	double microseconds;
+	// Instances whose visibility differs from the Scalar result.
+	uint32_t mismatchedCount;
+};
+
+// Culls the instances the given number of times with every mode and reports the average time of one pass.
+std::vector<CullingBenchmarkResult> BenchmarkCulling(const FrustumPlanes& frustum, const BoundingBox& objectBounds, std::span<const RenderInstance> instances, uint32_t iterationCount);
+
+const char* GetCullingModeName(CullingMode mode);
+
+struct InstanceCullingBenchmarkSettings
+{
+	// Instances of a unit cube, spread at random around a camera that sees about a twelfth of them.
+	uint32_t instanceCount = 1000000u;
+	uint32_t iterationCount = 10u;
+};
+
+struct InstanceCullingBenchmarkResult
+{
+	uint32_t instanceCount = 0;
+	uint32_t visibleCount = 0;
+	// CullInstances() over the render instances, which transforms the bounds of every instance.
+	double scalarInstancesPerMillisecond = 0.0;
+	double simdInstancesPerMillisecond = 0.0;
+	// CullInstanceRange() over an instance store with the same instances.
+	double storeInstancesPerMillisecond = 0.0;
+	// Instances whose visibility in the store differs from the Scalar result.
+	uint32_t mismatchedCount = 0;
+};
+
+// Compares culling the render instances with culling the same instances in an instance store. Runs on any platform.
+InstanceCullingBenchmarkResult BenchmarkInstanceCulling(const InstanceCullingBenchmarkSettings& settings = {});
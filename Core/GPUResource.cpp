@@ -1,6 +1,7 @@
 #include "GPUResource.h"
 
 #include <array>
+#include <stdexcept>
 
 #include "GraphicsErrorHandling.h"
 #include "DX12AbstractionUtils.h"
@@ -28,19 +29,14 @@ namespace DX12Abstractions
 		return &resource;
 	}
 
-	void GPUResource::TransitionTo(D3D12_RESOURCE_STATES newState, ComPtr<ID3D12GraphicsCommandList> commandList)
-	{  
-		if (newState == currentState) {
-			return;
+	void GPUResource::TransitionTo(D3D12_RESOURCE_STATES newState, BarrierBatcher& barrierBatcher)
+	{
+		if (!barrierBatcher.IsTracked(resource.Get()))
+		{
+			barrierBatcher.Track(resource.Get(), currentState);
 		}
 
-		auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			resource.Get(),
-			currentState,
-			newState
-		);
-
-		commandList->ResourceBarrier(1, &barrier);
+		barrierBatcher.Transition(resource.Get(), newState);
 
 		currentState = newState;
 	}
@@ -95,5 +91,57 @@ namespace DX12Abstractions
 		return CreateResource(device, resourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_HEAP_TYPE_DEFAULT);
 	}
 
+	GPUResource CreatePlacedResource(ComPtr<ID3D12Device4> device, ComPtr<ID3D12Heap> heap, UINT64 heapOffset, CD3DX12_RESOURCE_DESC resourceDesc, D3D12_RESOURCE_STATES resourceState, const D3D12_CLEAR_VALUE* clearValue)
+	{
+		GPUResource resource(resourceState);
+
+		device->CreatePlacedResource(
+			heap.Get(),
+			heapOffset,
+			&resourceDesc,
+			resourceState,
+			clearValue,
+			IID_PPV_ARGS(&resource)
+		) >> CHK_HR;
+
+		return resource;
+	}
+
+	UploadRingBuffer::UploadRingBuffer(ComPtr<ID3D12Device4> device, UINT64 capacity)
+		: m_buffer(CreateUploadResource(device, CD3DX12_RESOURCE_DESC::Buffer(capacity))), m_mappedData(nullptr), m_allocator(capacity)
+	{
+		NAME_D3D12_OBJECT_MEMBER(m_buffer, UploadRingBuffer);
+
+		// Upload heaps may stay mapped while the GPU reads them. The empty range tells the driver that the CPU never reads.
+		const CD3DX12_RANGE readRange(0, 0);
+		m_buffer.resource->Map(0, &readRange, reinterpret_cast<void**>(&m_mappedData)) >> CHK_HR;
+	}
+
+	UploadAllocation UploadRingBuffer::Allocate(UINT64 size, UINT64 alignment)
+	{
+		const uint64_t offset = m_allocator.Allocate(size, alignment);
+		if (offset == RingAllocatorInvalidOffset)
+		{
+			throw std::runtime_error("The upload ring buffer is full.");
+		}
+
+		return { m_mappedData + offset, m_buffer.resource->GetGPUVirtualAddress() + offset };
+	}
+
+	void UploadRingBuffer::FinishFrame(UINT64 fenceValue)
+	{
+		m_allocator.FinishFrame(fenceValue);
+	}
+
+	void UploadRingBuffer::Retire(UINT64 completedFenceValue)
+	{
+		m_allocator.Retire(completedFenceValue);
+	}
+
+	const RingAllocator& UploadRingBuffer::GetAllocator() const
+	{
+		return m_allocator;
+	}
+
 }
   
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <vector>
 
 #include "DirectXIncludes.h"
+#include "BarrierBatcher.h"
+#include "RingAllocator.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -23,8 +25,8 @@ namespace DX12Abstractions
 		// This enables the GPU resource to be used in usual D3D patterns of casting to void** for address instantiation. 
 		ResourceComPtrRef operator&();
 		
-		// Puts a transition resource barrier into the command list to transition the resource to the new state.
-		void TransitionTo(D3D12_RESOURCE_STATES newState, ComPtr<ID3D12GraphicsCommandList> commandList);
+		// Adds a transition to the new state to the batch, which records it with the other barriers when it's flushed.
+		void TransitionTo(D3D12_RESOURCE_STATES newState, BarrierBatcher& barrierBatcher);
 		ID3D12Resource* Get() const;
 
 		ComPtr<ID3D12Resource> resource;
@@ -34,7 +36,45 @@ namespace DX12Abstractions
 	GPUResource CreateResource(ComPtr<ID3D12Device4> device, CD3DX12_RESOURCE_DESC resourceDesc, D3D12_RESOURCE_STATES resourceState, D3D12_HEAP_TYPE heapType);
 	GPUResource CreateUploadResource(ComPtr<ID3D12Device4> device, CD3DX12_RESOURCE_DESC resourceDesc);
 	GPUResource CreateDefaultResource(ComPtr<ID3D12Device4> device, CD3DX12_RESOURCE_DESC resourceDesc);
+	// Creates a resource at the given offset of a heap. The clear value may be null and is required to be null for buffers.
+	GPUResource CreatePlacedResource(ComPtr<ID3D12Device4> device, ComPtr<ID3D12Heap> heap, UINT64 heapOffset, CD3DX12_RESOURCE_DESC resourceDesc, D3D12_RESOURCE_STATES resourceState, const D3D12_CLEAR_VALUE* clearValue);
 	
+	struct UploadAllocation
+	{
+		uint8_t* cpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+	};
+
+	// Upload heap buffer that is mapped once and stays mapped, so per frame data is written with plain stores. Allocations
+	// stay valid until the GPU has reached the fence value of the frame that made them.
+	class UploadRingBuffer
+	{
+	public:
+		UploadRingBuffer(ComPtr<ID3D12Device4> device, UINT64 capacity);
+
+		// Throws if the ring is full, which means that it's too small for the frames in flight.
+		UploadAllocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+		template <typename T>
+		D3D12_GPU_VIRTUAL_ADDRESS Upload(const T& data, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)
+		{
+			UploadAllocation allocation = Allocate(sizeof(T), alignment);
+			memcpy(allocation.cpuAddress, &data, sizeof(T));
+			return allocation.gpuAddress;
+		}
+
+		// Called with the fence value that the frame signals once it has been executed.
+		void FinishFrame(UINT64 fenceValue);
+		void Retire(UINT64 completedFenceValue);
+
+		const RingAllocator& GetAllocator() const;
+
+	private:
+		GPUResource m_buffer;
+		uint8_t* m_mappedData;
+		RingAllocator m_allocator;
+	};
+
 	template <typename T>
 	void UploadResource(ComPtr<ID3D12Device5> device, ComPtr<ID3D12GraphicsCommandList> commandList, GPUResource& destBuffer, GPUResource& uploadBuffer, const T* data, UINT size)
 	{
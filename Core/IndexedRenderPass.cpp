@@ -1,5 +1,11 @@
 #include "IndexedRenderPass.h"
 
+void IndexedRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Write(graphPass, FrameGraphBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	frameGraph.Write(graphPass, FrameGraphDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+}
+
 void IndexedRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
 	assert(pipelineArgs != nullptr);
@@ -12,6 +18,7 @@ void IndexedRenderPass::BuildRenderPass(const std::vector<RenderPackage>& render
 	commandList->OMSetRenderTargets(1, &args.RTV, TRUE, &args.commonArgs.depthStencilView);
 
 	// Draw.
+	FlushBarriers(context, frameIndex);
 	for (const RenderPackage& renderPackage : renderPackages)
 	{
 		if (renderPackage.renderObject)
@@ -26,9 +33,23 @@ void IndexedRenderPass::BuildRenderPass(const std::vector<RenderPackage>& render
 			{
 				const std::vector<RenderInstance>& renderInstances = *renderPackage.renderInstances;
 
-				for (const RenderInstance& renderInstance : renderInstances)
+				// Each context draws its own contiguous chunk of the instances.
+				const auto [firstInstance, lastInstance] = GetContextRange(context, frameIndex, (UINT)renderInstances.size());
+				if constexpr (ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer)
+				{
+					// The shader finds the constants of each instance of the chunk, so one draw per draw arg covers it.
+					if (firstInstance < lastInstance)
+					{
+						SetFirstInstance(renderInstances[firstInstance], commandList);
+						DrawInstanceIndexed(context, drawArgs, commandList, lastInstance - firstInstance);
+					}
+				}
+				else
 				{
-					PerRenderInstance(renderInstance, drawArgs, pipelineArgs, context, frameIndex);
+					for (UINT i = firstInstance; i < lastInstance; i++)
+					{
+						PerRenderInstance(renderInstances[i], drawArgs, pipelineArgs, context, frameIndex);
+					}
 				}
 			}
 		}
@@ -9,6 +9,7 @@ public:
 		: DX12RenderPass(device, D3D12_COMMAND_LIST_TYPE_DIRECT, true) {}
 
 	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
 
 protected:
 	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
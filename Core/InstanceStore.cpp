@@ -0,0 +1,125 @@
+#include "InstanceStore.h"
+
+#include <cassert>
+#include <stdexcept>
+
+#include "FrustumCulling.h"
+
+void InstanceStore::Build(const RenderInstanceMap& renderInstancesByID, const std::unordered_map<RenderObjectID, BoundingBox>& objectBoundsByID)
+{
+	uint32_t instanceCount = 0;
+	for (const auto& it : renderInstancesByID)
+	{
+		instanceCount += (uint32_t)it.second.size();
+	}
+
+	m_rangesByID.clear();
+	m_objectBoundsByID.clear();
+	m_transforms.clear();
+	m_cbIndices.clear();
+	m_transforms.reserve(instanceCount);
+	m_cbIndices.reserve(instanceCount);
+
+	for (std::vector<float>* bounds : { &m_centersX, &m_centersY, &m_centersZ, &m_extentsX, &m_extentsY, &m_extentsZ })
+	{
+		bounds->assign(instanceCount + SimdPadding, 0.0f);
+	}
+
+	for (const auto& [renderObjectID, renderInstances] : renderInstancesByID)
+	{
+		const InstanceRange range = { (uint32_t)m_transforms.size(), (uint32_t)renderInstances.size() };
+		m_rangesByID[renderObjectID] = range;
+
+		const auto boundsIt = objectBoundsByID.find(renderObjectID);
+		const BoundingBox objectBounds = boundsIt != objectBoundsByID.end() ? boundsIt->second : BoundingBox();
+		m_objectBoundsByID[renderObjectID] = objectBounds;
+
+		for (const RenderInstance& renderInstance : renderInstances)
+		{
+			// See the comment in InstanceStore.h.
+			assert(renderInstance.CBIndex == renderInstances.front().CBIndex + (m_transforms.size() - range.first));
+
+			m_transforms.push_back(renderInstance.instanceData.modelMatrix);
+			m_cbIndices.push_back(renderInstance.CBIndex);
+			UpdateBounds((uint32_t)m_transforms.size() - 1, objectBounds);
+		}
+	}
+}
+
+void InstanceStore::SetTransform(RenderObjectID renderObjectID, uint32_t instanceIndex, const DirectX::XMFLOAT4X4& model)
+{
+	const InstanceRange range = GetRange(renderObjectID);
+	if (instanceIndex >= range.count)
+	{
+		throw std::runtime_error("The render object doesn't have an instance with that index in the instance store.");
+	}
+
+	const uint32_t instance = range.first + instanceIndex;
+	m_transforms[instance] = model;
+	UpdateBounds(instance, m_objectBoundsByID.at(renderObjectID));
+}
+
+void InstanceStore::UpdateBounds(uint32_t instance, const BoundingBox& objectBounds)
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 extents;
+	TransformBoundsToWorld(objectBounds, m_transforms[instance], center, extents);
+
+	m_centersX[instance] = center.x;
+	m_centersY[instance] = center.y;
+	m_centersZ[instance] = center.z;
+	m_extentsX[instance] = extents.x;
+	m_extentsY[instance] = extents.y;
+	m_extentsZ[instance] = extents.z;
+}
+
+uint32_t InstanceStore::GetInstanceCount() const
+{
+	return (uint32_t)m_transforms.size();
+}
+
+InstanceRange InstanceStore::GetRange(RenderObjectID renderObjectID) const
+{
+	const auto it = m_rangesByID.find(renderObjectID);
+	return it != m_rangesByID.end() ? it->second : InstanceRange();
+}
+
+std::span<const DirectX::XMFLOAT4X4> InstanceStore::GetTransforms() const
+{
+	return m_transforms;
+}
+
+std::span<const UINT> InstanceStore::GetCBIndices() const
+{
+	return m_cbIndices;
+}
+
+const float* InstanceStore::GetCentersX() const
+{
+	return m_centersX.data();
+}
+
+const float* InstanceStore::GetCentersY() const
+{
+	return m_centersY.data();
+}
+
+const float* InstanceStore::GetCentersZ() const
+{
+	return m_centersZ.data();
+}
+
+const float* InstanceStore::GetExtentsX() const
+{
+	return m_extentsX.data();
+}
+
+const float* InstanceStore::GetExtentsY() const
+{
+	return m_extentsY.data();
+}
+
+const float* InstanceStore::GetExtentsZ() const
+{
+	return m_extentsZ.data();
+}
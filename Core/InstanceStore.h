@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "PlatformIncludes.h"
+#include "SceneTypes.h"
+
+/*
+	Structure of arrays copy of the render instances, for the work that touches every instance every frame.
+
+	The instances of a render object are stored next to each other, in the same order as in its vector of the render
+	instance map, so the index of an instance in its range is also its index in that vector. Transforms, CB indices and
+	the world space bounds each have their own array. The bounds are a center and half extents per axis, so eight
+	instances load into one register per component.
+
+	The bounds arrays have SimdPadding extra elements at the end, so 8 wide loads from any instance never read past them.
+
+	The CB indices of the instances of a render object have to be consecutive, which Build() asserts. The culling shader
+	(shaders/CullInstancesCS.hlsl) only gets the CB index of the first instance and reads the constants of instance i of the
+	render object at that index plus i.
+*/
+
+struct InstanceRange
+{
+	uint32_t first = 0;
+	uint32_t count = 0;
+};
+
+class InstanceStore
+{
+public:
+	static constexpr uint32_t SimdPadding = 8;
+
+	// Copies the instances of every render object. Render objects without bounds get empty bounds at their origin.
+	void Build(const RenderInstanceMap& renderInstancesByID, const std::unordered_map<RenderObjectID, BoundingBox>& objectBoundsByID);
+
+	// Moves an instance, given by its index in the vector of its render object, and updates its world space bounds.
+	void SetTransform(RenderObjectID renderObjectID, uint32_t instanceIndex, const DirectX::XMFLOAT4X4& model);
+
+	uint32_t GetInstanceCount() const;
+	// An empty range for render objects without instances.
+	InstanceRange GetRange(RenderObjectID renderObjectID) const;
+
+	std::span<const DirectX::XMFLOAT4X4> GetTransforms() const;
+	std::span<const UINT> GetCBIndices() const;
+
+	// World space bounds. Each array holds the instances followed by the padding.
+	const float* GetCentersX() const;
+	const float* GetCentersY() const;
+	const float* GetCentersZ() const;
+	const float* GetExtentsX() const;
+	const float* GetExtentsY() const;
+	const float* GetExtentsZ() const;
+
+private:
+	void UpdateBounds(uint32_t instance, const BoundingBox& objectBounds);
+
+private:
+	std::unordered_map<RenderObjectID, InstanceRange> m_rangesByID;
+	std::unordered_map<RenderObjectID, BoundingBox> m_objectBoundsByID;
+
+	std::vector<DirectX::XMFLOAT4X4> m_transforms;
+	std::vector<UINT> m_cbIndices;
+
+	std::vector<float> m_centersX;
+	std::vector<float> m_centersY;
+	std::vector<float> m_centersZ;
+	std::vector<float> m_extentsX;
+	std::vector<float> m_extentsY;
+	std::vector<float> m_extentsZ;
+};
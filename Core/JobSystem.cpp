@@ -0,0 +1,347 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ParallelUtils.h"
+
+namespace
+{
+	// Number of failed attempts at finding a job before a worker or a waiting thread goes to sleep.
+	constexpr uint32_t WorkerSpinCount = 64u;
+
+	struct ThreadBinding
+	{
+		const JobSystem* jobSystem = nullptr;
+		uint32_t threadIndex = 0;
+	};
+
+	thread_local ThreadBinding tThreadBinding;
+}
+
+JobSystem::JobSystem(uint32_t threadCount) :
+	m_queuedJobCount(0),
+	m_wakeSignal(0),
+	m_parkedThreadCount(0),
+	m_isExiting(false),
+	m_executedJobCount(0),
+	m_stolenJobCount(0),
+	m_parkCount(0)
+{
+	threadCount = threadCount == 0 ? GetDefaultThreadCount() : threadCount;
+
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	tThreadBinding = { this, 0 };
+
+	m_workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; i++)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	m_isExiting = true;
+	Signal(true);
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+
+	if (tThreadBinding.jobSystem == this)
+	{
+		tThreadBinding = {};
+	}
+}
+
+uint32_t JobSystem::GetThreadCount() const
+{
+	return (uint32_t)m_queues.size();
+}
+
+void JobSystem::Dispatch(JobCounter& counter, Job job)
+{
+	const uint32_t threadIndex = GetCurrentThreadIndex();
+
+	counter.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(m_queues[threadIndex]->mutex);
+		m_queues[threadIndex]->jobs.push_back({ std::move(job), &counter, threadIndex });
+	}
+	m_queuedJobCount.fetch_add(1);
+	Signal(false);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	const uint32_t threadIndex = GetCurrentThreadIndex();
+
+	uint32_t failedAttempts = 0;
+	while (counter.load() > 0)
+	{
+		if (TryRunJob(threadIndex))
+		{
+			failedAttempts = 0;
+			continue;
+		}
+
+		// The remaining jobs are running on other threads.
+		if (++failedAttempts < WorkerSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		Park([&]() { return counter.load() == 0 || m_queuedJobCount.load() > 0; });
+		failedAttempts = 0;
+	}
+}
+
+uint32_t JobSystem::GetCurrentThreadIndex() const
+{
+	return tThreadBinding.jobSystem == this ? tThreadBinding.threadIndex : 0;
+}
+
+JobSystemStats JobSystem::GetStats() const
+{
+	JobSystemStats stats;
+	stats.executedJobCount = m_executedJobCount.load();
+	stats.stolenJobCount = m_stolenJobCount.load();
+	stats.parkCount = m_parkCount.load();
+	return stats;
+}
+
+bool JobSystem::TryRunJob(uint32_t threadIndex)
+{
+	QueuedJob job;
+	if (!PopJob(threadIndex, job))
+	{
+		return false;
+	}
+
+	job.job();
+
+	m_executedJobCount.fetch_add(1, std::memory_order_relaxed);
+	if (job.dispatchThreadIndex != threadIndex)
+	{
+		m_stolenJobCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// The counter may be destroyed as soon as it reaches zero, so it's the last thing that is touched. Threads waiting for it
+	// park on the signal of the system instead.
+	if (job.counter->fetch_sub(1) == 1)
+	{
+		Signal(true);
+	}
+	return true;
+}
+
+bool JobSystem::PopJob(uint32_t threadIndex, QueuedJob& job)
+{
+	if (m_queuedJobCount.load() == 0)
+	{
+		return false;
+	}
+
+	// Newest job from the own queue first.
+	{
+		WorkQueue& queue = *m_queues[threadIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			m_queuedJobCount.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// Oldest job from one of the other queues, starting with the next thread so that thieves spread out.
+	const uint32_t queueCount = (uint32_t)m_queues.size();
+	for (uint32_t i = 1; i < queueCount; i++)
+	{
+		WorkQueue& queue = *m_queues[(threadIndex + i) % queueCount];
+		std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+		if (lock.owns_lock() && !queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			m_queuedJobCount.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex)
+{
+	tThreadBinding = { this, threadIndex };
+
+	uint32_t failedAttempts = 0;
+	while (!m_isExiting.load())
+	{
+		if (TryRunJob(threadIndex))
+		{
+			failedAttempts = 0;
+			continue;
+		}
+
+		if (++failedAttempts < WorkerSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		Park([this]() { return m_queuedJobCount.load() > 0 || m_isExiting.load(); });
+		failedAttempts = 0;
+	}
+}
+
+template<typename Condition>
+void JobSystem::Park(Condition&& isAwake)
+{
+	// A thread that signals bumps the signal before it checks for parked threads, and this thread announces itself before it
+	// reads the signal and checks the condition. So either the condition already holds here, or the signal changes after it
+	// was read and the wait returns, or the other thread sees this one and notifies it.
+	m_parkedThreadCount.fetch_add(1);
+	const uint32_t signal = m_wakeSignal.load();
+	if (!isAwake())
+	{
+		m_parkCount.fetch_add(1, std::memory_order_relaxed);
+		m_wakeSignal.wait(signal);
+	}
+	m_parkedThreadCount.fetch_sub(1);
+}
+
+void JobSystem::Signal(bool wakeAll)
+{
+	m_wakeSignal.fetch_add(1);
+	if (m_parkedThreadCount.load() == 0)
+	{
+		return;
+	}
+
+	// A finished batch or the shutdown may concern any parked thread, a new job only needs one of them.
+	if (wakeAll)
+	{
+		m_wakeSignal.notify_all();
+	}
+	else
+	{
+		m_wakeSignal.notify_one();
+	}
+}
+
+namespace
+{
+	// Stand in for a draw recorded into a command list.
+	struct FakeCommand
+	{
+		uint32_t type;
+		uint32_t arguments[7];
+	};
+
+	void RecordFakeCommands(std::vector<FakeCommand>& commandBuffer, uint32_t jobIndex, uint32_t commandCount)
+	{
+		commandBuffer.clear();
+		for (uint32_t i = 0; i < commandCount; i++)
+		{
+			// Roughly what SetInstanceCB() and DrawIndexedInstanced() amount to: some index math and a write of the arguments.
+			const uint32_t instance = jobIndex * commandCount + i;
+			commandBuffer.push_back({ i & 3u, { instance, instance * 3u, 1u, instance % 7u, instance ^ 0x5bd1e995u, 0u, 0u } });
+		}
+	}
+}
+
+JobSystemBenchmarkResult BenchmarkJobSystem(JobSystem& jobSystem, const JobSystemBenchmarkSettings& settings)
+{
+	using Clock = std::chrono::steady_clock;
+
+	JobSystemBenchmarkResult result;
+	result.threadCount = jobSystem.GetThreadCount();
+
+	// One command buffer per job, like the pooled command lists of the render passes.
+	std::vector<std::vector<FakeCommand>> commandBuffers(settings.jobCount);
+	for (std::vector<FakeCommand>& commandBuffer : commandBuffers)
+	{
+		commandBuffer.reserve(settings.commandsPerJob);
+	}
+
+	const auto serialStart = Clock::now();
+	for (uint32_t frame = 0; frame < settings.frameCount; frame++)
+	{
+		for (uint32_t job = 0; job < settings.jobCount; job++)
+		{
+			RecordFakeCommands(commandBuffers[job], job, settings.commandsPerJob);
+		}
+	}
+	const double serialMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - serialStart).count();
+
+	const auto parallelStart = Clock::now();
+	for (uint32_t frame = 0; frame < settings.frameCount; frame++)
+	{
+		JobCounter counter = 0;
+		for (uint32_t job = 0; job < settings.jobCount; job++)
+		{
+			jobSystem.Dispatch(counter, [&, job]() { RecordFakeCommands(commandBuffers[job], job, settings.commandsPerJob); });
+		}
+		jobSystem.Wait(counter);
+	}
+	const double parallelMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - parallelStart).count();
+
+	const auto emptyStart = Clock::now();
+	for (uint32_t frame = 0; frame < settings.frameCount; frame++)
+	{
+		JobCounter counter = 0;
+		for (uint32_t job = 0; job < settings.jobCount; job++)
+		{
+			jobSystem.Dispatch(counter, []() {});
+		}
+		jobSystem.Wait(counter);
+	}
+	const double emptyMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - emptyStart).count();
+
+	const double frameCount = std::max(settings.frameCount, 1u);
+	result.serialFrameMilliseconds = serialMilliseconds / frameCount;
+	result.parallelFrameMilliseconds = parallelMilliseconds / frameCount;
+	result.emptyJobNanoseconds = emptyMilliseconds * 1e6 / (frameCount * std::max(settings.jobCount, 1u));
+	result.speedup = parallelMilliseconds > 0.0 ? serialMilliseconds / parallelMilliseconds : 0.0;
+
+	return result;
+}
+
+JobSyncBenchmarkResult BenchmarkJobSync(uint32_t contextCount, uint32_t frameCount, uint32_t passCount)
+{
+	using Clock = std::chrono::steady_clock;
+
+	JobSyncBenchmarkResult result;
+	result.contextCount = std::max(contextCount, 1u);
+
+	JobSystem jobSystem(result.contextCount);
+	const auto start = Clock::now();
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		for (uint32_t pass = 0; pass < passCount; pass++)
+		{
+			JobCounter counter = 0;
+			for (uint32_t context = 0; context < result.contextCount; context++)
+			{
+				jobSystem.Dispatch(counter, []() {});
+			}
+			jobSystem.Wait(counter);
+		}
+	}
+	const double microseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+	const double frames = std::max(frameCount, 1u);
+	result.frameMicroseconds = microseconds / frames;
+	result.parksPerFrame = jobSystem.GetStats().parkCount / frames;
+	return result;
+}
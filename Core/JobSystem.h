@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Work stealing job scheduler.
+
+	Every thread owns a queue. Jobs dispatched from a thread go to the back of its own queue and the owner takes jobs from
+	the back as well, so recently dispatched jobs run while their data is still in the cache. A thread whose queue is empty
+	steals from the front of the other queues, which spreads large batches over all threads without any central queue.
+
+	The thread that creates the system is thread 0 and only runs jobs while it is inside Wait(). The other threads are
+	background workers that sleep when there is nothing to do.
+
+	Threads that find nothing to do spin for a short while, since new jobs or the end of a batch usually follow within a few
+	microseconds, and then park with std::atomic::wait() on a signal that is bumped whenever a job is queued or a batch
+	finishes. That is a futex on Linux and WaitOnAddress() on Windows, so a thread only enters the kernel when it really
+	sleeps, and waking nobody costs an atomic increment.
+*/
+
+typedef std::function<void()> Job;
+
+// Number of unfinished jobs in a batch. Dispatch() increments it and it's decremented when a job finishes.
+typedef std::atomic<uint32_t> JobCounter;
+
+struct JobSystemStats
+{
+	uint64_t executedJobCount = 0;
+	// Jobs that were run by another thread than the one that dispatched them.
+	uint64_t stolenJobCount = 0;
+	// Times a worker or a waiting thread went to sleep because it ran out of jobs.
+	uint64_t parkCount = 0;
+};
+
+class JobSystem
+{
+public:
+	// The thread count includes the calling thread. Zero means one thread per core.
+	explicit JobSystem(uint32_t threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem& other) = delete;
+	JobSystem& operator=(const JobSystem& other) = delete;
+
+	uint32_t GetThreadCount() const;
+
+	void Dispatch(JobCounter& counter, Job job);
+	// Runs jobs on the calling thread until every job of the counter is done.
+	void Wait(JobCounter& counter);
+
+	// Index of the calling thread within this system. Threads that don't belong to the system use the queue of thread 0.
+	uint32_t GetCurrentThreadIndex() const;
+
+	JobSystemStats GetStats() const;
+
+private:
+	struct QueuedJob
+	{
+		Job job;
+		JobCounter* counter;
+		uint32_t dispatchThreadIndex;
+	};
+
+	struct alignas(64) WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<QueuedJob> jobs;
+	};
+
+	bool TryRunJob(uint32_t threadIndex);
+	bool PopJob(uint32_t threadIndex, QueuedJob& job);
+	void WorkerLoop(uint32_t threadIndex);
+	// Sleeps until the signal changes, unless the condition already holds once the thread has announced that it sleeps.
+	template<typename Condition>
+	void Park(Condition&& isAwake);
+	void Signal(bool wakeAll);
+
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+	std::vector<std::thread> m_workers;
+
+	// Jobs that are queued but not started yet. Workers sleep while this is zero.
+	std::atomic<uint32_t> m_queuedJobCount;
+	// Bumped when a job is queued, a batch finishes or the system shuts down. Parked threads wait for it to change.
+	std::atomic<uint32_t> m_wakeSignal;
+	std::atomic<uint32_t> m_parkedThreadCount;
+	std::atomic<bool> m_isExiting;
+
+	std::atomic<uint64_t> m_executedJobCount;
+	std::atomic<uint64_t> m_stolenJobCount;
+	std::atomic<uint64_t> m_parkCount;
+};
+
+struct JobSystemBenchmarkSettings
+{
+	// Jobs per frame, like the command list recording jobs of the render passes.
+	uint32_t jobCount = 64u;
+	// Fake commands recorded by every job.
+	uint32_t commandsPerJob = 256u;
+	uint32_t frameCount = 200u;
+};
+
+struct JobSystemBenchmarkResult
+{
+	uint32_t threadCount = 0;
+	// Time per frame when every job is run directly on the calling thread.
+	double serialFrameMilliseconds = 0.0;
+	// Time per frame when the jobs are dispatched to the job system.
+	double parallelFrameMilliseconds = 0.0;
+	// Cost of dispatching, running and waiting for a job that does nothing.
+	double emptyJobNanoseconds = 0.0;
+	double speedup = 0.0;
+};
+
+// Measures the scheduling overhead of the job system with jobs that record fake commands into their own command buffers.
+// Runs on any platform, no GPU is needed.
+JobSystemBenchmarkResult BenchmarkJobSystem(JobSystem& jobSystem, const JobSystemBenchmarkSettings& settings = {});
+
+struct JobSyncBenchmarkResult
+{
+	uint32_t contextCount = 0;
+	// Average time of a frame in which every pass dispatches one empty job per context and waits for them.
+	double frameMicroseconds = 0.0;
+	// Average times per frame that a thread went to sleep.
+	double parksPerFrame = 0.0;
+};
+
+// Measures the sync latency of a frame with a job system of one thread per context, the way the render passes record one
+// command list per context and wait for all of them before they are submitted. The jobs do no work, so only the cost of the
+// synchronization is measured. Runs on any platform, no GPU is needed.
+JobSyncBenchmarkResult BenchmarkJobSync(uint32_t contextCount, uint32_t frameCount = 1000u, uint32_t passCount = 8u);
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cmath>
+
+#include "PlatformIncludes.h"
+
+/*
+	Scalar math helpers that only operate on the DirectXMath storage types.
+	These exist so that the headless core library can do its math without relying on the SIMD parts of DirectXMath.
+	Matrices follow the DirectXMath convention of row vectors (translation stored in the fourth row).
+*/
+
+namespace MathUtils
+{
+	inline DirectX::XMFLOAT4X4 Identity4x4()
+	{
+		DirectX::XMFLOAT4X4 matrix = {};
+		matrix._11 = 1.0f;
+		matrix._22 = 1.0f;
+		matrix._33 = 1.0f;
+		matrix._44 = 1.0f;
+
+		return matrix;
+	}
+
+	// Same result as storing XMMatrixTranslation() into a 4x4.
+	inline DirectX::XMFLOAT4X4 Translation4x4(float x, float y, float z)
+	{
+		DirectX::XMFLOAT4X4 matrix = Identity4x4();
+		matrix._41 = x;
+		matrix._42 = y;
+		matrix._43 = z;
+
+		return matrix;
+	}
+
+	// Same result as XMStoreFloat3x4(), which stores the transpose of the upper 4x3 part of the matrix.
+	// This is the layout expected by D3D12_RAYTRACING_INSTANCE_DESC::Transform.
+	inline void Store3x4(float (&dest)[3][4], const DirectX::XMFLOAT4X4& matrix)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				dest[row][column] = matrix.m[column][row];
+			}
+		}
+	}
+
+	inline DirectX::XMFLOAT3 Add(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return { a.x + b.x, a.y + b.y, a.z + b.z };
+	}
+
+	inline DirectX::XMFLOAT3 Subtract(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	inline DirectX::XMFLOAT3 Scale(const DirectX::XMFLOAT3& a, float s)
+	{
+		return { a.x * s, a.y * s, a.z * s };
+	}
+
+	inline float Dot(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline DirectX::XMFLOAT3 Cross(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return {
+			a.y * b.z - a.z * b.y,
+			a.z * b.x - a.x * b.z,
+			a.x * b.y - a.y * b.x
+		};
+	}
+
+	inline float Length(const DirectX::XMFLOAT3& a)
+	{
+		return std::sqrt(Dot(a, a));
+	}
+
+	inline DirectX::XMFLOAT3 Normalize(const DirectX::XMFLOAT3& a)
+	{
+		const float length = Length(a);
+		return length > 0.0f ? Scale(a, 1.0f / length) : a;
+	}
+
+	// Transforms a point by a row vector matrix (w = 1).
+	inline DirectX::XMFLOAT3 TransformPoint(const DirectX::XMFLOAT3& p, const DirectX::XMFLOAT4X4& m)
+	{
+		return {
+			p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41,
+			p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42,
+			p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43
+		};
+	}
+
+	// Transforms a direction by a row vector matrix (w = 0).
+	inline DirectX::XMFLOAT3 TransformVector(const DirectX::XMFLOAT3& v, const DirectX::XMFLOAT4X4& m)
+	{
+		return {
+			v.x * m._11 + v.y * m._21 + v.z * m._31,
+			v.x * m._12 + v.y * m._22 + v.z * m._32,
+			v.x * m._13 + v.y * m._23 + v.z * m._33
+		};
+	}
+
+	// Same result as storing XMMatrixMultiply(a, b) into a 4x4, which applies a first.
+	inline DirectX::XMFLOAT4X4 Multiply4x4(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+	{
+		DirectX::XMFLOAT4X4 matrix;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				matrix.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] + a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+			}
+		}
+
+		return matrix;
+	}
+
+	// Same result as storing XMMatrixLookAtLH() into a 4x4.
+	inline DirectX::XMFLOAT4X4 LookAtLH4x4(const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up)
+	{
+		const DirectX::XMFLOAT3 zAxis = Normalize(Subtract(target, eye));
+		const DirectX::XMFLOAT3 xAxis = Normalize(Cross(up, zAxis));
+		const DirectX::XMFLOAT3 yAxis = Cross(zAxis, xAxis);
+
+		DirectX::XMFLOAT4X4 matrix = Identity4x4();
+		matrix._11 = xAxis.x; matrix._12 = yAxis.x; matrix._13 = zAxis.x;
+		matrix._21 = xAxis.y; matrix._22 = yAxis.y; matrix._23 = zAxis.y;
+		matrix._31 = xAxis.z; matrix._32 = yAxis.z; matrix._33 = zAxis.z;
+		matrix._41 = -Dot(xAxis, eye);
+		matrix._42 = -Dot(yAxis, eye);
+		matrix._43 = -Dot(zAxis, eye);
+
+		return matrix;
+	}
+
+	// Same result as storing XMMatrixPerspectiveFovLH() into a 4x4.
+	inline DirectX::XMFLOAT4X4 PerspectiveFovLH4x4(float verticalFov, float aspectRatio, float nearZ, float farZ)
+	{
+		const float height = 1.0f / std::tan(verticalFov * 0.5f);
+		const float range = farZ / (farZ - nearZ);
+
+		DirectX::XMFLOAT4X4 matrix = {};
+		matrix._11 = height / aspectRatio;
+		matrix._22 = height;
+		matrix._33 = range;
+		matrix._34 = 1.0f;
+		matrix._43 = -range * nearZ;
+
+		return matrix;
+	}
+
+	// Inverse of a matrix whose last column is (0, 0, 0, 1), like every model matrix in the scene.
+	inline DirectX::XMFLOAT4X4 InverseAffine4x4(const DirectX::XMFLOAT4X4& m)
+	{
+		// Inverse of the upper 3x3 through its adjugate.
+		const float c11 = m._22 * m._33 - m._23 * m._32;
+		const float c12 = m._23 * m._31 - m._21 * m._33;
+		const float c13 = m._21 * m._32 - m._22 * m._31;
+		const float determinant = m._11 * c11 + m._12 * c12 + m._13 * c13;
+		const float inverseDeterminant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+		DirectX::XMFLOAT4X4 inverse = Identity4x4();
+		inverse._11 = c11 * inverseDeterminant;
+		inverse._12 = (m._13 * m._32 - m._12 * m._33) * inverseDeterminant;
+		inverse._13 = (m._12 * m._23 - m._13 * m._22) * inverseDeterminant;
+		inverse._21 = c12 * inverseDeterminant;
+		inverse._22 = (m._11 * m._33 - m._13 * m._31) * inverseDeterminant;
+		inverse._23 = (m._13 * m._21 - m._11 * m._23) * inverseDeterminant;
+		inverse._31 = c13 * inverseDeterminant;
+		inverse._32 = (m._12 * m._31 - m._11 * m._32) * inverseDeterminant;
+		inverse._33 = (m._11 * m._22 - m._12 * m._21) * inverseDeterminant;
+
+		// The translation is moved back through the inverted rotation and scale.
+		const DirectX::XMFLOAT3 translation = TransformVector({ m._41, m._42, m._43 }, inverse);
+		inverse._41 = -translation.x;
+		inverse._42 = -translation.y;
+		inverse._43 = -translation.z;
+
+		return inverse;
+	}
+}
@@ -0,0 +1,286 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include "MeshOptimizer.h"
+#include "ObjImporter.h"
+
+namespace
+{
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return (offset + MeshCacheAlignment - 1) & ~(uint64_t)(MeshCacheAlignment - 1);
+	}
+
+	// 64-bit FNV-1a.
+	uint64_t HashBytes(const uint8_t* data, uint64_t size)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (uint64_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 0x100000001b3ull;
+		}
+
+		return hash;
+	}
+
+	bool IsRangeInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+	{
+		return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	}
+}
+
+bool MeshCacheView::Open(const std::string& cachePath, const MeshCacheKey& expectedKey)
+{
+	if (!m_file.Open(cachePath) || m_file.Size() < sizeof(MeshCacheHeader))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	const uint8_t* data = m_file.Data();
+	const uint64_t fileSize = m_file.Size();
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(data);
+
+	bool isValid =
+		header->magic == MeshCacheMagic &&
+		header->version == MeshCacheVersion &&
+		header->vertexStride == sizeof(Vertex) &&
+		header->key.sourceHash == expectedKey.sourceHash &&
+		header->key.sourceModifiedTime == expectedKey.sourceModifiedTime &&
+		header->key.sourceSize == expectedKey.sourceSize &&
+		IsRangeInFile(header->vertexOffset, header->vertexCount, sizeof(Vertex), fileSize) &&
+		IsRangeInFile(header->indexOffset, header->indexCount, sizeof(VertexIndex), fileSize) &&
+		IsRangeInFile(header->drawArgsOffset, header->drawArgsCount, sizeof(DrawArgs), fileSize) &&
+		IsRangeInFile(header->meshletOffset, header->meshletCount, sizeof(Meshlet), fileSize) &&
+		IsRangeInFile(header->meshletVertexOffset, header->meshletVertexCount, sizeof(VertexIndex), fileSize) &&
+		IsRangeInFile(header->meshletPrimitiveOffset, header->meshletPrimitiveCount, sizeof(MeshletPrimitive), fileSize);
+
+	if (!isValid)
+	{
+		m_file.Close();
+		return false;
+	}
+
+	m_vertices = { reinterpret_cast<const Vertex*>(data + header->vertexOffset), header->vertexCount };
+	m_indices = { reinterpret_cast<const VertexIndex*>(data + header->indexOffset), header->indexCount };
+	m_drawArgs = { reinterpret_cast<const DrawArgs*>(data + header->drawArgsOffset), header->drawArgsCount };
+	m_meshlets = { reinterpret_cast<const Meshlet*>(data + header->meshletOffset), header->meshletCount };
+	m_meshletVertices = { reinterpret_cast<const VertexIndex*>(data + header->meshletVertexOffset), header->meshletVertexCount };
+	m_meshletPrimitives = { reinterpret_cast<const MeshletPrimitive*>(data + header->meshletPrimitiveOffset), header->meshletPrimitiveCount };
+	m_bounds = header->bounds;
+
+	return true;
+}
+
+void MeshCacheView::Adopt(MeshData&& mesh, std::vector<DrawArgs>&& drawArgs, MeshletData&& meshletData)
+{
+	m_file.Close();
+
+	m_ownedMesh = std::move(mesh);
+	m_ownedDrawArgs = std::move(drawArgs);
+	m_ownedMeshletData = std::move(meshletData);
+
+	m_vertices = m_ownedMesh.vertices;
+	m_indices = m_ownedMesh.indices;
+	m_drawArgs = m_ownedDrawArgs;
+	m_meshlets = m_ownedMeshletData.meshlets;
+	m_meshletVertices = m_ownedMeshletData.meshletVertices;
+	m_meshletPrimitives = m_ownedMeshletData.meshletPrimitives;
+	m_bounds = CalculateBounds(m_vertices);
+}
+
+std::span<const Vertex> MeshCacheView::GetVertices() const
+{
+	return m_vertices;
+}
+
+std::span<const VertexIndex> MeshCacheView::GetIndices() const
+{
+	return m_indices;
+}
+
+std::span<const DrawArgs> MeshCacheView::GetDrawArgs() const
+{
+	return m_drawArgs;
+}
+
+std::span<const Meshlet> MeshCacheView::GetMeshlets() const
+{
+	return m_meshlets;
+}
+
+std::span<const VertexIndex> MeshCacheView::GetMeshletVertices() const
+{
+	return m_meshletVertices;
+}
+
+std::span<const MeshletPrimitive> MeshCacheView::GetMeshletPrimitives() const
+{
+	return m_meshletPrimitives;
+}
+
+const BoundingBox& MeshCacheView::GetBounds() const
+{
+	return m_bounds;
+}
+
+bool MeshCacheView::IsMapped() const
+{
+	return m_file.IsOpen();
+}
+
+bool CreateMeshCacheKey(const std::string& sourcePath, MeshCacheKey& key)
+{
+	std::error_code errorCode;
+	const auto modifiedTime = std::filesystem::last_write_time(sourcePath, errorCode);
+	if (errorCode)
+	{
+		return false;
+	}
+
+	MappedFile sourceFile;
+	if (!sourceFile.Open(sourcePath))
+	{
+		return false;
+	}
+
+	key.sourceHash = HashBytes(sourceFile.Data(), sourceFile.Size());
+	key.sourceModifiedTime = (int64_t)modifiedTime.time_since_epoch().count();
+	key.sourceSize = sourceFile.Size();
+
+	return true;
+}
+
+BoundingBox CalculateBounds(std::span<const Vertex> vertices)
+{
+	BoundingBox bounds = {};
+	if (vertices.empty())
+	{
+		return bounds;
+	}
+
+	bounds.min = vertices[0].position;
+	bounds.max = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		bounds.min.x = std::min(bounds.min.x, vertex.position.x);
+		bounds.min.y = std::min(bounds.min.y, vertex.position.y);
+		bounds.min.z = std::min(bounds.min.z, vertex.position.z);
+
+		bounds.max.x = std::max(bounds.max.x, vertex.position.x);
+		bounds.max.y = std::max(bounds.max.y, vertex.position.y);
+		bounds.max.z = std::max(bounds.max.z, vertex.position.z);
+	}
+
+	return bounds;
+}
+
+bool WriteMeshCache(const std::string& cachePath, const MeshCacheKey& key, const MeshData& mesh, const std::vector<DrawArgs>& drawArgs, const MeshletData& meshletData)
+{
+	MeshCacheHeader header = {};
+	header.magic = MeshCacheMagic;
+	header.version = MeshCacheVersion;
+	header.key = key;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.drawArgsCount = (uint32_t)drawArgs.size();
+	header.meshletCount = (uint32_t)meshletData.meshlets.size();
+	header.meshletVertexCount = (uint32_t)meshletData.meshletVertices.size();
+	header.meshletPrimitiveCount = (uint32_t)meshletData.meshletPrimitives.size();
+	header.vertexOffset = AlignOffset(sizeof(MeshCacheHeader));
+	header.indexOffset = AlignOffset(header.vertexOffset + sizeof(Vertex) * header.vertexCount);
+	header.drawArgsOffset = AlignOffset(header.indexOffset + sizeof(VertexIndex) * header.indexCount);
+	header.meshletOffset = AlignOffset(header.drawArgsOffset + sizeof(DrawArgs) * header.drawArgsCount);
+	header.meshletVertexOffset = AlignOffset(header.meshletOffset + sizeof(Meshlet) * header.meshletCount);
+	header.meshletPrimitiveOffset = AlignOffset(header.meshletVertexOffset + sizeof(VertexIndex) * header.meshletVertexCount);
+	header.bounds = CalculateBounds(mesh.vertices);
+
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		auto writeAt = [&file](uint64_t offset, const void* data, uint64_t size)
+		{
+			// Pad up to the aligned offset.
+			static const char padding[MeshCacheAlignment] = {};
+			const uint64_t currentOffset = (uint64_t)file.tellp();
+			file.write(padding, (std::streamsize)(offset - currentOffset));
+			file.write(static_cast<const char*>(data), (std::streamsize)size);
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeAt(header.vertexOffset, mesh.vertices.data(), sizeof(Vertex) * header.vertexCount);
+		writeAt(header.indexOffset, mesh.indices.data(), sizeof(VertexIndex) * header.indexCount);
+		writeAt(header.drawArgsOffset, drawArgs.data(), sizeof(DrawArgs) * header.drawArgsCount);
+		writeAt(header.meshletOffset, meshletData.meshlets.data(), sizeof(Meshlet) * header.meshletCount);
+		writeAt(header.meshletVertexOffset, meshletData.meshletVertices.data(), sizeof(VertexIndex) * header.meshletVertexCount);
+		writeAt(header.meshletPrimitiveOffset, meshletData.meshletPrimitives.data(), sizeof(MeshletPrimitive) * header.meshletPrimitiveCount);
+
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, cachePath, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	return true;
+}
+
+void LoadMeshCached(const std::string& objPath, MeshCacheView& meshView)
+{
+	const std::string cachePath = objPath + MeshCacheExtension;
+
+	MeshCacheKey key;
+	const bool hasKey = CreateMeshCacheKey(objPath, key);
+
+	if (hasKey && meshView.Open(cachePath, key))
+	{
+		return;
+	}
+
+	MeshData mesh;
+	ImportOBJ(objPath, mesh);
+
+	const MeshOptimizationStats optimizationStats = OptimizeMesh(mesh);
+	OutputDebugMessage("Optimized '" + objPath + "': ACMR " + std::to_string(optimizationStats.before.acmr) + " -> " + std::to_string(optimizationStats.after.acmr) +
+		", ATVR " + std::to_string(optimizationStats.before.atvr) + " -> " + std::to_string(optimizationStats.after.atvr) + "\n");
+
+	// The whole mesh is drawn with a single draw.
+	std::vector<DrawArgs> drawArgs = { {
+		.vertexCount = (UINT)mesh.vertices.size(),
+		.startVertex = 0,
+		.indexCount = (UINT)mesh.indices.size(),
+		.startIndex = 0
+	} };
+
+	// Meshlets are built last since they follow the optimized triangle order.
+	MeshletData meshletData;
+	const MeshletStats meshletStats = BuildMeshlets(mesh.vertices, mesh.indices, {}, meshletData);
+	OutputDebugMessage("Built " + std::to_string(meshletStats.meshletCount) + " meshlets for '" + objPath + "' in " + std::to_string(meshletStats.buildMilliseconds) + " ms\n");
+
+	if (hasKey && WriteMeshCache(cachePath, key, mesh, drawArgs, meshletData) && meshView.Open(cachePath, key))
+	{
+		return;
+	}
+
+	OutputDebugMessage("Could not write mesh cache for '" + objPath + "', using the imported mesh directly.\n");
+	meshView.Adopt(std::move(mesh), std::move(drawArgs), std::move(meshletData));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "SceneTypes.h"
+#include "MeshletBuilder.h"
+#include "PlatformUtils.h"
+
+/*
+	Versioned binary container for imported meshes. The file is written the first time a source mesh is imported and
+	is memory mapped on later runs, which skips the text parsing entirely.
+
+	File layout (all offsets are from the start of the file and aligned to MeshCacheAlignment):
+		MeshCacheHeader
+		Vertex[vertexCount]
+		VertexIndex[indexCount]
+		DrawArgs[drawArgsCount]
+		Meshlet[meshletCount]
+		VertexIndex[meshletVertexCount]
+		MeshletPrimitive[meshletPrimitiveCount]
+*/
+
+constexpr uint32_t MeshCacheMagic = 0x48534D52; // "RMSH"
+constexpr uint32_t MeshCacheVersion = 4u;
+constexpr uint32_t MeshCacheAlignment = 16u;
+constexpr const char* MeshCacheExtension = ".meshcache";
+
+// Identifies the exact source file a cache was built from.
+struct MeshCacheKey
+{
+	uint64_t sourceHash = 0;
+	int64_t sourceModifiedTime = 0;
+	uint64_t sourceSize = 0;
+};
+
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	MeshCacheKey key;
+
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t drawArgsCount;
+	uint32_t meshletCount;
+	uint32_t meshletVertexCount;
+	uint32_t meshletPrimitiveCount;
+
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t drawArgsOffset;
+	uint64_t meshletOffset;
+	uint64_t meshletVertexOffset;
+	uint64_t meshletPrimitiveOffset;
+
+	BoundingBox bounds;
+};
+
+// A read only view into a memory mapped mesh cache. The spans stay valid for as long as the view is alive.
+class MeshCacheView
+{
+public:
+	// Maps the cache file and validates it against the expected key. Returns false if the cache is missing, stale or corrupt.
+	bool Open(const std::string& cachePath, const MeshCacheKey& expectedKey);
+
+	// Takes ownership of an already imported mesh. Used as a fallback when the cache could not be written.
+	void Adopt(MeshData&& mesh, std::vector<DrawArgs>&& drawArgs, MeshletData&& meshletData);
+
+	std::span<const Vertex> GetVertices() const;
+	std::span<const VertexIndex> GetIndices() const;
+	std::span<const DrawArgs> GetDrawArgs() const;
+	std::span<const Meshlet> GetMeshlets() const;
+	std::span<const VertexIndex> GetMeshletVertices() const;
+	std::span<const MeshletPrimitive> GetMeshletPrimitives() const;
+	const BoundingBox& GetBounds() const;
+
+	// True if the data is read straight from a mapped cache file.
+	bool IsMapped() const;
+
+private:
+	MappedFile m_file;
+
+	// Only used when the mesh was adopted instead of mapped.
+	MeshData m_ownedMesh;
+	std::vector<DrawArgs> m_ownedDrawArgs;
+	MeshletData m_ownedMeshletData;
+
+	std::span<const Vertex> m_vertices;
+	std::span<const VertexIndex> m_indices;
+	std::span<const DrawArgs> m_drawArgs;
+	std::span<const Meshlet> m_meshlets;
+	std::span<const VertexIndex> m_meshletVertices;
+	std::span<const MeshletPrimitive> m_meshletPrimitives;
+	BoundingBox m_bounds;
+};
+
+// Builds the key of a source file from its contents and last modification time.
+// Returns false if the file could not be read.
+bool CreateMeshCacheKey(const std::string& sourcePath, MeshCacheKey& key);
+
+BoundingBox CalculateBounds(std::span<const Vertex> vertices);
+
+// Writes a mesh cache file. The file is first written to a temporary path and then moved into place
+// so that a concurrently running instance never maps a half written cache.
+bool WriteMeshCache(const std::string& cachePath, const MeshCacheKey& key, const MeshData& mesh, const std::vector<DrawArgs>& drawArgs, const MeshletData& meshletData);
+
+// Returns a mapped view of the mesh at the given OBJ path. The OBJ is only parsed, optimized and split into meshlets if no
+// valid cache exists next to it, in which case the cache is written before being mapped.
+void LoadMeshCached(const std::string& objPath, MeshCacheView& meshView);
@@ -0,0 +1,94 @@
+#include "MeshLoader.h"
+
+#include <set>
+#include <stdexcept>
+
+#include "PlatformUtils.h"
+#include "tiny_obj_loader.h"
+
+void ReadObjFile(std::string modelPath, tinyobj::ObjReader& reader, tinyobj::ObjReaderConfig config)
+{
+	if (!reader.ParseFromFile(modelPath, config))
+	{
+		if (!reader.Error().empty())
+		{
+			throw std::runtime_error(reader.Error());
+		}
+		else
+		{
+			throw std::runtime_error("Failed to load model");
+		}
+	}
+
+	if (!reader.Warning().empty())
+	{
+		OutputDebugMessage(reader.Warning());
+	}
+}
+
+template <typename T>
+void GetObjVertexIndices(std::vector<T>& vertexIndices, tinyobj::ObjReader& reader)
+{
+	auto& shapes = reader.GetShapes();
+
+	for (const auto& shape : shapes)
+	{
+		for (const auto& index : shape.mesh.indices)
+		{
+			vertexIndices.push_back((T)index.vertex_index);
+		}
+	}
+}
+
+void LoadMeshFromOBJ(const std::string& objPath, MeshData& mesh)
+{
+	tinyobj::ObjReaderConfig readerConfig = {};
+	readerConfig.triangulate = true;
+	tinyobj::ObjReader reader;
+
+	ReadObjFile(objPath, reader, readerConfig);
+
+	auto& attrib = reader.GetAttrib();
+	auto& shapes = reader.GetShapes();
+
+	std::vector<VertexIndex>& indices = mesh.indices;
+	GetObjVertexIndices(indices, reader);
+
+	std::vector<Vertex>& vertices = mesh.vertices;
+	vertices.resize(attrib.vertices.size() / 3);
+	std::set<UINT> createdVertexIndices;
+
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		for (auto& indexInfo : shapes[s].mesh.indices)
+		{
+			auto vertexIndex = indexInfo.vertex_index;
+			auto normalIndex = indexInfo.normal_index;
+
+			if (createdVertexIndices.find(vertexIndex) == createdVertexIndices.end())
+			{
+				Vertex vertex = {};
+				vertex.position = {
+					attrib.vertices[3 * vertexIndex + 0],
+					attrib.vertices[3 * vertexIndex + 1],
+					attrib.vertices[3 * vertexIndex + 2]
+				};
+
+				if (normalIndex != -1)
+				{
+					vertex.normal = {
+						attrib.normals[3 * normalIndex + 0],
+						attrib.normals[3 * normalIndex + 1],
+						attrib.normals[3 * normalIndex + 2]
+					};
+				}
+
+				vertex.color = { 1.0f, 1.0f, 1.0f };
+
+				vertices[vertexIndex] = vertex;
+				createdVertexIndices.insert(vertexIndex);
+			}
+		}
+
+	}
+}
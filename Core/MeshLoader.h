@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+#include "SceneTypes.h"
+
+// Parses an OBJ file from disk and fills the given mesh with its vertices and indices.
+// Throws a runtime error if the file could not be parsed.
+void LoadMeshFromOBJ(const std::string& objPath, MeshData& mesh);
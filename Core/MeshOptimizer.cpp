@@ -0,0 +1,465 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "MathUtils.h"
+
+namespace
+{
+	// Simulated LRU cache size and score constants from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	constexpr uint32_t ForsythCacheSize = 32u;
+	constexpr float ForsythCacheDecayPower = 1.5f;
+	constexpr float ForsythLastTriangleScore = 0.75f;
+	constexpr float ForsythValenceBoostScale = 2.0f;
+	constexpr float ForsythValenceBoostPower = 0.5f;
+
+	// Smallest number of triangles a soft overdraw cluster may have.
+	constexpr uint32_t MinOverdrawClusterSize = 8u;
+
+	float ForsythVertexScore(int32_t cachePosition, uint32_t activeTriangleCount)
+	{
+		if (activeTriangleCount == 0)
+		{
+			// The vertex is not used by any remaining triangle.
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// The vertex was used by the last triangle. The score is fixed so that the next triangle
+				// isn't biased towards any of its edges.
+				score = ForsythLastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (ForsythCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, ForsythCacheDecayPower);
+			}
+		}
+
+		// Prefer vertices with few remaining triangles to get rid of lone triangles early.
+		score += ForsythValenceBoostScale * std::pow((float)activeTriangleCount, -ForsythValenceBoostPower);
+
+		return score;
+	}
+
+	// FIFO cache simulation based on timestamps. A vertex is in the cache if it was loaded less than cacheSize misses ago.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint32_t cacheSize) :
+			m_timestamps(vertexCount, 0),
+			m_cacheSize(cacheSize),
+			m_time(cacheSize + 1)
+		{
+		}
+
+		// Returns true if the vertex had to be transformed.
+		bool Access(VertexIndex vertex)
+		{
+			if (m_time - m_timestamps[vertex] > m_cacheSize)
+			{
+				m_timestamps[vertex] = m_time++;
+				return true;
+			}
+
+			return false;
+		}
+
+		// Empties the cache without touching every vertex.
+		void Flush()
+		{
+			m_time += m_cacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32_t> m_timestamps;
+		uint32_t m_cacheSize;
+		uint32_t m_time;
+	};
+
+	struct OverdrawCluster
+	{
+		uint32_t startTriangle;
+		uint32_t triangleCount;
+		float sortKey;
+	};
+
+	// Splits the triangles into clusters that start where the cache is completely cold.
+	std::vector<uint32_t> FindHardClusterBoundaries(std::span<const VertexIndex> indices, size_t vertexCount)
+	{
+		const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+		std::vector<uint32_t> boundaries;
+		FifoCache cache(vertexCount, VertexCacheAnalysisSize);
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t misses = 0;
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				misses += cache.Access(indices[3 * t + i]) ? 1 : 0;
+			}
+
+			if (misses == 3)
+			{
+				boundaries.push_back(t);
+			}
+		}
+
+		boundaries.push_back(triangleCount);
+		return boundaries;
+	}
+
+	// Splits a hard cluster further wherever the cluster drawn so far is already about as cache efficient as the whole.
+	void AddSoftClusters(std::span<const VertexIndex> indices, FifoCache& cache, uint32_t start, uint32_t end, float threshold, std::vector<OverdrawCluster>& clusters)
+	{
+		cache.Flush();
+
+		uint32_t misses = 0;
+		for (uint32_t t = start; t < end; t++)
+		{
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				misses += cache.Access(indices[3 * t + i]) ? 1 : 0;
+			}
+		}
+
+		const float clusterAcmr = (float)misses / (end - start);
+
+		cache.Flush();
+		misses = 0;
+
+		uint32_t clusterStart = start;
+		for (uint32_t t = start; t < end; t++)
+		{
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				misses += cache.Access(indices[3 * t + i]) ? 1 : 0;
+			}
+
+			const uint32_t clusterSize = t - clusterStart + 1;
+			const bool isLast = t + 1 == end;
+			if (isLast || (clusterSize >= MinOverdrawClusterSize && (float)misses / clusterSize <= clusterAcmr * threshold))
+			{
+				clusters.push_back({ clusterStart, clusterSize, 0.0f });
+
+				clusterStart = t + 1;
+				misses = 0;
+				cache.Flush();
+			}
+		}
+	}
+}
+
+VertexCacheStats AnalyzeVertexCache(std::span<const VertexIndex> indices, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> isReferenced(vertexCount, false);
+
+	uint32_t misses = 0;
+	uint32_t referencedCount = 0;
+	for (VertexIndex index : indices)
+	{
+		misses += cache.Access(index) ? 1 : 0;
+
+		if (!isReferenced[index])
+		{
+			isReferenced[index] = true;
+			referencedCount++;
+		}
+	}
+
+	stats.acmr = (float)misses / (indices.size() / 3);
+	stats.atvr = (float)misses / referencedCount;
+
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<VertexIndex>& indices, size_t vertexCount)
+{
+	const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles adjacent to every vertex. The first activeTriangleCounts[v] entries are the ones not yet emitted.
+	std::vector<uint32_t> activeTriangleCounts(vertexCount, 0);
+	for (VertexIndex index : indices)
+	{
+		activeTriangleCounts[index]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + activeTriangleCounts[v];
+	}
+
+	std::vector<uint32_t> adjacentTriangles(indices.size());
+	{
+		std::vector<uint32_t> fillCounts(vertexCount, 0);
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				const VertexIndex v = indices[3 * t + i];
+				adjacentTriangles[adjacencyOffsets[v] + fillCounts[v]++] = t;
+			}
+		}
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = ForsythVertexScore(-1, activeTriangleCounts[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> isEmitted(triangleCount, false);
+
+	uint32_t bestTriangle = 0;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[3 * t + 0]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	std::vector<VertexIndex> optimizedIndices;
+	optimizedIndices.reserve(indices.size());
+
+	// The cache can temporarily hold three more entries before the ones falling out are processed.
+	std::array<VertexIndex, ForsythCacheSize + 3> cache;
+	std::array<VertexIndex, ForsythCacheSize + 3> newCache;
+	uint32_t cacheCount = 0;
+
+	uint32_t fallbackCursor = 0;
+	for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (bestTriangle == UINT32_MAX)
+		{
+			// None of the triangles touching the cache are left, continue with the next one in file order.
+			while (isEmitted[fallbackCursor])
+			{
+				fallbackCursor++;
+			}
+
+			bestTriangle = fallbackCursor;
+		}
+
+		const VertexIndex* triangle = &indices[3 * bestTriangle];
+		optimizedIndices.insert(optimizedIndices.end(), triangle, triangle + 3);
+		isEmitted[bestTriangle] = true;
+
+		// Remove the triangle from the adjacency of its vertices.
+		uint32_t newCacheCount = 0;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const VertexIndex v = triangle[i];
+
+			uint32_t* adjacency = &adjacentTriangles[adjacencyOffsets[v]];
+			uint32_t& activeCount = activeTriangleCounts[v];
+			for (uint32_t j = 0; j < activeCount; j++)
+			{
+				if (adjacency[j] == bestTriangle)
+				{
+					std::swap(adjacency[j], adjacency[activeCount - 1]);
+					activeCount--;
+					break;
+				}
+			}
+
+			// Degenerate triangles can reference the same vertex more than once.
+			if (std::find(newCache.begin(), newCache.begin() + newCacheCount, v) == newCache.begin() + newCacheCount)
+			{
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// The triangle's vertices move to the front of the cache.
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			const VertexIndex v = cache[i];
+			if (std::find(newCache.begin(), newCache.begin() + newCacheCount, v) == newCache.begin() + newCacheCount)
+			{
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// Update the scores of everything that moved in or out of the cache.
+		for (uint32_t i = 0; i < newCacheCount; i++)
+		{
+			const VertexIndex v = newCache[i];
+			cachePositions[v] = i < ForsythCacheSize ? (int32_t)i : -1;
+			vertexScores[v] = ForsythVertexScore(cachePositions[v], activeTriangleCounts[v]);
+		}
+
+		// Only triangles touching the cache changed their score, so the next best triangle is one of them.
+		bestTriangle = UINT32_MAX;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCacheCount; i++)
+		{
+			const VertexIndex v = newCache[i];
+			const uint32_t* adjacency = &adjacentTriangles[adjacencyOffsets[v]];
+			for (uint32_t j = 0; j < activeTriangleCounts[v]; j++)
+			{
+				const uint32_t t = adjacency[j];
+				triangleScores[t] = vertexScores[indices[3 * t + 0]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCacheCount, ForsythCacheSize);
+		std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+	}
+
+	indices = std::move(optimizedIndices);
+}
+
+void OptimizeOverdraw(std::vector<VertexIndex>& indices, std::span<const Vertex> vertices, float threshold)
+{
+	using namespace MathUtils;
+
+	const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	std::vector<OverdrawCluster> clusters;
+	{
+		const std::vector<uint32_t> hardBoundaries = FindHardClusterBoundaries(indices, vertices.size());
+
+		FifoCache cache(vertices.size(), VertexCacheAnalysisSize);
+		uint32_t start = 0;
+		for (uint32_t end : hardBoundaries)
+		{
+			if (end > start)
+			{
+				AddSoftClusters(indices, cache, start, end, threshold, clusters);
+			}
+
+			start = end;
+		}
+	}
+
+	// Area weighted centroid of the whole mesh.
+	DirectX::XMFLOAT3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const DirectX::XMFLOAT3& p0 = vertices[indices[3 * t + 0]].position;
+		const DirectX::XMFLOAT3& p1 = vertices[indices[3 * t + 1]].position;
+		const DirectX::XMFLOAT3& p2 = vertices[indices[3 * t + 2]].position;
+
+		const float area = Length(Cross(Subtract(p1, p0), Subtract(p2, p0)));
+		meshCentroid = Add(meshCentroid, Scale(Add(Add(p0, p1), p2), area / 3.0f));
+		meshArea += area;
+	}
+
+	meshCentroid = Scale(meshCentroid, meshArea > 0.0f ? 1.0f / meshArea : 0.0f);
+
+	// Clusters that face away from the center are more likely to occlude the rest and are drawn first.
+	for (OverdrawCluster& cluster : clusters)
+	{
+		DirectX::XMFLOAT3 centroid = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 normal = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+
+		for (uint32_t t = cluster.startTriangle; t < cluster.startTriangle + cluster.triangleCount; t++)
+		{
+			const DirectX::XMFLOAT3& p0 = vertices[indices[3 * t + 0]].position;
+			const DirectX::XMFLOAT3& p1 = vertices[indices[3 * t + 1]].position;
+			const DirectX::XMFLOAT3& p2 = vertices[indices[3 * t + 2]].position;
+
+			const DirectX::XMFLOAT3 areaNormal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+			const float triangleArea = Length(areaNormal);
+
+			centroid = Add(centroid, Scale(Add(Add(p0, p1), p2), triangleArea / 3.0f));
+			normal = Add(normal, areaNormal);
+			area += triangleArea;
+		}
+
+		centroid = Scale(centroid, area > 0.0f ? 1.0f / area : 0.0f);
+		cluster.sortKey = Dot(Subtract(centroid, meshCentroid), Normalize(normal));
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster& a, const OverdrawCluster& b)
+	{
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<VertexIndex> sortedIndices;
+	sortedIndices.reserve(indices.size());
+	for (const OverdrawCluster& cluster : clusters)
+	{
+		auto begin = indices.begin() + 3 * (size_t)cluster.startTriangle;
+		sortedIndices.insert(sortedIndices.end(), begin, begin + 3 * (size_t)cluster.triangleCount);
+	}
+
+	indices = std::move(sortedIndices);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	std::vector<VertexIndex> remap(mesh.vertices.size(), UINT32_MAX);
+	std::vector<Vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (VertexIndex& index : mesh.indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = (VertexIndex)vertices.size();
+			vertices.push_back(mesh.vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh.vertices = std::move(vertices);
+}
+
+MeshOptimizationStats OptimizeMesh(MeshData& mesh, const MeshOptimizationSettings& settings)
+{
+	MeshOptimizationStats stats = {};
+	stats.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+	if (settings.optimizeVertexCache)
+	{
+		OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	}
+
+	if (settings.optimizeOverdraw)
+	{
+		OptimizeOverdraw(mesh.indices, mesh.vertices, settings.overdrawThreshold);
+	}
+
+	// Runs last because it follows the final triangle order.
+	if (settings.optimizeVertexFetch)
+	{
+		OptimizeVertexFetch(mesh);
+	}
+
+	stats.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	return stats;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "SceneTypes.h"
+
+/*
+	Import time mesh optimizations for indexed triangle lists.
+
+	OptimizeVertexCache() reorders triangles for post transform cache reuse using Tom Forsyth's linear speed vertex cache
+	optimization. OptimizeOverdraw() then optionally groups those triangles into clusters and sorts the clusters so that
+	outward facing parts of the mesh are drawn first, trading a bit of cache efficiency for less overdraw. Finally
+	OptimizeVertexFetch() renumbers the vertices in order of first use so that vertex fetches walk memory linearly.
+
+	None of the passes change what is drawn, only the order it is drawn in.
+*/
+
+// Size of the FIFO cache used to measure cache efficiency. Matches the smallest post transform caches on current GPUs.
+constexpr uint32_t VertexCacheAnalysisSize = 16u;
+
+struct VertexCacheStats
+{
+	// Average cache miss ratio: transformed vertices per triangle. Lies between 0.5 (ideal grid) and 3.
+	float acmr = 0.0f;
+	// Average transform to vertex ratio: transformed vertices per referenced vertex. 1 is ideal.
+	float atvr = 0.0f;
+};
+
+struct MeshOptimizationSettings
+{
+	bool optimizeVertexCache = true;
+	bool optimizeOverdraw = false;
+	// How much worse the ACMR of a cluster may get to split the mesh into more clusters for overdraw sorting.
+	float overdrawThreshold = 1.05f;
+	bool optimizeVertexFetch = true;
+};
+
+struct MeshOptimizationStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// Simulates a FIFO post transform cache of the given size over a triangle list.
+VertexCacheStats AnalyzeVertexCache(std::span<const VertexIndex> indices, size_t vertexCount, uint32_t cacheSize = VertexCacheAnalysisSize);
+
+// Reorders the triangles for vertex cache locality.
+void OptimizeVertexCache(std::vector<VertexIndex>& indices, size_t vertexCount);
+
+// Sorts clusters of triangles front to back as seen from outside the mesh. Expects cache optimized indices.
+void OptimizeOverdraw(std::vector<VertexIndex>& indices, std::span<const Vertex> vertices, float threshold);
+
+// Reorders the vertices in order of first use and drops vertices that are not referenced.
+void OptimizeVertexFetch(MeshData& mesh);
+
+// Runs the enabled passes in the right order and reports the cache efficiency before and after.
+MeshOptimizationStats OptimizeMesh(MeshData& mesh, const MeshOptimizationSettings& settings = {});
@@ -0,0 +1,204 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include "MathUtils.h"
+
+namespace
+{
+	constexpr uint32_t NoLocalIndex = UINT32_MAX;
+
+	// Ritter's bounding sphere. Not minimal, but deterministic and linear in the number of vertices.
+	void CalculateBoundingSphere(std::span<const Vertex> vertices, std::span<const VertexIndex> meshletVertices, Meshlet& meshlet)
+	{
+		using namespace MathUtils;
+
+		auto findFarthest = [&](const DirectX::XMFLOAT3& from)
+		{
+			DirectX::XMFLOAT3 farthest = from;
+			float farthestDistance = -1.0f;
+			for (VertexIndex index : meshletVertices)
+			{
+				const float distance = Length(Subtract(vertices[index].position, from));
+				if (distance > farthestDistance)
+				{
+					farthestDistance = distance;
+					farthest = vertices[index].position;
+				}
+			}
+
+			return farthest;
+		};
+
+		const DirectX::XMFLOAT3 a = findFarthest(vertices[meshletVertices[0]].position);
+		const DirectX::XMFLOAT3 b = findFarthest(a);
+
+		DirectX::XMFLOAT3 center = Scale(Add(a, b), 0.5f);
+		float radius = Length(Subtract(b, a)) * 0.5f;
+
+		// Grow the sphere to include any vertex left outside.
+		for (VertexIndex index : meshletVertices)
+		{
+			const DirectX::XMFLOAT3& position = vertices[index].position;
+			const float distance = Length(Subtract(position, center));
+			if (distance > radius)
+			{
+				const float newRadius = (radius + distance) * 0.5f;
+				center = Add(center, Scale(Subtract(position, center), (newRadius - radius) / distance));
+				radius = newRadius;
+			}
+		}
+
+		meshlet.center = center;
+		meshlet.radius = radius;
+	}
+
+	void CalculateNormalCone(std::span<const Vertex> vertices, const MeshletData& meshletData, Meshlet& meshlet)
+	{
+		using namespace MathUtils;
+
+		std::vector<DirectX::XMFLOAT3> normals;
+		normals.reserve(meshlet.primitiveCount);
+
+		DirectX::XMFLOAT3 normalSum = { 0.0f, 0.0f, 0.0f };
+		for (UINT i = 0; i < meshlet.primitiveCount; i++)
+		{
+			uint32_t localIndices[3];
+			UnpackMeshletPrimitive(meshletData.meshletPrimitives[meshlet.primitiveOffset + i], localIndices);
+
+			const DirectX::XMFLOAT3& p0 = vertices[meshletData.meshletVertices[meshlet.vertexOffset + localIndices[0]]].position;
+			const DirectX::XMFLOAT3& p1 = vertices[meshletData.meshletVertices[meshlet.vertexOffset + localIndices[1]]].position;
+			const DirectX::XMFLOAT3& p2 = vertices[meshletData.meshletVertices[meshlet.vertexOffset + localIndices[2]]].position;
+
+			const DirectX::XMFLOAT3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+			if (Length(normal) == 0.0f)
+			{
+				// Degenerate triangles are never visible and don't restrict the cone.
+				continue;
+			}
+
+			normals.push_back(Normalize(normal));
+			normalSum = Add(normalSum, normals.back());
+		}
+
+		meshlet.coneAxis = { 0.0f, 0.0f, 0.0f };
+		meshlet.coneCutoff = 1.0f;
+
+		if (normals.empty() || Length(normalSum) == 0.0f)
+		{
+			return;
+		}
+
+		meshlet.coneAxis = Normalize(normalSum);
+
+		float minDot = 1.0f;
+		for (const DirectX::XMFLOAT3& normal : normals)
+		{
+			minDot = std::min(minDot, Dot(meshlet.coneAxis, normal));
+		}
+
+		// A cone of 90 degrees or more always has a triangle facing the camera.
+		if (minDot > 0.0f)
+		{
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+}
+
+MeshletStats BuildMeshlets(std::span<const Vertex> vertices, std::span<const VertexIndex> indices, const MeshletSettings& settings, MeshletData& meshletData)
+{
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	if (settings.maxVertices < 3 || settings.maxVertices > MaxMeshletVertexLimit ||
+		settings.maxPrimitives == 0 || settings.maxPrimitives > MaxMeshletPrimitiveLimit)
+	{
+		throw std::runtime_error("Invalid meshlet limits.");
+	}
+
+	meshletData = {};
+
+	// Local index of every mesh vertex in the meshlet that is being built.
+	std::vector<uint32_t> localIndices(vertices.size(), NoLocalIndex);
+
+	Meshlet meshlet = {};
+
+	auto finishMeshlet = [&]()
+	{
+		if (meshlet.primitiveCount == 0)
+		{
+			return;
+		}
+
+		std::span<const VertexIndex> meshletVertices(meshletData.meshletVertices.data() + meshlet.vertexOffset, meshlet.vertexCount);
+		for (VertexIndex index : meshletVertices)
+		{
+			localIndices[index] = NoLocalIndex;
+		}
+
+		CalculateBoundingSphere(vertices, meshletVertices, meshlet);
+		CalculateNormalCone(vertices, meshletData, meshlet);
+		meshletData.meshlets.push_back(meshlet);
+
+		meshlet = {};
+		meshlet.vertexOffset = (UINT)meshletData.meshletVertices.size();
+		meshlet.primitiveOffset = (UINT)meshletData.meshletPrimitives.size();
+	};
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		const VertexIndex triangle[3] = { indices[t + 0], indices[t + 1], indices[t + 2] };
+
+		uint32_t newVertexCount = 0;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const bool isDuplicate = (i > 0 && triangle[i] == triangle[0]) || (i > 1 && triangle[i] == triangle[1]);
+			newVertexCount += localIndices[triangle[i]] == NoLocalIndex && !isDuplicate ? 1 : 0;
+		}
+
+		if (meshlet.vertexCount + newVertexCount > settings.maxVertices || meshlet.primitiveCount + 1 > settings.maxPrimitives)
+		{
+			finishMeshlet();
+		}
+
+		MeshletPrimitive primitive = 0;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			uint32_t& localIndex = localIndices[triangle[i]];
+			if (localIndex == NoLocalIndex)
+			{
+				localIndex = meshlet.vertexCount++;
+				meshletData.meshletVertices.push_back(triangle[i]);
+			}
+
+			primitive |= localIndex << (8 * i);
+		}
+
+		meshletData.meshletPrimitives.push_back(primitive);
+		meshlet.primitiveCount++;
+	}
+
+	finishMeshlet();
+
+	MeshletStats stats = {};
+	stats.meshletCount = (uint32_t)meshletData.meshlets.size();
+	if (stats.meshletCount > 0)
+	{
+		stats.averageVertexCount = (float)meshletData.meshletVertices.size() / stats.meshletCount;
+		stats.averagePrimitiveCount = (float)meshletData.meshletPrimitives.size() / stats.meshletCount;
+	}
+
+	stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+	return stats;
+}
+
+bool IsMeshletBackfacing(const Meshlet& meshlet, const DirectX::XMFLOAT3& cameraPosition)
+{
+	using namespace MathUtils;
+
+	// Uses the bounding sphere instead of a cone apex, which is conservative for every point of the meshlet.
+	const DirectX::XMFLOAT3 toCenter = Subtract(meshlet.center, cameraPosition);
+	return Dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * Length(toCenter) + meshlet.radius;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "PlatformIncludes.h"
+#include "SceneTypes.h"
+
+/*
+	Splits an indexed triangle list into meshlets: small clusters with a bounded number of unique vertices and triangles.
+
+	Every meshlet references a range of meshletVertices, which are indices into the mesh's vertex buffer, and a range of
+	meshletPrimitives, which hold three local vertex indices per triangle packed into 8 bits each. Each meshlet also has a
+	bounding sphere and a normal cone so that later passes can frustum and backface cull whole clusters.
+
+	Triangles are added greedily in index buffer order, so the output is deterministic and the clusters are as coherent as
+	the triangle order. Imported meshes are cache optimized before this runs, which keeps neighboring triangles together.
+*/
+
+// Limits imposed by the 8 bit local indices.
+constexpr uint32_t MaxMeshletVertexLimit = 256u;
+constexpr uint32_t MaxMeshletPrimitiveLimit = 256u;
+
+// Three local vertex indices packed as i0 | i1 << 8 | i2 << 16.
+typedef uint32_t MeshletPrimitive;
+
+struct Meshlet
+{
+	UINT vertexOffset;
+	UINT vertexCount;
+	UINT primitiveOffset;
+	UINT primitiveCount;
+
+	// Bounding sphere in object space.
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	// All triangle normals lie within the cone around coneAxis. coneCutoff is the sine of the cone's half angle,
+	// or 1 if the cone is too wide to ever be backface culled.
+	DirectX::XMFLOAT3 coneAxis;
+	float coneCutoff;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<VertexIndex> meshletVertices;
+	std::vector<MeshletPrimitive> meshletPrimitives;
+};
+
+struct MeshletSettings
+{
+	// 64 vertices and 124 triangles are the sizes recommended for mesh shaders on current hardware.
+	uint32_t maxVertices = 64u;
+	uint32_t maxPrimitives = 124u;
+};
+
+struct MeshletStats
+{
+	uint32_t meshletCount = 0;
+	float averageVertexCount = 0.0f;
+	float averagePrimitiveCount = 0.0f;
+	double buildMilliseconds = 0.0;
+};
+
+// Builds the meshlets of a triangle list. Throws a runtime error if the limits are zero or exceed the 8 bit index range.
+MeshletStats BuildMeshlets(std::span<const Vertex> vertices, std::span<const VertexIndex> indices, const MeshletSettings& settings, MeshletData& meshletData);
+
+inline void UnpackMeshletPrimitive(MeshletPrimitive primitive, uint32_t (&localIndices)[3])
+{
+	localIndices[0] = primitive & 0xFF;
+	localIndices[1] = (primitive >> 8) & 0xFF;
+	localIndices[2] = (primitive >> 16) & 0xFF;
+}
+
+// True if every triangle of the meshlet faces away from a camera at the given object space position.
+bool IsMeshletBackfacing(const Meshlet& meshlet, const DirectX::XMFLOAT3& cameraPosition);
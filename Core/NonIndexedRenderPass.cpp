@@ -1,5 +1,11 @@
 #include "NonIndexedRenderPass.h"
 
+void NonIndexedRenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	frameGraph.Write(graphPass, FrameGraphBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	frameGraph.Write(graphPass, FrameGraphDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+}
+
 void NonIndexedRenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
 	assert(pipelineArgs != nullptr);
@@ -12,6 +18,7 @@ void NonIndexedRenderPass::BuildRenderPass(const std::vector<RenderPackage>& ren
 	commandList->OMSetRenderTargets(1, &args.RTV, TRUE, &args.commonArgs.depthStencilView);
 
 	// Draw.
+	FlushBarriers(context, frameIndex);
 	for (const RenderPackage& renderPackage : renderPackages)
 	{
 		if (renderPackage.renderObject)
@@ -26,9 +33,25 @@ void NonIndexedRenderPass::BuildRenderPass(const std::vector<RenderPackage>& ren
 			{
 				const std::vector<RenderInstance>& renderInstances = *renderPackage.renderInstances;
 
-				for (UINT i = context; i < drawArgs.size(); i += NumContexts)
+				if constexpr (ActiveInstanceDataMode == InstanceDataMode::StructuredBuffer)
+				{
+					// Every draw arg of the context draws all of the instances at once.
+					if (!renderInstances.empty())
+					{
+						SetFirstInstance(renderInstances[0], commandList);
+						for (UINT i = context; i < drawArgs.size(); i += GetActiveContextCount(frameIndex))
+						{
+							const DrawArgs& drawArg = drawArgs[i];
+							commandList->DrawInstanced(drawArg.vertexCount, (UINT)renderInstances.size(), drawArg.startVertex, drawArg.startInstance);
+						}
+					}
+				}
+				else
 				{
-					PerRenderInstance(renderInstances[i], drawArgs, pipelineArgs, context, frameIndex);
+					for (UINT i = context; i < drawArgs.size(); i += GetActiveContextCount(frameIndex))
+					{
+						PerRenderInstance(renderInstances[i], drawArgs, pipelineArgs, context, frameIndex);
+					}
 				}
 			}
 		}
@@ -50,7 +73,7 @@ void NonIndexedRenderPass::PerRenderInstance(const RenderInstance& renderInstanc
 
 	SetInstanceCB(args.commonArgs, frameIndex, renderInstance, commandList);
 
-	for (UINT i = context; i < drawArgs.size(); i += NumContexts)
+	for (UINT i = context; i < drawArgs.size(); i += GetActiveContextCount(frameIndex))
 	{
 		const DrawArgs& drawArg = drawArgs[i];
 
@@ -0,0 +1,576 @@
+#include "ObjImporter.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
+
+#include "ParallelUtils.h"
+#include "PlatformUtils.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Fixed shard count so that the weld does not depend on the number of threads.
+	constexpr uint32_t WeldShardCount = 64u;
+	constexpr size_t MinChunkSize = 64u * 1024u;
+	constexpr int32_t NoAttribute = INT32_MIN;
+
+	constexpr uint8_t RelativePosition = 1u << 0;
+	constexpr uint8_t RelativeTexcoord = 1u << 1;
+	constexpr uint8_t RelativeNormal = 1u << 2;
+
+	// One corner of a triangle, holding zero based attribute indices.
+	// Negative OBJ indices are relative to the attributes defined so far, which can't be resolved until
+	// all previous chunks are parsed. Those are stored relative to the chunk start and flagged in relativeMask.
+	struct ObjCorner
+	{
+		int32_t position;
+		int32_t texcoord;
+		int32_t normal;
+		uint8_t relativeMask;
+	};
+
+	struct ObjChunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		std::vector<float> positions;
+		std::vector<float> texcoords;
+		std::vector<float> normals;
+		std::vector<ObjCorner> corners;
+
+		// Prefix counts of all previous chunks.
+		uint64_t positionBase = 0;
+		uint64_t texcoordBase = 0;
+		uint64_t normalBase = 0;
+		uint64_t cornerBase = 0;
+		uint64_t vertexBase = 0;
+
+		std::array<uint32_t, WeldShardCount> shardCounts = {};
+		bool hasInvalidIndex = false;
+	};
+
+	// Reference from a corner to the unique vertex in its weld shard.
+	struct ShardVertexRef
+	{
+		uint32_t shard;
+		uint32_t local;
+	};
+
+	struct WeldEntry
+	{
+		int32_t position;
+		int32_t texcoord;
+		int32_t normal;
+		uint32_t local; // UINT32_MAX when the slot is empty.
+	};
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpaces(const char* cursor, const char* end)
+	{
+		while (cursor < end && IsSpace(*cursor))
+		{
+			cursor++;
+		}
+
+		return cursor;
+	}
+
+	const char* ParseFloats(const char* cursor, const char* end, float* values, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			cursor = SkipSpaces(cursor, end);
+
+			// from_chars does not accept a leading '+'.
+			if (cursor < end && *cursor == '+')
+			{
+				cursor++;
+			}
+
+			float value = 0.0f;
+			auto result = std::from_chars(cursor, end, value);
+			if (result.ec == std::errc())
+			{
+				cursor = result.ptr;
+			}
+
+			values[i] = value;
+		}
+
+		return cursor;
+	}
+
+	// Converts a one based OBJ index into a zero based index, flagging relative (negative) indices.
+	int32_t ToZeroBased(int64_t objIndex, uint64_t localCount, uint8_t relativeFlag, uint8_t& relativeMask)
+	{
+		if (objIndex > 0)
+		{
+			return (int32_t)(objIndex - 1);
+		}
+		else if (objIndex < 0)
+		{
+			relativeMask |= relativeFlag;
+			return (int32_t)((int64_t)localCount + objIndex);
+		}
+
+		return NoAttribute;
+	}
+
+	// Parses a single "v", "v/vt", "v//vn" or "v/vt/vn" face token.
+	const char* ParseFaceCorner(const char* cursor, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+	{
+		std::array<int64_t, 3> values = { 0, 0, 0 };
+		for (uint32_t component = 0; component < 3 && cursor < end; component++)
+		{
+			auto result = std::from_chars(cursor, end, values[component]);
+			if (result.ec == std::errc())
+			{
+				cursor = result.ptr;
+			}
+
+			if (cursor < end && *cursor == '/')
+			{
+				cursor++;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		// Skip anything that is left of the token.
+		while (cursor < end && !IsSpace(*cursor))
+		{
+			cursor++;
+		}
+
+		corner.relativeMask = 0;
+		corner.position = ToZeroBased(values[0], chunk.positions.size() / 3, RelativePosition, corner.relativeMask);
+		corner.texcoord = ToZeroBased(values[1], chunk.texcoords.size() / 2, RelativeTexcoord, corner.relativeMask);
+		corner.normal = ToZeroBased(values[2], chunk.normals.size() / 3, RelativeNormal, corner.relativeMask);
+
+		return cursor;
+	}
+
+	void ParseChunk(ObjChunk& chunk)
+	{
+		std::vector<ObjCorner> polygon;
+
+		const char* cursor = chunk.begin;
+		const char* end = chunk.end;
+		while (cursor < end)
+		{
+			const char* lineEnd = std::find(cursor, end, '\n');
+			cursor = SkipSpaces(cursor, lineEnd);
+
+			if (lineEnd - cursor >= 2 && cursor[0] == 'v')
+			{
+				if (IsSpace(cursor[1]))
+				{
+					float values[3];
+					ParseFloats(cursor + 2, lineEnd, values, 3);
+					chunk.positions.insert(chunk.positions.end(), values, values + 3);
+				}
+				else if (cursor[1] == 'n')
+				{
+					float values[3];
+					ParseFloats(cursor + 2, lineEnd, values, 3);
+					chunk.normals.insert(chunk.normals.end(), values, values + 3);
+				}
+				else if (cursor[1] == 't')
+				{
+					float values[2];
+					ParseFloats(cursor + 2, lineEnd, values, 2);
+					chunk.texcoords.insert(chunk.texcoords.end(), values, values + 2);
+				}
+			}
+			else if (lineEnd - cursor >= 2 && cursor[0] == 'f' && IsSpace(cursor[1]))
+			{
+				polygon.clear();
+
+				const char* faceCursor = SkipSpaces(cursor + 2, lineEnd);
+				while (faceCursor < lineEnd)
+				{
+					ObjCorner corner;
+					faceCursor = ParseFaceCorner(faceCursor, lineEnd, chunk, corner);
+					polygon.push_back(corner);
+
+					faceCursor = SkipSpaces(faceCursor, lineEnd);
+				}
+
+				// Fan triangulation.
+				for (size_t i = 2; i < polygon.size(); i++)
+				{
+					chunk.corners.push_back(polygon[0]);
+					chunk.corners.push_back(polygon[i - 1]);
+					chunk.corners.push_back(polygon[i]);
+				}
+			}
+
+			cursor = lineEnd < end ? lineEnd + 1 : end;
+		}
+	}
+
+	// Splits the data into chunks that always start at the beginning of a line.
+	std::vector<ObjChunk> SplitIntoChunks(const char* data, size_t size, uint32_t desiredChunkCount)
+	{
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(desiredChunkCount, size / MinChunkSize));
+
+		std::vector<ObjChunk> chunks;
+		chunks.reserve(chunkCount);
+
+		const char* end = data + size;
+		const char* chunkBegin = data;
+		for (size_t i = 1; i <= chunkCount && chunkBegin < end; i++)
+		{
+			const char* chunkEnd = end;
+			if (i < chunkCount)
+			{
+				chunkEnd = std::max(chunkBegin, data + (size * i) / chunkCount);
+				chunkEnd = std::find(chunkEnd, end, '\n');
+				chunkEnd = chunkEnd < end ? chunkEnd + 1 : end;
+			}
+
+			ObjChunk chunk;
+			chunk.begin = chunkBegin;
+			chunk.end = chunkEnd;
+			chunks.push_back(std::move(chunk));
+
+			chunkBegin = chunkEnd;
+		}
+
+		return chunks;
+	}
+
+	bool ResolveIndex(int32_t& index, uint8_t relativeMask, uint8_t relativeFlag, uint64_t base, uint64_t totalCount)
+	{
+		if (index == NoAttribute)
+		{
+			return true;
+		}
+
+		int64_t resolved = index;
+		if (relativeMask & relativeFlag)
+		{
+			resolved += (int64_t)base;
+		}
+
+		index = (int32_t)resolved;
+		return resolved >= 0 && resolved < (int64_t)totalCount;
+	}
+
+	uint32_t HashCorner(const ObjCorner& corner)
+	{
+		uint64_t hash = (uint64_t)(uint32_t)corner.position * 0x9E3779B97F4A7C15ull;
+		hash ^= (uint64_t)(uint32_t)corner.normal * 0xC2B2AE3D27D4EB4Full;
+		hash ^= (uint64_t)(uint32_t)corner.texcoord * 0x165667B19E3779F9ull;
+
+		// Murmur3 finalizer.
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+
+		return (uint32_t)hash;
+	}
+
+	uint32_t GetShard(uint32_t hash)
+	{
+		return hash % WeldShardCount;
+	}
+}
+
+void ImportOBJ(const std::string& objPath, MeshData& mesh, const ObjImportSettings& settings, ObjImportStats* stats)
+{
+	MappedFile file;
+	if (!file.Open(objPath))
+	{
+		throw std::runtime_error("Failed to open model: " + objPath);
+	}
+
+	ImportOBJFromMemory(reinterpret_cast<const char*>(file.Data()), (size_t)file.Size(), mesh, settings, stats);
+}
+
+void ImportOBJFromMemory(const char* data, size_t size, MeshData& mesh, const ObjImportSettings& settings, ObjImportStats* stats)
+{
+	const Clock::time_point importStart = Clock::now();
+	const uint32_t threadCount = settings.threadCount == 0 ? GetDefaultThreadCount() : settings.threadCount;
+
+	// Parse all chunks in parallel.
+	std::vector<ObjChunk> chunks = SplitIntoChunks(data, size, threadCount * std::max(1u, settings.chunksPerThread));
+	const uint32_t chunkCount = (uint32_t)chunks.size();
+
+	ParallelFor(chunkCount, [&](uint32_t chunkIndex)
+	{
+		ParseChunk(chunks[chunkIndex]);
+	}, threadCount);
+
+	const double parseMilliseconds = MillisecondsSince(importStart);
+	const Clock::time_point weldStart = Clock::now();
+
+	// Prefix counts so that every chunk knows where its attributes and corners start.
+	uint64_t positionCount = 0;
+	uint64_t texcoordCount = 0;
+	uint64_t normalCount = 0;
+	uint64_t cornerCount = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.positionBase = positionCount;
+		chunk.texcoordBase = texcoordCount;
+		chunk.normalBase = normalCount;
+		chunk.cornerBase = cornerCount;
+
+		positionCount += chunk.positions.size() / 3;
+		texcoordCount += chunk.texcoords.size() / 2;
+		normalCount += chunk.normals.size() / 3;
+		cornerCount += chunk.corners.size();
+	}
+
+	if (cornerCount > UINT32_MAX)
+	{
+		throw std::runtime_error("Model has too many indices.");
+	}
+
+	// Gather attributes into global arrays, resolve relative indices and count corners per weld shard.
+	std::vector<float> positions(positionCount * 3);
+	std::vector<float> normals(normalCount * 3);
+	std::vector<uint32_t> cornerHashes(cornerCount);
+
+	ParallelFor(chunkCount, [&](uint32_t chunkIndex)
+	{
+		ObjChunk& chunk = chunks[chunkIndex];
+
+		std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			ObjCorner& corner = chunk.corners[i];
+
+			bool valid = ResolveIndex(corner.position, corner.relativeMask, RelativePosition, chunk.positionBase, positionCount);
+			valid &= ResolveIndex(corner.texcoord, corner.relativeMask, RelativeTexcoord, chunk.texcoordBase, texcoordCount);
+			valid &= ResolveIndex(corner.normal, corner.relativeMask, RelativeNormal, chunk.normalBase, normalCount);
+			valid &= corner.position != NoAttribute;
+			chunk.hasInvalidIndex |= !valid;
+
+			if (!settings.weldOnTexcoords)
+			{
+				corner.texcoord = NoAttribute;
+			}
+
+			const uint32_t hash = HashCorner(corner);
+			cornerHashes[chunk.cornerBase + i] = hash;
+			chunk.shardCounts[GetShard(hash)]++;
+		}
+
+		// The raw chunk data is no longer needed.
+		chunk.positions = {};
+		chunk.texcoords = {};
+		chunk.normals = {};
+	}, threadCount);
+
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (chunk.hasInvalidIndex)
+		{
+			throw std::runtime_error("Model references a vertex attribute that does not exist.");
+		}
+	}
+
+	// Bucket all corners by shard, keeping file order within each shard.
+	std::array<uint64_t, WeldShardCount + 1> shardStarts = {};
+	std::vector<std::array<uint64_t, WeldShardCount>> chunkShardOffsets(chunkCount);
+	{
+		for (uint32_t shard = 0; shard < WeldShardCount; shard++)
+		{
+			uint64_t offset = shardStarts[shard];
+			for (uint32_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+			{
+				chunkShardOffsets[chunkIndex][shard] = offset;
+				offset += chunks[chunkIndex].shardCounts[shard];
+			}
+
+			shardStarts[shard + 1] = offset;
+		}
+	}
+
+	std::vector<uint32_t> shardBuckets(cornerCount);
+	ParallelFor(chunkCount, [&](uint32_t chunkIndex)
+	{
+		const ObjChunk& chunk = chunks[chunkIndex];
+		std::array<uint64_t, WeldShardCount>& offsets = chunkShardOffsets[chunkIndex];
+
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			const uint64_t cornerIndex = chunk.cornerBase + i;
+			shardBuckets[offsets[GetShard(cornerHashes[cornerIndex])]++] = (uint32_t)cornerIndex;
+		}
+	}, threadCount);
+
+	// Weld every shard with its own open addressing table.
+	std::vector<ShardVertexRef> cornerRefs(cornerCount);
+	std::array<std::vector<uint32_t>, WeldShardCount> shardFirstCorners;
+
+	auto getCorner = [&](uint32_t cornerIndex) -> const ObjCorner&
+	{
+		// Chunks are few, so a binary search over their corner bases is cheap.
+		auto it = std::upper_bound(chunks.begin(), chunks.end(), (uint64_t)cornerIndex, [](uint64_t index, const ObjChunk& chunk)
+		{
+			return index < chunk.cornerBase;
+		});
+
+		const ObjChunk& chunk = *(it - 1);
+		return chunk.corners[cornerIndex - chunk.cornerBase];
+	};
+
+	ParallelFor(WeldShardCount, [&](uint32_t shard)
+	{
+		const uint64_t bucketStart = shardStarts[shard];
+		const uint64_t bucketSize = shardStarts[shard + 1] - bucketStart;
+		if (bucketSize == 0)
+		{
+			return;
+		}
+
+		const uint64_t capacity = std::bit_ceil(bucketSize * 2);
+		const uint64_t mask = capacity - 1;
+		std::vector<WeldEntry> table(capacity, WeldEntry{ 0, 0, 0, UINT32_MAX });
+		std::vector<uint32_t>& firstCorners = shardFirstCorners[shard];
+
+		for (uint64_t i = 0; i < bucketSize; i++)
+		{
+			const uint32_t cornerIndex = shardBuckets[bucketStart + i];
+			const ObjCorner& corner = getCorner(cornerIndex);
+
+			// Linear probing. The low bits are used by the shard selection so the upper bits pick the slot.
+			uint64_t slot = (cornerHashes[cornerIndex] / WeldShardCount) & mask;
+			while (true)
+			{
+				WeldEntry& entry = table[slot];
+				if (entry.local == UINT32_MAX)
+				{
+					entry = { corner.position, corner.texcoord, corner.normal, (uint32_t)firstCorners.size() };
+					firstCorners.push_back(cornerIndex);
+					break;
+				}
+
+				if (entry.position == corner.position && entry.texcoord == corner.texcoord && entry.normal == corner.normal)
+				{
+					break;
+				}
+
+				slot = (slot + 1) & mask;
+			}
+
+			cornerRefs[cornerIndex] = { shard, table[slot].local };
+		}
+	}, threadCount);
+
+	// Number the vertices in order of first use. Each chunk first counts the vertices it introduces.
+	std::vector<uint64_t> chunkVertexCounts(chunkCount, 0);
+	ParallelFor(chunkCount, [&](uint32_t chunkIndex)
+	{
+		const ObjChunk& chunk = chunks[chunkIndex];
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			const uint32_t cornerIndex = (uint32_t)(chunk.cornerBase + i);
+			const ShardVertexRef ref = cornerRefs[cornerIndex];
+			chunkVertexCounts[chunkIndex] += shardFirstCorners[ref.shard][ref.local] == cornerIndex ? 1 : 0;
+		}
+	}, threadCount);
+
+	uint64_t vertexCount = 0;
+	for (uint32_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		chunks[chunkIndex].vertexBase = vertexCount;
+		vertexCount += chunkVertexCounts[chunkIndex];
+	}
+
+	std::array<std::vector<VertexIndex>, WeldShardCount> shardRemaps;
+	for (uint32_t shard = 0; shard < WeldShardCount; shard++)
+	{
+		shardRemaps[shard].resize(shardFirstCorners[shard].size());
+	}
+
+	mesh.vertices.resize(vertexCount);
+	mesh.indices.resize(cornerCount);
+
+	// Write the unique vertices. Every vertex is written by exactly one chunk, the one holding its first corner.
+	ParallelFor(chunkCount, [&](uint32_t chunkIndex)
+	{
+		const ObjChunk& chunk = chunks[chunkIndex];
+		uint64_t nextVertex = chunk.vertexBase;
+
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			const uint32_t cornerIndex = (uint32_t)(chunk.cornerBase + i);
+			const ShardVertexRef ref = cornerRefs[cornerIndex];
+			if (shardFirstCorners[ref.shard][ref.local] != cornerIndex)
+			{
+				continue;
+			}
+
+			const ObjCorner& corner = chunk.corners[i];
+
+			Vertex vertex = {};
+			vertex.position = {
+				positions[3 * (size_t)corner.position + 0],
+				positions[3 * (size_t)corner.position + 1],
+				positions[3 * (size_t)corner.position + 2]
+			};
+
+			if (corner.normal != NoAttribute)
+			{
+				vertex.normal = {
+					normals[3 * (size_t)corner.normal + 0],
+					normals[3 * (size_t)corner.normal + 1],
+					normals[3 * (size_t)corner.normal + 2]
+				};
+			}
+
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+
+			shardRemaps[ref.shard][ref.local] = (VertexIndex)nextVertex;
+			mesh.vertices[nextVertex++] = vertex;
+		}
+	}, threadCount);
+
+	// Write the final indices now that every unique vertex has its number.
+	ParallelFor(chunkCount, [&](uint32_t chunkIndex)
+	{
+		const ObjChunk& chunk = chunks[chunkIndex];
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			const uint64_t cornerIndex = chunk.cornerBase + i;
+			const ShardVertexRef ref = cornerRefs[cornerIndex];
+			mesh.indices[cornerIndex] = shardRemaps[ref.shard][ref.local];
+		}
+	}, threadCount);
+
+	if (stats != nullptr)
+	{
+		stats->threadCount = threadCount;
+		stats->chunkCount = chunkCount;
+		stats->cornerCount = cornerCount;
+		stats->vertexCount = vertexCount;
+		stats->parseMilliseconds = parseMilliseconds;
+		stats->weldMilliseconds = MillisecondsSince(weldStart);
+		stats->totalMilliseconds = MillisecondsSince(importStart);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "SceneTypes.h"
+
+/*
+	Multithreaded OBJ importer.
+
+	The file is memory mapped and split into line aligned chunks that are parsed in parallel. Corners are then welded into
+	unique vertices on their full (position, normal, texcoord) index tuple using open addressing hash tables. The tables are
+	sharded by hash so that every shard can be welded by a different thread. Vertices are numbered in order of their first use,
+	which makes the output identical to a single threaded import no matter how many threads are used.
+
+	Only the geometry is imported. Polygons with more than three corners are triangulated as fans.
+*/
+
+struct ObjImportSettings
+{
+	// Number of threads to use. Zero means one thread per core.
+	uint32_t threadCount = 0;
+	// How many chunks each thread gets on average. More chunks balance better but cost more bookkeeping.
+	uint32_t chunksPerThread = 4;
+	// Splits vertices that only differ by texture coordinate. Vertex has no texture coordinate yet,
+	// so turning this off avoids duplicate vertices on UV seams.
+	bool weldOnTexcoords = true;
+};
+
+struct ObjImportStats
+{
+	uint32_t threadCount = 0;
+	uint32_t chunkCount = 0;
+	uint64_t cornerCount = 0;
+	uint64_t vertexCount = 0;
+
+	double parseMilliseconds = 0.0;
+	double weldMilliseconds = 0.0;
+	double totalMilliseconds = 0.0;
+};
+
+// Imports the OBJ file at the given path. Throws a runtime error if the file can't be read or references attributes that don't exist.
+void ImportOBJ(const std::string& objPath, MeshData& mesh, const ObjImportSettings& settings = {}, ObjImportStats* stats = nullptr);
+
+// Same as ImportOBJ() but reads from an OBJ that is already in memory.
+void ImportOBJFromMemory(const char* data, size_t size, MeshData& mesh, const ObjImportSettings& settings = {}, ObjImportStats* stats = nullptr);
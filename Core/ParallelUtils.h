@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Returns the number of worker threads to use when no specific count is requested.
+inline uint32_t GetDefaultThreadCount()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs task(index) for every index in [0, taskCount) spread over up to threadCount threads (0 means all cores).
+// Tasks are handed out one by one through an atomic counter, so uneven task sizes balance themselves.
+// The calling thread takes part in the work and the function returns when every task is done.
+template <typename Task>
+void ParallelFor(uint32_t taskCount, const Task& task, uint32_t threadCount = 0)
+{
+	if (threadCount == 0)
+	{
+		threadCount = GetDefaultThreadCount();
+	}
+	threadCount = std::min(threadCount, taskCount);
+
+	if (threadCount <= 1)
+	{
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			task(i);
+		}
+
+		return;
+	}
+
+	std::atomic<uint32_t> nextTask = 0;
+	auto worker = [&]()
+	{
+		for (uint32_t i = nextTask.fetch_add(1); i < taskCount; i = nextTask.fetch_add(1))
+		{
+			task(i);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (uint32_t i = 0; i < threadCount - 1; i++)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
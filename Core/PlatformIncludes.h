@@ -0,0 +1,91 @@
+#pragma once
+
+/*
+	Platform neutral includes for the code that is shared between the renderer and the headless core library (RTAOCore).
+	On Windows the regular Windows SDK and DirectXMath headers are used. On any other platform the WSL stubs
+	from DirectX-Headers are used together with the plain DirectXMath storage types declared below.
+
+	NOTE: Code that is part of RTAOCore may only use the storage types (XMFLOAT3, XMFLOAT4X4, etc.) and not the
+	SIMD types (XMVECTOR, XMMATRIX). DirectXMath itself is portable, but this tree only gets it from the Windows SDK and
+	doesn't vendor it, so the non-Windows build has nothing but the storage types below.
+*/
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <DirectXMath.h>
+#else
+#include <wsl/winadapter.h>
+#endif
+
+#include "directx/d3d12.h"
+#include "directx/dxgiformat.h"
+
+#if !defined(_WIN32)
+namespace DirectX
+{
+	// Storage types that mirror the layout of the ones found in DirectXMath.
+
+	struct XMFLOAT2
+	{
+		float x;
+		float y;
+
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMFLOAT3X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+			};
+			float m[3][4];
+		};
+
+		XMFLOAT3X4() = default;
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
+		XMFLOAT4X4() = default;
+	};
+}
+#endif
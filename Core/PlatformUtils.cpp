@@ -0,0 +1,161 @@
+#include "PlatformUtils.h"
+
+#include <cstdio>
+#include <utility>
+
+#include "PlatformIncludes.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void OutputDebugMessage(const std::string& message)
+{
+#if defined(_WIN32)
+	OutputDebugStringA(message.c_str());
+#else
+	fputs(message.c_str(), stderr);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+		std::swap(m_fileHandle, other.m_fileHandle);
+		std::swap(m_mappingHandle, other.m_mappingHandle);
+#else
+		std::swap(m_fileDescriptor, other.m_fileDescriptor);
+#endif
+	}
+
+	return *this;
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_fileHandle = fileHandle;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+	m_mappingHandle = mappingHandle;
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	m_size = (uint64_t)fileSize.QuadPart;
+#else
+	m_fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (m_fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStats = {};
+	if (fstat(m_fileDescriptor, &fileStats) != 0 || fileStats.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, (size_t)fileStats.st_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	m_data = mapping == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapping);
+	m_size = (uint64_t)fileStats.st_size;
+#endif
+
+	if (m_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mappingHandle != nullptr)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+
+	if (m_fileHandle != nullptr)
+	{
+		CloseHandle(m_fileHandle);
+	}
+
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(m_data), (size_t)m_size);
+	}
+
+	if (m_fileDescriptor >= 0)
+	{
+		close(m_fileDescriptor);
+	}
+
+	m_fileDescriptor = -1;
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return m_data != nullptr;
+}
+
+const uint8_t* MappedFile::Data() const
+{
+	return m_data;
+}
+
+uint64_t MappedFile::Size() const
+{
+	return m_size;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Writes a message to the debugger output on Windows and to stderr on every other platform.
+void OutputDebugMessage(const std::string& message);
+
+// Read only memory mapping of a whole file. The mapping is released when the object is destroyed.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Maps the file at the given path. Returns false if the file could not be opened or mapped.
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const;
+	const uint8_t* Data() const;
+	uint64_t Size() const;
+
+private:
+	const uint8_t* m_data = nullptr;
+	uint64_t m_size = 0;
+
+#if defined(_WIN32)
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#else
+	int m_fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,313 @@
+#include "RTAOReference.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include "MathUtils.h"
+#include "ParallelUtils.h"
+
+namespace
+{
+	// Rows per task when tracing in parallel.
+	constexpr uint32_t RowsPerTask = 4u;
+}
+
+uint32_t RTAOInitRand(uint32_t val0, uint32_t val1, uint32_t backoff)
+{
+	uint32_t v0 = val0, v1 = val1, s0 = 0;
+
+	for (uint32_t n = 0; n < backoff; n++)
+	{
+		s0 += 0x9e3779b9;
+		v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+		v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+	}
+
+	return v0;
+}
+
+float RTAONextRand(uint32_t& seed)
+{
+	seed = (1664525u * seed + 1013904223u);
+	return float(seed & 0x00FFFFFF) / float(0x01000000);
+}
+
+DirectX::XMFLOAT3 RTAOGetPerpendicularVector(const DirectX::XMFLOAT3& u)
+{
+	const DirectX::XMFLOAT3 a = { std::abs(u.x), std::abs(u.y), std::abs(u.z) };
+	const uint32_t xm = ((a.x - a.y) < 0 && (a.x - a.z) < 0) ? 1 : 0;
+	const uint32_t ym = (a.y - a.z) < 0 ? (1 ^ xm) : 0;
+	const uint32_t zm = 1 ^ (xm | ym);
+	return MathUtils::Cross(u, { (float)xm, (float)ym, (float)zm });
+}
+
+DirectX::XMFLOAT3 RTAOGetCosHemisphereSample(uint32_t& seed, const DirectX::XMFLOAT3& hitNormal)
+{
+	using namespace MathUtils;
+
+	// The two random numbers are drawn in the same order as the float2 constructor in the shader.
+	const float randX = RTAONextRand(seed);
+	const float randY = RTAONextRand(seed);
+
+	const DirectX::XMFLOAT3 bitangent = RTAOGetPerpendicularVector(hitNormal);
+	const DirectX::XMFLOAT3 tangent = Cross(bitangent, hitNormal);
+	const float r = std::sqrt(randX);
+	const float phi = 2.0f * 3.14159265f * randY;
+
+	return Add(Add(Scale(tangent, r * std::cos(phi)), Scale(bitangent, r * std::sin(phi))), Scale(hitNormal, std::sqrt(1 - randX)));
+}
+
+RTAOGBuffer CreateSyntheticGBuffer(const RaytracingScene& scene, uint32_t width, uint32_t height, const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, float verticalFov)
+{
+	using namespace MathUtils;
+
+	RTAOGBuffer gBuffer;
+	gBuffer.width = width;
+	gBuffer.height = height;
+	gBuffer.positions.assign((size_t)width * height, { 0.0f, 0.0f, 0.0f, 0.0f });
+	gBuffer.normals.assign((size_t)width * height, { 0.0f, 0.0f, 0.0f, 0.0f });
+
+	// Left handed look at basis, the same handedness as the renderer's camera.
+	const DirectX::XMFLOAT3 forward = Normalize(Subtract(target, eye));
+	const DirectX::XMFLOAT3 right = Normalize(Cross({ 0.0f, 1.0f, 0.0f }, forward));
+	const DirectX::XMFLOAT3 up = Cross(forward, right);
+
+	const float tanHalfFov = std::tan(verticalFov * 0.5f);
+	const float aspectRatio = (float)width / (float)height;
+
+	ParallelFor((height + RowsPerTask - 1) / RowsPerTask, [&](uint32_t task)
+	{
+		const uint32_t endY = std::min((task + 1) * RowsPerTask, height);
+		for (uint32_t y = task * RowsPerTask; y < endY; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const float ndcX = (2.0f * (x + 0.5f) / width - 1.0f) * tanHalfFov * aspectRatio;
+				const float ndcY = (1.0f - 2.0f * (y + 0.5f) / height) * tanHalfFov;
+
+				BVHRay ray;
+				ray.origin = eye;
+				ray.direction = Normalize(Add(forward, Add(Scale(right, ndcX), Scale(up, ndcY))));
+				ray.tMin = 0.0f;
+				ray.tMax = std::numeric_limits<float>::infinity();
+
+				RaytracingHit hit;
+				if (scene.IntersectClosest(ray, hit))
+				{
+					const DirectX::XMFLOAT3 position = Add(ray.origin, Scale(ray.direction, hit.t));
+					const size_t pixel = (size_t)y * width + x;
+					gBuffer.positions[pixel] = { position.x, position.y, position.z, 1.0f };
+					gBuffer.normals[pixel] = { hit.worldNormal.x, hit.worldNormal.y, hit.worldNormal.z, 0.0f };
+				}
+			}
+		}
+	});
+
+	return gBuffer;
+}
+
+RTAOStats TraceAmbientOcclusion(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, uint32_t frameCount, std::vector<float>& ao, const RTAOTraceSettings& settings)
+{
+	using namespace MathUtils;
+
+	const auto traceStart = std::chrono::steady_clock::now();
+
+	RTAOStats stats;
+	stats.threadCount = settings.threadCount == 0 ? GetDefaultThreadCount() : settings.threadCount;
+
+	const uint32_t width = gBuffer.width;
+	const uint32_t height = gBuffer.height;
+	const uint32_t samplesPerPixel = std::max(settings.samplesPerPixel, 1u);
+	const uint32_t taskCount = (height + RowsPerTask - 1) / RowsPerTask;
+
+	const bool hasSampleCounts = !settings.sampleCounts.empty();
+	if (hasSampleCounts)
+	{
+		if (settings.sampleCounts.size() != (size_t)width * height || ao.size() != (size_t)width * height)
+		{
+			throw std::runtime_error("The sample counts and the AO have to match the size of the G-buffer.");
+		}
+	}
+	else
+	{
+		ao.assign((size_t)width * height, 1.0f);
+	}
+
+	auto getSampleCount = [&](size_t pixel)
+	{
+		return hasSampleCounts ? (uint32_t)settings.sampleCounts[pixel] : samplesPerPixel;
+	};
+	std::vector<uint64_t> taskRayCounts(taskCount, 0);
+
+	ParallelFor(taskCount, [&](uint32_t task)
+	{
+		// Packets are filled with the samples of neighboring pixels in the order the shader would trace them.
+		BVHRayPacket packet;
+		size_t packetPixels[BVHPacketSize];
+		uint32_t packetSize = 0;
+
+		auto tracePacket = [&]()
+		{
+			const uint32_t hitMask = scene.IntersectAnyPacket(packet, (1u << packetSize) - 1u);
+			for (uint32_t lane = 0; lane < packetSize; lane++)
+			{
+				ao[packetPixels[lane]] += (hitMask & (1u << lane)) ? 0.0f : RTAOIsIlluminatedValue;
+			}
+			packetSize = 0;
+		};
+
+		const uint32_t startY = task * RowsPerTask;
+		const uint32_t endY = std::min(startY + RowsPerTask, height);
+		for (uint32_t y = startY; y < endY; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const size_t pixel = (size_t)y * width + x;
+				uint32_t randSeed = RTAOInitRand(x + y * width, frameCount);
+
+				const DirectX::XMFLOAT4& worldPos = gBuffer.positions[pixel];
+				const DirectX::XMFLOAT3 worldNormal = { gBuffer.normals[pixel].x, gBuffer.normals[pixel].y, gBuffer.normals[pixel].z };
+
+				if (worldPos.w == 0.0f)
+				{
+					ao[pixel] = RTAOIsIlluminatedValue;
+					continue;
+				}
+
+				const uint32_t pixelSampleCount = getSampleCount(pixel);
+				if (pixelSampleCount == 0)
+				{
+					continue;
+				}
+
+				// The AO value is accumulated in place and divided by the sample count once the rows are done.
+				ao[pixel] = 0.0f;
+				for (uint32_t i = 0; i < pixelSampleCount; i++)
+				{
+					const DirectX::XMFLOAT3 worldDir = RTAOGetCosHemisphereSample(randSeed, worldNormal);
+
+					BVHRay rayAO;
+					rayAO.origin = Add({ worldPos.x, worldPos.y, worldPos.z }, Scale(worldNormal, RTAONormalOffset));
+					rayAO.tMin = RTAOMinT;
+					rayAO.direction = worldDir;
+					rayAO.tMax = RTAORadius;
+
+					// The geometry is opaque and the closest hit shader is skipped, so a hit leaves the payload at zero.
+					switch (settings.mode)
+					{
+					case RTAOTraceMode::SingleRay:
+						ao[pixel] += scene.IntersectAny(rayAO) ? 0.0f : RTAOIsIlluminatedValue;
+						break;
+					case RTAOTraceMode::WideSingleRay:
+						ao[pixel] += scene.IntersectAnyWide(rayAO) ? 0.0f : RTAOIsIlluminatedValue;
+						break;
+					default:
+						packet.SetRay(packetSize, rayAO);
+						packetPixels[packetSize++] = pixel;
+						if (packetSize == BVHPacketSize)
+						{
+							tracePacket();
+						}
+						break;
+					}
+				}
+
+				taskRayCounts[task] += pixelSampleCount;
+			}
+		}
+
+		if (packetSize > 0)
+		{
+			tracePacket();
+		}
+
+		for (size_t pixel = (size_t)startY * width; pixel < (size_t)endY * width; pixel++)
+		{
+			const uint32_t pixelSampleCount = getSampleCount(pixel);
+			if (gBuffer.positions[pixel].w != 0.0f && pixelSampleCount > 0)
+			{
+				ao[pixel] /= (float)pixelSampleCount;
+			}
+		}
+	}, stats.threadCount);
+
+	for (uint64_t rayCount : taskRayCounts)
+	{
+		stats.rayCount += rayCount;
+	}
+
+	stats.traceMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - traceStart).count();
+	stats.raysPerSecond = stats.traceMilliseconds > 0.0 ? stats.rayCount / (stats.traceMilliseconds / 1000.0) : 0.0;
+
+	return stats;
+}
+
+std::vector<RTAOBenchmarkResult> BenchmarkAmbientOcclusion(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, std::span<const uint32_t> samplesPerPixel, uint32_t threadCount)
+{
+	std::vector<RTAOBenchmarkResult> results;
+	std::vector<float> referenceAO;
+	std::vector<float> ao;
+
+	for (uint32_t sampleCount : samplesPerPixel)
+	{
+		for (uint32_t mode = 0; mode < (uint32_t)RTAOTraceMode::Count; mode++)
+		{
+			RTAOTraceSettings settings;
+			settings.mode = (RTAOTraceMode)mode;
+			settings.samplesPerPixel = sampleCount;
+			settings.threadCount = threadCount;
+
+			// SingleRay is the first mode, so its result is the reference for the other ones.
+			std::vector<float>& result = settings.mode == RTAOTraceMode::SingleRay ? referenceAO : ao;
+
+			RTAOBenchmarkResult benchmarkResult;
+			benchmarkResult.mode = settings.mode;
+			benchmarkResult.samplesPerPixel = sampleCount;
+			benchmarkResult.stats = TraceAmbientOcclusion(scene, gBuffer, 0, result, settings);
+			benchmarkResult.mismatchedPixelCount = 0;
+			for (size_t pixel = 0; pixel < result.size(); pixel++)
+			{
+				benchmarkResult.mismatchedPixelCount += result[pixel] != referenceAO[pixel] ? 1 : 0;
+			}
+
+			results.push_back(benchmarkResult);
+		}
+	}
+
+	return results;
+}
+
+const char* GetRTAOTraceModeName(RTAOTraceMode mode)
+{
+	switch (mode)
+	{
+	case RTAOTraceMode::SingleRay:
+		return "SingleRay";
+	case RTAOTraceMode::WideSingleRay:
+		return "WideSingleRay";
+	case RTAOTraceMode::Packet:
+		return "Packet";
+	default:
+		return "Unknown";
+	}
+}
+
+bool WriteAOImage(const std::string& path, uint32_t width, uint32_t height, std::span<const float> ao)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	// A negative scale marks little endian data. PFM rows are stored bottom to top.
+	file << "Pf\n" << width << " " << height << "\n-1.0\n";
+	for (uint32_t y = height; y > 0; y--)
+	{
+		file.write(reinterpret_cast<const char*>(ao.data() + (size_t)(y - 1) * width), sizeof(float) * width);
+	}
+
+	return (bool)file;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "PlatformIncludes.h"
+#include "RaytracingScene.h"
+
+/*
+	CPU reference of the raygen shader in shaders/RTAOShader.hlsl.
+
+	The random number generator, hemisphere sampling, ray offsets and constants are copied from the shader, so for the
+	same G-buffer and frame count every pixel shoots exactly the same rays as on the GPU. Rays are traced against a
+	RaytracingScene built from the same geometry and instances as the top level acceleration structure. This makes it
+	possible to produce ground truth AO images and measure ray throughput without a GPU.
+*/
+
+// Constants from RTAOShader.hlsl. Keep them in sync with the shader.
+constexpr float RTAOIsIlluminatedValue = 1.0f;
+constexpr float RTAOMinT = 0.0001f;
+constexpr float RTAORadius = 100000.0f;
+constexpr uint32_t RTAONumSamples = 1u;
+constexpr float RTAONormalOffset = 0.0000001f;
+
+// Same as initRand() in the shader.
+uint32_t RTAOInitRand(uint32_t val0, uint32_t val1, uint32_t backoff = 16);
+// Same as nextRand() in the shader.
+float RTAONextRand(uint32_t& seed);
+// Same as getPerpendicularVector() in the shader.
+DirectX::XMFLOAT3 RTAOGetPerpendicularVector(const DirectX::XMFLOAT3& u);
+// Same as getCosHemisphereSample() in the shader.
+DirectX::XMFLOAT3 RTAOGetCosHemisphereSample(uint32_t& seed, const DirectX::XMFLOAT3& hitNormal);
+
+// The G-buffer channels read by the raygen shader. Pixels with a position w of zero are background.
+struct RTAOGBuffer
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<DirectX::XMFLOAT4> positions;
+	std::vector<DirectX::XMFLOAT4> normals;
+};
+
+enum class RTAOTraceMode
+{
+	// One ray at a time through the binary BVHs.
+	SingleRay,
+	// One ray at a time through the wide BVHs, testing all children of a node with one SIMD instruction.
+	WideSingleRay,
+	// Packets of BVHPacketSize rays through the wide BVHs, with the rays in the SIMD lanes.
+	Packet,
+	Count
+};
+
+struct RTAOTraceSettings
+{
+	RTAOTraceMode mode = RTAOTraceMode::SingleRay;
+	// NUM_SAMPLES in the shader.
+	uint32_t samplesPerPixel = RTAONumSamples;
+	// Sample count of every pixel in place of samplesPerPixel, like the sample count texture of the adaptive sampling pass.
+	// Pixels without samples keep the AO that is already in the output. See AdaptiveSampling.h.
+	std::span<const uint8_t> sampleCounts;
+	// Number of threads to use. Zero means one thread per core.
+	uint32_t threadCount = 0;
+};
+
+struct RTAOStats
+{
+	uint32_t threadCount = 0;
+	uint64_t rayCount = 0;
+	double traceMilliseconds = 0.0;
+	double raysPerSecond = 0.0;
+};
+
+// Renders a G-buffer of the scene by casting primary rays from a pinhole camera, using geometric normals.
+RTAOGBuffer CreateSyntheticGBuffer(const RaytracingScene& scene, uint32_t width, uint32_t height, const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, float verticalFov);
+
+// Runs the raygen shader for every pixel and writes the AO value of each pixel. The GPU writes this value to the AO texture.
+// Every trace mode returns the same values, they only differ in speed.
+RTAOStats TraceAmbientOcclusion(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, uint32_t frameCount, std::vector<float>& ao, const RTAOTraceSettings& settings = {});
+
+struct RTAOBenchmarkResult
+{
+	RTAOTraceMode mode;
+	uint32_t samplesPerPixel;
+	RTAOStats stats;
+	// Pixels whose AO value differs from the SingleRay result with the same sample count.
+	uint32_t mismatchedPixelCount;
+};
+
+// Traces the G-buffer with every trace mode for each of the sample counts and reports the ray throughput of each run.
+std::vector<RTAOBenchmarkResult> BenchmarkAmbientOcclusion(const RaytracingScene& scene, const RTAOGBuffer& gBuffer, std::span<const uint32_t> samplesPerPixel, uint32_t threadCount = 0);
+
+const char* GetRTAOTraceModeName(RTAOTraceMode mode);
+
+// Writes a single channel float image as a PFM file, which keeps ground truth images lossless.
+bool WriteAOImage(const std::string& path, uint32_t width, uint32_t height, std::span<const float> ao);
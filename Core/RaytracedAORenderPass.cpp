@@ -7,6 +7,22 @@ RaytracedAORenderPass::RaytracedAORenderPass(ComPtr<ID3D12Device5> device, ComPt
 	m_renderableObjects.push_back(RTRenderObjectID);
 }
 
+void RaytracedAORenderPass::DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const
+{
+	for (UINT i = 0; i < GBufferIDCount; i++)
+	{
+		frameGraph.Read(graphPass, FrameGraphGBufferDiffuse + i, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	}
+
+	// The full resolution mode writes the AO texture, the others the trace texture.
+	frameGraph.Write(graphPass, FrameGraphAOTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	frameGraph.Write(graphPass, FrameGraphAOTraceTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// Only read, but through an unordered access view.
+	frameGraph.Write(graphPass, FrameGraphSampleCountTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// The top level acceleration structure is built or refit by the pass itself, when it changed.
+	frameGraph.Write(graphPass, FrameGraphTopLevelAS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+}
+
 void RaytracedAORenderPass::BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs)
 {
 	assert(pipelineArgs != nullptr);
@@ -18,9 +34,12 @@ void RaytracedAORenderPass::BuildRenderPass(const std::vector<RenderPackage>& re
 	std::array<ID3D12DescriptorHeap*, 1> descriptorHeaps = { args.commonRTArgs.cbvSrvUavHeap.Get() };
 	commandList->SetDescriptorHeaps((UINT)descriptorHeaps.size(), descriptorHeaps.data());
 
+	// One ray generation thread per traced pixel.
+	const AOTraceSize traceSize = GetAOTraceSize(args.resolutionMode, args.screenWidth, args.screenHeight);
+
 	D3D12_DISPATCH_RAYS_DESC raytraceDesc = {};
-	raytraceDesc.Width = args.screenWidth;
-	raytraceDesc.Height = args.screenHeight;
+	raytraceDesc.Width = traceSize.width;
+	raytraceDesc.Height = traceSize.height;
 	raytraceDesc.Depth = 1;
 
 	//set shader tables
@@ -45,43 +64,69 @@ void RaytracedAORenderPass::BuildRenderPass(const std::vector<RenderPackage>& re
 
 	// Bind the empty root signature
 	commandList->SetComputeRootSignature(args.commonRTArgs.globalRootSig.Get());
-	commandList->SetComputeRoot32BitConstant(
-		RTShaderRegisters::ConstantRegistersGlobal::ConstantRegister,
-		args.frameCount,
+	const RaytracedAOConstants constants = {
+		.frameCount = args.frameCount,
+		.resolutionMode = (UINT)args.resolutionMode,
+		.screenWidth = args.screenWidth,
+		.screenHeight = args.screenHeight,
+		.adaptiveSampling = args.isAdaptiveSamplingEnabled ? 1u : 0u
+	};
+	commandList->SetComputeRoot32BitConstants(
+		RTGlobalParameterIdx::Global32BitConstantIdx,
+		sizeof(RaytracedAOConstants) / 4,
+		&constants,
 		0
 	);
 
-	std::vector<CD3DX12_RESOURCE_BARRIER> barriers = {};
+	// The builds only wait for the frame graph barriers. Their UAV barriers are queued after the last build, so they don't
+	// serialize the builds.
+	std::vector<ID3D12Resource*> builtStructures;
 	for (const RayTracingRenderPackage& rtRenderPackage : args.renderPackages)
 	{
+		// The TLAS of this frame already matches the instances.
+		if (rtRenderPackage.buildType == TopLevelBuildType::Skip)
+		{
+			continue;
+		}
+
 		// TODO: Make this input shared between the initial creation and now.
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS rtInputs = {};
 		rtInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-		rtInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+		rtInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
 		rtInputs.NumDescs = rtRenderPackage.instanceCount;
 		rtInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 
 		DX12Abstractions::AccelerationStructureBuffers* topAccStruct = rtRenderPackage.topLevelASBuffers;
+		const D3D12_GPU_VIRTUAL_ADDRESS resultAddress = topAccStruct->result.resource->GetGPUVirtualAddress();
 
-		// Create the TLAS
+		// Build the TLAS, or refit it in place when only the transforms changed since it was last built.
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC asDesc = {};
 		asDesc.Inputs = rtInputs;
-		asDesc.Inputs.InstanceDescs = topAccStruct->instanceDesc.resource->GetGPUVirtualAddress();
-		asDesc.DestAccelerationStructureData = topAccStruct->result.resource->GetGPUVirtualAddress();
+		asDesc.Inputs.InstanceDescs = topAccStruct->instanceDescs;
+		asDesc.DestAccelerationStructureData = resultAddress;
 		asDesc.ScratchAccelerationStructureData = topAccStruct->scratch.resource->GetGPUVirtualAddress();
+		if (rtRenderPackage.buildType == TopLevelBuildType::Update)
+		{
+			asDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+			asDesc.SourceAccelerationStructureData = resultAddress;
+		}
 
+		FlushBarriers(context, frameIndex);
 		commandList->BuildRaytracingAccelerationStructure(&asDesc, 0, nullptr);
 
-		// UAV barrier needed before using the acceleration structures in a ray tracing operation
-		CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(topAccStruct->result.Get());
-		barriers.push_back(uavBarrier);
+		builtStructures.push_back(topAccStruct->result.Get());
 	}
 
-	// Put UAV barriers for all the acceleration structures
-	commandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	// UAV barrier needed before using the acceleration structures in a ray tracing operation
+	BarrierBatcher& barrierBatcher = GetBarrierBatcher(context, frameIndex);
+	for (ID3D12Resource* builtStructure : builtStructures)
+	{
+		barrierBatcher.UAV(builtStructure);
+	}
 
-	// Dispatch
+	// Dispatch. The UAV barriers of all the acceleration structures are flushed as one batch.
 	commandList->SetPipelineState1(args.stateObject.Get());
+	FlushBarriers(context, frameIndex);
 	commandList->DispatchRays(&raytraceDesc);
 }
 
@@ -2,12 +2,26 @@
 
 #include "DX12RenderPass.h"
 
+// Global root constants of shaders/RTAOShader.hlsl.
+struct RaytracedAOConstants
+{
+	UINT frameCount;
+	// AOResolutionMode, which picks the pixels that are traced.
+	UINT resolutionMode;
+	UINT screenWidth;
+	UINT screenHeight;
+	// Nonzero to trace the sample counts of the adaptive sampling pass.
+	UINT adaptiveSampling;
+};
+static_assert(sizeof(RaytracedAOConstants) == 5 * sizeof(UINT), "RaytracedAOConstants has to match the global root constants of the ray tracing shaders.");
+
 class RaytracedAORenderPass : public DX12RenderPass
 {
 public:
 	RaytracedAORenderPass(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSig);
 
 	void BuildRenderPass(const std::vector<RenderPackage>& renderPackages, UINT context, UINT frameIndex, RenderPassArgs* pipelineArgs) override final;
+	void DeclareResourceAccesses(FrameGraph& frameGraph, uint32_t graphPass, bool isLastRenderPass) const override final;
 
 protected:
 	void PerRenderObject(const RenderObject& renderObject, RenderPassArgs* pipelineArgs, UINT context, UINT frameIndex) override final;
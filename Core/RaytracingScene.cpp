@@ -0,0 +1,194 @@
+#include "RaytracingScene.h"
+
+#include <algorithm>
+
+#include "MathUtils.h"
+
+namespace
+{
+	BVHRay ToObjectSpace(const BVHRay& worldRay, const DirectX::XMFLOAT4X4& worldToObject)
+	{
+		// The direction isn't normalized, which keeps the hit distances the same in both spaces.
+		BVHRay objectRay = worldRay;
+		objectRay.origin = MathUtils::TransformPoint(worldRay.origin, worldToObject);
+		objectRay.direction = MathUtils::TransformVector(worldRay.direction, worldToObject);
+		return objectRay;
+	}
+
+	BVHRayPacket ToObjectSpace(const BVHRayPacket& worldPacket, const DirectX::XMFLOAT4X4& m)
+	{
+		using Simd = SimdFloat<BVHPacketSize>;
+
+		// Same math as TransformPoint() and TransformVector(), for all lanes at once.
+		const Simd originX = Simd::Load(worldPacket.originX);
+		const Simd originY = Simd::Load(worldPacket.originY);
+		const Simd originZ = Simd::Load(worldPacket.originZ);
+		const Simd directionX = Simd::Load(worldPacket.directionX);
+		const Simd directionY = Simd::Load(worldPacket.directionY);
+		const Simd directionZ = Simd::Load(worldPacket.directionZ);
+
+		BVHRayPacket objectPacket = worldPacket;
+		(originX * Simd::Broadcast(m._11) + originY * Simd::Broadcast(m._21) + originZ * Simd::Broadcast(m._31) + Simd::Broadcast(m._41)).Store(objectPacket.originX);
+		(originX * Simd::Broadcast(m._12) + originY * Simd::Broadcast(m._22) + originZ * Simd::Broadcast(m._32) + Simd::Broadcast(m._42)).Store(objectPacket.originY);
+		(originX * Simd::Broadcast(m._13) + originY * Simd::Broadcast(m._23) + originZ * Simd::Broadcast(m._33) + Simd::Broadcast(m._43)).Store(objectPacket.originZ);
+		(directionX * Simd::Broadcast(m._11) + directionY * Simd::Broadcast(m._21) + directionZ * Simd::Broadcast(m._31)).Store(objectPacket.directionX);
+		(directionX * Simd::Broadcast(m._12) + directionY * Simd::Broadcast(m._22) + directionZ * Simd::Broadcast(m._32)).Store(objectPacket.directionY);
+		(directionX * Simd::Broadcast(m._13) + directionY * Simd::Broadcast(m._23) + directionZ * Simd::Broadcast(m._33)).Store(objectPacket.directionZ);
+		return objectPacket;
+	}
+
+	BoundingBox TransformBounds(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, const DirectX::XMFLOAT4X4& matrix)
+	{
+		BoundingBox bounds = {};
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			const DirectX::XMFLOAT3 point = MathUtils::TransformPoint({
+				(corner & 1) ? boundsMax.x : boundsMin.x,
+				(corner & 2) ? boundsMax.y : boundsMin.y,
+				(corner & 4) ? boundsMax.z : boundsMin.z
+			}, matrix);
+
+			if (corner == 0)
+			{
+				bounds.min = point;
+				bounds.max = point;
+			}
+			else
+			{
+				bounds.min = { std::min(bounds.min.x, point.x), std::min(bounds.min.y, point.y), std::min(bounds.min.z, point.z) };
+				bounds.max = { std::max(bounds.max.x, point.x), std::max(bounds.max.y, point.y), std::max(bounds.max.z, point.z) };
+			}
+		}
+
+		return bounds;
+	}
+}
+
+void RaytracingScene::Build(const BVHGeometryDesc& geometryDesc, const std::vector<RenderInstance>& renderInstances, const BVHBuildSettings& settings)
+{
+	m_bottomLevel.Build(geometryDesc, settings);
+
+	m_instances.clear();
+	std::vector<BoundingBox> instanceBounds;
+
+	if (!m_bottomLevel.GetNodes().empty())
+	{
+		const BVHNode& root = m_bottomLevel.GetNodes()[0];
+		for (const RenderInstance& renderInstance : renderInstances)
+		{
+			const DirectX::XMFLOAT4X4& objectToWorld = renderInstance.instanceData.modelMatrix;
+			m_instances.push_back({ MathUtils::InverseAffine4x4(objectToWorld) });
+			instanceBounds.push_back(TransformBounds(root.boundsMin, root.boundsMax, objectToWorld));
+		}
+	}
+
+	// Instances are large compared to triangles, so the top level uses single instance leaves.
+	BVHBuildSettings topLevelSettings = settings;
+	topLevelSettings.maxLeafSize = 1;
+	m_topLevel.BuildFromBounds(instanceBounds, topLevelSettings);
+
+	m_wideBottomLevel.Build(m_bottomLevel);
+	m_wideTopLevel.Build(m_topLevel);
+}
+
+bool RaytracingScene::IntersectAny(const BVHRay& worldRay) const
+{
+	std::span<const uint32_t> instanceIndices = m_topLevel.GetPrimitiveIndices();
+
+	bool isHit = false;
+	m_topLevel.Traverse(worldRay, [&](uint32_t leafPrimitive, float& tMax)
+	{
+		BVHRay objectRay = ToObjectSpace(worldRay, m_instances[instanceIndices[leafPrimitive]].worldToObject);
+		objectRay.tMax = tMax;
+
+		isHit = m_bottomLevel.IntersectAny(objectRay);
+		return isHit;
+	});
+
+	return isHit;
+}
+
+bool RaytracingScene::IntersectClosest(const BVHRay& worldRay, RaytracingHit& hit) const
+{
+	using namespace MathUtils;
+
+	std::span<const uint32_t> instanceIndices = m_topLevel.GetPrimitiveIndices();
+
+	bool isHit = false;
+	BVHHit bottomLevelHit = {};
+	m_topLevel.Traverse(worldRay, [&](uint32_t leafPrimitive, float& tMax)
+	{
+		const uint32_t instanceIndex = instanceIndices[leafPrimitive];
+
+		BVHRay objectRay = ToObjectSpace(worldRay, m_instances[instanceIndex].worldToObject);
+		objectRay.tMax = tMax;
+
+		if (m_bottomLevel.IntersectClosest(objectRay, bottomLevelHit))
+		{
+			tMax = bottomLevelHit.t;
+
+			hit.t = bottomLevelHit.t;
+			hit.instanceIndex = instanceIndex;
+			hit.primitiveIndex = bottomLevelHit.primitiveIndex;
+
+			// Normals transform with the inverse transpose.
+			const BVHTriangle& triangle = m_bottomLevel.GetTriangles()[bottomLevelHit.leafPrimitive];
+			const DirectX::XMFLOAT3 objectNormal = Cross(Subtract(triangle.v1, triangle.v0), Subtract(triangle.v2, triangle.v0));
+			const DirectX::XMFLOAT4X4& m = m_instances[instanceIndex].worldToObject;
+			hit.worldNormal = {
+				objectNormal.x * m._11 + objectNormal.y * m._12 + objectNormal.z * m._13,
+				objectNormal.x * m._21 + objectNormal.y * m._22 + objectNormal.z * m._23,
+				objectNormal.x * m._31 + objectNormal.y * m._32 + objectNormal.z * m._33
+			};
+
+			isHit = true;
+		}
+
+		return false;
+	});
+
+	if (isHit)
+	{
+		hit.worldNormal = Normalize(hit.worldNormal);
+		if (Dot(hit.worldNormal, worldRay.direction) > 0.0f)
+		{
+			hit.worldNormal = Scale(hit.worldNormal, -1.0f);
+		}
+	}
+
+	return isHit;
+}
+
+bool RaytracingScene::IntersectAnyWide(const BVHRay& worldRay) const
+{
+	std::span<const uint32_t> instanceIndices = m_wideTopLevel.GetPrimitiveIndices();
+
+	bool isHit = false;
+	m_wideTopLevel.Traverse(worldRay, [&](uint32_t leafPrimitive)
+	{
+		isHit = m_wideBottomLevel.IntersectAny(ToObjectSpace(worldRay, m_instances[instanceIndices[leafPrimitive]].worldToObject));
+		return isHit;
+	});
+
+	return isHit;
+}
+
+uint32_t RaytracingScene::IntersectAnyPacket(const BVHRayPacket& worldPacket, uint32_t activeMask) const
+{
+	std::span<const uint32_t> instanceIndices = m_wideTopLevel.GetPrimitiveIndices();
+
+	return m_wideTopLevel.TraversePacket(worldPacket, activeMask, [&](uint32_t leafPrimitive, uint32_t rayMask)
+	{
+		return m_wideBottomLevel.IntersectAnyPacket(ToObjectSpace(worldPacket, m_instances[instanceIndices[leafPrimitive]].worldToObject), rayMask);
+	});
+}
+
+const BVH& RaytracingScene::GetBottomLevel() const
+{
+	return m_bottomLevel;
+}
+
+const BVH& RaytracingScene::GetTopLevel() const
+{
+	return m_topLevel;
+}
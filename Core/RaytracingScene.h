@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "BVH.h"
+#include "SceneTypes.h"
+#include "WideBVH.h"
+
+/*
+	CPU equivalent of the two level acceleration structure used for ray tracing. A single bottom level BVH is shared by all
+	instances, the same way every D3D12_RAYTRACING_INSTANCE_DESC written by WriteRaytracingInstanceDescs() references the
+	same BLAS, and a top level BVH is built over the world space bounds of the instances.
+
+	Both levels are also collapsed into wide BVHs, which are used by the SIMD single ray and packet any hit queries.
+*/
+
+struct RaytracingHit
+{
+	float t;
+	uint32_t instanceIndex;
+	uint32_t primitiveIndex;
+	// Normalized geometric normal in world space, facing the side the ray came from.
+	DirectX::XMFLOAT3 worldNormal;
+};
+
+class RaytracingScene
+{
+public:
+	void Build(const BVHGeometryDesc& geometryDesc, const std::vector<RenderInstance>& renderInstances, const BVHBuildSettings& settings = {});
+
+	// Same as TraceRay() with RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH against the opaque scene geometry.
+	bool IntersectAny(const BVHRay& worldRay) const;
+	bool IntersectClosest(const BVHRay& worldRay, RaytracingHit& hit) const;
+
+	// Same result as IntersectAny(), traversing the wide BVHs.
+	bool IntersectAnyWide(const BVHRay& worldRay) const;
+	// Any hit query for the rays in activeMask, returns the rays that hit anything.
+	uint32_t IntersectAnyPacket(const BVHRayPacket& worldPacket, uint32_t activeMask) const;
+
+	const BVH& GetBottomLevel() const;
+	const BVH& GetTopLevel() const;
+
+private:
+	struct Instance
+	{
+		DirectX::XMFLOAT4X4 worldToObject;
+	};
+
+	BVH m_bottomLevel;
+	BVH m_topLevel;
+	NativeWideBVH m_wideBottomLevel;
+	NativeWideBVH m_wideTopLevel;
+	std::vector<Instance> m_instances;
+};
@@ -6,36 +6,14 @@
 #include "GPUResource.h"
 #include "AppDefines.h"
 #include "DXRAbstractions.h"
+#include "SceneTypes.h"
+#include "VertexLayout.h"
+#include "MeshletBuilder.h"
+#include "TopLevelUpdateTracker.h"
 
 using Microsoft::WRL::ComPtr;
 using DX12Abstractions::GPUResource;
 
-// The vertex structure contains the position, normal, and color of a vertex.
-struct Vertex
-{
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 normal;
-	DirectX::XMFLOAT3 color;
-
-	static const DXGI_FORMAT sVertexFormat = DXGI_FORMAT_R32G32B32_FLOAT; // Position format.
-};
-
-// Typedef to have one definition for the vertex index.
-typedef uint32_t VertexIndex;
-
-// The draw arguments are used to specify how many vertices and indices to draw.
-struct DrawArgs
-{
-	UINT vertexCount = UINT_MAX;
-	UINT startVertex = UINT_MAX;
-
-	UINT indexCount = UINT_MAX;
-	UINT startIndex = UINT_MAX;
-	UINT baseVertex = 0;
-
-	UINT startInstance = 0;
-};
-
 // A render object is a unique object that can be rendered in the scene.
 // It contains the vertex and index buffers, as well as the draw arguments.
 // Each render object can have multiple instances.
@@ -48,13 +26,14 @@ struct RenderObject
 
 	std::vector<DrawArgs> drawArgs;
 	D3D12_PRIMITIVE_TOPOLOGY topology;
-};
 
-// Each instance contains a set of constants and an index to a descriptor heap where its CBV is stored.
-struct RenderInstance
-{
-	UINT CBIndex;
-	InstanceConstants instanceData;
+	// Clusters of the index buffer for per cluster culling and drawing. Only imported meshes have meshlets.
+	MeshletData meshletData;
+
+	// How the vertices are stored in the vertex buffer. Render passes pick their pipeline state from it.
+	VertexLayout vertexLayout;
+
+	BoundingBox bounds;
 };
 
 // Render packages are sent to render passes so they can render multiple render objects with several instances.
@@ -62,6 +41,8 @@ struct RenderPackage
 {
 	RenderObject* renderObject;
 	std::vector<RenderInstance>* renderInstances;
+	// Indices into the render instances of the ones that passed CPU culling, in order. Null when every instance is drawn.
+	const std::vector<uint32_t>* visibleInstances = nullptr;
 };
 
 // The ray tracing equivalent of the RenderObject.
@@ -69,4 +50,5 @@ struct RayTracingRenderPackage
 {
 	DX12Abstractions::AccelerationStructureBuffers* topLevelASBuffers;
 	UINT instanceCount;
+	TopLevelBuildType buildType;
 };
\ No newline at end of file
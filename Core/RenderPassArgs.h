@@ -3,6 +3,9 @@
 #include "DirectXIncludes.h"
 #include "DXRAbstractions.h"
 #include "RenderObject.h"
+#include "AtrousDenoiser.h"
+#include "AOUpsampler.h"
+#include "AdaptiveSampling.h"
 #include <variant>
 
 struct CommonRenderPassArgs
@@ -15,7 +18,9 @@ struct CommonRenderPassArgs
 	ComPtr<ID3D12DescriptorHeap> cbvSrvUavHeapGlobal;
 	UINT cbvSrvUavDescSize;
 
-	ComPtr<ID3D12Resource> globalFrameDataResource;
+	D3D12_GPU_VIRTUAL_ADDRESS globalFrameDataAddress;
+	// Constants of the instance with CB index zero, the others follow InstanceConstantsStride bytes apart.
+	D3D12_GPU_VIRTUAL_ADDRESS instanceConstantsAddress;
 
 	DirectX::XMMATRIX viewProjectionMatrix;
 };
@@ -68,15 +73,58 @@ struct RaytracedAORenderPassArgs
 	UINT frameCount;
 	UINT screenWidth;
 	UINT screenHeight;
+	AOResolutionMode resolutionMode;
+	// Traces the sample counts of the adaptive sampling pass.
+	bool isAdaptiveSamplingEnabled;
 
 	std::vector<RayTracingRenderPackage> renderPackages;
 };
 
+struct AdaptiveSamplingRenderPassArgs
+{
+	CommonRenderPassArgs commonArgs;
+
+	UINT frameCount;
+	UINT screenWidth;
+	UINT screenHeight;
+	AdaptiveSamplingSettings settings;
+	// Off when adaptive sampling is disabled or the AO is traced at a reduced resolution.
+	bool isEnabled;
+
+	// Counters that the shader adds up, and the readback buffer of the frame that they are copied to.
+	DX12Abstractions::GPUResource* counterBuffer;
+	DX12Abstractions::GPUResource* readbackBuffer;
+};
+
+struct AOUpsampleRenderPassArgs
+{
+	CommonRenderPassArgs commonArgs;
+
+	UINT frameCount;
+	UINT screenWidth;
+	UINT screenHeight;
+	AOResolutionMode resolutionMode;
+};
+
 struct AccumulationRenderPassArgs
+{
+	CommonRenderPassArgs commonArgs;
+};
+
+struct DenoiseRenderPassArgs
+{
+	CommonRenderPassArgs commonArgs;
+
+	UINT screenWidth;
+	UINT screenHeight;
+	DenoiseSettings settings;
+};
+
+struct CompositeRenderPassArgs
 {
 	CommonRenderPassArgs commonArgs;
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE RTVTargetFrame;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE RTV;
 };
 
 // This acts as a union of sorts but is safer in the way that
@@ -90,5 +138,9 @@ using RenderPassArgs = std::variant
 	DeferredGBufferRenderPassArgs, 
 	DeferredLightingRenderPassArgs,
 	RaytracedAORenderPassArgs,
-	AccumulationRenderPassArgs
+	AdaptiveSamplingRenderPassArgs,
+	AOUpsampleRenderPassArgs,
+	AccumulationRenderPassArgs,
+	DenoiseRenderPassArgs,
+	CompositeRenderPassArgs
 >;
\ No newline at end of file
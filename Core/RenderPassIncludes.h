@@ -5,4 +5,8 @@
 #include "DeferredGBufferRenderPass.h"
 #include "DeferredLightingRenderPass.h"
 #include "RaytracedAORenderPass.h"
+#include "AdaptiveSamplingRenderPass.h"
+#include "AOUpsampleRenderPass.h"
 #include "AccumilationRenderPass.h"
+#include "DenoiseRenderPass.h"
+#include "CompositeRenderPass.h"
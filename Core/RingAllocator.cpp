@@ -0,0 +1,114 @@
+#include "RingAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+RingAllocator::RingAllocator(uint64_t capacity) :
+	m_capacity(capacity)
+{
+	if (capacity == 0)
+	{
+		throw std::runtime_error("A ring allocator needs a capacity.");
+	}
+}
+
+uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || size > m_capacity)
+	{
+		throw std::runtime_error("Ring allocations have to be between one byte and the capacity of the ring.");
+	}
+
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0 || m_capacity % alignment != 0)
+	{
+		throw std::runtime_error("Ring allocation alignments have to be powers of two that divide the capacity.");
+	}
+
+	uint64_t start = AlignUp(m_head, alignment);
+
+	// Allocations are contiguous, so one that would cross the end of the ring starts over at offset zero instead.
+	const uint64_t offset = start % m_capacity;
+	const bool isWrapping = offset + size > m_capacity;
+	if (isWrapping)
+	{
+		start += m_capacity - offset;
+	}
+
+	// Nothing is in use when the ring is empty, including the part that was just skipped.
+	if (m_head == m_tail)
+	{
+		m_tail = start;
+	}
+
+	if (start + size - m_tail > m_capacity)
+	{
+		m_stats.failedAllocationCount++;
+		return RingAllocatorInvalidOffset;
+	}
+
+	m_stats.allocationCount++;
+	m_stats.allocatedBytes += size;
+	m_stats.wastedBytes += start - m_head;
+	m_stats.wrapCount += isWrapping ? 1 : 0;
+
+	m_head = start + size;
+	m_stats.peakUsedSize = std::max(m_stats.peakUsedSize, GetUsedSize());
+
+	return start % m_capacity;
+}
+
+void RingAllocator::FinishFrame(uint64_t fenceValue)
+{
+	if (fenceValue < m_lastFenceValue)
+	{
+		throw std::runtime_error("Ring allocator frames have to be finished in fence order.");
+	}
+	m_lastFenceValue = fenceValue;
+
+	// A frame without allocations has nothing to free.
+	const uint64_t frameStart = m_frames.empty() ? m_tail : m_frames.back().end;
+	if (m_head == frameStart)
+	{
+		return;
+	}
+
+	m_frames.push_back({ fenceValue, m_head });
+}
+
+void RingAllocator::Retire(uint64_t completedFenceValue)
+{
+	while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_frames.front().end;
+		m_frames.pop_front();
+		m_stats.retiredFrameCount++;
+	}
+}
+
+uint64_t RingAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+uint64_t RingAllocator::GetUsedSize() const
+{
+	return m_head - m_tail;
+}
+
+uint32_t RingAllocator::GetFramesInFlight() const
+{
+	return (uint32_t)m_frames.size();
+}
+
+const RingAllocatorStats& RingAllocator::GetStats() const
+{
+	return m_stats;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+/*
+	Linear allocator over a fixed size ring of memory that the CPU writes and the GPU reads a few frames later.
+
+	Allocations are handed out back to back. When one doesn't fit before the end of the ring, the rest of the ring is
+	skipped and it starts at offset zero. The allocations of a frame are tagged with the fence value that the frame signals
+	when it's finished, and become free once that value has been reached. Frames are retired in order, so the used part of
+	the ring always is a single range that wraps at most once.
+
+	Only works with offsets, no device, so it runs on any platform. Not thread safe.
+*/
+
+constexpr uint64_t RingAllocatorInvalidOffset = UINT64_MAX;
+
+struct RingAllocatorStats
+{
+	uint64_t allocationCount = 0;
+	// Allocations that didn't fit next to the memory that the GPU still may read.
+	uint64_t failedAllocationCount = 0;
+	uint64_t allocatedBytes = 0;
+	// Alignment padding and the ends of the ring that were skipped when wrapping around.
+	uint64_t wastedBytes = 0;
+	uint64_t wrapCount = 0;
+	uint64_t retiredFrameCount = 0;
+	// Most bytes in use at once, including the wasted ones.
+	uint64_t peakUsedSize = 0;
+};
+
+class RingAllocator
+{
+public:
+	// The capacity has to be a multiple of every alignment that is asked for, so that offsets stay aligned after wrapping.
+	explicit RingAllocator(uint64_t capacity);
+
+	// Returns the offset of the allocation, or RingAllocatorInvalidOffset if the ring is full until more frames are retired.
+	// The alignment is a power of two. Throws for empty allocations, allocations larger than the ring and alignments that
+	// don't divide the capacity.
+	uint64_t Allocate(uint64_t size, uint64_t alignment);
+	// Tags the allocations since the last call with the fence value that is signaled once the GPU is done with them. Fence
+	// values may not decrease.
+	void FinishFrame(uint64_t fenceValue);
+	// Frees the allocations of every finished frame whose fence value has been reached.
+	void Retire(uint64_t completedFenceValue);
+
+	uint64_t GetCapacity() const;
+	// Bytes from the oldest allocation that isn't retired yet to the end of the latest one.
+	uint64_t GetUsedSize() const;
+	// Number of finished frames that aren't retired yet.
+	uint32_t GetFramesInFlight() const;
+
+	const RingAllocatorStats& GetStats() const;
+
+private:
+	struct Frame
+	{
+		uint64_t fenceValue;
+		// Position after the last allocation of the frame.
+		uint64_t end;
+	};
+
+	uint64_t m_capacity;
+	// Positions only grow, the offset in the ring is the position modulo the capacity.
+	uint64_t m_head = 0;
+	uint64_t m_tail = 0;
+	uint64_t m_lastFenceValue = 0;
+	std::deque<Frame> m_frames;
+	RingAllocatorStats m_stats;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <climits>
+#include <vector>
+#include <unordered_map>
+
+#include "PlatformIncludes.h"
+#include "AppDefines.h"
+
+/*
+	Scene and mesh types that do not depend on any GPU objects.
+	These are shared between the renderer and the headless core library.
+*/
+
+// The vertex structure contains the position, normal, and color of a vertex.
+struct Vertex
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 normal;
+	DirectX::XMFLOAT3 color;
+
+	static const DXGI_FORMAT sVertexFormat = DXGI_FORMAT_R32G32B32_FLOAT; // Position format.
+};
+
+// Typedef to have one definition for the vertex index.
+typedef uint32_t VertexIndex;
+
+// The draw arguments are used to specify how many vertices and indices to draw.
+struct DrawArgs
+{
+	UINT vertexCount = UINT_MAX;
+	UINT startVertex = UINT_MAX;
+
+	UINT indexCount = UINT_MAX;
+	UINT startIndex = UINT_MAX;
+	UINT baseVertex = 0;
+
+	UINT startInstance = 0;
+};
+
+// Axis aligned bounding box in object space.
+struct BoundingBox
+{
+	DirectX::XMFLOAT3 min = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 max = { 0.0f, 0.0f, 0.0f };
+};
+
+// CPU side geometry of a mesh before it is uploaded to the GPU.
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<VertexIndex> indices;
+};
+
+// Each instance contains a set of constants and the index of the constants in the per frame instance data. The instances
+// of a render object have consecutive indices, so that they can be drawn with one instanced draw.
+struct RenderInstance
+{
+	UINT CBIndex;
+	InstanceConstants instanceData;
+};
+
+typedef std::unordered_map<RenderObjectID, std::vector<RenderInstance>> RenderInstanceMap;
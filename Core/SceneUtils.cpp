@@ -0,0 +1,96 @@
+#include "SceneUtils.h"
+
+#include <cstdlib>
+
+#include "MathUtils.h"
+
+UINT CreateSceneRenderInstances(RenderInstanceMap& renderInstancesByID)
+{
+	UINT renderInstanceCount = 0;
+
+	// Triangles.
+	{
+		std::vector<RenderInstance>& renderInstances = renderInstancesByID[RenderObjectID::Triangle];
+
+		const float xPositions[] = { 3.0f, -3.0f, -6.0f, 6.0f, 0.0f };
+		for (float xPos : xPositions)
+		{
+			RenderInstance renderInstance = {};
+			renderInstance.CBIndex = renderInstanceCount++;
+			renderInstance.instanceData.modelMatrix = MathUtils::Translation4x4(xPos, 0.0f, 0.0f);
+			renderInstances.push_back(renderInstance);
+		}
+	}
+
+	{
+		std::vector<RenderInstance>& renderInstances = renderInstancesByID[RenderObjectID::OBJModel1];
+
+		RenderInstance renderInstance = {};
+
+		renderInstance.CBIndex = renderInstanceCount++;
+		renderInstance.instanceData.modelMatrix = MathUtils::Translation4x4(0.0f, 0.0f, -5.0f);
+		renderInstances.push_back(renderInstance);
+	}
+
+	{
+		std::vector<RenderInstance>& renderInstances = renderInstancesByID[RenderObjectID::Cube];
+
+		RenderInstance renderInstance = {};
+
+		renderInstance.CBIndex = renderInstanceCount++;
+		renderInstance.instanceData.modelMatrix = MathUtils::Translation4x4(0.0f, 0.0f, -5.0f);
+		renderInstances.push_back(renderInstance);
+	}
+
+	// Raytracing render objects.
+	{
+		std::vector<RenderInstance>& rtRenderInstances = renderInstancesByID[RTRenderObjectID];
+
+		float scale = 8.0f;
+		int randomOffset = 5;
+
+		RenderInstance renderInstance = {};
+		int maxZ = 7;
+		int maxYX = 7;
+		for (int z = 0; z < maxZ; z++)
+		{
+			float zPos = (z - (maxZ / 2)) * scale;
+			for (int x = 0; x < maxYX; x++)
+			{
+				float xPos = (x - (maxYX / 2)) * scale;
+				for (int y = 0; y < maxYX; y++)
+				{
+					float yPos = (y - (maxYX / 2)) * scale;
+
+					float zRandPos = zPos + ((rand() % randomOffset) - randomOffset);
+					float yRandPos = yPos + ((rand() % randomOffset) - randomOffset);
+					float xRandPos = xPos + ((rand() % randomOffset) - randomOffset);
+
+					renderInstance.CBIndex = renderInstanceCount++;
+					renderInstance.instanceData.modelMatrix = MathUtils::Translation4x4(xRandPos, yRandPos, zRandPos);
+					rtRenderInstances.push_back(renderInstance);
+				}
+			}
+		}
+	}
+
+	return renderInstanceCount;
+}
+
+void WriteRaytracingInstanceDescs(const std::vector<RenderInstance>& renderInstances, D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAddress, D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs)
+{
+	for (UINT i = 0; i < renderInstances.size(); i++)
+	{
+		const RenderInstance& renderInstance = renderInstances[i];
+		D3D12_RAYTRACING_INSTANCE_DESC* instanceDesc = &instanceDescs[i];
+
+		instanceDesc->InstanceID = i;
+		instanceDesc->InstanceContributionToHitGroupIndex = 0;
+		instanceDesc->Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+
+		MathUtils::Store3x4(instanceDesc->Transform, renderInstance.instanceData.modelMatrix);
+
+		instanceDesc->AccelerationStructure = bottomLevelAddress;
+		instanceDesc->InstanceMask = 0xFF;
+	}
+}
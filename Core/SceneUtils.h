@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+#include "SceneTypes.h"
+
+// Fills the instance map with the instances of the default scene.
+// The ray traced object is placed in a randomized grid, which means the result depends on the current rand() seed.
+// Returns the total number of instances created, which is also the next free constant buffer index.
+UINT CreateSceneRenderInstances(RenderInstanceMap& renderInstancesByID);
+
+// Writes one ray tracing instance description per render instance, all of them referencing the same bottom level AS.
+void WriteRaytracingInstanceDescs(const std::vector<RenderInstance>& renderInstances, D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAddress, D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs);
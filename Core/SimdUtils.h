@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/*
+	Thin wrappers over 4 and 8 wide float registers for the CPU ray tracing code.
+
+	SSE2 is used for 4 lanes whenever the target has it (every x64 target does). 8 lanes use AVX when the compiler targets
+	AVX2 (RTAO_ENABLE_AVX2 in CMake), and otherwise pairs of 4 lane registers. Targets without SSE2 fall back to plain
+	loops, so the code that uses these types compiles everywhere.
+
+	Comparisons return masks in the float lanes (all bits set for true) which are combined with &, | and AndNot().
+*/
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#endif
+
+#if defined(SIMD_AVX2)
+#include <immintrin.h>
+#elif defined(SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(SIMD_SSE2)
+
+struct SimdFloat4
+{
+	static constexpr uint32_t Width = 4;
+
+	__m128 v;
+
+	static SimdFloat4 Load(const float* source) { return { _mm_loadu_ps(source) }; }
+	static SimdFloat4 Broadcast(float value) { return { _mm_set1_ps(value) }; }
+	void Store(float* dest) const { _mm_storeu_ps(dest, v); }
+};
+
+inline SimdFloat4 operator+(SimdFloat4 a, SimdFloat4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline SimdFloat4 operator-(SimdFloat4 a, SimdFloat4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline SimdFloat4 operator*(SimdFloat4 a, SimdFloat4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline SimdFloat4 operator/(SimdFloat4 a, SimdFloat4 b) { return { _mm_div_ps(a.v, b.v) }; }
+inline SimdFloat4 operator<(SimdFloat4 a, SimdFloat4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline SimdFloat4 operator<=(SimdFloat4 a, SimdFloat4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+inline SimdFloat4 operator>(SimdFloat4 a, SimdFloat4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline SimdFloat4 operator>=(SimdFloat4 a, SimdFloat4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline SimdFloat4 operator!=(SimdFloat4 a, SimdFloat4 b) { return { _mm_cmpneq_ps(a.v, b.v) }; }
+inline SimdFloat4 operator&(SimdFloat4 a, SimdFloat4 b) { return { _mm_and_ps(a.v, b.v) }; }
+inline SimdFloat4 operator|(SimdFloat4 a, SimdFloat4 b) { return { _mm_or_ps(a.v, b.v) }; }
+// a & ~b.
+inline SimdFloat4 AndNot(SimdFloat4 a, SimdFloat4 b) { return { _mm_andnot_ps(b.v, a.v) }; }
+inline SimdFloat4 Min(SimdFloat4 a, SimdFloat4 b) { return { _mm_min_ps(a.v, b.v) }; }
+inline SimdFloat4 Max(SimdFloat4 a, SimdFloat4 b) { return { _mm_max_ps(a.v, b.v) }; }
+inline SimdFloat4 Sqrt(SimdFloat4 a) { return { _mm_sqrt_ps(a.v) }; }
+// One bit per lane, set where the lane mask is true.
+inline uint32_t MoveMask(SimdFloat4 mask) { return (uint32_t)_mm_movemask_ps(mask.v); }
+
+#else
+
+struct SimdFloat4
+{
+	static constexpr uint32_t Width = 4;
+
+	float v[4];
+
+	static SimdFloat4 Load(const float* source) { SimdFloat4 result; std::memcpy(result.v, source, sizeof(result.v)); return result; }
+	static SimdFloat4 Broadcast(float value) { return { { value, value, value, value } }; }
+	void Store(float* dest) const { std::memcpy(dest, v, sizeof(v)); }
+};
+
+namespace SimdScalar
+{
+	inline float FromBits(uint32_t bits) { float value; std::memcpy(&value, &bits, sizeof(value)); return value; }
+	inline uint32_t ToBits(float value) { uint32_t bits; std::memcpy(&bits, &value, sizeof(bits)); return bits; }
+	inline float FromBool(bool value) { return FromBits(value ? 0xFFFFFFFFu : 0u); }
+
+	template <typename Op>
+	SimdFloat4 Apply(SimdFloat4 a, SimdFloat4 b, const Op& op)
+	{
+		SimdFloat4 result;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			result.v[i] = op(a.v[i], b.v[i]);
+		}
+		return result;
+	}
+}
+
+inline SimdFloat4 operator+(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x + y; }); }
+inline SimdFloat4 operator-(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x - y; }); }
+inline SimdFloat4 operator*(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x * y; }); }
+inline SimdFloat4 operator/(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x / y; }); }
+inline SimdFloat4 operator<(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBool(x < y); }); }
+inline SimdFloat4 operator<=(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBool(x <= y); }); }
+inline SimdFloat4 operator>(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBool(x > y); }); }
+inline SimdFloat4 operator>=(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBool(x >= y); }); }
+inline SimdFloat4 operator!=(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBool(x != y); }); }
+inline SimdFloat4 operator&(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBits(SimdScalar::ToBits(x) & SimdScalar::ToBits(y)); }); }
+inline SimdFloat4 operator|(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBits(SimdScalar::ToBits(x) | SimdScalar::ToBits(y)); }); }
+inline SimdFloat4 AndNot(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::FromBits(SimdScalar::ToBits(x) & ~SimdScalar::ToBits(y)); }); }
+// Same operand order as minps/maxps: the second operand is returned when either one is NaN.
+inline SimdFloat4 Min(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+inline SimdFloat4 Max(SimdFloat4 a, SimdFloat4 b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+inline SimdFloat4 Sqrt(SimdFloat4 a) { return SimdScalar::Apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+
+inline uint32_t MoveMask(SimdFloat4 mask)
+{
+	uint32_t bits = 0;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		bits |= (SimdScalar::ToBits(mask.v[i]) >> 31) << i;
+	}
+	return bits;
+}
+
+#endif
+
+#if defined(SIMD_AVX2)
+
+struct SimdFloat8
+{
+	static constexpr uint32_t Width = 8;
+
+	__m256 v;
+
+	static SimdFloat8 Load(const float* source) { return { _mm256_loadu_ps(source) }; }
+	static SimdFloat8 Broadcast(float value) { return { _mm256_set1_ps(value) }; }
+	void Store(float* dest) const { _mm256_storeu_ps(dest, v); }
+};
+
+inline SimdFloat8 operator+(SimdFloat8 a, SimdFloat8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline SimdFloat8 operator-(SimdFloat8 a, SimdFloat8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline SimdFloat8 operator*(SimdFloat8 a, SimdFloat8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline SimdFloat8 operator/(SimdFloat8 a, SimdFloat8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline SimdFloat8 operator<(SimdFloat8 a, SimdFloat8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline SimdFloat8 operator<=(SimdFloat8 a, SimdFloat8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+inline SimdFloat8 operator>(SimdFloat8 a, SimdFloat8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline SimdFloat8 operator>=(SimdFloat8 a, SimdFloat8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+inline SimdFloat8 operator!=(SimdFloat8 a, SimdFloat8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) }; }
+inline SimdFloat8 operator&(SimdFloat8 a, SimdFloat8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+inline SimdFloat8 operator|(SimdFloat8 a, SimdFloat8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+inline SimdFloat8 AndNot(SimdFloat8 a, SimdFloat8 b) { return { _mm256_andnot_ps(b.v, a.v) }; }
+inline SimdFloat8 Min(SimdFloat8 a, SimdFloat8 b) { return { _mm256_min_ps(a.v, b.v) }; }
+inline SimdFloat8 Max(SimdFloat8 a, SimdFloat8 b) { return { _mm256_max_ps(a.v, b.v) }; }
+inline SimdFloat8 Sqrt(SimdFloat8 a) { return { _mm256_sqrt_ps(a.v) }; }
+inline uint32_t MoveMask(SimdFloat8 mask) { return (uint32_t)_mm256_movemask_ps(mask.v); }
+
+#else
+
+// Two 4 lane registers, the first one holds lanes 0-3.
+struct SimdFloat8
+{
+	static constexpr uint32_t Width = 8;
+
+	SimdFloat4 low;
+	SimdFloat4 high;
+
+	static SimdFloat8 Load(const float* source) { return { SimdFloat4::Load(source), SimdFloat4::Load(source + 4) }; }
+	static SimdFloat8 Broadcast(float value) { return { SimdFloat4::Broadcast(value), SimdFloat4::Broadcast(value) }; }
+	void Store(float* dest) const { low.Store(dest); high.Store(dest + 4); }
+};
+
+inline SimdFloat8 operator+(SimdFloat8 a, SimdFloat8 b) { return { a.low + b.low, a.high + b.high }; }
+inline SimdFloat8 operator-(SimdFloat8 a, SimdFloat8 b) { return { a.low - b.low, a.high - b.high }; }
+inline SimdFloat8 operator*(SimdFloat8 a, SimdFloat8 b) { return { a.low * b.low, a.high * b.high }; }
+inline SimdFloat8 operator/(SimdFloat8 a, SimdFloat8 b) { return { a.low / b.low, a.high / b.high }; }
+inline SimdFloat8 operator<(SimdFloat8 a, SimdFloat8 b) { return { a.low < b.low, a.high < b.high }; }
+inline SimdFloat8 operator<=(SimdFloat8 a, SimdFloat8 b) { return { a.low <= b.low, a.high <= b.high }; }
+inline SimdFloat8 operator>(SimdFloat8 a, SimdFloat8 b) { return { a.low > b.low, a.high > b.high }; }
+inline SimdFloat8 operator>=(SimdFloat8 a, SimdFloat8 b) { return { a.low >= b.low, a.high >= b.high }; }
+inline SimdFloat8 operator!=(SimdFloat8 a, SimdFloat8 b) { return { a.low != b.low, a.high != b.high }; }
+inline SimdFloat8 operator&(SimdFloat8 a, SimdFloat8 b) { return { a.low & b.low, a.high & b.high }; }
+inline SimdFloat8 operator|(SimdFloat8 a, SimdFloat8 b) { return { a.low | b.low, a.high | b.high }; }
+inline SimdFloat8 AndNot(SimdFloat8 a, SimdFloat8 b) { return { AndNot(a.low, b.low), AndNot(a.high, b.high) }; }
+inline SimdFloat8 Min(SimdFloat8 a, SimdFloat8 b) { return { Min(a.low, b.low), Min(a.high, b.high) }; }
+inline SimdFloat8 Max(SimdFloat8 a, SimdFloat8 b) { return { Max(a.low, b.low), Max(a.high, b.high) }; }
+inline SimdFloat8 Sqrt(SimdFloat8 a) { return { Sqrt(a.low), Sqrt(a.high) }; }
+inline uint32_t MoveMask(SimdFloat8 mask) { return MoveMask(mask.low) | (MoveMask(mask.high) << 4); }
+
+#endif
+
+template <uint32_t Width>
+using SimdFloat = std::conditional_t<Width == 4, SimdFloat4, SimdFloat8>;
+
+// Widest register that maps to a single native register on the target.
+#if defined(SIMD_AVX2)
+constexpr uint32_t NativeSimdWidth = 8u;
+#else
+constexpr uint32_t NativeSimdWidth = 4u;
+#endif
@@ -0,0 +1,172 @@
+#include "TemporalReprojection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "MathUtils.h"
+
+namespace
+{
+	// Same as IsHistoryTapValid() in the shader.
+	bool IsHistoryTapValid(const DirectX::XMFLOAT4& surface, const DirectX::XMFLOAT3& normal, float expectedDistance)
+	{
+		if (surface.w <= 0.0f)
+		{
+			return false;
+		}
+
+		const bool isSameOrientation = MathUtils::Dot({ surface.x, surface.y, surface.z }, normal) >= TemporalNormalThreshold;
+		const bool isSameDistance = std::abs(surface.w - expectedDistance) <= TemporalDepthTolerance * expectedDistance;
+		return isSameOrientation && isSameDistance;
+	}
+}
+
+TemporalCamera CreateTemporalCamera(const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, float verticalFov, float aspectRatio)
+{
+	// Near and far plane of DX12Renderer::CreateCamera(). The reprojection doesn't depend on them.
+	constexpr float nearZ = 0.01f;
+	constexpr float farZ = 1000.0f;
+
+	TemporalCamera camera;
+	camera.viewProjection = MathUtils::Multiply4x4(MathUtils::LookAtLH4x4(eye, target, { 0.0f, 1.0f, 0.0f }),
+		MathUtils::PerspectiveFovLH4x4(verticalFov, aspectRatio, nearZ, farZ));
+	camera.position = eye;
+	return camera;
+}
+
+bool ReprojectHistory(const TemporalHistory& previous, const TemporalCamera& previousCamera, const DirectX::XMFLOAT3& worldPos, const DirectX::XMFLOAT3& normal, DirectX::XMFLOAT4& history)
+{
+	const DirectX::XMFLOAT4X4& m = previousCamera.viewProjection;
+	const float clipX = worldPos.x * m._11 + worldPos.y * m._21 + worldPos.z * m._31 + m._41;
+	const float clipY = worldPos.x * m._12 + worldPos.y * m._22 + worldPos.z * m._32 + m._42;
+	const float clipW = worldPos.x * m._14 + worldPos.y * m._24 + worldPos.z * m._34 + m._44;
+	if (clipW <= 0.0f)
+	{
+		return false;
+	}
+
+	// Texture coordinates have y pointing down, and pixel centers are at half coordinates.
+	const float u = clipX / clipW * 0.5f + 0.5f;
+	const float v = clipY / clipW * -0.5f + 0.5f;
+	const float pixelX = u * previous.width - 0.5f;
+	const float pixelY = v * previous.height - 0.5f;
+
+	const float baseX = std::floor(pixelX);
+	const float baseY = std::floor(pixelY);
+	const float fractionX = pixelX - baseX;
+	const float fractionY = pixelY - baseY;
+
+	const float expectedDistance = MathUtils::Length(MathUtils::Subtract(worldPos, previousCamera.position));
+
+	DirectX::XMFLOAT4 sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float totalWeight = 0.0f;
+	for (int tap = 0; tap < 4; tap++)
+	{
+		const int offsetX = tap & 1;
+		const int offsetY = tap >> 1;
+		const int x = (int)baseX + offsetX;
+		const int y = (int)baseY + offsetY;
+		if (x < 0 || y < 0 || x >= (int)previous.width || y >= (int)previous.height)
+		{
+			continue;
+		}
+
+		const size_t pixel = (size_t)y * previous.width + x;
+		if (!IsHistoryTapValid(previous.surfaces[pixel], normal, expectedDistance))
+		{
+			continue;
+		}
+
+		const float weight = (offsetX ? fractionX : 1.0f - fractionX) * (offsetY ? fractionY : 1.0f - fractionY);
+		const DirectX::XMFLOAT4& value = previous.values[pixel];
+		sum.x += value.x * weight;
+		sum.y += value.y * weight;
+		sum.z += value.z * weight;
+		sum.w += value.w * weight;
+		totalWeight += weight;
+	}
+
+	if (totalWeight < TemporalMinHistoryWeight)
+	{
+		return false;
+	}
+
+	history = { sum.x / totalWeight, sum.y / totalWeight, sum.z / totalWeight, sum.w / totalWeight };
+	return true;
+}
+
+TemporalAccumulationStats AccumulateTemporal(const RTAOGBuffer& gBuffer, std::span<const float> currentAO, const TemporalCamera& camera, const TemporalCamera& previousCamera, const TemporalHistory* previous, TemporalHistory& next, std::span<const uint8_t> sampleCounts)
+{
+	const size_t pixelCount = (size_t)gBuffer.width * gBuffer.height;
+	if (currentAO.size() != pixelCount)
+	{
+		throw std::runtime_error("The AO of the frame doesn't match the size of the G-buffer.");
+	}
+	if (previous && (previous->width != gBuffer.width || previous->height != gBuffer.height))
+	{
+		throw std::runtime_error("The history doesn't match the size of the G-buffer.");
+	}
+	if (!sampleCounts.empty() && sampleCounts.size() != pixelCount)
+	{
+		throw std::runtime_error("The sample counts don't match the size of the G-buffer.");
+	}
+
+	next.width = gBuffer.width;
+	next.height = gBuffer.height;
+	next.values.assign(pixelCount, { 0.0f, 0.0f, 0.0f, 0.0f });
+	next.surfaces.assign(pixelCount, { 0.0f, 0.0f, 0.0f, 0.0f });
+
+	TemporalAccumulationStats stats;
+	double historyLengthSum = 0.0;
+	for (size_t pixel = 0; pixel < pixelCount; pixel++)
+	{
+		const float current = currentAO[pixel];
+		const DirectX::XMFLOAT4& position = gBuffer.positions[pixel];
+
+		if (position.w == 0.0f)
+		{
+			next.values[pixel] = { current, 0.0f, 0.0f, 0.0f };
+			stats.backgroundPixelCount++;
+			continue;
+		}
+
+		const DirectX::XMFLOAT3 worldPos = { position.x, position.y, position.z };
+		const DirectX::XMFLOAT3 normal = MathUtils::Normalize({ gBuffer.normals[pixel].x, gBuffer.normals[pixel].y, gBuffer.normals[pixel].z });
+
+		DirectX::XMFLOAT4 history;
+		float historyLength = 1.0f;
+		float ao = current;
+		float aoSquared = current * current;
+		if (previous && ReprojectHistory(*previous, previousCamera, worldPos, normal, history))
+		{
+			if (!sampleCounts.empty() && sampleCounts[pixel] == 0)
+			{
+				historyLength = history.y;
+				ao = history.x;
+				aoSquared = history.z;
+				stats.heldPixelCount++;
+			}
+			else
+			{
+				historyLength = std::min(history.y + 1.0f, TemporalMaxHistoryLength);
+				const float alpha = 1.0f / historyLength;
+				ao = history.x + (current - history.x) * alpha;
+				aoSquared = history.z + (current * current - history.z) * alpha;
+			}
+			stats.reprojectedPixelCount++;
+		}
+		else
+		{
+			stats.disoccludedPixelCount++;
+		}
+
+		next.values[pixel] = { ao, historyLength, aoSquared, 0.0f };
+		next.surfaces[pixel] = { normal.x, normal.y, normal.z, MathUtils::Length(MathUtils::Subtract(worldPos, camera.position)) };
+		historyLengthSum += historyLength;
+	}
+
+	const uint32_t surfacePixelCount = stats.reprojectedPixelCount + stats.disoccludedPixelCount;
+	stats.averageHistoryLength = surfacePixelCount > 0 ? (float)(historyLengthSum / surfacePixelCount) : 0.0f;
+	return stats;
+}
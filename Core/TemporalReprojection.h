@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "PlatformIncludes.h"
+#include "RTAOReference.h"
+
+/*
+	CPU reference of the temporal accumulation in shaders/AccumulationPS.hlsl.
+
+	Every frame blends the AO of the frame into a history that is reprojected from the frame before, so the noise of one
+	sample per pixel averages out while the camera moves:
+	- The world position from the G-buffer is projected with the view projection matrix of the previous frame, which
+	  gives where the surface was on screen. The scene is static, so the world position doubles as the motion vector.
+	- The history is fetched with the four bilinear taps around that point. A tap is rejected when the surface stored
+	  for it faces another way or is at another distance from the previous camera, which catches disocclusions.
+	- Every pixel keeps its own history length, which restarts at one when no tap survives and is capped, so the
+	  history still follows changes of the lighting.
+	- The mean of the squared AO is accumulated along with the AO, which gives the variance that the adaptive sampling
+	  pass spreads the rays of the next frame by. Pixels that it gave no rays keep their history as it is.
+
+	The functions mirror the shader step by step. The GPU stores the AO and the history in half floats, so its results
+	only differ from these by rounding.
+*/
+
+// Constants from AccumulationPS.hlsl. Keep them in sync with the shader.
+constexpr float TemporalMaxHistoryLength = 64.0f;
+// Largest difference between the stored and the expected distance to the previous camera, relative to the distance.
+constexpr float TemporalDepthTolerance = 0.05f;
+// Smallest cosine between the stored and the current normal.
+constexpr float TemporalNormalThreshold = 0.9f;
+// Bilinear weight that the surviving taps need together for the history to be used.
+constexpr float TemporalMinHistoryWeight = 0.001f;
+
+struct TemporalCamera
+{
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMFLOAT3 position;
+};
+
+// Camera at the eye looking at the target, with the view projection of the renderer's camera and the same basis as
+// CreateSyntheticGBuffer(), so that a synthetic G-buffer of the camera can be reprojected with it.
+TemporalCamera CreateTemporalCamera(const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, float verticalFov, float aspectRatio);
+
+// The content of one accumulation texture and one reprojection texture, which the renderer ping-pongs between frames.
+struct TemporalHistory
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	// Accumulated AO, the history length, which is zero for the background, and the accumulated squared AO.
+	std::vector<DirectX::XMFLOAT4> values;
+	// Normal of the surface with its distance to the camera in w, zero for the background.
+	std::vector<DirectX::XMFLOAT4> surfaces;
+};
+
+struct TemporalAccumulationStats
+{
+	uint32_t reprojectedPixelCount = 0;
+	uint32_t disoccludedPixelCount = 0;
+	uint32_t backgroundPixelCount = 0;
+	// Reprojected pixels without samples, which kept their history.
+	uint32_t heldPixelCount = 0;
+	// Over the pixels that aren't background.
+	float averageHistoryLength = 0.0f;
+};
+
+// Same as ReprojectHistory() in the shader. Returns false when the surface wasn't visible in the previous frame, otherwise
+// writes the filtered history.
+bool ReprojectHistory(const TemporalHistory& previous, const TemporalCamera& previousCamera, const DirectX::XMFLOAT3& worldPos, const DirectX::XMFLOAT3& normal, DirectX::XMFLOAT4& history);
+
+// Runs the accumulation shader for every pixel and writes the new history, whose AO is also what the pass writes back to
+// the AO texture. Without a history, which is the case for the first frame, every pixel starts over. The sample counts
+// are the ones the AO was traced with, empty when every pixel was traced.
+TemporalAccumulationStats AccumulateTemporal(const RTAOGBuffer& gBuffer, std::span<const float> currentAO, const TemporalCamera& camera, const TemporalCamera& previousCamera, const TemporalHistory* previous, TemporalHistory& next, std::span<const uint8_t> sampleCounts = {});
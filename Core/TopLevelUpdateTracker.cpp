@@ -0,0 +1,87 @@
+#include "TopLevelUpdateTracker.h"
+
+#include <sstream>
+#include <stdexcept>
+
+TopLevelUpdateTracker::TopLevelUpdateTracker(uint32_t copyCount)
+	: m_copies(copyCount)
+{
+}
+
+void TopLevelUpdateTracker::MarkTransformsDirty()
+{
+	m_transformVersion++;
+}
+
+TopLevelBuildType TopLevelUpdateTracker::PrepareCopy(uint32_t copyIndex, uint32_t instanceCount)
+{
+	if (copyIndex >= m_copies.size())
+	{
+		throw std::runtime_error("The top level acceleration structure copy doesn't exist.");
+	}
+
+	if (instanceCount != m_instanceCount)
+	{
+		m_instanceCount = instanceCount;
+		m_instanceCountVersion++;
+	}
+
+	Copy& copy = m_copies[copyIndex];
+
+	TopLevelBuildType buildType;
+	if (!copy.isBuilt || copy.instanceCountVersion != m_instanceCountVersion)
+	{
+		buildType = TopLevelBuildType::Rebuild;
+		m_stats.rebuildCount++;
+	}
+	else if (copy.transformVersion != m_transformVersion)
+	{
+		buildType = TopLevelBuildType::Update;
+		m_stats.updateCount++;
+	}
+	else
+	{
+		buildType = TopLevelBuildType::Skip;
+		m_stats.skipCount++;
+	}
+
+	copy.isBuilt = true;
+	copy.transformVersion = m_transformVersion;
+	copy.instanceCountVersion = m_instanceCountVersion;
+	m_stats.lastBuildType = buildType;
+
+	return buildType;
+}
+
+uint64_t TopLevelUpdateTracker::GetTransformVersion() const
+{
+	return m_transformVersion;
+}
+
+const TopLevelUpdateStats& TopLevelUpdateTracker::GetStats() const
+{
+	return m_stats;
+}
+
+const char* GetTopLevelBuildTypeName(TopLevelBuildType buildType)
+{
+	switch (buildType)
+	{
+	case TopLevelBuildType::Skip:
+		return "Skip";
+	case TopLevelBuildType::Update:
+		return "Update";
+	case TopLevelBuildType::Rebuild:
+		return "Rebuild";
+	default:
+		return "Unknown";
+	}
+}
+
+std::string FormatTopLevelUpdateStats(const TopLevelUpdateStats& stats)
+{
+	std::ostringstream stream;
+	stream << "TLAS: " << stats.skipCount << " skipped, " << stats.updateCount << " updated, " << stats.rebuildCount << " rebuilt, last "
+		<< GetTopLevelBuildTypeName(stats.lastBuildType) << "\n";
+	return stream.str();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+	Decides how every copy of a top level acceleration structure is brought up to date at the start of its frame.
+
+	The renderer keeps one copy per frame resource, so a change of the instances has to reach each copy once. Every change
+	of the instance transforms bumps a version, and each copy remembers the version and the instance count it was last
+	built with:
+	- A copy that already has the latest version is skipped, so neither its instance descs nor the build are recorded.
+	- A copy with the same instance count is refit with PERFORM_UPDATE, which keeps the tree and only moves the bounds.
+	- A copy that was never built, or was built before the instance count last changed, is rebuilt from scratch.
+
+	Only counts versions, no device, so it runs on any platform.
+*/
+
+enum class TopLevelBuildType : uint32_t
+{
+	Skip = 0,
+	Update,
+	Rebuild,
+	Count
+};
+
+struct TopLevelUpdateStats
+{
+	uint64_t skipCount = 0;
+	uint64_t updateCount = 0;
+	uint64_t rebuildCount = 0;
+	// Path taken by the copy that was prepared last, which is the one of the latest frame.
+	TopLevelBuildType lastBuildType = TopLevelBuildType::Skip;
+};
+
+class TopLevelUpdateTracker
+{
+public:
+	explicit TopLevelUpdateTracker(uint32_t copyCount);
+
+	// Called whenever a transform of an instance of the acceleration structure changes.
+	void MarkTransformsDirty();
+
+	// Returns how the copy has to be built to match the current transforms and instance count, and from then on treats it
+	// as up to date. Throws for copies that don't exist.
+	TopLevelBuildType PrepareCopy(uint32_t copyIndex, uint32_t instanceCount);
+
+	uint64_t GetTransformVersion() const;
+	const TopLevelUpdateStats& GetStats() const;
+
+private:
+	struct Copy
+	{
+		bool isBuilt = false;
+		uint64_t transformVersion = 0;
+		uint64_t instanceCountVersion = 0;
+	};
+
+	std::vector<Copy> m_copies;
+	uint64_t m_transformVersion = 0;
+	// Bumped whenever a copy is prepared with another instance count than the one before it.
+	uint64_t m_instanceCountVersion = 0;
+	uint32_t m_instanceCount = 0;
+	TopLevelUpdateStats m_stats;
+};
+
+const char* GetTopLevelBuildTypeName(TopLevelBuildType buildType);
+// One line with the number of copies that took every path and the path of the latest one.
+std::string FormatTopLevelUpdateStats(const TopLevelUpdateStats& stats);
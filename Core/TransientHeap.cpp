@@ -0,0 +1,120 @@
+#include "TransientHeap.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+uint64_t TransientHeapLayout::GetSavedBytes() const
+{
+	return unaliasedSize - heapSize;
+}
+
+const TransientResourcePlacement& TransientHeapLayout::GetPlacement(uint32_t resource) const
+{
+	for (const TransientResourcePlacement& placement : placements)
+	{
+		if (placement.resource == resource)
+		{
+			return placement;
+		}
+	}
+
+	throw std::runtime_error("The transient heap layout has no placement for the resource.");
+}
+
+TransientHeapLayout PackTransientResources(const FrameGraph& frameGraph, const std::vector<TransientResourceRequest>& requests)
+{
+	const uint32_t requestCount = (uint32_t)requests.size();
+
+	TransientHeapLayout layout;
+	layout.placements.resize(requestCount);
+
+	for (uint32_t i = 0; i < requestCount; i++)
+	{
+		const TransientResourceRequest& request = requests[i];
+		if (!frameGraph.IsTransient(request.resource))
+		{
+			throw std::runtime_error("Frame graph resource '" + frameGraph.GetResourceName(request.resource) + "' isn't transient.");
+		}
+		if (request.alignment == 0 || (request.alignment & (request.alignment - 1)) != 0)
+		{
+			throw std::runtime_error("Frame graph resource '" + frameGraph.GetResourceName(request.resource) + "' has an invalid alignment.");
+		}
+		for (uint32_t j = 0; j < i; j++)
+		{
+			if (requests[j].resource == request.resource)
+			{
+				throw std::runtime_error("Frame graph resource '" + frameGraph.GetResourceName(request.resource) + "' is requested twice.");
+			}
+		}
+
+		layout.placements[i] = { request.resource, 0, request.size };
+		layout.heapAlignment = std::max(layout.heapAlignment, request.alignment);
+		layout.unaliasedSize = AlignUp(layout.unaliasedSize, request.alignment) + request.size;
+	}
+
+	// Largest first, ties in request order, so that the layout is deterministic.
+	std::vector<uint32_t> packingOrder(requestCount);
+	std::iota(packingOrder.begin(), packingOrder.end(), 0u);
+	std::stable_sort(packingOrder.begin(), packingOrder.end(), [&](uint32_t a, uint32_t b) { return requests[a].size > requests[b].size; });
+
+	std::vector<uint32_t> packed;
+	packed.reserve(requestCount);
+	std::vector<uint64_t> candidates;
+	for (uint32_t i : packingOrder)
+	{
+		const TransientResourceRequest& request = requests[i];
+
+		// Ranges of the packed resources that are in use at the same time as this one.
+		std::vector<const TransientResourcePlacement*> conflicts;
+		for (uint32_t j : packed)
+		{
+			if (!frameGraph.CanAlias(request.resource, requests[j].resource))
+			{
+				conflicts.push_back(&layout.placements[j]);
+			}
+		}
+
+		// The lowest free offset is either the start of the heap or right after one of the conflicting ranges.
+		candidates.assign(1, 0);
+		for (const TransientResourcePlacement* conflict : conflicts)
+		{
+			candidates.push_back(AlignUp(conflict->offset + conflict->size, request.alignment));
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for (uint64_t candidate : candidates)
+		{
+			const auto overlaps = [&](const TransientResourcePlacement* conflict)
+			{
+				return candidate < conflict->offset + conflict->size && conflict->offset < candidate + request.size;
+			};
+
+			if (std::none_of(conflicts.begin(), conflicts.end(), overlaps))
+			{
+				layout.placements[i].offset = candidate;
+				break;
+			}
+		}
+
+		layout.heapSize = std::max(layout.heapSize, layout.placements[i].offset + request.size);
+		packed.push_back(i);
+	}
+
+	// Heap sizes are multiples of the heap alignment.
+	if (layout.heapAlignment > 0)
+	{
+		layout.heapSize = AlignUp(layout.heapSize, layout.heapAlignment);
+		layout.unaliasedSize = AlignUp(layout.unaliasedSize, layout.heapAlignment);
+	}
+
+	return layout;
+}
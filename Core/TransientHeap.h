@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FrameGraph.h"
+
+/*
+	Packs the transient resources of a frame graph into a single heap. Resources that are in use at the same time on the GPU
+	get disjoint ranges, the others may overlap. Largest resources are placed first, each at the lowest aligned offset that
+	doesn't overlap a resource it conflicts with.
+
+	Only needs the compiled graph and the sizes, no device, so it runs on any platform.
+*/
+
+struct TransientResourceRequest
+{
+	uint32_t resource;
+	uint64_t size;
+	// Power of two.
+	uint64_t alignment;
+};
+
+struct TransientResourcePlacement
+{
+	uint32_t resource;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct TransientHeapLayout
+{
+	// In the order of the requests.
+	std::vector<TransientResourcePlacement> placements;
+	uint64_t heapSize = 0;
+	// Largest alignment of the requests, which the heap needs as well.
+	uint64_t heapAlignment = 0;
+	// Size of a heap with every resource in its own memory.
+	uint64_t unaliasedSize = 0;
+
+	uint64_t GetSavedBytes() const;
+	// Throws if the resource wasn't requested.
+	const TransientResourcePlacement& GetPlacement(uint32_t resource) const;
+};
+
+// The frame graph has to be compiled. Throws if a requested resource isn't transient or is requested twice.
+TransientHeapLayout PackTransientResources(const FrameGraph& frameGraph, const std::vector<TransientResourceRequest>& requests);
@@ -0,0 +1,304 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "MathUtils.h"
+
+namespace
+{
+	UINT GetNormalSize(VertexNormalEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case VertexNormalEncoding::Float3:		return sizeof(float) * 3;
+		case VertexNormalEncoding::Snorm16:		return sizeof(int16_t) * 4;
+		case VertexNormalEncoding::Octahedral:	return sizeof(int16_t) * 2;
+		default:								return 0;
+		}
+	}
+
+	DXGI_FORMAT GetNormalFormat(VertexNormalEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case VertexNormalEncoding::Float3:		return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexNormalEncoding::Snorm16:		return DXGI_FORMAT_R16G16B16A16_SNORM;
+		case VertexNormalEncoding::Octahedral:	return DXGI_FORMAT_R16G16_SNORM;
+		default:								return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	UINT GetColorSize(VertexColorEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case VertexColorEncoding::Float3:	return sizeof(float) * 3;
+		case VertexColorEncoding::Unorm8:	return sizeof(uint8_t) * 4;
+		default:							return 0;
+		}
+	}
+
+	DXGI_FORMAT GetColorFormat(VertexColorEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case VertexColorEncoding::Float3:	return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexColorEncoding::Unorm8:	return DXGI_FORMAT_R8G8B8A8_UNORM;
+		default:							return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	UINT GetColorOffset(const VertexLayout& layout)
+	{
+		return sizeof(DirectX::XMFLOAT3) + GetNormalSize(layout.normalEncoding);
+	}
+}
+
+uint32_t GetVertexLayoutIndex(const VertexLayout& layout)
+{
+	return (uint32_t)layout.normalEncoding * (uint32_t)VertexColorEncoding::Count + (uint32_t)layout.colorEncoding;
+}
+
+VertexLayout GetVertexLayoutFromIndex(uint32_t index)
+{
+	return {
+		.normalEncoding = (VertexNormalEncoding)(index / (uint32_t)VertexColorEncoding::Count),
+		.colorEncoding = (VertexColorEncoding)(index % (uint32_t)VertexColorEncoding::Count)
+	};
+}
+
+VertexLayoutDesc GetVertexLayoutDesc(const VertexLayout& layout)
+{
+	VertexLayoutDesc desc;
+	desc.elements.push_back({ "POSITION", Vertex::sVertexFormat, 0 });
+	desc.elements.push_back({ "NORMAL", GetNormalFormat(layout.normalEncoding), sizeof(DirectX::XMFLOAT3) });
+
+	if (layout.colorEncoding != VertexColorEncoding::None)
+	{
+		desc.elements.push_back({ "COLOR", GetColorFormat(layout.colorEncoding), GetColorOffset(layout) });
+	}
+
+	desc.stride = GetVertexStride(layout);
+	return desc;
+}
+
+UINT GetVertexStride(const VertexLayout& layout)
+{
+	return GetColorOffset(layout) + GetColorSize(layout.colorEncoding);
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> CreateInputElementDescs(const VertexLayoutDesc& layoutDesc)
+{
+	std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs;
+	inputElementDescs.reserve(layoutDesc.elements.size());
+
+	for (const VertexElement& element : layoutDesc.elements)
+	{
+		inputElementDescs.push_back({ element.semanticName, 0, element.format, 0, element.offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+	}
+
+	return inputElementDescs;
+}
+
+std::string GetVertexLayoutShaderSuffix(const VertexLayout& layout)
+{
+	// Snorm and unorm formats are converted to floats by the input assembler and don't need a permutation.
+	std::string suffix;
+	if (layout.normalEncoding == VertexNormalEncoding::Octahedral)
+	{
+		suffix += "_OctNormal";
+	}
+
+	if (layout.colorEncoding == VertexColorEncoding::None)
+	{
+		suffix += "_NoColor";
+	}
+
+	return suffix;
+}
+
+int16_t EncodeSnorm16(float value)
+{
+	return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+float DecodeSnorm16(int16_t value)
+{
+	// -32768 and -32767 both map to -1, as in the D3D conversion rules.
+	return std::max((float)value / 32767.0f, -1.0f);
+}
+
+uint8_t EncodeUnorm8(float value)
+{
+	return (uint8_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+float DecodeUnorm8(uint8_t value)
+{
+	return (float)value / 255.0f;
+}
+
+void EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t (&encoded)[2])
+{
+	const float l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (l1Norm == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	// Project onto the octahedron and fold the lower hemisphere over the diagonals.
+	float x = normal.x / l1Norm;
+	float y = normal.y / l1Norm;
+	if (normal.z < 0.0f)
+	{
+		const float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		const float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = EncodeSnorm16(x);
+	encoded[1] = EncodeSnorm16(y);
+}
+
+DirectX::XMFLOAT3 DecodeOctahedral(const int16_t (&encoded)[2])
+{
+	DirectX::XMFLOAT3 normal = { DecodeSnorm16(encoded[0]), DecodeSnorm16(encoded[1]), 0.0f };
+	normal.z = 1.0f - std::abs(normal.x) - std::abs(normal.y);
+
+	const float t = std::clamp(-normal.z, 0.0f, 1.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+
+	return MathUtils::Normalize(normal);
+}
+
+void EncodeVertices(std::span<const Vertex> vertices, const VertexLayout& layout, std::vector<uint8_t>& encoded)
+{
+	const UINT stride = GetVertexStride(layout);
+	const UINT colorOffset = GetColorOffset(layout);
+
+	encoded.assign(vertices.size() * stride, 0);
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& vertex = vertices[i];
+		uint8_t* dest = &encoded[i * stride];
+
+		memcpy(dest, &vertex.position, sizeof(vertex.position));
+
+		uint8_t* normalDest = dest + sizeof(DirectX::XMFLOAT3);
+		switch (layout.normalEncoding)
+		{
+		case VertexNormalEncoding::Float3:
+		{
+			memcpy(normalDest, &vertex.normal, sizeof(vertex.normal));
+			break;
+		}
+		case VertexNormalEncoding::Snorm16:
+		{
+			const int16_t normal[4] = { EncodeSnorm16(vertex.normal.x), EncodeSnorm16(vertex.normal.y), EncodeSnorm16(vertex.normal.z), 0 };
+			memcpy(normalDest, normal, sizeof(normal));
+			break;
+		}
+		case VertexNormalEncoding::Octahedral:
+		{
+			int16_t normal[2];
+			EncodeOctahedral(vertex.normal, normal);
+			memcpy(normalDest, normal, sizeof(normal));
+			break;
+		}
+		default:
+			break;
+		}
+
+		uint8_t* colorDest = dest + colorOffset;
+		switch (layout.colorEncoding)
+		{
+		case VertexColorEncoding::Float3:
+		{
+			memcpy(colorDest, &vertex.color, sizeof(vertex.color));
+			break;
+		}
+		case VertexColorEncoding::Unorm8:
+		{
+			const uint8_t color[4] = { EncodeUnorm8(vertex.color.x), EncodeUnorm8(vertex.color.y), EncodeUnorm8(vertex.color.z), 255 };
+			memcpy(colorDest, color, sizeof(color));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+void DecodeVertices(std::span<const uint8_t> encoded, const VertexLayout& layout, std::vector<Vertex>& vertices)
+{
+	const UINT stride = GetVertexStride(layout);
+	const UINT colorOffset = GetColorOffset(layout);
+
+	vertices.resize(encoded.size() / stride);
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		Vertex& vertex = vertices[i];
+		const uint8_t* source = &encoded[i * stride];
+
+		memcpy(&vertex.position, source, sizeof(vertex.position));
+
+		const uint8_t* normalSource = source + sizeof(DirectX::XMFLOAT3);
+		switch (layout.normalEncoding)
+		{
+		case VertexNormalEncoding::Float3:
+		{
+			memcpy(&vertex.normal, normalSource, sizeof(vertex.normal));
+			break;
+		}
+		case VertexNormalEncoding::Snorm16:
+		{
+			int16_t normal[4];
+			memcpy(normal, normalSource, sizeof(normal));
+			vertex.normal = { DecodeSnorm16(normal[0]), DecodeSnorm16(normal[1]), DecodeSnorm16(normal[2]) };
+			break;
+		}
+		case VertexNormalEncoding::Octahedral:
+		{
+			int16_t normal[2];
+			memcpy(normal, normalSource, sizeof(normal));
+			vertex.normal = DecodeOctahedral(normal);
+			break;
+		}
+		default:
+			break;
+		}
+
+		const uint8_t* colorSource = source + colorOffset;
+		switch (layout.colorEncoding)
+		{
+		case VertexColorEncoding::Float3:
+		{
+			memcpy(&vertex.color, colorSource, sizeof(vertex.color));
+			break;
+		}
+		case VertexColorEncoding::Unorm8:
+		{
+			vertex.color = { DecodeUnorm8(colorSource[0]), DecodeUnorm8(colorSource[1]), DecodeUnorm8(colorSource[2]) };
+			break;
+		}
+		default:
+		{
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+			break;
+		}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "PlatformIncludes.h"
+#include "SceneTypes.h"
+
+/*
+	Describes how a Vertex is stored in a GPU vertex buffer.
+
+	Meshes are always imported and cached as full Vertex structs and are only encoded into their layout when they are
+	uploaded. The position always stays a float3 at offset 0, which keeps the vertex buffers usable as ray tracing geometry
+	no matter which layout is used. The input layout of a pipeline and the encoding on the CPU are both generated from the
+	same VertexLayoutDesc, so they can't get out of sync.
+*/
+
+enum class VertexNormalEncoding : uint8_t
+{
+	Float3,		// DXGI_FORMAT_R32G32B32_FLOAT, 12 bytes.
+	Snorm16,	// DXGI_FORMAT_R16G16B16A16_SNORM, 8 bytes.
+	Octahedral,	// DXGI_FORMAT_R16G16_SNORM, 4 bytes. Decoded in the vertex shader.
+	Count
+};
+
+enum class VertexColorEncoding : uint8_t
+{
+	Float3,		// DXGI_FORMAT_R32G32B32_FLOAT, 12 bytes.
+	Unorm8,		// DXGI_FORMAT_R8G8B8A8_UNORM, 4 bytes.
+	None,		// Not stored, shaders use white.
+	Count
+};
+
+struct VertexLayout
+{
+	VertexNormalEncoding normalEncoding = VertexNormalEncoding::Float3;
+	VertexColorEncoding colorEncoding = VertexColorEncoding::Float3;
+
+	bool operator==(const VertexLayout&) const = default;
+};
+
+constexpr uint32_t VertexLayoutCount = (uint32_t)VertexNormalEncoding::Count * (uint32_t)VertexColorEncoding::Count;
+
+// The original 36 byte layout, the same as the Vertex struct.
+constexpr VertexLayout FullVertexLayout = {};
+// 16 byte layout for meshes that don't use vertex colors.
+constexpr VertexLayout CompactVertexLayout = { VertexNormalEncoding::Octahedral, VertexColorEncoding::None };
+
+struct VertexElement
+{
+	const char* semanticName;
+	DXGI_FORMAT format;
+	UINT offset;
+};
+
+struct VertexLayoutDesc
+{
+	std::vector<VertexElement> elements;
+	UINT stride = 0;
+};
+
+// Dense index of a layout, used to look up per layout pipeline states.
+uint32_t GetVertexLayoutIndex(const VertexLayout& layout);
+VertexLayout GetVertexLayoutFromIndex(uint32_t index);
+
+VertexLayoutDesc GetVertexLayoutDesc(const VertexLayout& layout);
+UINT GetVertexStride(const VertexLayout& layout);
+
+// The element descs point to the semantic names of the layout desc, which are string literals.
+std::vector<D3D12_INPUT_ELEMENT_DESC> CreateInputElementDescs(const VertexLayoutDesc& layoutDesc);
+
+// Suffix of the vertex shader permutation that reads the layout, e.g. "_OctNormal_NoColor". Empty for layouts that don't need
+// a permutation. Must match the permutations compiled in shaders/CMakeLists.txt.
+std::string GetVertexLayoutShaderSuffix(const VertexLayout& layout);
+
+// Scalar encode/decode kernels. The decoders match what the input assembler and DeferredRenderVS.hlsl do on the GPU.
+int16_t EncodeSnorm16(float value);
+float DecodeSnorm16(int16_t value);
+uint8_t EncodeUnorm8(float value);
+float DecodeUnorm8(uint8_t value);
+void EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t (&encoded)[2]);
+DirectX::XMFLOAT3 DecodeOctahedral(const int16_t (&encoded)[2]);
+
+// Encodes the vertices into a tightly packed vertex buffer of the given layout.
+void EncodeVertices(std::span<const Vertex> vertices, const VertexLayout& layout, std::vector<uint8_t>& encoded);
+// Decodes a vertex buffer back into full vertices. Colors that aren't stored decode as white.
+void DecodeVertices(std::span<const uint8_t> encoded, const VertexLayout& layout, std::vector<Vertex>& vertices);
@@ -0,0 +1,190 @@
+#include "WideBVH.h"
+
+namespace
+{
+	float HalfSurfaceArea(const BVHNode& node)
+	{
+		const float x = node.boundsMax.x - node.boundsMin.x;
+		const float y = node.boundsMax.y - node.boundsMin.y;
+		const float z = node.boundsMax.z - node.boundsMin.z;
+		return x * y + y * z + z * x;
+	}
+}
+
+void BVHRayPacket::SetRay(uint32_t lane, const BVHRay& ray)
+{
+	originX[lane] = ray.origin.x;
+	originY[lane] = ray.origin.y;
+	originZ[lane] = ray.origin.z;
+	directionX[lane] = ray.direction.x;
+	directionY[lane] = ray.direction.y;
+	directionZ[lane] = ray.direction.z;
+	tMin[lane] = ray.tMin;
+	tMax[lane] = ray.tMax;
+}
+
+template <uint32_t Width>
+void WideBVH<Width>::Build(const BVH& bvh)
+{
+	m_nodes.clear();
+	m_triangles.assign(bvh.GetTriangles().begin(), bvh.GetTriangles().end());
+	m_primitiveIndices.assign(bvh.GetPrimitiveIndices().begin(), bvh.GetPrimitiveIndices().end());
+
+	if (!bvh.GetNodes().empty())
+	{
+		CollapseNode(bvh.GetNodes(), 0);
+	}
+}
+
+template <uint32_t Width>
+uint32_t WideBVH<Width>::CollapseNode(std::span<const BVHNode> binaryNodes, uint32_t binaryIndex)
+{
+	// Start with the two children of the binary node and keep opening the largest inner child until the node is full.
+	// A binary leaf, which only happens for a tiny root, becomes the single child of the node.
+	uint32_t children[Width];
+	uint32_t childCount = 0;
+
+	const BVHNode& binaryNode = binaryNodes[binaryIndex];
+	if (binaryNode.IsLeaf())
+	{
+		children[childCount++] = binaryIndex;
+	}
+	else
+	{
+		children[childCount++] = binaryNode.leftOrFirst;
+		children[childCount++] = binaryNode.leftOrFirst + 1;
+	}
+
+	while (childCount < Width)
+	{
+		uint32_t largestChild = Width;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; i++)
+		{
+			const BVHNode& child = binaryNodes[children[i]];
+			if (!child.IsLeaf() && HalfSurfaceArea(child) > largestArea)
+			{
+				largestChild = i;
+				largestArea = HalfSurfaceArea(child);
+			}
+		}
+
+		if (largestChild == Width)
+		{
+			break;
+		}
+
+		const uint32_t left = binaryNodes[children[largestChild]].leftOrFirst;
+		children[largestChild] = left;
+		children[childCount++] = left + 1;
+	}
+
+	const uint32_t nodeIndex = (uint32_t)m_nodes.size();
+	m_nodes.emplace_back();
+
+	WideBVHNode<Width> node = {};
+	node.childCount = childCount;
+	for (uint32_t i = 0; i < childCount; i++)
+	{
+		const BVHNode& child = binaryNodes[children[i]];
+		node.boundsMinX[i] = child.boundsMin.x;
+		node.boundsMinY[i] = child.boundsMin.y;
+		node.boundsMinZ[i] = child.boundsMin.z;
+		node.boundsMaxX[i] = child.boundsMax.x;
+		node.boundsMaxY[i] = child.boundsMax.y;
+		node.boundsMaxZ[i] = child.boundsMax.z;
+		node.primitiveCount[i] = child.primitiveCount;
+		node.childOrFirst[i] = child.IsLeaf() ? child.leftOrFirst : CollapseNode(binaryNodes, children[i]);
+	}
+
+	// The recursion above grows the node array, so the node is written last.
+	m_nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+template <uint32_t Width>
+bool WideBVH<Width>::IntersectAny(const BVHRay& ray) const
+{
+	bool isHit = false;
+	Traverse(ray, [&](uint32_t leafPrimitive)
+	{
+		float t;
+		isHit = IntersectTriangle(ray, m_triangles[leafPrimitive], ray.tMax, t);
+		return isHit;
+	});
+
+	return isHit;
+}
+
+template <uint32_t Width>
+uint32_t WideBVH<Width>::IntersectAnyPacket(const BVHRayPacket& packet, uint32_t activeMask) const
+{
+	return TraversePacket(packet, activeMask, [&](uint32_t leafPrimitive, uint32_t rayMask)
+	{
+		return IntersectTrianglePacket(packet, rayMask, m_triangles[leafPrimitive]);
+	});
+}
+
+template <uint32_t Width>
+std::span<const WideBVHNode<Width>> WideBVH<Width>::GetNodes() const
+{
+	return m_nodes;
+}
+
+template <uint32_t Width>
+std::span<const BVHTriangle> WideBVH<Width>::GetTriangles() const
+{
+	return m_triangles;
+}
+
+template <uint32_t Width>
+std::span<const uint32_t> WideBVH<Width>::GetPrimitiveIndices() const
+{
+	return m_primitiveIndices;
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+uint32_t IntersectTrianglePacket(const BVHRayPacket& packet, uint32_t activeMask, const BVHTriangle& triangle)
+{
+	using Simd = SimdFloat<BVHPacketSize>;
+
+	// The operations are done in the same order as in IntersectTriangle(), so both return the same hits.
+	const Simd edge1X = Simd::Broadcast(triangle.v1.x - triangle.v0.x);
+	const Simd edge1Y = Simd::Broadcast(triangle.v1.y - triangle.v0.y);
+	const Simd edge1Z = Simd::Broadcast(triangle.v1.z - triangle.v0.z);
+	const Simd edge2X = Simd::Broadcast(triangle.v2.x - triangle.v0.x);
+	const Simd edge2Y = Simd::Broadcast(triangle.v2.y - triangle.v0.y);
+	const Simd edge2Z = Simd::Broadcast(triangle.v2.z - triangle.v0.z);
+
+	const Simd directionX = Simd::Load(packet.directionX);
+	const Simd directionY = Simd::Load(packet.directionY);
+	const Simd directionZ = Simd::Load(packet.directionZ);
+
+	const Simd pX = directionY * edge2Z - directionZ * edge2Y;
+	const Simd pY = directionZ * edge2X - directionX * edge2Z;
+	const Simd pZ = directionX * edge2Y - directionY * edge2X;
+	const Simd determinant = edge1X * pX + edge1Y * pY + edge1Z * pZ;
+
+	const Simd zero = Simd::Broadcast(0.0f);
+	const Simd one = Simd::Broadcast(1.0f);
+	const Simd inverseDeterminant = one / determinant;
+
+	const Simd toOriginX = Simd::Load(packet.originX) - Simd::Broadcast(triangle.v0.x);
+	const Simd toOriginY = Simd::Load(packet.originY) - Simd::Broadcast(triangle.v0.y);
+	const Simd toOriginZ = Simd::Load(packet.originZ) - Simd::Broadcast(triangle.v0.z);
+	const Simd u = (toOriginX * pX + toOriginY * pY + toOriginZ * pZ) * inverseDeterminant;
+
+	const Simd qX = toOriginY * edge1Z - toOriginZ * edge1Y;
+	const Simd qY = toOriginZ * edge1X - toOriginX * edge1Z;
+	const Simd qZ = toOriginX * edge1Y - toOriginY * edge1X;
+	const Simd v = (directionX * qX + directionY * qY + directionZ * qZ) * inverseDeterminant;
+	const Simd t = (edge2X * qX + edge2Y * qY + edge2Z * qZ) * inverseDeterminant;
+
+	// Lanes with a zero determinant produce NaN or infinity above, which the comparisons reject or the first test masks out.
+	const Simd hit = (determinant != zero) & (u >= zero) & (u <= one) & (v >= zero) & (u + v <= one) &
+		(t >= Simd::Load(packet.tMin)) & (t <= Simd::Load(packet.tMax));
+
+	return MoveMask(hit) & activeMask;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "BVH.h"
+#include "SimdUtils.h"
+
+/*
+	4 or 8 wide BVH for any hit rays, collapsed from a binary BVH.
+
+	Every node stores the bounds of up to Width children in SoA order so that a single ray is tested against all of them
+	with one SIMD slab test. Ray packets go the other way: BVHPacketSize rays are tested against one child at a time with
+	the rays in the SIMD lanes, which pays off for coherent rays like the AO rays of neighboring pixels that start on the
+	same surface. Only any hit queries are supported, which is all that RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH needs.
+*/
+
+// Rays per packet.
+constexpr uint32_t BVHPacketSize = 8u;
+
+// Rays in SoA order, lane i of every array belongs to ray i.
+struct BVHRayPacket
+{
+	float originX[BVHPacketSize];
+	float originY[BVHPacketSize];
+	float originZ[BVHPacketSize];
+	float directionX[BVHPacketSize];
+	float directionY[BVHPacketSize];
+	float directionZ[BVHPacketSize];
+	float tMin[BVHPacketSize];
+	float tMax[BVHPacketSize];
+
+	void SetRay(uint32_t lane, const BVHRay& ray);
+};
+
+template <uint32_t Width>
+struct WideBVHNode
+{
+	float boundsMinX[Width];
+	float boundsMinY[Width];
+	float boundsMinZ[Width];
+	float boundsMaxX[Width];
+	float boundsMaxY[Width];
+	float boundsMaxZ[Width];
+	// Child node index for inner children, first primitive for leaf children.
+	uint32_t childOrFirst[Width];
+	// Zero for inner children.
+	uint32_t primitiveCount[Width];
+	// Children are packed at the front.
+	uint32_t childCount;
+};
+
+template <uint32_t Width>
+class WideBVH
+{
+	static_assert(Width == 4 || Width == 8, "Wide BVH nodes must have 4 or 8 children.");
+
+public:
+	// Collapses a binary BVH. Triangles and primitive indices are copied, so the source can be released afterwards.
+	void Build(const BVH& bvh);
+
+	// Same result as BVH::IntersectAny(), with the children of a node tested in parallel.
+	bool IntersectAny(const BVHRay& ray) const;
+	// Returns the subset of activeMask (one bit per packet lane) that hits any triangle.
+	uint32_t IntersectAnyPacket(const BVHRayPacket& packet, uint32_t activeMask) const;
+
+	// Visits the leaf primitives overlapped by the ray. The visitor is called as visitor(leafPrimitive) and returns true to
+	// end the traversal.
+	template <typename Visitor>
+	void Traverse(const BVHRay& ray, const Visitor& visitor) const;
+	// Visits the leaf primitives overlapped by the rays in activeMask. The visitor is called as visitor(leafPrimitive, rayMask)
+	// with the rays that reached the leaf and returns the rays that are done, which are dropped from the rest of the traversal.
+	// Returns the rays that are done.
+	template <typename Visitor>
+	uint32_t TraversePacket(const BVHRayPacket& packet, uint32_t activeMask, const Visitor& visitor) const;
+
+	std::span<const WideBVHNode<Width>> GetNodes() const;
+	std::span<const BVHTriangle> GetTriangles() const;
+	std::span<const uint32_t> GetPrimitiveIndices() const;
+
+private:
+	// Each level of the binary tree adds at most Width - 1 entries to the stack.
+	static constexpr uint32_t MaxStackSize = MaxBVHDepth * (Width - 1) + 1;
+
+	uint32_t CollapseNode(std::span<const BVHNode> binaryNodes, uint32_t binaryIndex);
+
+	std::vector<WideBVHNode<Width>> m_nodes;
+	std::vector<BVHTriangle> m_triangles;
+	std::vector<uint32_t> m_primitiveIndices;
+};
+
+// Tests the rays in activeMask against one triangle with the same math as IntersectTriangle() and returns the rays that hit it.
+uint32_t IntersectTrianglePacket(const BVHRayPacket& packet, uint32_t activeMask, const BVHTriangle& triangle);
+
+template <uint32_t Width>
+template <typename Visitor>
+void WideBVH<Width>::Traverse(const BVHRay& ray, const Visitor& visitor) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	using Simd = SimdFloat<Width>;
+
+	const Simd originX = Simd::Broadcast(ray.origin.x);
+	const Simd originY = Simd::Broadcast(ray.origin.y);
+	const Simd originZ = Simd::Broadcast(ray.origin.z);
+	const Simd inverseDirectionX = Simd::Broadcast(1.0f / ray.direction.x);
+	const Simd inverseDirectionY = Simd::Broadcast(1.0f / ray.direction.y);
+	const Simd inverseDirectionZ = Simd::Broadcast(1.0f / ray.direction.z);
+	const Simd tMin = Simd::Broadcast(ray.tMin);
+	const Simd tMax = Simd::Broadcast(ray.tMax);
+
+	uint32_t stack[MaxStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const WideBVHNode<Width>& node = m_nodes[stack[--stackSize]];
+
+		// Same slab test as IntersectBounds(), for all children at once.
+		const Simd tx0 = (Simd::Load(node.boundsMinX) - originX) * inverseDirectionX;
+		const Simd tx1 = (Simd::Load(node.boundsMaxX) - originX) * inverseDirectionX;
+		const Simd ty0 = (Simd::Load(node.boundsMinY) - originY) * inverseDirectionY;
+		const Simd ty1 = (Simd::Load(node.boundsMaxY) - originY) * inverseDirectionY;
+		const Simd tz0 = (Simd::Load(node.boundsMinZ) - originZ) * inverseDirectionZ;
+		const Simd tz1 = (Simd::Load(node.boundsMaxZ) - originZ) * inverseDirectionZ;
+
+		const Simd tNear = Max(Max(Max(Min(tx0, tx1), Min(ty0, ty1)), Min(tz0, tz1)), tMin);
+		const Simd tFar = Min(Min(Min(Max(tx0, tx1), Max(ty0, ty1)), Max(tz0, tz1)), tMax);
+
+		uint32_t hitMask = MoveMask(tNear <= tFar) & ((1u << node.childCount) - 1u);
+		while (hitMask != 0)
+		{
+			const uint32_t child = (uint32_t)std::countr_zero(hitMask);
+			hitMask &= hitMask - 1u;
+
+			if (node.primitiveCount[child] == 0)
+			{
+				stack[stackSize++] = node.childOrFirst[child];
+				continue;
+			}
+
+			for (uint32_t i = node.childOrFirst[child]; i < node.childOrFirst[child] + node.primitiveCount[child]; i++)
+			{
+				if (visitor(i))
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+template <uint32_t Width>
+template <typename Visitor>
+uint32_t WideBVH<Width>::TraversePacket(const BVHRayPacket& packet, uint32_t activeMask, const Visitor& visitor) const
+{
+	if (m_nodes.empty() || activeMask == 0)
+	{
+		return 0;
+	}
+
+	using Simd = SimdFloat<BVHPacketSize>;
+
+	const Simd originX = Simd::Load(packet.originX);
+	const Simd originY = Simd::Load(packet.originY);
+	const Simd originZ = Simd::Load(packet.originZ);
+	const Simd one = Simd::Broadcast(1.0f);
+	const Simd inverseDirectionX = one / Simd::Load(packet.directionX);
+	const Simd inverseDirectionY = one / Simd::Load(packet.directionY);
+	const Simd inverseDirectionZ = one / Simd::Load(packet.directionZ);
+	const Simd tMin = Simd::Load(packet.tMin);
+	const Simd tMax = Simd::Load(packet.tMax);
+
+	struct StackEntry
+	{
+		uint32_t nodeIndex;
+		uint32_t rayMask;
+	};
+
+	StackEntry stack[MaxStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, activeMask };
+
+	uint32_t doneMask = 0;
+	while (stackSize > 0)
+	{
+		const StackEntry entry = stack[--stackSize];
+		const uint32_t rayMask = entry.rayMask & ~doneMask;
+		if (rayMask == 0)
+		{
+			continue;
+		}
+
+		const WideBVHNode<Width>& node = m_nodes[entry.nodeIndex];
+		for (uint32_t child = 0; child < node.childCount; child++)
+		{
+			const Simd tx0 = (Simd::Broadcast(node.boundsMinX[child]) - originX) * inverseDirectionX;
+			const Simd tx1 = (Simd::Broadcast(node.boundsMaxX[child]) - originX) * inverseDirectionX;
+			const Simd ty0 = (Simd::Broadcast(node.boundsMinY[child]) - originY) * inverseDirectionY;
+			const Simd ty1 = (Simd::Broadcast(node.boundsMaxY[child]) - originY) * inverseDirectionY;
+			const Simd tz0 = (Simd::Broadcast(node.boundsMinZ[child]) - originZ) * inverseDirectionZ;
+			const Simd tz1 = (Simd::Broadcast(node.boundsMaxZ[child]) - originZ) * inverseDirectionZ;
+
+			const Simd tNear = Max(Max(Max(Min(tx0, tx1), Min(ty0, ty1)), Min(tz0, tz1)), tMin);
+			const Simd tFar = Min(Min(Min(Max(tx0, tx1), Max(ty0, ty1)), Max(tz0, tz1)), tMax);
+
+			const uint32_t childRayMask = MoveMask(tNear <= tFar) & rayMask & ~doneMask;
+			if (childRayMask == 0)
+			{
+				continue;
+			}
+
+			if (node.primitiveCount[child] == 0)
+			{
+				stack[stackSize++] = { node.childOrFirst[child], childRayMask };
+				continue;
+			}
+
+			for (uint32_t i = node.childOrFirst[child]; i < node.childOrFirst[child] + node.primitiveCount[child]; i++)
+			{
+				const uint32_t leafRayMask = childRayMask & ~doneMask;
+				if (leafRayMask == 0)
+				{
+					break;
+				}
+
+				doneMask |= visitor(i, leafRayMask);
+			}
+
+			if ((activeMask & ~doneMask) == 0)
+			{
+				return doneMask;
+			}
+		}
+	}
+
+	return doneMask;
+}
+
+// Width whose nodes fit a single native SIMD register.
+using NativeWideBVH = WideBVH<NativeSimdWidth>;
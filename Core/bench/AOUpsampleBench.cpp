@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "AOUpsampler.h"
+#include "BenchUtils.h"
+
+/*
+	Measures how close the upsampled AO of every resolution mode gets to the converged AO of the default scene, and how
+	many rays it takes to get there.
+
+	Usage: AOUpsampleBench [frames] [reference frames]
+*/
+
+namespace
+{
+	constexpr uint32_t Width = 640u;
+	constexpr uint32_t Height = 360u;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t frameCount = argc > 1 ? (uint32_t)std::max(1, atoi(argv[1])) : 16u;
+	const uint32_t referenceFrameCount = argc > 2 ? (uint32_t)std::max(1, atoi(argv[2])) : 64u;
+
+	BenchScene benchScene;
+	CreateBenchScene("Sphere.obj", Width, Height, benchScene);
+
+	const std::vector<AOUpsampleBenchmarkResult> results = BenchmarkAOUpsampling(benchScene.scene, benchScene.gBuffer, frameCount, referenceFrameCount);
+
+	printf("Sphere.obj, %ux%u pixels, average of %u frames against %u full resolution frames\n", Width, Height, frameCount, referenceFrameCount);
+	printf("%-14s %12s %10s %12s %16s %16s\n", "mode", "rays/frame", "fewer", "mean error", "without noise", "fallback pixels");
+	for (const AOUpsampleBenchmarkResult& result : results)
+	{
+		printf("%-14s %12u %9.2fx %12.3f %16.3f %16u\n", GetAOResolutionModeName(result.mode), result.rayCount,
+			(double)results[0].rayCount / std::max(1u, result.rayCount), result.meanAbsoluteError, result.reconstructionError, result.fallbackPixelCount);
+	}
+
+	return 0;
+}
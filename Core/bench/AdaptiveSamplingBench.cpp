@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "AdaptiveSampling.h"
+#include "BenchUtils.h"
+
+/*
+	Compares the accumulated AO of the default scene with one ray for every surface pixel against adaptive sampling with
+	the same ray budget and with half of it, after the same number of frames.
+
+	Usage: AdaptiveSamplingBench [frames] [reference frames]
+*/
+
+namespace
+{
+	constexpr uint32_t Width = 640u;
+	constexpr uint32_t Height = 360u;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t frameCount = argc > 1 ? (uint32_t)std::max(1, atoi(argv[1])) : 64u;
+	const uint32_t referenceFrameCount = argc > 2 ? (uint32_t)std::max(1, atoi(argv[2])) : 256u;
+
+	BenchScene benchScene;
+	CreateBenchScene("Sphere.obj", Width, Height, benchScene);
+	const TemporalCamera camera = CreateTemporalCamera(benchScene.eye, benchScene.target, benchScene.verticalFov, (float)Width / (float)Height);
+
+	uint32_t surfacePixelCount = 0;
+	for (const DirectX::XMFLOAT4& position : benchScene.gBuffer.positions)
+	{
+		surfacePixelCount += position.w != 0.0f ? 1u : 0u;
+	}
+
+	printf("Sphere.obj, %ux%u pixels, %u surface pixels, %u frames against %u reference frames\n", Width, Height, surfacePixelCount, frameCount, referenceFrameCount);
+	printf("%-10s %8s %14s %14s %12s %10s\n", "sampling", "budget", "rays", "max frame rays", "over budget", "RMSE");
+
+	bool isOverBudget = false;
+	for (float budgetScale : { 1.0f, 0.5f })
+	{
+		// The budget is spread over every pixel of the screen, uniform sampling only traces the surface pixels.
+		AdaptiveSamplingSettings settings;
+		settings.enabled = true;
+		settings.raysPerPixelBudget = budgetScale * surfacePixelCount / (Width * Height);
+
+		for (const AdaptiveSamplingBenchmarkResult& result : BenchmarkAdaptiveSampling(benchScene.scene, benchScene.gBuffer, camera, frameCount, referenceFrameCount, settings))
+		{
+			if (!result.isAdaptive && budgetScale != 1.0f)
+			{
+				continue;
+			}
+
+			printf("%-10s %8.3f %14llu %14u %12u %10.4f\n", result.isAdaptive ? "Adaptive" : "Uniform", result.isAdaptive ? settings.raysPerPixelBudget : 0.0f,
+				(unsigned long long)result.rayCount, result.maxFrameRayCount, result.overBudgetFrameCount, result.rootMeanSquaredError);
+			isOverBudget = isOverBudget || result.overBudgetFrameCount > 1u;
+		}
+	}
+
+	// Only the first frame, in which no pixel has a history yet, may go over the budget.
+	return isOverBudget ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "BenchUtils.h"
+#include "BVH.h"
+#include "ObjImporter.h"
+#include "ParallelUtils.h"
+
+/*
+	Builds the BVH of every bundled asset on one thread, four threads and all cores and prints the tree statistics. Every
+	build has to produce the same tree.
+*/
+
+namespace
+{
+	constexpr uint32_t IterationCount = 10u;
+	const char* AssetNames[] = { "cube.obj", "Sphere.obj", "LowpolyTree.obj", "Koltuk.obj", "pumpkin.obj", "teapot.obj" };
+	const uint32_t ThreadCounts[] = { 1u, 4u, 0u };
+}
+
+int main()
+{
+	printf("%-16s %8s %10s %10s %10s %10s %10s %10s %14s\n", "asset", "threads", "triangles", "nodes", "leaves", "max depth", "SAH cost", "build ms", "deterministic");
+
+	bool allMatch = true;
+	for (const char* assetName : AssetNames)
+	{
+		MeshData mesh;
+		ImportOBJ(GetAssetPath(assetName), mesh);
+		const BVHGeometryDesc geometryDesc = CreateBVHGeometryDesc(mesh.vertices, mesh.indices);
+
+		BVH reference;
+		reference.Build(geometryDesc, { .threadCount = 1u });
+
+		for (uint32_t threadCount : ThreadCounts)
+		{
+			BVHBuildSettings settings;
+			settings.threadCount = threadCount;
+
+			BVH bvh;
+			const double milliseconds = MeasureMilliseconds(IterationCount, [&]()
+			{
+				bvh.Build(geometryDesc, settings);
+			});
+
+			// The node order depends on the thread count, so compare what the tree stores for its leaves.
+			const BVHStats& stats = bvh.GetStats();
+			const bool isDeterministic = stats.nodeCount == reference.GetStats().nodeCount && stats.leafCount == reference.GetStats().leafCount &&
+				std::equal(bvh.GetPrimitiveIndices().begin(), bvh.GetPrimitiveIndices().end(), reference.GetPrimitiveIndices().begin());
+			allMatch = allMatch && isDeterministic;
+
+			printf("%-16s %8u %10u %10u %10u %10u %10.2f %10.3f %14s\n", assetName, threadCount == 0 ? GetDefaultThreadCount() : threadCount,
+				stats.triangleCount, stats.nodeCount, stats.leafCount, stats.maxDepth, stats.sahCost, milliseconds, isDeterministic ? "yes" : "NO");
+		}
+	}
+
+	if (!allMatch)
+	{
+		printf("The multithreaded builds do not match the single threaded one.\n");
+		return 1;
+	}
+	return 0;
+}
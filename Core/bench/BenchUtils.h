@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "ObjImporter.h"
+#include "RTAOReference.h"
+#include "RaytracingScene.h"
+#include "SceneUtils.h"
+
+/*
+	Small helpers shared by the benchmark executables.
+*/
+
+// Path of a file in the assets directory of the source tree.
+inline std::string GetAssetPath(const std::string& fileName)
+{
+	return std::string(RTAO_ASSET_DIR) + "/" + fileName;
+}
+
+// Runs the function the given number of times and returns the fastest run in milliseconds.
+template<typename Function>
+double MeasureMilliseconds(uint32_t iterationCount, Function&& function)
+{
+	double best = 0.0;
+	for (uint32_t i = 0; i < iterationCount; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (i == 0 || milliseconds < best)
+		{
+			best = milliseconds;
+		}
+	}
+	return best;
+}
+
+// The ray traced part of the default scene and a G-buffer of it, as seen from above and in front of the instance grid.
+struct BenchScene
+{
+	RaytracingScene scene;
+	RTAOGBuffer gBuffer;
+	DirectX::XMFLOAT3 eye;
+	DirectX::XMFLOAT3 target;
+	float verticalFov = 1.0f;
+};
+
+inline void CreateBenchScene(const std::string& assetName, uint32_t width, uint32_t height, BenchScene& benchScene)
+{
+	MeshData mesh;
+	ImportOBJ(GetAssetPath(assetName), mesh);
+
+	// The instance grid is randomized, fix the seed so that every run measures the same scene.
+	srand(0u);
+	RenderInstanceMap renderInstancesByID;
+	CreateSceneRenderInstances(renderInstancesByID);
+	benchScene.scene.Build(CreateBVHGeometryDesc(mesh.vertices, mesh.indices), renderInstancesByID[RTRenderObjectID]);
+
+	const BVHNode& root = benchScene.scene.GetTopLevel().GetNodes()[0];
+	benchScene.target = { (root.boundsMin.x + root.boundsMax.x) * 0.5f, (root.boundsMin.y + root.boundsMax.y) * 0.5f, (root.boundsMin.z + root.boundsMax.z) * 0.5f };
+	benchScene.eye = { benchScene.target.x, benchScene.target.y + (root.boundsMax.y - root.boundsMin.y),
+		benchScene.target.z - (root.boundsMax.z - root.boundsMin.z) * 1.2f };
+	benchScene.gBuffer = CreateSyntheticGBuffer(benchScene.scene, width, height, benchScene.eye, benchScene.target, benchScene.verticalFov);
+}
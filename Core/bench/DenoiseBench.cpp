@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AtrousDenoiser.h"
+#include "BenchUtils.h"
+
+/*
+	Measures the à-trous denoiser in Scalar and Simd mode on one sample per pixel of AO of the default scene, on one thread
+	and on every core. The iteration count can be given as the first argument.
+	Exits with 1 if the Simd result differs from the Scalar one.
+*/
+
+namespace
+{
+	constexpr uint32_t Width = 640u;
+	constexpr uint32_t Height = 360u;
+	constexpr uint32_t IterationCount = 5u;
+}
+
+int main(int argc, char** argv)
+{
+	DenoiseSettings settings;
+	if (argc > 1)
+	{
+		settings.iterationCount = (uint32_t)std::max(1, atoi(argv[1]));
+	}
+
+	BenchScene benchScene;
+	CreateBenchScene("Sphere.obj", Width, Height, benchScene);
+
+	std::vector<float> ao;
+	TraceAmbientOcclusion(benchScene.scene, benchScene.gBuffer, 1u, ao);
+
+	const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+	printf("Sphere.obj, %ux%u pixels, %u iterations, fastest of %u runs\n", Width, Height, settings.iterationCount, IterationCount);
+	printf("%8s %8s %12s %10s %16s\n", "mode", "threads", "ms", "speedup", "max difference");
+
+	bool isMismatched = false;
+	for (uint32_t threadCount : { 1u, coreCount })
+	{
+		std::vector<DenoiseBenchmarkResult> fastestResults;
+		for (uint32_t i = 0; i < IterationCount; i++)
+		{
+			const std::vector<DenoiseBenchmarkResult> results = BenchmarkDenoiser(benchScene.gBuffer, ao, settings, threadCount);
+			if (fastestResults.empty())
+			{
+				fastestResults = results;
+				continue;
+			}
+			for (size_t mode = 0; mode < results.size(); mode++)
+			{
+				if (results[mode].stats.filterMilliseconds < fastestResults[mode].stats.filterMilliseconds)
+				{
+					fastestResults[mode] = results[mode];
+				}
+			}
+		}
+
+		const double scalarMilliseconds = fastestResults[(size_t)DenoiseMode::Scalar].stats.filterMilliseconds;
+		for (const DenoiseBenchmarkResult& result : fastestResults)
+		{
+			printf("%8s %8u %12.2f %9.2fx %16g\n", GetDenoiseModeName(result.mode), result.stats.threadCount, result.stats.filterMilliseconds,
+				scalarMilliseconds / result.stats.filterMilliseconds, result.maxDifference);
+			isMismatched = isMismatched || result.maxDifference != 0.0f;
+		}
+
+		if (threadCount == coreCount)
+		{
+			break;
+		}
+	}
+
+	return isMismatched ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "FrustumCulling.h"
+
+/*
+	Measures culling a million random unit cubes with CullInstances() in Scalar and Simd mode and with CullInstanceRange()
+	on an instance store. The instance count can be given as the first argument.
+	Exits with 1 if the store finds other instances than the scalar path.
+*/
+
+int main(int argc, char** argv)
+{
+	InstanceCullingBenchmarkSettings settings;
+	if (argc > 1)
+	{
+		settings.instanceCount = (uint32_t)std::max(1, atoi(argv[1]));
+	}
+
+	const InstanceCullingBenchmarkResult result = BenchmarkInstanceCulling(settings);
+
+	printf("%u instances, %u visible, averaged over %u iterations\n", result.instanceCount, result.visibleCount, settings.iterationCount);
+	printf("%10s %16s %10s\n", "path", "instances / ms", "speedup");
+	printf("%10s %16.0f %9.2fx\n", "Scalar", result.scalarInstancesPerMillisecond, 1.0);
+	printf("%10s %16.0f %9.2fx\n", "Simd", result.simdInstancesPerMillisecond, result.simdInstancesPerMillisecond / result.scalarInstancesPerMillisecond);
+	printf("%10s %16.0f %9.2fx\n", "Store", result.storeInstancesPerMillisecond, result.storeInstancesPerMillisecond / result.scalarInstancesPerMillisecond);
+
+	if (result.mismatchedCount != 0)
+	{
+		printf("%u instances differ from the scalar path\n", result.mismatchedCount);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "AppDefines.h"
+#include "JobSystem.h"
+
+/*
+	Measures the per frame sync latency of the job system at 2, 8 and 32 contexts, or at the context counts given as
+	arguments. Every render pass of a frame dispatches one empty job per context and waits for them.
+*/
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32_t> contextCounts;
+	for (int i = 1; i < argc; i++)
+	{
+		contextCounts.push_back((uint32_t)std::max(1, atoi(argv[i])));
+	}
+	if (contextCounts.empty())
+	{
+		contextCounts = { 2u, 8u, 32u };
+	}
+
+	constexpr uint32_t FrameCount = 1000u;
+	constexpr uint32_t PassCount = NumRenderPasses;
+	printf("%u passes per frame, %u frames\n", PassCount, FrameCount);
+	printf("%10s %12s %12s %16s\n", "contexts", "frame us", "pass us", "parks / frame");
+
+	for (uint32_t contextCount : contextCounts)
+	{
+		const JobSyncBenchmarkResult result = BenchmarkJobSync(contextCount, FrameCount, PassCount);
+		printf("%10u %12.2f %12.2f %16.2f\n", result.contextCount, result.frameMicroseconds, result.frameMicroseconds / PassCount, result.parksPerFrame);
+	}
+
+	return 0;
+}
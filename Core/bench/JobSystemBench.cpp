@@ -0,0 +1,38 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+/*
+	Measures the scheduling overhead of the job system with fake command recording jobs, for 1 to N threads.
+	The speedup is relative to running the same jobs one after the other on the calling thread.
+*/
+
+int main()
+{
+	const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1u; threadCount < coreCount; threadCount *= 2u)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(coreCount);
+
+	const JobSystemBenchmarkSettings settings;
+	printf("%u jobs per frame, %u commands per job, %u frames\n", settings.jobCount, settings.commandsPerJob, settings.frameCount);
+	printf("%8s %12s %12s %10s %14s %12s\n", "threads", "serial ms", "parallel ms", "speedup", "empty job ns", "stolen jobs");
+
+	for (uint32_t threadCount : threadCounts)
+	{
+		JobSystem jobSystem(threadCount);
+		const JobSystemBenchmarkResult result = BenchmarkJobSystem(jobSystem, settings);
+		const JobSystemStats stats = jobSystem.GetStats();
+
+		printf("%8u %12.3f %12.3f %9.2fx %14.1f %12llu\n", result.threadCount, result.serialFrameMilliseconds, result.parallelFrameMilliseconds,
+			result.speedup, result.emptyJobNanoseconds, (unsigned long long)stats.stolenJobCount);
+	}
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <cstring>
+
+#include "BenchUtils.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "ObjImporter.h"
+
+/*
+	Builds the meshlets of every bundled asset the way the importer does, after vertex cache optimization,
+	for a few meshlet size limits. Every build is run twice to check that the output is deterministic.
+*/
+
+namespace
+{
+	constexpr uint32_t IterationCount = 10u;
+	const char* AssetNames[] = { "cube.obj", "Sphere.obj", "LowpolyTree.obj", "Koltuk.obj", "pumpkin.obj", "teapot.obj" };
+	const MeshletSettings SettingsList[] = { { 64u, 124u }, { 128u, 256u }, { 256u, 256u } };
+
+	bool IsEqual(const MeshletData& a, const MeshletData& b)
+	{
+		return a.meshlets.size() == b.meshlets.size() && a.meshletVertices == b.meshletVertices && a.meshletPrimitives == b.meshletPrimitives &&
+			memcmp(a.meshlets.data(), b.meshlets.data(), a.meshlets.size() * sizeof(Meshlet)) == 0;
+	}
+}
+
+int main()
+{
+	printf("%-16s %10s %10s %10s %10s %10s %10s %10s %14s\n", "asset", "triangles", "max verts", "max prims", "meshlets", "avg verts", "avg prims", "build ms", "deterministic");
+
+	for (const char* assetName : AssetNames)
+	{
+		MeshData mesh;
+		ImportOBJ(GetAssetPath(assetName), mesh);
+		OptimizeMesh(mesh);
+
+		for (const MeshletSettings& settings : SettingsList)
+		{
+			MeshletData meshletData;
+			MeshletStats stats;
+			const double milliseconds = MeasureMilliseconds(IterationCount, [&]()
+			{
+				meshletData = {};
+				stats = BuildMeshlets(mesh.vertices, mesh.indices, settings, meshletData);
+			});
+
+			MeshletData secondBuild;
+			BuildMeshlets(mesh.vertices, mesh.indices, settings, secondBuild);
+
+			printf("%-16s %10zu %10u %10u %10u %10.1f %10.1f %10.3f %14s\n", assetName, mesh.indices.size() / 3u, settings.maxVertices, settings.maxPrimitives,
+				stats.meshletCount, stats.averageVertexCount, stats.averagePrimitiveCount, milliseconds, IsEqual(meshletData, secondBuild) ? "yes" : "NO");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "BenchUtils.h"
+#include "MeshLoader.h"
+#include "ObjImporter.h"
+
+/*
+	Compares the tinyobjloader based LoadMeshFromOBJ() with the parallel ImportOBJ() on the bundled assets,
+	once with a single thread and once with one thread per core. The bundled assets are small, so a generated
+	grid with a million triangles is imported from memory as well to show how the importer scales.
+*/
+
+namespace
+{
+	constexpr uint32_t IterationCount = 5u;
+	const char* AssetNames[] = { "Koltuk.obj", "pumpkin.obj", "teapot.obj" };
+	constexpr uint32_t GridSize = 708u; // 2 * 707 * 707 is just under a million triangles.
+
+	// Writes a grid of quads with per corner normals and texture coordinates.
+	std::string CreateGridOBJ(uint32_t gridSize)
+	{
+		std::string obj;
+		obj.reserve(size_t(gridSize) * gridSize * 96u);
+
+		char line[128];
+		for (uint32_t y = 0; y < gridSize; y++)
+		{
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				const float u = float(x) / float(gridSize - 1u);
+				const float v = float(y) / float(gridSize - 1u);
+				obj.append(line, snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn 0 1 0\n", u, 0.0f, v, u, v));
+			}
+		}
+
+		for (uint32_t y = 0; y + 1u < gridSize; y++)
+		{
+			for (uint32_t x = 0; x + 1u < gridSize; x++)
+			{
+				const uint32_t i0 = y * gridSize + x + 1u;
+				const uint32_t i1 = i0 + 1u;
+				const uint32_t i2 = i0 + gridSize + 1u;
+				const uint32_t i3 = i0 + gridSize;
+				obj.append(line, snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", i0, i0, i1, i1, i2, i2, i3, i3));
+			}
+		}
+		return obj;
+	}
+}
+
+int main()
+{
+	const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+	printf("%-12s %12s %12s %12s %12s %10s %10s\n", "asset", "vertices", "tinyobj ms", "1 thread ms", "N thread ms", "threads", "speedup");
+
+	for (const char* assetName : AssetNames)
+	{
+		const std::string path = GetAssetPath(assetName);
+
+		MeshData referenceMesh;
+		const double referenceMilliseconds = MeasureMilliseconds(IterationCount, [&]()
+		{
+			referenceMesh = {};
+			LoadMeshFromOBJ(path, referenceMesh);
+		});
+
+		ObjImportSettings settings;
+		settings.threadCount = 1u;
+
+		MeshData mesh;
+		const double singleMilliseconds = MeasureMilliseconds(IterationCount, [&]()
+		{
+			ImportOBJ(path, mesh, settings);
+		});
+
+		settings.threadCount = coreCount;
+		ObjImportStats stats;
+		const double parallelMilliseconds = MeasureMilliseconds(IterationCount, [&]()
+		{
+			ImportOBJ(path, mesh, settings, &stats);
+		});
+
+		printf("%-12s %12zu %12.2f %12.2f %12.2f %10u %9.2fx\n", assetName, mesh.vertices.size(), referenceMilliseconds, singleMilliseconds,
+			parallelMilliseconds, stats.threadCount, referenceMilliseconds / parallelMilliseconds);
+	}
+
+	const std::string grid = CreateGridOBJ(GridSize);
+	for (uint32_t threadCount = 1u; threadCount <= coreCount; threadCount *= 2u)
+	{
+		ObjImportSettings settings;
+		settings.threadCount = threadCount;
+
+		MeshData mesh;
+		ObjImportStats stats;
+		const double milliseconds = MeasureMilliseconds(IterationCount, [&]()
+		{
+			ImportOBJFromMemory(grid.data(), grid.size(), mesh, settings, &stats);
+		});
+
+		printf("grid %ux%u: %zu triangles, %u threads, %u chunks, %.2f ms (parse %.2f ms, weld %.2f ms)\n", GridSize, GridSize, mesh.indices.size() / 3u,
+			stats.threadCount, stats.chunkCount, milliseconds, stats.parseMilliseconds, stats.weldMilliseconds);
+	}
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "RTAOReference.h"
+
+/*
+	Measures the ray throughput of the CPU reference tracer on the default scene with 1 to N threads.
+
+	Usage: RTAOBench [samples per pixel...]
+*/
+
+namespace
+{
+	constexpr uint32_t Width = 640u;
+	constexpr uint32_t Height = 360u;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32_t> samplesPerPixel;
+	for (int i = 1; i < argc; i++)
+	{
+		samplesPerPixel.push_back(std::max(1, atoi(argv[i])));
+	}
+	if (samplesPerPixel.empty())
+	{
+		samplesPerPixel.push_back(RTAONumSamples);
+	}
+
+	BenchScene benchScene;
+	CreateBenchScene("Sphere.obj", Width, Height, benchScene);
+
+	const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+	printf("Sphere.obj, %u instances, %ux%u pixels\n", (uint32_t)benchScene.scene.GetTopLevel().GetPrimitiveIndices().size(), Width, Height);
+	printf("%-14s %6s %8s %12s %12s %14s %12s\n", "mode", "spp", "threads", "rays", "ms", "Mrays/s", "mismatches");
+
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1u; threadCount < coreCount; threadCount *= 2u)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(coreCount);
+
+	for (uint32_t threadCount : threadCounts)
+	{
+		for (const RTAOBenchmarkResult& result : BenchmarkAmbientOcclusion(benchScene.scene, benchScene.gBuffer, samplesPerPixel, threadCount))
+		{
+			printf("%-14s %6u %8u %12llu %12.2f %14.2f %12u\n", GetRTAOTraceModeName(result.mode), result.samplesPerPixel, result.stats.threadCount,
+				(unsigned long long)result.stats.rayCount, result.stats.traceMilliseconds, result.stats.raysPerSecond / 1e6, result.mismatchedPixelCount);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "RTAOReference.h"
+#include "WideBVH.h"
+
+/*
+	Compares single ray traversal of the binary BVH with single ray and packet traversal of the wide BVH at 1, 4 and 16
+	samples per pixel, on all cores. Every mode has to produce the same AO as the single ray reference.
+*/
+
+namespace
+{
+	constexpr uint32_t Width = 640u;
+	constexpr uint32_t Height = 360u;
+	constexpr uint32_t SamplesPerPixel[] = { 1u, 4u, 16u };
+}
+
+int main()
+{
+	BenchScene benchScene;
+	CreateBenchScene("Sphere.obj", Width, Height, benchScene);
+
+	printf("%u wide BVH nodes, %u ray packets, %ux%u pixels\n", NativeSimdWidth, BVHPacketSize, Width, Height);
+	printf("%-14s %6s %8s %12s %12s %14s %10s %12s\n", "mode", "spp", "threads", "rays", "ms", "Mrays/s", "speedup", "mismatches");
+
+	const std::vector<RTAOBenchmarkResult> results = BenchmarkAmbientOcclusion(benchScene.scene, benchScene.gBuffer, SamplesPerPixel);
+
+	bool allMatch = true;
+	double singleRayThroughput = 0.0;
+	for (const RTAOBenchmarkResult& result : results)
+	{
+		// Results are ordered by sample count and then by mode, starting with SingleRay.
+		if (result.mode == RTAOTraceMode::SingleRay)
+		{
+			singleRayThroughput = result.stats.raysPerSecond;
+		}
+
+		printf("%-14s %6u %8u %12llu %12.2f %14.2f %9.2fx %12u\n", GetRTAOTraceModeName(result.mode), result.samplesPerPixel, result.stats.threadCount,
+			(unsigned long long)result.stats.rayCount, result.stats.traceMilliseconds, result.stats.raysPerSecond / 1e6,
+			result.stats.raysPerSecond / singleRayThroughput, result.mismatchedPixelCount);
+		allMatch = allMatch && result.mismatchedPixelCount == 0;
+	}
+
+	if (!allMatch)
+	{
+		printf("The wide BVH modes do not match the single ray reference.\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,180 @@
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "AOUpsampler.h"
+#include "TestScene.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Not a multiple of the block sizes, so the blocks on the right and bottom edges stick out of the screen.
+	constexpr uint32_t Width = 162u;
+	constexpr uint32_t Height = 91u;
+
+	// Frames until every pixel has been traced once.
+	uint32_t GetCycleLength(AOResolutionMode mode)
+	{
+		switch (mode)
+		{
+		case AOResolutionMode::Half:
+			return 4u;
+		case AOResolutionMode::Quarter:
+			return 16u;
+		case AOResolutionMode::Checkerboard:
+			return 2u;
+		default:
+			return 1u;
+		}
+	}
+}
+
+TEST_CASE(ConstantsMatchTheShader)
+{
+	CHECK_EQ((float)ReadShaderDefine("AOUpsampleCS.hlsl", "NORMAL_POWER"), AOUpsampleNormalPower);
+	CHECK_EQ((float)ReadShaderDefine("AOUpsampleCS.hlsl", "PLANE_THRESHOLD"), AOUpsamplePlaneThreshold);
+	CHECK_EQ((float)ReadShaderDefine("AOUpsampleCS.hlsl", "MIN_WEIGHT"), AOUpsampleMinWeight);
+
+	CHECK_EQ((uint32_t)ReadShaderDefine("AOResolution.hlsli", "RESOLUTION_MODE_FULL"), (uint32_t)AOResolutionMode::Full);
+	CHECK_EQ((uint32_t)ReadShaderDefine("AOResolution.hlsli", "RESOLUTION_MODE_HALF"), (uint32_t)AOResolutionMode::Half);
+	CHECK_EQ((uint32_t)ReadShaderDefine("AOResolution.hlsli", "RESOLUTION_MODE_QUARTER"), (uint32_t)AOResolutionMode::Quarter);
+	CHECK_EQ((uint32_t)ReadShaderDefine("AOResolution.hlsli", "RESOLUTION_MODE_CHECKERBOARD"), (uint32_t)AOResolutionMode::Checkerboard);
+}
+
+TEST_CASE(TraceSizesRoundUp)
+{
+	const AOTraceSize full = GetAOTraceSize(AOResolutionMode::Full, Width, Height);
+	const AOTraceSize half = GetAOTraceSize(AOResolutionMode::Half, Width, Height);
+	const AOTraceSize quarter = GetAOTraceSize(AOResolutionMode::Quarter, Width, Height);
+	const AOTraceSize checkerboard = GetAOTraceSize(AOResolutionMode::Checkerboard, Width, Height);
+
+	CHECK_EQ(full.width, 162u);
+	CHECK_EQ(full.height, 91u);
+	CHECK_EQ(half.width, 81u);
+	CHECK_EQ(half.height, 46u);
+	CHECK_EQ(quarter.width, 41u);
+	CHECK_EQ(quarter.height, 23u);
+	CHECK_EQ(checkerboard.width, 81u);
+	CHECK_EQ(checkerboard.height, 91u);
+}
+
+TEST_CASE(EveryPixelIsTracedOncePerCycle)
+{
+	// Edge blocks that are clamped to the screen trace some pixels more than once, so only the inner part is exact.
+	constexpr uint32_t InnerWidth = 160u;
+	constexpr uint32_t InnerHeight = 88u;
+
+	for (uint32_t mode = 0; mode < (uint32_t)AOResolutionMode::Count; mode++)
+	{
+		const AOTraceSize traceSize = GetAOTraceSize((AOResolutionMode)mode, Width, Height);
+		std::vector<uint32_t> traceCounts((size_t)Width * Height, 0u);
+		for (uint32_t frame = 0; frame < GetCycleLength((AOResolutionMode)mode); frame++)
+		{
+			for (uint32_t traceY = 0; traceY < traceSize.height; traceY++)
+			{
+				for (uint32_t traceX = 0; traceX < traceSize.width; traceX++)
+				{
+					uint32_t x, y;
+					GetAOTracePixel((AOResolutionMode)mode, traceX, traceY, frame, Width, Height, x, y);
+					REQUIRE(x < Width && y < Height);
+					traceCounts[(size_t)y * Width + x]++;
+				}
+			}
+		}
+
+		uint32_t wrongCount = 0;
+		for (uint32_t y = 0; y < Height; y++)
+		{
+			for (uint32_t x = 0; x < Width; x++)
+			{
+				const uint32_t traceCount = traceCounts[(size_t)y * Width + x];
+				const bool isInner = x < InnerWidth && y < InnerHeight;
+				wrongCount += (isInner ? traceCount != 1u : traceCount == 0u) ? 1u : 0u;
+			}
+		}
+		CHECK_EQ(wrongCount, 0u);
+	}
+}
+
+TEST_CASE(TraceGBufferHoldsTheTracedPixels)
+{
+	const RTAOGBuffer traceGBuffer = CreateAOTraceGBuffer(GetTestGBuffer(Width, Height), AOResolutionMode::Quarter, 5u);
+	REQUIRE(traceGBuffer.positions.size() == (size_t)traceGBuffer.width * traceGBuffer.height);
+
+	for (uint32_t traceY = 0; traceY < traceGBuffer.height; traceY++)
+	{
+		for (uint32_t traceX = 0; traceX < traceGBuffer.width; traceX++)
+		{
+			uint32_t x, y;
+			GetAOTracePixel(AOResolutionMode::Quarter, traceX, traceY, 5u, Width, Height, x, y);
+			const DirectX::XMFLOAT4& tracePosition = traceGBuffer.positions[(size_t)traceY * traceGBuffer.width + traceX];
+			const DirectX::XMFLOAT4& position = GetTestGBuffer(Width, Height).positions[(size_t)y * Width + x];
+			CHECK(tracePosition.x == position.x && tracePosition.y == position.y && tracePosition.z == position.z && tracePosition.w == position.w);
+		}
+	}
+}
+
+TEST_CASE(ConstantAOStaysConstant)
+{
+	for (uint32_t mode = 0; mode < (uint32_t)AOResolutionMode::Count; mode++)
+	{
+		const AOTraceSize traceSize = GetAOTraceSize((AOResolutionMode)mode, Width, Height);
+		const std::vector<float> traceAO((size_t)traceSize.width * traceSize.height, 0.375f);
+
+		std::vector<float> ao;
+		UpsampleAmbientOcclusion(GetTestGBuffer(Width, Height), traceAO, (AOResolutionMode)mode, 3u, ao);
+		REQUIRE(ao.size() == (size_t)Width * Height);
+
+		// Full copies the trace as it is, the other modes leave the background unoccluded.
+		uint32_t wrongCount = 0;
+		for (size_t pixel = 0; pixel < ao.size(); pixel++)
+		{
+			const bool isCopied = (AOResolutionMode)mode == AOResolutionMode::Full || GetTestGBuffer(Width, Height).positions[pixel].w != 0.0f;
+			const float expected = isCopied ? 0.375f : RTAOIsIlluminatedValue;
+			wrongCount += std::abs(ao[pixel] - expected) > 1e-5f ? 1u : 0u;
+		}
+		CHECK_EQ(wrongCount, 0u);
+	}
+}
+
+TEST_CASE(ReducedModesTradeErrorForRays)
+{
+	const std::vector<AOUpsampleBenchmarkResult> results = BenchmarkAOUpsampling(GetTestScene(), GetTestGBuffer(Width, Height), 4u, 16u);
+	REQUIRE(results.size() == (size_t)AOResolutionMode::Count);
+
+	const AOUpsampleBenchmarkResult& full = results[(size_t)AOResolutionMode::Full];
+	const AOUpsampleBenchmarkResult& half = results[(size_t)AOResolutionMode::Half];
+	const AOUpsampleBenchmarkResult& quarter = results[(size_t)AOResolutionMode::Quarter];
+	const AOUpsampleBenchmarkResult& checkerboard = results[(size_t)AOResolutionMode::Checkerboard];
+
+	CHECK_EQ(full.reconstructionError, 0.0f);
+	CHECK_EQ(full.fallbackPixelCount, 0u);
+
+	// Fewer rays leave more for the upsample to reconstruct.
+	CHECK(checkerboard.rayCount < full.rayCount && half.rayCount < checkerboard.rayCount && quarter.rayCount < half.rayCount);
+	CHECK(0.0f < checkerboard.reconstructionError && checkerboard.reconstructionError < half.reconstructionError);
+	CHECK(half.reconstructionError < quarter.reconstructionError);
+
+	// The upsample also smooths the noise of the samples, so the error of the reduced modes stays close to Full.
+	for (const AOUpsampleBenchmarkResult& result : results)
+	{
+		CHECK(result.meanAbsoluteError < 1.25f * full.meanAbsoluteError);
+	}
+}
+
+TEST_CASE(MismatchedSizesThrow)
+{
+	const std::vector<float> traceAO((size_t)Width * Height, 1.0f);
+	std::vector<float> ao;
+
+	bool threw = false;
+	try
+	{
+		UpsampleAmbientOcclusion(GetTestGBuffer(Width, Height), traceAO, AOResolutionMode::Half, 0u, ao);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
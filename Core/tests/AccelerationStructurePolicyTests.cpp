@@ -0,0 +1,50 @@
+#include <vector>
+
+#include "AccelerationStructurePolicy.h"
+#include "TestUtils.h"
+
+namespace
+{
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO MakePrebuildInfo(uint64_t scratchBytes, uint64_t updateScratchBytes)
+	{
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+		info.ResultDataMaxSizeInBytes = 4096;
+		info.ScratchDataSizeInBytes = scratchBytes;
+		info.UpdateScratchDataSizeInBytes = updateScratchBytes;
+		return info;
+	}
+}
+
+TEST_CASE(ScratchFitsTheBuildWithoutUpdates)
+{
+	const BottomLevelBuildPolicy policy;
+	CHECK_EQ(GetBottomLevelScratchBytes(policy, MakePrebuildInfo(1024, 2048)), 1024u);
+	CHECK_EQ(GetBottomLevelScratchBytes(policy, MakePrebuildInfo(1024, 512)), 1024u);
+}
+
+TEST_CASE(ScratchFitsTheBuildAndTheUpdateWithUpdates)
+{
+	const BottomLevelBuildPolicy policy = { .allowUpdate = true };
+	CHECK((GetBottomLevelBuildFlags(policy) & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE) != 0);
+
+	// The update scratch can be larger than the build scratch, in which case a refit would overrun the buffer.
+	CHECK_EQ(GetBottomLevelScratchBytes(policy, MakePrebuildInfo(1024, 2048)), 2048u);
+	CHECK_EQ(GetBottomLevelScratchBytes(policy, MakePrebuildInfo(1024, 512)), 1024u);
+}
+
+TEST_CASE(ScratchIsOnlyResidentUntilReleased)
+{
+	BottomLevelASStats stats;
+	stats.name = "Bunny";
+	stats.originalBytes = 4096;
+	stats.compactedBytes = 1024;
+	stats.scratchBytes = 2048;
+	CHECK_EQ(stats.GetResidentBytes(), 3072u);
+
+	stats.isScratchReleased = true;
+	CHECK_EQ(stats.GetResidentBytes(), 1024u);
+
+	const std::vector<BottomLevelASStats> allStats = { stats };
+	CHECK_EQ(FormatBottomLevelASStats(allStats),
+		std::string("BLAS Bunny: 4096 bytes, 1024 bytes compacted, 2048 bytes scratch (released)\nBLAS total: 1024 bytes resident instead of 6144 bytes\n"));
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "AdaptiveSampling.h"
+#include "TestScene.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr uint32_t Width = 96u;
+	constexpr uint32_t Height = 54u;
+
+	TemporalCamera GetCamera()
+	{
+		return CreateTemporalCamera(TestCameraEye, TestCameraTarget, TestCameraFov, (float)Width / (float)Height);
+	}
+
+	// Checks that the stats agree with the sample counts and that the trace shoots exactly the rays they hand out.
+	void CheckStatsMatchTheTrace(const AdaptiveSamplingStats& stats, const std::vector<uint8_t>& sampleCounts, std::vector<float>& ao, uint32_t frameCount)
+	{
+		uint32_t rayCount = 0;
+		for (uint8_t sampleCount : sampleCounts)
+		{
+			REQUIRE(sampleCount <= AdaptiveMaxSamplesPerPixel);
+			rayCount += sampleCount;
+		}
+		CHECK_EQ(rayCount, stats.rayCount);
+		CHECK_EQ(std::accumulate(stats.histogram.begin(), stats.histogram.end(), 0u), CountSurfacePixels(GetTestGBuffer(Width, Height)));
+
+		uint32_t histogramRayCount = 0;
+		for (uint32_t sampleCount = 0; sampleCount < stats.histogram.size(); sampleCount++)
+		{
+			histogramRayCount += sampleCount * stats.histogram[sampleCount];
+		}
+		CHECK_EQ(histogramRayCount, stats.rayCount);
+
+		RTAOTraceSettings traceSettings;
+		traceSettings.sampleCounts = sampleCounts;
+		CHECK_EQ(TraceAmbientOcclusion(GetTestScene(), GetTestGBuffer(Width, Height), frameCount, ao, traceSettings).rayCount, (uint64_t)stats.rayCount);
+	}
+}
+
+TEST_CASE(ConstantsMatchTheShader)
+{
+	CHECK_EQ((uint32_t)ReadShaderDefine("AdaptiveSamplingCS.hlsl", "MAX_SAMPLES_PER_PIXEL"), AdaptiveMaxSamplesPerPixel);
+	CHECK_EQ((float)ReadShaderDefine("AdaptiveSamplingCS.hlsl", "VARIANCE_PRIOR_WEIGHT"), AdaptiveVariancePriorWeight);
+	CHECK_EQ((float)ReadShaderDefine("AdaptiveSamplingCS.hlsl", "MAX_VARIANCE"), AdaptiveMaxVariance);
+}
+
+TEST_CASE(RequestsFollowTheVariance)
+{
+	AdaptiveSamplingSettings settings;
+	settings.maxSamplesPerPixel = 4;
+
+	CHECK_EQ(GetRequestedSampleCount(nullptr, 0, 0, Width, 0, settings), 4u);
+
+	// Half of the rays were occluded over a long history, which is the most variance there is.
+	const DirectX::XMFLOAT4 noisy = { 0.5f, 64.0f, 0.5f, 0.0f };
+	CHECK_EQ(GetRequestedSampleCount(&noisy, 0, 0, Width, 0, settings), 4u);
+
+	// One ray in ten was occluded, a standard deviation of 0.3.
+	const DirectX::XMFLOAT4 lessNoisy = { 0.9f, 64.0f, 0.9f, 0.0f };
+	CHECK_EQ(GetRequestedSampleCount(&lessNoisy, 0, 0, Width, 0, settings), 3u);
+
+	// Two frames of equal values don't pass for converged.
+	const DirectX::XMFLOAT4 shortHistory = { 1.0f, 2.0f, 1.0f, 0.0f };
+	CHECK(GetRequestedSampleCount(&shortHistory, 0, 0, Width, 0, settings) > 0u);
+
+	// A long history of equal values is converged and only gets a ray every refresh interval.
+	const DirectX::XMFLOAT4 converged = { 1.0f, 64.0f, 1.0f, 0.0f };
+	uint32_t refreshCount = 0;
+	for (uint32_t frame = 0; frame < settings.refreshInterval; frame++)
+	{
+		refreshCount += GetRequestedSampleCount(&converged, 5, 3, Width, frame, settings);
+	}
+	CHECK_EQ(refreshCount, 1u);
+}
+
+TEST_CASE(DitherSharesTheBudgetEvenly)
+{
+	// Every pixel of a 4x4 block asks for one ray and the budget covers a quarter of them.
+	std::vector<uint32_t> pixelRayCounts(16, 0u);
+	for (uint32_t frame = 0; frame < 16u; frame++)
+	{
+		uint32_t blockRayCount = 0;
+		for (uint32_t pixel = 0; pixel < 16u; pixel++)
+		{
+			const uint32_t rayCount = ScaleSampleCount(1u, 1u, 4u, pixel % 4u, pixel / 4u, frame);
+			blockRayCount += rayCount;
+			pixelRayCounts[pixel] += rayCount;
+		}
+		CHECK_EQ(blockRayCount, 4u);
+	}
+
+	for (uint32_t rayCount : pixelRayCounts)
+	{
+		CHECK_EQ(rayCount, 4u);
+	}
+}
+
+TEST_CASE(FirstFrameTracesEveryPixel)
+{
+	// Pixels without a history keep one ray even when the budget is too small for them.
+	AdaptiveSamplingSettings settings;
+	settings.enabled = true;
+	settings.raysPerPixelBudget = 0.05f;
+
+	std::vector<uint8_t> sampleCounts;
+	std::vector<float> ao;
+	const AdaptiveSamplingStats stats = ComputeSampleCounts(GetTestGBuffer(Width, Height), GetCamera(), nullptr, 0u, settings, sampleCounts, ao);
+
+	CHECK_EQ(stats.requestedRayCount, CountSurfacePixels(GetTestGBuffer(Width, Height)) * settings.maxSamplesPerPixel);
+	CHECK_EQ(stats.histogram[0], 0u);
+	const uint32_t expectedRayCount = std::max(stats.rayBudget, CountSurfacePixels(GetTestGBuffer(Width, Height)));
+	CHECK_EQ(stats.rayCount, expectedRayCount);
+	CheckStatsMatchTheTrace(stats, sampleCounts, ao, 0u);
+}
+
+TEST_CASE(LaterFramesStayWithinTheBudget)
+{
+	AdaptiveSamplingSettings settings;
+	settings.enabled = true;
+	settings.raysPerPixelBudget = 0.25f;
+
+	const TemporalCamera camera = GetCamera();
+	std::vector<uint8_t> sampleCounts;
+	std::vector<float> ao;
+	TemporalHistory previous;
+	TemporalHistory next;
+	for (uint32_t frame = 0; frame < 8u; frame++)
+	{
+		const TemporalHistory* history = frame > 0 ? &previous : nullptr;
+		const AdaptiveSamplingStats stats = ComputeSampleCounts(GetTestGBuffer(Width, Height), camera, history, frame, settings, sampleCounts, ao);
+		CheckStatsMatchTheTrace(stats, sampleCounts, ao, frame);
+		if (frame > 0)
+		{
+			CHECK(stats.rayCount <= stats.rayBudget);
+		}
+
+		AccumulateTemporal(GetTestGBuffer(Width, Height), ao, camera, camera, history, next, sampleCounts);
+		std::swap(previous, next);
+	}
+}
+
+TEST_CASE(AdaptiveMatchesUniformAtTheSameRayCount)
+{
+	// With as many rays as uniform sampling, the error stays about the same on this scene, which has little spread of
+	// variance to exploit. Half of the rays cost accuracy, but not twice as much.
+	AdaptiveSamplingSettings settings;
+	settings.enabled = true;
+	settings.raysPerPixelBudget = (float)CountSurfacePixels(GetTestGBuffer(Width, Height)) / (Width * Height);
+
+	const std::vector<AdaptiveSamplingBenchmarkResult> results = BenchmarkAdaptiveSampling(GetTestScene(), GetTestGBuffer(Width, Height), GetCamera(), 16u, 64u, settings);
+	REQUIRE(results.size() == 2u);
+	const AdaptiveSamplingBenchmarkResult& uniform = results[0];
+	const AdaptiveSamplingBenchmarkResult& adaptive = results[1];
+	REQUIRE(!uniform.isAdaptive && adaptive.isAdaptive);
+
+	CHECK_EQ(uniform.rayCount, 16ull * CountSurfacePixels(GetTestGBuffer(Width, Height)));
+	CHECK(adaptive.rayCount <= uniform.rayCount);
+	CHECK(adaptive.overBudgetFrameCount <= 1u);
+	CHECK(adaptive.rootMeanSquaredError < 1.1f * uniform.rootMeanSquaredError);
+
+	settings.raysPerPixelBudget *= 0.5f;
+	const AdaptiveSamplingBenchmarkResult halfBudget = BenchmarkAdaptiveSampling(GetTestScene(), GetTestGBuffer(Width, Height), GetCamera(), 16u, 64u, settings)[1];
+	CHECK(halfBudget.rayCount < 0.6 * uniform.rayCount);
+	CHECK(halfBudget.overBudgetFrameCount <= 1u);
+	CHECK(halfBudget.rootMeanSquaredError < 2.0f * uniform.rootMeanSquaredError);
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "AtrousDenoiser.h"
+#include "TestScene.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Not a multiple of the eight SIMD lanes, so the tail of every row is covered.
+	constexpr uint32_t Width = 157u;
+	constexpr uint32_t Height = 91u;
+
+	std::vector<float> TraceAO(uint32_t frameCount, uint32_t samplesPerPixel)
+	{
+		RTAOTraceSettings settings;
+		settings.samplesPerPixel = samplesPerPixel;
+
+		std::vector<float> ao;
+		TraceAmbientOcclusion(GetTestScene(), GetTestGBuffer(Width, Height), frameCount, ao, settings);
+		return ao;
+	}
+
+	// Over the pixels with a surface.
+	double GetMeanSquaredError(std::span<const float> ao, std::span<const float> reference)
+	{
+		double sum = 0.0;
+		uint32_t count = 0;
+		for (size_t pixel = 0; pixel < ao.size(); pixel++)
+		{
+			if (GetTestGBuffer(Width, Height).positions[pixel].w != 0.0f)
+			{
+				sum += (ao[pixel] - reference[pixel]) * (ao[pixel] - reference[pixel]);
+				count++;
+			}
+		}
+		return count > 0 ? sum / count : 0.0;
+	}
+}
+
+TEST_CASE(ConstantsMatchTheShader)
+{
+	CHECK_EQ((uint32_t)ReadShaderDefine("DenoiseCS.hlsl", "NORMAL_POWER"), DenoiseNormalPower);
+	CHECK_EQ((float)ReadShaderDefine("DenoiseCS.hlsl", "COLOR_EPSILON"), DenoiseColorEpsilon);
+}
+
+TEST_CASE(SimdMatchesScalar)
+{
+	const std::vector<float> ao = TraceAO(1u, 1u);
+
+	for (uint32_t iterationCount : { 1u, 4u, 5u })
+	{
+		DenoiseSettings settings;
+		settings.iterationCount = iterationCount;
+
+		std::vector<float> scalar;
+		std::vector<float> simd;
+		DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, scalar, settings, DenoiseMode::Scalar);
+		DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, simd, settings, DenoiseMode::Simd);
+		REQUIRE(scalar.size() == ao.size());
+		REQUIRE(simd.size() == ao.size());
+
+		uint32_t mismatchedPixelCount = 0;
+		for (size_t pixel = 0; pixel < ao.size(); pixel++)
+		{
+			mismatchedPixelCount += scalar[pixel] != simd[pixel] ? 1u : 0u;
+		}
+		CHECK_EQ(mismatchedPixelCount, 0u);
+	}
+
+	for (const DenoiseBenchmarkResult& result : BenchmarkDenoiser(GetTestGBuffer(Width, Height), ao))
+	{
+		CHECK_EQ(result.maxDifference, 0.0f);
+	}
+}
+
+TEST_CASE(BackgroundAndZeroIterationsAreCopied)
+{
+	const std::vector<float> ao = TraceAO(1u, 1u);
+
+	DenoiseSettings settings;
+	settings.iterationCount = 0;
+	std::vector<float> denoised;
+	DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, denoised, settings);
+	CHECK(denoised == ao);
+
+	DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, denoised);
+	REQUIRE(CountSurfacePixels(GetTestGBuffer(Width, Height)) < ao.size());
+	for (size_t pixel = 0; pixel < ao.size(); pixel++)
+	{
+		if (GetTestGBuffer(Width, Height).positions[pixel].w == 0.0f)
+		{
+			CHECK_EQ(denoised[pixel], ao[pixel]);
+		}
+	}
+}
+
+TEST_CASE(ConstantAOStaysConstant)
+{
+	const std::vector<float> ao(Width * Height, 0.75f);
+	std::vector<float> denoised;
+	DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, denoised);
+	for (float value : denoised)
+	{
+		CHECK_NEAR(value, 0.75f, 1e-5f);
+	}
+}
+
+TEST_CASE(DenoisingMovesOneSampleTowardsTheReference)
+{
+	// Many samples per pixel stand in for the converged AO.
+	const std::vector<float> reference = TraceAO(1u, 32u);
+	const std::vector<float> ao = TraceAO(1u, 1u);
+
+	std::vector<float> denoised;
+	DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, denoised);
+
+	const double noisyError = GetMeanSquaredError(ao, reference);
+	const double denoisedError = GetMeanSquaredError(denoised, reference);
+	// About half of the squared error goes away, part of what is left is the noise of the reference itself.
+	CHECK(denoisedError < 0.6 * noisyError);
+}
+
+TEST_CASE(MismatchedSizesThrow)
+{
+	const std::vector<float> ao(Width * Height - 1, 1.0f);
+	std::vector<float> denoised;
+
+	bool threw = false;
+	try
+	{
+		DenoiseAmbientOcclusion(GetTestGBuffer(Width, Height), ao, denoised);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
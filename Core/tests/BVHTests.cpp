@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BVH.h"
+#include "ObjImporter.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr uint32_t RayCount = 2000u;
+	constexpr uint32_t ThreadCounts[] = { 2u, 4u, 7u };
+
+	void LoadMesh(const char* assetName, MeshData& mesh)
+	{
+		ImportOBJ(std::string(RTAO_ASSET_DIR) + "/" + assetName, mesh);
+	}
+
+	// Triangles in the order of the source geometry, for the brute force reference.
+	std::vector<BVHTriangle> GetSourceTriangles(const MeshData& mesh)
+	{
+		std::vector<BVHTriangle> triangles(mesh.indices.size() / 3);
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			triangles[i] = { mesh.vertices[mesh.indices[3 * i]].position, mesh.vertices[mesh.indices[3 * i + 1]].position, mesh.vertices[mesh.indices[3 * i + 2]].position };
+		}
+		return triangles;
+	}
+
+	// Rays from all around the mesh towards points inside its bounds, so that most of them hit. Every fourth ray is cut short.
+	std::vector<BVHRay> CreateRandomRays(const BVHNode& root, uint32_t rayCount)
+	{
+		std::mt19937 random(7u);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const DirectX::XMFLOAT3 extent = { root.boundsMax.x - root.boundsMin.x, root.boundsMax.y - root.boundsMin.y, root.boundsMax.z - root.boundsMin.z };
+		auto randomPoint = [&](float scale)
+		{
+			return DirectX::XMFLOAT3{
+				root.boundsMin.x + extent.x * (0.5f + (unit(random) - 0.5f) * scale),
+				root.boundsMin.y + extent.y * (0.5f + (unit(random) - 0.5f) * scale),
+				root.boundsMin.z + extent.z * (0.5f + (unit(random) - 0.5f) * scale)
+			};
+		};
+
+		std::vector<BVHRay> rays(rayCount);
+		for (uint32_t i = 0; i < rayCount; i++)
+		{
+			const DirectX::XMFLOAT3 origin = randomPoint(3.0f);
+			const DirectX::XMFLOAT3 target = randomPoint(1.0f);
+			const float tMax = i % 4 == 3 ? unit(random) : std::numeric_limits<float>::infinity();
+			rays[i] = { origin, 0.0f, { target.x - origin.x, target.y - origin.y, target.z - origin.z }, tMax };
+		}
+		return rays;
+	}
+
+	bool IsEqual(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	// Walks both trees side by side. The node order depends on the number of build threads, the tree itself must not.
+	bool IsSameTree(const BVH& a, const BVH& b, uint32_t nodeA, uint32_t nodeB)
+	{
+		const BVHNode& left = a.GetNodes()[nodeA];
+		const BVHNode& right = b.GetNodes()[nodeB];
+		if (!IsEqual(left.boundsMin, right.boundsMin) || !IsEqual(left.boundsMax, right.boundsMax) || left.primitiveCount != right.primitiveCount)
+		{
+			return false;
+		}
+
+		if (left.IsLeaf())
+		{
+			return left.leftOrFirst == right.leftOrFirst;
+		}
+
+		return IsSameTree(a, b, left.leftOrFirst, right.leftOrFirst) && IsSameTree(a, b, left.leftOrFirst + 1, right.leftOrFirst + 1);
+	}
+}
+
+TEST_CASE(TraversalMatchesBruteForce)
+{
+	MeshData mesh;
+	LoadMesh("teapot.obj", mesh);
+	const std::vector<BVHTriangle> triangles = GetSourceTriangles(mesh);
+
+	BVH bvh;
+	bvh.Build(CreateBVHGeometryDesc(mesh.vertices, mesh.indices));
+	REQUIRE(bvh.GetStats().triangleCount == triangles.size());
+
+	uint32_t hitCount = 0;
+	for (const BVHRay& ray : CreateRandomRays(bvh.GetNodes()[0], RayCount))
+	{
+		float closestT = ray.tMax;
+		bool isHit = false;
+		for (const BVHTriangle& triangle : triangles)
+		{
+			float t;
+			if (IntersectTriangle(ray, triangle, closestT, t))
+			{
+				closestT = t;
+				isHit = true;
+			}
+		}
+		hitCount += isHit ? 1u : 0u;
+
+		CHECK_EQ(bvh.IntersectAny(ray), isHit);
+
+		BVHHit hit;
+		REQUIRE(bvh.IntersectClosest(ray, hit) == isHit);
+		if (isHit)
+		{
+			CHECK_EQ(hit.t, closestT);
+
+			// Ties on shared edges can pick either triangle, but the hit has to be consistent and at the closest distance.
+			REQUIRE(hit.primitiveIndex < triangles.size());
+			CHECK_EQ(bvh.GetPrimitiveIndices()[hit.leafPrimitive], hit.primitiveIndex);
+			float t;
+			CHECK(IntersectTriangle(ray, triangles[hit.primitiveIndex], ray.tMax, t) && t == hit.t);
+		}
+	}
+
+	// The rays have to exercise both outcomes.
+	CHECK(hitCount > RayCount / 4u);
+	CHECK(hitCount < RayCount);
+}
+
+TEST_CASE(ThreadCountDoesNotChangeTheTree)
+{
+	MeshData mesh;
+	LoadMesh("pumpkin.obj", mesh);
+
+	BVHBuildSettings settings;
+	settings.threadCount = 1u;
+	BVH reference;
+	reference.Build(CreateBVHGeometryDesc(mesh.vertices, mesh.indices), settings);
+	const BVHStats& referenceStats = reference.GetStats();
+
+	for (uint32_t threadCount : ThreadCounts)
+	{
+		settings.threadCount = threadCount;
+		BVH bvh;
+		bvh.Build(CreateBVHGeometryDesc(mesh.vertices, mesh.indices), settings);
+		const BVHStats& stats = bvh.GetStats();
+
+		CHECK_EQ(stats.triangleCount, referenceStats.triangleCount);
+		CHECK_EQ(stats.nodeCount, referenceStats.nodeCount);
+		CHECK_EQ(stats.leafCount, referenceStats.leafCount);
+		CHECK_EQ(stats.maxDepth, referenceStats.maxDepth);
+		// The cost is summed in node order.
+		CHECK_NEAR(stats.sahCost, referenceStats.sahCost, 1e-4 * referenceStats.sahCost);
+
+		REQUIRE(bvh.GetNodes().size() == reference.GetNodes().size());
+		CHECK(IsSameTree(reference, bvh, 0u, 0u));
+		CHECK(std::equal(bvh.GetPrimitiveIndices().begin(), bvh.GetPrimitiveIndices().end(), reference.GetPrimitiveIndices().begin()));
+		CHECK(std::memcmp(bvh.GetTriangles().data(), reference.GetTriangles().data(), bvh.GetTriangles().size_bytes()) == 0);
+	}
+}
+
+TEST_CASE(StatsDescribeTheNodes)
+{
+	MeshData mesh;
+	LoadMesh("Koltuk.obj", mesh);
+
+	BVH bvh;
+	bvh.Build(CreateBVHGeometryDesc(mesh.vertices, mesh.indices));
+	const BVHStats& stats = bvh.GetStats();
+
+	uint32_t leafCount = 0;
+	uint32_t leafTriangleCount = 0;
+	for (const BVHNode& node : bvh.GetNodes())
+	{
+		if (node.IsLeaf())
+		{
+			leafCount++;
+			leafTriangleCount += node.primitiveCount;
+		}
+	}
+
+	CHECK_EQ(stats.triangleCount, (uint32_t)(mesh.indices.size() / 3));
+	CHECK_EQ(stats.nodeCount, (uint32_t)bvh.GetNodes().size());
+	CHECK_EQ(stats.leafCount, leafCount);
+	CHECK_EQ(leafTriangleCount, stats.triangleCount);
+	// A binary tree has one inner node less than it has leaves.
+	CHECK_EQ(stats.nodeCount, 2u * stats.leafCount - 1u);
+	CHECK(stats.maxDepth > 0u && stats.maxDepth < MaxBVHDepth);
+	// Every ray that hits the root pays for traversing it and then some.
+	CHECK(stats.sahCost > 1.0f);
+}
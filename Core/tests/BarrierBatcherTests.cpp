@@ -0,0 +1,310 @@
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "BarrierBatcher.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Stands in for a command list and keeps every ResourceBarrier() call.
+	struct RecordingCommandList
+	{
+		std::vector<std::vector<D3D12_RESOURCE_BARRIER>> batches;
+
+		void ResourceBarrier(UINT barrierCount, const D3D12_RESOURCE_BARRIER* barriers)
+		{
+			batches.emplace_back(barriers, barriers + barrierCount);
+		}
+
+		const std::vector<D3D12_RESOURCE_BARRIER>& GetLastBatch() const
+		{
+			static const std::vector<D3D12_RESOURCE_BARRIER> empty;
+			return batches.empty() ? empty : batches.back();
+		}
+	};
+
+	// The batcher never dereferences the resources, so any distinct pointers will do.
+	ID3D12Resource* FakeResource(uintptr_t id)
+	{
+		return reinterpret_cast<ID3D12Resource*>(id * 64u);
+	}
+
+	bool IsTransition(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource, uint32_t subresource, D3D12_RESOURCE_STATES before,
+		D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE)
+	{
+		return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && barrier.Flags == flags && barrier.Transition.pResource == resource &&
+			barrier.Transition.Subresource == subresource && barrier.Transition.StateBefore == before && barrier.Transition.StateAfter == after;
+	}
+
+	bool IsUAV(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource)
+	{
+		return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && barrier.UAV.pResource == resource;
+	}
+
+	constexpr uint32_t All = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+}
+
+TEST_CASE(RedundantTransitionsAreDropped)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.Track(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	CHECK(!batcher.HasPendingBarriers());
+	batcher.Flush(&commandList);
+
+	// Nothing to record, so there is no call at all.
+	CHECK(commandList.batches.empty());
+	CHECK_EQ(batcher.GetStats().requestedCount, 1u);
+	CHECK_EQ(batcher.GetStats().skippedCount, 1u);
+	CHECK_EQ(batcher.GetStats().flushCount, 0u);
+}
+
+TEST_CASE(RoundTripsCancelAndChainsMerge)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	ID3D12Resource* buffer = FakeResource(2);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	// A to B to A cancels out.
+	batcher.Track(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	CHECK(!batcher.HasPendingBarriers());
+
+	// A to B to C becomes A to C.
+	batcher.Track(buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+	batcher.Transition(buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batcher.Transition(buffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	batcher.Flush(&commandList);
+
+	REQUIRE(commandList.batches.size() == 1u);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], buffer, All, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT));
+	CHECK_EQ(batcher.GetState(buffer), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	CHECK_EQ(batcher.GetStats().cancelledCount, 1u);
+	CHECK_EQ(batcher.GetStats().mergedCount, 1u);
+	CHECK_EQ(batcher.GetStats().recordedCount, 1u);
+
+	// Round trips across a flush are real work and are kept.
+	batcher.Transition(buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+	batcher.Flush(&commandList);
+	CHECK_EQ(commandList.batches.size(), 2u);
+}
+
+TEST_CASE(RoundTripThroughUAVKeepsAUAVBarrier)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.Track(texture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batcher.Flush(&commandList);
+
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsUAV(commandList.GetLastBatch()[0], texture));
+}
+
+TEST_CASE(SubresourcesAreTrackedSeparately)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.Track(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 3u);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_RENDER_TARGET, 1u);
+	batcher.Flush(&commandList);
+
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], texture, 1u, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	CHECK_EQ(batcher.GetState(texture, 0u), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	CHECK_EQ(batcher.GetState(texture, 1u), D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	bool mixedThrows = false;
+	try
+	{
+		batcher.GetState(texture);
+	}
+	catch (const std::runtime_error&)
+	{
+		mixedThrows = true;
+	}
+	CHECK(mixedThrows);
+
+	// Only the subresources that aren't in the state yet are transitioned.
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 2u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], texture, 0u, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	CHECK(IsTransition(commandList.GetLastBatch()[1], texture, 2u, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
+
+	// Once they agree again, one barrier covers all of them.
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], texture, All, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
+
+TEST_CASE(UAVBarriersAreDeduplicated)
+{
+	ID3D12Resource* first = FakeResource(1);
+	ID3D12Resource* second = FakeResource(2);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.UAV(first);
+	batcher.UAV(first);
+	batcher.UAV(second);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 2u);
+	CHECK(IsUAV(commandList.GetLastBatch()[0], first));
+	CHECK(IsUAV(commandList.GetLastBatch()[1], second));
+
+	// A global UAV barrier covers every resource after it.
+	batcher.UAV(nullptr);
+	batcher.UAV(first);
+	batcher.UAV(nullptr);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsUAV(commandList.GetLastBatch()[0], nullptr));
+
+	// A transition of the whole resource orders its unordered accesses as well.
+	batcher.Track(first, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batcher.Transition(first, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	batcher.UAV(first);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], first, All, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	CHECK_EQ(batcher.GetStats().skippedCount, 4u);
+}
+
+TEST_CASE(SubresourceTransitionsDontCoverUAVBarriers)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	// Mip 0 is transitioned, mip 1 stays an unordered access view and still needs the UAV barrier.
+	batcher.Track(texture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 2u);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0u);
+	batcher.UAV(texture);
+	batcher.Flush(&commandList);
+
+	REQUIRE(commandList.GetLastBatch().size() == 2u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], texture, 0u, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	CHECK(IsUAV(commandList.GetLastBatch()[1], texture));
+
+	// Once every subresource has its own transition the UAV barrier is redundant.
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0u);
+	batcher.Flush(&commandList);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_COPY_SOURCE, 0u);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_COPY_SOURCE, 1u);
+	batcher.UAV(texture);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 2u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], texture, 0u, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	CHECK(IsTransition(commandList.GetLastBatch()[1], texture, 1u, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+}
+
+TEST_CASE(SplitTransitionsAreBegunAndEnded)
+{
+	ID3D12Resource* target = FakeResource(1);
+	ID3D12Resource* other = FakeResource(2);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.Track(target, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batcher.BeginTransition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	CHECK(batcher.HasSplitTransitions());
+	CHECK_EQ(batcher.GetState(target), D3D12_RESOURCE_STATE_RENDER_TARGET);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], target, All, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+
+	// Work on other resources runs while the transition is in flight. The transition to the same state ends it.
+	batcher.Track(other, D3D12_RESOURCE_STATE_COPY_DEST);
+	batcher.Transition(other, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batcher.Transition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	CHECK(!batcher.HasSplitTransitions());
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 2u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], other, All, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	CHECK(IsTransition(commandList.GetLastBatch()[1], target, All, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+
+	// Ending with a different state ends the split half first and then transitions on.
+	batcher.BeginTransition(target, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batcher.Flush(&commandList);
+	batcher.Transition(target, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 2u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], target, All, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+	CHECK(IsTransition(commandList.GetLastBatch()[1], target, All, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+	// Splits that are still open are ended before the command list is closed.
+	batcher.BeginTransition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	batcher.Flush(&commandList);
+	batcher.EndSplitTransitions();
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], target, All, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+	CHECK_EQ(batcher.GetStats().splitCount, 3u);
+}
+
+TEST_CASE(SplitTransitionsOfSubresourcesEndSeparately)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.Track(texture, D3D12_RESOURCE_STATE_RENDER_TARGET, 2u);
+	batcher.BeginTransition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0u);
+	batcher.BeginTransition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 1u);
+	batcher.Flush(&commandList);
+	CHECK_EQ(commandList.GetLastBatch().size(), 2u);
+
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 1u);
+	CHECK(batcher.HasSplitTransitions());
+	batcher.Flush(&commandList);
+	REQUIRE(commandList.GetLastBatch().size() == 1u);
+	CHECK(IsTransition(commandList.GetLastBatch()[0], texture, 1u, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+
+	// Resetting a resource with a split in flight would lose the end.
+	bool resetThrows = false;
+	try
+	{
+		batcher.Track(texture, D3D12_RESOURCE_STATE_COMMON);
+	}
+	catch (const std::runtime_error&)
+	{
+		resetThrows = true;
+	}
+	CHECK(resetThrows);
+}
+
+TEST_CASE(AliasingBarriersBlockMerging)
+{
+	ID3D12Resource* texture = FakeResource(1);
+	BarrierBatcher batcher;
+	RecordingCommandList commandList;
+
+	batcher.Track(texture, D3D12_RESOURCE_STATE_COMMON);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_COPY_DEST);
+	batcher.Aliasing(nullptr, texture);
+	batcher.Transition(texture, D3D12_RESOURCE_STATE_COMMON);
+	batcher.Flush(&commandList);
+
+	REQUIRE(commandList.GetLastBatch().size() == 3u);
+	CHECK(commandList.GetLastBatch()[1].Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING);
+	CHECK_EQ(batcher.GetStats().cancelledCount, 0u);
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "FrameGraph.h"
+#include "TestUtils.h"
+
+namespace
+{
+	bool HasTransition(const std::vector<FrameGraphBarrier>& barriers, uint32_t resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+	{
+		return std::any_of(barriers.begin(), barriers.end(), [&](const FrameGraphBarrier& barrier)
+		{
+			return barrier.type == FrameGraphBarrierType::Transition && barrier.resource == resource && barrier.stateBefore == before && barrier.stateAfter == after;
+		});
+	}
+
+	uint32_t CountBarriers(const std::vector<FrameGraphBarrier>& barriers, uint32_t resource, FrameGraphBarrierType type)
+	{
+		return (uint32_t)std::count_if(barriers.begin(), barriers.end(), [&](const FrameGraphBarrier& barrier)
+		{
+			return barrier.type == type && barrier.resource == resource;
+		});
+	}
+
+	template<typename Function>
+	bool Throws(Function&& function)
+	{
+		try
+		{
+			function();
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST_CASE(ConsecutiveReadsShareOneTransition)
+{
+	FrameGraph graph;
+	const uint32_t gBuffer = graph.AddResource("GBuffer", D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.SetFinalState(gBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	const uint32_t gBufferPass = graph.AddPass("GBuffer", FrameGraphQueue::Direct);
+	const uint32_t lightingPass = graph.AddPass("Lighting", FrameGraphQueue::Direct);
+	const uint32_t aoPass = graph.AddPass("AO", FrameGraphQueue::Direct);
+	graph.Write(gBufferPass, gBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(lightingPass, gBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(aoPass, gBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	CHECK(!graph.IsCompiled());
+	graph.Compile();
+	CHECK(graph.IsCompiled());
+
+	const D3D12_RESOURCE_STATES allShaderResource = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	CHECK(HasTransition(graph.GetCompiledPass(gBufferPass).barriersBefore, gBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	CHECK(HasTransition(graph.GetCompiledPass(lightingPass).barriersBefore, gBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, allShaderResource));
+	CHECK(graph.GetCompiledPass(aoPass).barriersBefore.empty());
+	CHECK(HasTransition(graph.GetFinalBarriers(), gBuffer, allShaderResource, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	CHECK_EQ(graph.GetFinalState(gBuffer), D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	const FrameGraphStats& stats = graph.GetStats();
+	CHECK_EQ(stats.transitionCount, 3u);
+	CHECK_EQ(stats.mergedReadCount, 1u);
+	CHECK_EQ(stats.barrierBatchCount, 3u);
+	CHECK_EQ(stats.waitCount, 0u);
+
+	// Changing the graph invalidates it.
+	graph.SetInitialState(gBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	CHECK(!graph.IsCompiled());
+	graph.Compile();
+	CHECK(graph.GetCompiledPass(gBufferPass).barriersBefore.empty());
+}
+
+TEST_CASE(ReadsThatCantBeMergedGetTheirOwnTransition)
+{
+	FrameGraph graph;
+	const uint32_t buffer = graph.AddResource("Buffer", D3D12_RESOURCE_STATE_COPY_DEST);
+	const uint32_t first = graph.AddPass("Draw", FrameGraphQueue::Direct);
+	const uint32_t second = graph.AddPass("Present", FrameGraphQueue::Direct);
+	graph.Read(first, buffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(second, buffer, D3D12_RESOURCE_STATE_COMMON);
+	graph.Compile();
+
+	// COMMON can't be combined with other read states.
+	CHECK(HasTransition(graph.GetCompiledPass(first).barriersBefore, buffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	CHECK(HasTransition(graph.GetCompiledPass(second).barriersBefore, buffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON));
+	CHECK_EQ(graph.GetStats().mergedReadCount, 0u);
+}
+
+TEST_CASE(UnorderedAccessesGetUAVBarriers)
+{
+	FrameGraph graph;
+	const uint32_t history = graph.AddResource("History", D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	const uint32_t write = graph.AddPass("Write", FrameGraphQueue::Direct);
+	const uint32_t read = graph.AddPass("Read", FrameGraphQueue::Direct);
+	const uint32_t secondRead = graph.AddPass("SecondRead", FrameGraphQueue::Direct);
+	const uint32_t secondWrite = graph.AddPass("SecondWrite", FrameGraphQueue::Direct);
+	graph.Write(write, history, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Read(read, history, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Read(secondRead, history, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Write(secondWrite, history, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Compile();
+
+	// The previous frame may still write it, then read after write, no barrier between two reads and write after read.
+	CHECK_EQ(CountBarriers(graph.GetCompiledPass(write).barriersBefore, history, FrameGraphBarrierType::UAV), 1u);
+	CHECK_EQ(CountBarriers(graph.GetCompiledPass(read).barriersBefore, history, FrameGraphBarrierType::UAV), 1u);
+	CHECK_EQ(CountBarriers(graph.GetCompiledPass(secondRead).barriersBefore, history, FrameGraphBarrierType::UAV), 0u);
+	CHECK_EQ(CountBarriers(graph.GetCompiledPass(secondWrite).barriersBefore, history, FrameGraphBarrierType::UAV), 1u);
+	CHECK_EQ(graph.GetStats().uavBarrierCount, 3u);
+	CHECK_EQ(graph.GetStats().transitionCount, 0u);
+}
+
+TEST_CASE(CrossQueueAccessesWaitOnce)
+{
+	FrameGraph graph;
+	const uint32_t ao = graph.AddResource("AO", D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	const uint32_t denoised = graph.AddResource("Denoised", D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	const uint32_t stats = graph.AddResource("Stats", D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	const uint32_t trace = graph.AddPass("Trace", FrameGraphQueue::Direct);
+	const uint32_t denoise = graph.AddPass("Denoise", FrameGraphQueue::Compute);
+	const uint32_t denoiseAgain = graph.AddPass("DenoiseAgain", FrameGraphQueue::Compute);
+	const uint32_t composite = graph.AddPass("Composite", FrameGraphQueue::Direct);
+	const uint32_t gatherStats = graph.AddPass("GatherStats", FrameGraphQueue::Compute);
+
+	graph.Write(trace, ao, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Read(denoise, ao, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Write(denoise, denoised, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Read(denoiseAgain, ao, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Read(composite, denoised, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(gatherStats, stats, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Compile();
+
+	// The compute queue can transition out of UAV itself, after waiting for the trace.
+	CHECK(HasTransition(graph.GetCompiledPass(denoise).barriersBefore, ao, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	REQUIRE(graph.GetCompiledPass(denoise).waits.size() == 1u);
+	CHECK(graph.GetCompiledPass(denoise).waits[0].queue == FrameGraphQueue::Direct);
+	CHECK_EQ(graph.GetCompiledPass(denoise).waits[0].pass, trace);
+	CHECK(graph.GetCompiledPass(trace).signalAfter);
+
+	// The compute queue already waited for the trace.
+	CHECK(graph.GetCompiledPass(denoiseAgain).waits.empty());
+
+	// PIXEL_SHADER_RESOURCE is graphics only, so the direct queue transitions the denoised image after waiting for compute.
+	CHECK(HasTransition(graph.GetCompiledPass(composite).barriersBefore, denoised, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	REQUIRE(graph.GetCompiledPass(composite).waits.size() == 1u);
+	CHECK(graph.GetCompiledPass(composite).waits[0].queue == FrameGraphQueue::Compute);
+	CHECK_EQ(graph.GetCompiledPass(composite).waits[0].pass, denoise);
+	CHECK(graph.GetCompiledPass(denoise).signalAfter);
+
+	// Nothing waits for the last compute pass, so the frame end does.
+	REQUIRE(graph.GetFrameEndWaits().size() == 1u);
+	CHECK(graph.GetFrameEndWaits()[0].queue == FrameGraphQueue::Compute);
+	CHECK_EQ(graph.GetFrameEndWaits()[0].pass, gatherStats);
+	CHECK(graph.GetCompiledPass(gatherStats).signalAfter);
+	CHECK_EQ(graph.GetStats().waitCount, 3u);
+}
+
+TEST_CASE(GraphicsOnlyTransitionsMoveToTheDirectQueue)
+{
+	FrameGraph graph;
+	const uint32_t color = graph.AddResource("Color", D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	const uint32_t draw = graph.AddPass("Draw", FrameGraphQueue::Direct);
+	const uint32_t filter = graph.AddPass("Filter", FrameGraphQueue::Compute);
+	graph.Write(draw, color, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(filter, color, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Compile();
+
+	const FrameGraphCompiledPass& drawPass = graph.GetCompiledPass(draw);
+	CHECK(HasTransition(drawPass.barriersAfter, color, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	CHECK(drawPass.signalAfter);
+	CHECK(graph.GetCompiledPass(filter).barriersBefore.empty());
+	REQUIRE(graph.GetCompiledPass(filter).waits.size() == 1u);
+	CHECK_EQ(graph.GetCompiledPass(filter).waits[0].pass, draw);
+
+	// Without a direct pass in front nobody can record it.
+	FrameGraph computeOnly;
+	const uint32_t target = computeOnly.AddResource("Target", D3D12_RESOURCE_STATE_RENDER_TARGET);
+	computeOnly.Read(computeOnly.AddPass("Filter", FrameGraphQueue::Compute), target, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	CHECK(Throws([&]() { computeOnly.Compile(); }));
+}
+
+TEST_CASE(PassOrderAndAliasing)
+{
+	FrameGraph graph;
+	const uint32_t input = graph.AddResource("Input", D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	const uint32_t asyncTarget = graph.AddResource("AsyncTarget", D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	const uint32_t overlapping = graph.AddResource("Overlapping", D3D12_RESOURCE_STATE_RENDER_TARGET);
+	const uint32_t later = graph.AddResource("Later", D3D12_RESOURCE_STATE_RENDER_TARGET);
+	const uint32_t unused = graph.AddResource("Unused", D3D12_RESOURCE_STATE_RENDER_TARGET);
+	for (uint32_t resource : { asyncTarget, overlapping, later, unused })
+	{
+		graph.SetTransient(resource);
+	}
+
+	const uint32_t prepare = graph.AddPass("Prepare", FrameGraphQueue::Direct);
+	const uint32_t async = graph.AddPass("Async", FrameGraphQueue::Compute);
+	const uint32_t draw = graph.AddPass("Draw", FrameGraphQueue::Direct);
+	const uint32_t consume = graph.AddPass("Consume", FrameGraphQueue::Direct);
+	const uint32_t finish = graph.AddPass("Finish", FrameGraphQueue::Direct);
+
+	graph.Write(prepare, input, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Read(async, input, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Write(async, asyncTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Write(draw, overlapping, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(consume, asyncTarget, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Write(finish, later, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+
+	// Same queue is always ordered, the compute pass only after what it waited for.
+	CHECK(graph.HappensBefore(prepare, draw));
+	CHECK(graph.HappensBefore(prepare, async));
+	CHECK(!graph.HappensBefore(async, draw));
+	CHECK(graph.HappensBefore(async, consume));
+	CHECK(graph.HappensBefore(async, finish));
+	CHECK(!graph.HappensBefore(draw, prepare));
+	CHECK(!graph.HappensBefore(draw, draw));
+
+	const FrameGraphLifetime asyncLifetime = graph.GetLifetime(asyncTarget);
+	CHECK_EQ(asyncLifetime.firstPass, async);
+	CHECK_EQ(asyncLifetime.lastPass, consume);
+	CHECK_EQ(graph.GetLifetime(unused).firstPass, FrameGraphNoPass);
+
+	// The compute pass may run at the same time as the draw.
+	CHECK(!graph.CanAlias(asyncTarget, overlapping));
+	CHECK(!graph.CanAlias(overlapping, asyncTarget));
+	CHECK(graph.CanAlias(asyncTarget, later));
+	CHECK(graph.CanAlias(overlapping, later));
+	CHECK(graph.CanAlias(unused, overlapping));
+	CHECK(!graph.CanAlias(later, later));
+
+	// Transients start with an aliasing barrier and have to be initialized by their first pass.
+	const FrameGraphCompiledPass& drawPass = graph.GetCompiledPass(draw);
+	REQUIRE(!drawPass.barriersBefore.empty());
+	CHECK(drawPass.barriersBefore[0].type == FrameGraphBarrierType::Aliasing);
+	CHECK_EQ(drawPass.barriersBefore[0].resource, overlapping);
+	REQUIRE(drawPass.initializations.size() == 1u);
+	CHECK_EQ(drawPass.initializations[0].resource, overlapping);
+	CHECK_EQ(drawPass.initializations[0].state, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	CHECK_EQ(CountBarriers(graph.GetCompiledPass(async).barriersBefore, asyncTarget, FrameGraphBarrierType::Aliasing), 1u);
+	CHECK_EQ(graph.GetStats().aliasingBarrierCount, 3u);
+}
+
+TEST_CASE(InvalidGraphsThrow)
+{
+	FrameGraph graph;
+	const uint32_t transient = graph.AddResource("Transient", D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.SetTransient(transient);
+	const uint32_t pass = graph.AddPass("Pass", FrameGraphQueue::Direct);
+
+	CHECK(Throws([&]() { graph.Read(pass, transient, D3D12_RESOURCE_STATE_RENDER_TARGET); }));
+	CHECK(Throws([&]() { graph.Read(pass, 7u, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE); }));
+
+	// Transients have to be written first.
+	graph.Read(pass, transient, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	CHECK(Throws([&]() { graph.Write(pass, transient, D3D12_RESOURCE_STATE_RENDER_TARGET); }));
+	CHECK(Throws([&]() { graph.Compile(); }));
+
+	graph.ClearPasses();
+	graph.Write(graph.AddPass("Pass", FrameGraphQueue::Direct), transient, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+	CHECK(graph.IsCompiled());
+
+	// Transient content doesn't survive the frame, so there is no final state to go to.
+	graph.SetFinalState(transient, D3D12_RESOURCE_STATE_COMMON);
+	CHECK(Throws([&]() { graph.Compile(); }));
+}
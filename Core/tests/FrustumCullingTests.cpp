@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "InstanceStore.h"
+#include "MathUtils.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// The box -10 <= x, y <= 10, 0 <= z <= 100.
+	FrustumPlanes CreateBoxFrustum()
+	{
+		FrustumPlanes frustum;
+		frustum.planes[0] = { 1.0f, 0.0f, 0.0f, 10.0f };
+		frustum.planes[1] = { -1.0f, 0.0f, 0.0f, 10.0f };
+		frustum.planes[2] = { 0.0f, 1.0f, 0.0f, 10.0f };
+		frustum.planes[3] = { 0.0f, -1.0f, 0.0f, 10.0f };
+		frustum.planes[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+		frustum.planes[5] = { 0.0f, 0.0f, -1.0f, 100.0f };
+		return frustum;
+	}
+
+	// Row vector perspective projection of a camera at the origin that looks down +z, with D3D depth from 0 to 1.
+	FrustumPlanes CreatePerspectiveFrustum()
+	{
+		const float yScale = 1.0f / std::tan(0.5f);
+		const float zRange = 100.0f / (100.0f - 0.1f);
+
+		DirectX::XMFLOAT4X4 projection = {};
+		projection._11 = yScale / (16.0f / 9.0f);
+		projection._22 = yScale;
+		projection._33 = zRange;
+		projection._34 = 1.0f;
+		projection._43 = -0.1f * zRange;
+		return ExtractFrustumPlanes(projection);
+	}
+
+	RenderInstance CreateInstance(UINT cbIndex, const DirectX::XMFLOAT4X4& model)
+	{
+		RenderInstance renderInstance = {};
+		renderInstance.CBIndex = cbIndex;
+		renderInstance.instanceData.modelMatrix = model;
+		return renderInstance;
+	}
+
+	// Instances that are inside, outside and across the planes of both frusta, some rotated and scaled.
+	std::vector<RenderInstance> CreateRandomInstances(uint32_t count, UINT firstCBIndex, uint32_t seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> depth(-20.0f, 120.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.2832f);
+		std::uniform_real_distribution<float> scale(0.2f, 6.0f);
+
+		std::vector<RenderInstance> renderInstances;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const float s = scale(generator);
+			const float a = angle(generator);
+			DirectX::XMFLOAT4X4 model = MathUtils::Translation4x4(position(generator), position(generator), depth(generator));
+			model._11 = s * std::cos(a);
+			model._13 = -s * std::sin(a);
+			model._31 = s * std::sin(a);
+			model._33 = s * std::cos(a);
+			model._22 = s;
+			renderInstances.push_back(CreateInstance(firstCBIndex + i, model));
+		}
+		return renderInstances;
+	}
+
+	// Runs all three paths and checks that they find the same instances.
+	void CheckPathsAgree(const FrustumPlanes& frustum, const BoundingBox& bounds, const std::vector<RenderInstance>& renderInstances)
+	{
+		// A second render object in front of the culled one, so its range doesn't start at zero.
+		RenderInstanceMap renderInstancesByID;
+		renderInstancesByID[RenderObjectID::Cube] = renderInstances;
+		renderInstancesByID[RenderObjectID::Triangle] = CreateRandomInstances(5, (UINT)renderInstances.size(), 7u);
+
+		InstanceStore instanceStore;
+		instanceStore.Build(renderInstancesByID, { { RenderObjectID::Cube, bounds }, { RenderObjectID::Triangle, bounds } });
+		const InstanceRange range = instanceStore.GetRange(RenderObjectID::Cube);
+		REQUIRE(range.count == renderInstances.size());
+
+		std::vector<uint32_t> scalarInstances;
+		std::vector<uint32_t> simdInstances;
+		std::vector<uint32_t> storeInstances;
+		const uint32_t scalarCount = CullInstances(frustum, bounds, renderInstances, scalarInstances, CullingMode::Scalar);
+		CullInstances(frustum, bounds, renderInstances, simdInstances, CullingMode::Simd);
+		CullInstanceRange(frustum, instanceStore, range, storeInstances);
+
+		CHECK_EQ(scalarCount, (uint32_t)scalarInstances.size());
+		CHECK(simdInstances == scalarInstances);
+		CHECK(storeInstances == scalarInstances);
+
+		for (uint32_t i = 0; i < (uint32_t)renderInstances.size(); i++)
+		{
+			const bool isVisible = std::find(scalarInstances.begin(), scalarInstances.end(), i) != scalarInstances.end();
+			CHECK_EQ(IsInstanceVisible(frustum, bounds, renderInstances[i].instanceData.modelMatrix), isVisible);
+		}
+	}
+
+	const BoundingBox UnitBounds = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+}
+
+TEST_CASE(InsideOutsideAndStraddlingBoxes)
+{
+	const FrustumPlanes frustum = CreateBoxFrustum();
+
+	const std::vector<RenderInstance> renderInstances = {
+		CreateInstance(0, MathUtils::Translation4x4(0.0f, 0.0f, 50.0f)),
+		// Outside of one plane each.
+		CreateInstance(1, MathUtils::Translation4x4(12.0f, 0.0f, 50.0f)),
+		CreateInstance(2, MathUtils::Translation4x4(0.0f, -12.0f, 50.0f)),
+		CreateInstance(3, MathUtils::Translation4x4(0.0f, 0.0f, -2.0f)),
+		CreateInstance(4, MathUtils::Translation4x4(0.0f, 0.0f, 102.0f)),
+		// Across one plane each.
+		CreateInstance(5, MathUtils::Translation4x4(10.5f, 0.0f, 50.0f)),
+		CreateInstance(6, MathUtils::Translation4x4(0.0f, 0.0f, 100.5f)),
+		// Just touching a plane counts as inside.
+		CreateInstance(7, MathUtils::Translation4x4(-11.0f, 0.0f, 50.0f)),
+		// Outside of two planes at a corner.
+		CreateInstance(8, MathUtils::Translation4x4(12.0f, 12.0f, 50.0f)),
+		CreateInstance(9, MathUtils::Translation4x4(0.0f, 0.0f, 0.0f))
+	};
+
+	std::vector<uint32_t> visibleInstances;
+	for (const CullingMode mode : { CullingMode::Scalar, CullingMode::Simd })
+	{
+		CHECK_EQ(CullInstances(frustum, UnitBounds, renderInstances, visibleInstances, mode), 5u);
+		CHECK(visibleInstances == std::vector<uint32_t>({ 0u, 5u, 6u, 7u, 9u }));
+	}
+
+	CheckPathsAgree(frustum, UnitBounds, renderInstances);
+}
+
+TEST_CASE(ScaledAndRotatedBoundsAreWidened)
+{
+	const FrustumPlanes frustum = CreateBoxFrustum();
+
+	// A box 12 away from the side is only reached when it's scaled by more than 11 along x.
+	DirectX::XMFLOAT4X4 model = MathUtils::Translation4x4(22.0f, 0.0f, 50.0f);
+	CHECK(!IsInstanceVisible(frustum, UnitBounds, model));
+	model._11 = 12.5f;
+	CHECK(IsInstanceVisible(frustum, UnitBounds, model));
+
+	// Rotating the scale onto z keeps it out again.
+	model._11 = 0.0f;
+	model._13 = 12.5f;
+	model._31 = -1.0f;
+	model._33 = 0.0f;
+	CHECK(!IsInstanceVisible(frustum, UnitBounds, model));
+
+	// Offset object bounds move the center.
+	const BoundingBox offsetBounds = { { -25.0f, -1.0f, -1.0f }, { -23.0f, 1.0f, 1.0f } };
+	CHECK(IsInstanceVisible(frustum, offsetBounds, MathUtils::Translation4x4(22.0f, 0.0f, 50.0f)));
+}
+
+TEST_CASE(ScalarSimdAndStorePathsAgree)
+{
+	const BoundingBox offsetBounds = { { 0.5f, -2.0f, -0.5f }, { 3.0f, 1.0f, 4.0f } };
+
+	// Counts around and between multiples of the SIMD width, so the last lanes of a range are masked.
+	for (const uint32_t count : { 0u, 1u, 7u, 8u, 9u, 13u, 31u, 1001u })
+	{
+		const std::vector<RenderInstance> renderInstances = CreateRandomInstances(count, 0u, 1000u + count);
+		CheckPathsAgree(CreateBoxFrustum(), UnitBounds, renderInstances);
+		CheckPathsAgree(CreatePerspectiveFrustum(), offsetBounds, renderInstances);
+	}
+}
+
+TEST_CASE(RandomScenesHaveVisibleAndCulledInstances)
+{
+	const std::vector<RenderInstance> renderInstances = CreateRandomInstances(1001u, 0u, 42u);
+
+	std::vector<uint32_t> visibleInstances;
+	const uint32_t visibleCount = CullInstances(CreatePerspectiveFrustum(), UnitBounds, renderInstances, visibleInstances, CullingMode::Scalar);
+
+	// Otherwise the comparisons above would pass without testing anything.
+	CHECK(visibleCount > 50u);
+	CHECK(visibleCount < 950u);
+}
+
+TEST_CASE(BenchmarkPathsMatch)
+{
+	InstanceCullingBenchmarkSettings settings;
+	settings.instanceCount = 10001u;
+	settings.iterationCount = 1u;
+	const InstanceCullingBenchmarkResult result = BenchmarkInstanceCulling(settings);
+
+	CHECK_EQ(result.instanceCount, 10001u);
+	CHECK(result.visibleCount > 0u);
+	CHECK_EQ(result.mismatchedCount, 0u);
+
+	for (const CullingBenchmarkResult& modeResult : BenchmarkCulling(CreatePerspectiveFrustum(), UnitBounds, CreateRandomInstances(999u, 0u, 3u), 1u))
+	{
+		CHECK_EQ(modeResult.mismatchedCount, 0u);
+	}
+}
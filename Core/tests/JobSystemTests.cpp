@@ -0,0 +1,111 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TestUtils.h"
+
+TEST_CASE(EveryJobRunsOnce)
+{
+	JobSystem jobSystem(4u);
+	CHECK_EQ(jobSystem.GetThreadCount(), 4u);
+
+	constexpr uint32_t JobCount = 1000u;
+	std::vector<std::atomic<uint32_t>> runCounts(JobCount);
+
+	JobCounter counter = 0;
+	for (uint32_t i = 0; i < JobCount; i++)
+	{
+		jobSystem.Dispatch(counter, [&runCounts, i]()
+		{
+			runCounts[i]++;
+		});
+	}
+	jobSystem.Wait(counter);
+
+	CHECK_EQ(counter.load(), 0u);
+	bool allOnce = true;
+	for (const auto& runCount : runCounts)
+	{
+		allOnce = allOnce && runCount.load() == 1u;
+	}
+	CHECK(allOnce);
+	CHECK_EQ(jobSystem.GetStats().executedJobCount, uint64_t(JobCount));
+}
+
+TEST_CASE(JobsCanDispatchAndWaitForJobs)
+{
+	JobSystem jobSystem(3u);
+	std::atomic<uint32_t> leafCount = 0;
+
+	// Like a render pass that splits its instances into recording jobs.
+	JobCounter outerCounter = 0;
+	for (uint32_t i = 0; i < 8u; i++)
+	{
+		jobSystem.Dispatch(outerCounter, [&jobSystem, &leafCount]()
+		{
+			JobCounter innerCounter = 0;
+			for (uint32_t j = 0; j < 16u; j++)
+			{
+				jobSystem.Dispatch(innerCounter, [&leafCount]()
+				{
+					leafCount++;
+				});
+			}
+			jobSystem.Wait(innerCounter);
+		});
+	}
+	jobSystem.Wait(outerCounter);
+
+	CHECK_EQ(leafCount.load(), 8u * 16u);
+}
+
+TEST_CASE(BenchmarkRecordsEveryJob)
+{
+	JobSystem jobSystem(2u);
+
+	JobSystemBenchmarkSettings settings;
+	settings.frameCount = 4u;
+	const JobSystemBenchmarkResult result = BenchmarkJobSystem(jobSystem, settings);
+
+	CHECK_EQ(result.threadCount, 2u);
+	CHECK(result.serialFrameMilliseconds > 0.0);
+	CHECK(result.parallelFrameMilliseconds > 0.0);
+	CHECK(result.speedup > 0.0);
+}
+
+TEST_CASE(ParkedThreadsWakeForJobsAndFinishedBatches)
+{
+	JobSystem jobSystem(4u);
+
+	// Long enough for the idle workers to park before the first batch.
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	for (uint32_t batch = 0; batch < 3u; batch++)
+	{
+		// The calling thread takes the newest job first, and usually parks while a worker runs the slow one.
+		std::atomic<uint32_t> runCount = 0;
+		JobCounter counter = 0;
+		jobSystem.Dispatch(counter, [&]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(30));
+			runCount++;
+		});
+		jobSystem.Dispatch(counter, [&]() { runCount++; });
+		jobSystem.Wait(counter);
+		CHECK_EQ(runCount.load(), 2u);
+		CHECK_EQ(counter.load(), 0u);
+	}
+
+	CHECK(jobSystem.GetStats().parkCount > 0u);
+}
+
+TEST_CASE(SyncBenchmarkRunsEveryContextCount)
+{
+	for (uint32_t contextCount : { 2u, 8u, 32u })
+	{
+		const JobSyncBenchmarkResult result = BenchmarkJobSync(contextCount, 20u, 4u);
+		CHECK_EQ(result.contextCount, contextCount);
+		CHECK(result.frameMicroseconds > 0.0);
+	}
+}
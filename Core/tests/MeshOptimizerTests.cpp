@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include "MeshOptimizer.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Grid of gridSize x gridSize vertices with two triangles per cell, in row order.
+	MeshData CreateGrid(uint32_t gridSize)
+	{
+		MeshData mesh;
+		for (uint32_t y = 0; y < gridSize; y++)
+		{
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				Vertex vertex = {};
+				vertex.position = { float(x), 0.0f, float(y) };
+				vertex.normal = { 0.0f, 1.0f, 0.0f };
+				mesh.vertices.push_back(vertex);
+			}
+		}
+
+		for (uint32_t y = 0; y + 1u < gridSize; y++)
+		{
+			for (uint32_t x = 0; x + 1u < gridSize; x++)
+			{
+				const VertexIndex i0 = y * gridSize + x;
+				const VertexIndex i1 = i0 + 1u;
+				const VertexIndex i2 = i0 + gridSize;
+				const VertexIndex i3 = i2 + 1u;
+				mesh.indices.insert(mesh.indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+		return mesh;
+	}
+
+	// Shuffles the triangles so that the input has no locality left.
+	void ShuffleTriangles(std::vector<VertexIndex>& indices, uint32_t seed)
+	{
+		std::vector<std::array<VertexIndex, 3>> triangles(indices.size() / 3u);
+		std::copy(indices.begin(), indices.end(), triangles.front().data());
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+		std::copy(triangles.front().data(), triangles.front().data() + indices.size(), indices.begin());
+	}
+
+	// Triangles as position triples, rotated so that the smallest corner comes first and sorted. Two meshes draw the same
+	// triangles with the same winding if these are equal, no matter how triangles and vertices were reordered.
+	std::vector<std::array<float, 9>> GetCanonicalTriangles(const MeshData& mesh)
+	{
+		std::vector<std::array<float, 9>> triangles;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3u)
+		{
+			std::array<std::array<float, 3>, 3> corners;
+			for (uint32_t c = 0; c < 3u; c++)
+			{
+				const DirectX::XMFLOAT3& position = mesh.vertices[mesh.indices[i + c]].position;
+				corners[c] = { position.x, position.y, position.z };
+			}
+			std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+			std::array<float, 9> triangle;
+			std::copy(corners.front().data(), corners.front().data() + 9u, triangle.data());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+TEST_CASE(AnalyzeVertexCacheCountsMisses)
+{
+	// A lone triangle transforms every corner once.
+	const std::vector<VertexIndex> triangle = { 0u, 1u, 2u };
+	VertexCacheStats stats = AnalyzeVertexCache(triangle, 3u);
+	CHECK_NEAR(stats.acmr, 3.0f, 1e-6f);
+	CHECK_NEAR(stats.atvr, 1.0f, 1e-6f);
+
+	// Two triangles sharing an edge transform four vertices.
+	const std::vector<VertexIndex> quad = { 0u, 1u, 2u, 2u, 1u, 3u };
+	stats = AnalyzeVertexCache(quad, 4u);
+	CHECK_NEAR(stats.acmr, 2.0f, 1e-6f);
+	CHECK_NEAR(stats.atvr, 1.0f, 1e-6f);
+
+	// With a three entry FIFO the first triangle is evicted before it is used again.
+	const std::vector<VertexIndex> evicted = { 0u, 1u, 2u, 3u, 4u, 5u, 0u, 1u, 2u };
+	stats = AnalyzeVertexCache(evicted, 6u, 3u);
+	CHECK_NEAR(stats.acmr, 3.0f, 1e-6f);
+	CHECK_NEAR(stats.atvr, 1.5f, 1e-6f);
+
+	// A large enough cache keeps it.
+	stats = AnalyzeVertexCache(evicted, 6u, 16u);
+	CHECK_NEAR(stats.acmr, 2.0f, 1e-6f);
+	CHECK_NEAR(stats.atvr, 1.0f, 1e-6f);
+}
+
+TEST_CASE(OptimizeVertexCacheImprovesShuffledGrid)
+{
+	MeshData mesh = CreateGrid(64u);
+	ShuffleTriangles(mesh.indices, 1u);
+
+	const VertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	std::vector<VertexIndex> optimized = mesh.indices;
+	OptimizeVertexCache(optimized, mesh.vertices.size());
+	const VertexCacheStats after = AnalyzeVertexCache(optimized, mesh.vertices.size());
+
+	// A shuffled grid misses on nearly every corner. A regular grid can't go below 0.5, and Forsyth's algorithm
+	// stays well under 1 on one with a 16 entry cache.
+	CHECK(before.acmr > 2.5f);
+	CHECK(after.acmr < 0.8f);
+	CHECK(after.acmr >= 0.5f);
+	CHECK(after.atvr < 1.5f);
+
+	MeshData optimizedMesh = { mesh.vertices, optimized };
+	CHECK(GetCanonicalTriangles(optimizedMesh) == GetCanonicalTriangles(mesh));
+}
+
+TEST_CASE(OptimizeVertexFetchNumbersVerticesByFirstUse)
+{
+	MeshData mesh = CreateGrid(16u);
+
+	// Drop the last row of cells so that the bottom row of vertices is no longer referenced.
+	const size_t unusedVertexCount = 16u;
+	mesh.indices.resize(mesh.indices.size() - 15u * 6u);
+	ShuffleTriangles(mesh.indices, 2u);
+
+	const auto triangles = GetCanonicalTriangles(mesh);
+	OptimizeVertexFetch(mesh);
+
+	CHECK_EQ(mesh.vertices.size(), size_t(16u * 16u) - unusedVertexCount);
+
+	// Every index is either a vertex seen before or the next new one.
+	VertexIndex nextVertex = 0u;
+	bool inOrder = true;
+	for (VertexIndex index : mesh.indices)
+	{
+		inOrder = inOrder && index <= nextVertex;
+		nextVertex = std::max(nextVertex, VertexIndex(index + 1u));
+	}
+	CHECK(inOrder);
+	CHECK_EQ(size_t(nextVertex), mesh.vertices.size());
+	CHECK(GetCanonicalTriangles(mesh) == triangles);
+}
+
+TEST_CASE(OptimizeMeshReportsBeforeAndAfter)
+{
+	MeshData mesh = CreateGrid(48u);
+	ShuffleTriangles(mesh.indices, 3u);
+
+	const VertexCacheStats input = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	const auto triangles = GetCanonicalTriangles(mesh);
+
+	MeshOptimizationSettings settings;
+	settings.optimizeOverdraw = true;
+	const MeshOptimizationStats stats = OptimizeMesh(mesh, settings);
+
+	CHECK_NEAR(stats.before.acmr, input.acmr, 1e-6f);
+	CHECK_NEAR(stats.before.atvr, input.atvr, 1e-6f);
+
+	const VertexCacheStats output = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	CHECK_NEAR(stats.after.acmr, output.acmr, 1e-6f);
+	CHECK_NEAR(stats.after.atvr, output.atvr, 1e-6f);
+
+	// Overdraw sorting may give up a little cache efficiency, but only up to the threshold per cluster.
+	CHECK(stats.after.acmr < stats.before.acmr * 0.5f);
+	CHECK(GetCanonicalTriangles(mesh) == triangles);
+}
+
+TEST_CASE(OptimizeMeshIsDeterministic)
+{
+	MeshData first = CreateGrid(32u);
+	ShuffleTriangles(first.indices, 4u);
+	MeshData second = first;
+
+	MeshOptimizationSettings settings;
+	settings.optimizeOverdraw = true;
+	OptimizeMesh(first, settings);
+	OptimizeMesh(second, settings);
+
+	CHECK(first.indices == second.indices);
+	CHECK(GetCanonicalTriangles(first) == GetCanonicalTriangles(second));
+}
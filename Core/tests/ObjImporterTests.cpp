@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ObjImporter.h"
+#include "TestUtils.h"
+
+namespace
+{
+	void Import(const std::string& obj, MeshData& mesh, const ObjImportSettings& settings = {}, ObjImportStats* stats = nullptr)
+	{
+		ImportOBJFromMemory(obj.data(), obj.size(), mesh, settings, stats);
+	}
+
+	bool IsSameMesh(const MeshData& a, const MeshData& b)
+	{
+		return a.indices == b.indices && a.vertices.size() == b.vertices.size() &&
+			memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0;
+	}
+
+	// Grid of quads with gridSize x gridSize positions and a normal per row, large enough to be split into many chunks.
+	// The second half of the faces uses relative indices, which point back into earlier chunks.
+	std::string CreateGridObj(uint32_t gridSize)
+	{
+		std::string obj = "# grid\n";
+		for (uint32_t y = 0; y < gridSize; y++)
+		{
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				obj += "v " + std::to_string(x) + " 0.5 " + std::to_string(y) + "\n";
+			}
+			obj += "vn 0 1 " + std::to_string(y % 2) + "\n";
+		}
+
+		const int64_t positionCount = (int64_t)gridSize * gridSize;
+		for (uint32_t y = 0; y + 1u < gridSize; y++)
+		{
+			for (uint32_t x = 0; x + 1u < gridSize; x++)
+			{
+				const int64_t corners[4] = { y * gridSize + x + 1, y * gridSize + x + 2, (y + 1) * gridSize + x + 2, (y + 1) * gridSize + x + 1 };
+				const int64_t normal = y + 1;
+				const bool isRelative = y >= gridSize / 2u;
+
+				obj += "f";
+				for (int64_t corner : corners)
+				{
+					obj += " " + std::to_string(isRelative ? corner - positionCount - 1 : corner) + "//" + std::to_string(isRelative ? normal - gridSize - 1 : normal);
+				}
+				obj += "\n";
+			}
+		}
+		return obj;
+	}
+}
+
+TEST_CASE(SeamVerticesStaySplit)
+{
+	// Positions 2 and 3 are shared by two triangles with different normals. The third face reuses corners of the first.
+	const std::string obj =
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+		"vn 0 0 1\nvn 0 1 0\n"
+		"f 1//1 2//1 3//1\n"
+		"f 2//2 4//2 3//2\n"
+		"f 3//1 2//1 1//1\n";
+
+	MeshData mesh;
+	Import(obj, mesh);
+	REQUIRE(mesh.vertices.size() == 6u);
+	CHECK(mesh.indices == std::vector<VertexIndex>({ 0, 1, 2, 3, 4, 5, 2, 1, 0 }));
+
+	CHECK_EQ(mesh.vertices[1].position.x, mesh.vertices[3].position.x);
+	CHECK_EQ(mesh.vertices[1].normal.z, 1.0f);
+	CHECK_EQ(mesh.vertices[3].normal.y, 1.0f);
+	CHECK_EQ(mesh.vertices[0].color.x, 1.0f);
+}
+
+TEST_CASE(TexcoordsOnlySplitWhenAskedTo)
+{
+	const std::string obj =
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 0 1\nvt 1 1\nvt 0.5 0.5\n"
+		"vn 0 0 1\n"
+		"f 1/1/1 2/2/1 3/3/1\n"
+		"f 2/5/1 4/4/1 3/5/1\n";
+
+	MeshData mesh;
+	Import(obj, mesh);
+	CHECK_EQ(mesh.vertices.size(), 6u);
+
+	ObjImportSettings settings;
+	settings.weldOnTexcoords = false;
+	Import(obj, mesh, settings);
+	CHECK_EQ(mesh.vertices.size(), 4u);
+	CHECK(mesh.indices == std::vector<VertexIndex>({ 0, 1, 2, 1, 3, 2 }));
+}
+
+TEST_CASE(RelativeIndicesMatchAbsoluteOnes)
+{
+	MeshData absolute;
+	Import("v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//1 3//1\nv 1 1 0\nvn 0 1 0\nf 2//2 4//2 3//2\n", absolute);
+
+	MeshData relative;
+	Import("v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf -3//-1 -2//-1 -1//-1\nv 1 1 0\nvn 0 1 0\nf -3//-1 -1//-1 -2//-1\n", relative);
+	CHECK(IsSameMesh(absolute, relative));
+
+	// Indices past either end of the attributes are errors.
+	bool threw = false;
+	try
+	{
+		Import("v 0 0 0\nv 1 0 0\nv 0 1 0\nf -4 -2 -1\n", relative);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	threw = false;
+	try
+	{
+		Import("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n", relative);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE(PolygonsAreTriangulatedAsFans)
+{
+	const std::string obj =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0.5 0\n"
+		"f 1 2 3 4\n"
+		"f 1 2 3 4 5\n";
+
+	MeshData mesh;
+	Import(obj, mesh);
+	REQUIRE(mesh.vertices.size() == 5u);
+	CHECK(mesh.indices == std::vector<VertexIndex>({ 0, 1, 2, 0, 2, 3, 0, 1, 2, 0, 2, 3, 0, 3, 4 }));
+}
+
+TEST_CASE(LineEndingsDontMatter)
+{
+	const std::string obj = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvn 0 0 1\nf 1//1 2//1 3//1\nf 2//1 4//1 3//1\n";
+
+	MeshData reference;
+	Import(obj, reference);
+	REQUIRE(reference.indices.size() == 6u);
+
+	std::string crlf;
+	for (char c : obj)
+	{
+		crlf += c == '\n' ? "\r\n" : std::string(1, c);
+	}
+
+	MeshData mesh;
+	Import(crlf, mesh);
+	CHECK(IsSameMesh(reference, mesh));
+
+	// Without the trailing newline the last face still counts.
+	Import(obj.substr(0, obj.size() - 1), mesh);
+	CHECK(IsSameMesh(reference, mesh));
+	Import(crlf.substr(0, crlf.size() - 2), mesh);
+	CHECK(IsSameMesh(reference, mesh));
+}
+
+TEST_CASE(ThreadAndChunkCountsDontChangeTheMesh)
+{
+	constexpr uint32_t GridSize = 160u;
+	const std::string obj = CreateGridObj(GridSize);
+
+	ObjImportSettings settings;
+	settings.threadCount = 1u;
+	settings.chunksPerThread = 1u;
+	MeshData reference;
+	ObjImportStats referenceStats;
+	Import(obj, reference, settings, &referenceStats);
+	CHECK_EQ(referenceStats.chunkCount, 1u);
+	// Every position is used with the normal of its own row and of the row below or above.
+	CHECK_EQ(reference.vertices.size(), (size_t)2u * GridSize * GridSize - 2u * GridSize);
+	CHECK_EQ(reference.indices.size(), (size_t)6u * (GridSize - 1u) * (GridSize - 1u));
+
+	uint32_t maxChunkCount = 0;
+	for (uint32_t threadCount : { 2u, 4u, 7u })
+	{
+		for (uint32_t chunksPerThread : { 1u, 4u, 16u })
+		{
+			settings.threadCount = threadCount;
+			settings.chunksPerThread = chunksPerThread;
+
+			MeshData mesh;
+			ObjImportStats stats;
+			Import(obj, mesh, settings, &stats);
+			CHECK(IsSameMesh(reference, mesh));
+			CHECK_EQ(stats.vertexCount, referenceStats.vertexCount);
+			maxChunkCount = std::max(maxChunkCount, stats.chunkCount);
+		}
+	}
+
+	// The grid has to be large enough to end up in many chunks.
+	CHECK(maxChunkCount >= 8u);
+}
@@ -0,0 +1,139 @@
+#include <stdexcept>
+
+#include "RingAllocator.h"
+#include "TestUtils.h"
+
+namespace
+{
+	template <typename Function>
+	bool Throws(Function&& function)
+	{
+		try
+		{
+			function();
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST_CASE(AllocationsAreBackToBack)
+{
+	RingAllocator ring(1024);
+
+	CHECK_EQ(ring.Allocate(100, 1), 0u);
+	CHECK_EQ(ring.Allocate(200, 1), 100u);
+	CHECK_EQ(ring.GetUsedSize(), 300u);
+	CHECK_EQ(ring.GetStats().allocatedBytes, 300u);
+	CHECK_EQ(ring.GetStats().wastedBytes, 0u);
+}
+
+TEST_CASE(OffsetsAreAligned)
+{
+	RingAllocator ring(1024);
+
+	CHECK_EQ(ring.Allocate(3, 1), 0u);
+	CHECK_EQ(ring.Allocate(8, 256), 256u);
+	CHECK_EQ(ring.Allocate(1, 16), 272u);
+	CHECK_EQ(ring.Allocate(4, 4), 276u);
+	CHECK_EQ(ring.GetStats().wastedBytes, 253u + 8u + 3u);
+	CHECK_EQ(ring.GetUsedSize(), 280u);
+
+	// Alignments have to be powers of two that divide the capacity, or the offsets wouldn't stay aligned after wrapping.
+	CHECK(Throws([&]() { ring.Allocate(4, 3); }));
+	CHECK(Throws([&]() { ring.Allocate(4, 0); }));
+	CHECK(Throws([&]() { ring.Allocate(4, 2048); }));
+	CHECK(Throws([&]() { ring.Allocate(0, 4); }));
+	CHECK(Throws([&]() { ring.Allocate(1025, 1); }));
+	CHECK(Throws([]() { RingAllocator empty(0); }));
+}
+
+TEST_CASE(AllocationsWrapAtTheEndOfTheRing)
+{
+	RingAllocator ring(1024);
+
+	CHECK_EQ(ring.Allocate(600, 1), 0u);
+	ring.FinishFrame(1);
+	CHECK_EQ(ring.Allocate(300, 1), 600u);
+	ring.FinishFrame(2);
+	ring.Retire(1);
+
+	// 124 bytes are left before the end, so the allocation starts over at offset zero and skips them.
+	CHECK_EQ(ring.Allocate(200, 1), 0u);
+	CHECK_EQ(ring.GetStats().wrapCount, 1u);
+	CHECK_EQ(ring.GetStats().wastedBytes, 124u);
+	CHECK_EQ(ring.GetUsedSize(), 300u + 124u + 200u);
+
+	// The ring now ends where frame 2 starts.
+	CHECK_EQ(ring.Allocate(400, 1), 200u);
+	CHECK_EQ(ring.Allocate(1, 1), RingAllocatorInvalidOffset);
+
+	// The head is at 600, aligned to 768 the allocation would cross the end. It wraps and stays aligned.
+	ring.FinishFrame(3);
+	ring.Retire(3);
+	CHECK_EQ(ring.GetUsedSize(), 0u);
+	CHECK_EQ(ring.Allocate(400, 256), 0u);
+	CHECK_EQ(ring.Allocate(256, 256), 512u);
+	CHECK_EQ(ring.GetStats().wrapCount, 2u);
+}
+
+TEST_CASE(AllocationsFailWhileTheRingIsFull)
+{
+	RingAllocator ring(1024);
+
+	CHECK_EQ(ring.Allocate(512, 1), 0u);
+	ring.FinishFrame(1);
+	CHECK_EQ(ring.Allocate(512, 1), 512u);
+	ring.FinishFrame(2);
+
+	// The GPU may still read both frames.
+	CHECK_EQ(ring.Allocate(1, 1), RingAllocatorInvalidOffset);
+	ring.Retire(0);
+	CHECK_EQ(ring.Allocate(1, 1), RingAllocatorInvalidOffset);
+	CHECK_EQ(ring.GetStats().failedAllocationCount, 2u);
+	CHECK_EQ(ring.GetFramesInFlight(), 2u);
+
+	// A failed allocation doesn't take any memory, so retiring the first frame frees exactly its 512 bytes.
+	ring.Retire(1);
+	CHECK_EQ(ring.GetUsedSize(), 512u);
+	CHECK_EQ(ring.Allocate(513, 1), RingAllocatorInvalidOffset);
+	CHECK_EQ(ring.Allocate(512, 1), 0u);
+	CHECK_EQ(ring.GetStats().peakUsedSize, 1024u);
+}
+
+TEST_CASE(FramesRetireUpToTheCompletedFence)
+{
+	RingAllocator ring(1024);
+
+	for (uint64_t fenceValue = 1; fenceValue <= 3; fenceValue++)
+	{
+		ring.Allocate(100, 1);
+		ring.FinishFrame(fenceValue);
+	}
+
+	// A frame without allocations isn't tracked.
+	ring.FinishFrame(4);
+	CHECK_EQ(ring.GetFramesInFlight(), 3u);
+
+	// Fences that are reached out of step with the calls retire every frame up to them at once.
+	ring.Retire(2);
+	CHECK_EQ(ring.GetFramesInFlight(), 1u);
+	CHECK_EQ(ring.GetUsedSize(), 100u);
+
+	// A stale completed value, as from a fence that was read earlier, doesn't free anything.
+	ring.Retire(1);
+	CHECK_EQ(ring.GetFramesInFlight(), 1u);
+	CHECK_EQ(ring.GetStats().retiredFrameCount, 2u);
+
+	// Frames have to be finished in fence order, but may share a fence value.
+	ring.Allocate(100, 1);
+	ring.FinishFrame(4);
+	CHECK(Throws([&]() { ring.FinishFrame(3); }));
+
+	ring.Retire(4);
+	CHECK_EQ(ring.GetFramesInFlight(), 0u);
+	CHECK_EQ(ring.GetUsedSize(), 0u);
+}
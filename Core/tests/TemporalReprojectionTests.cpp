@@ -0,0 +1,158 @@
+#include <cmath>
+#include <vector>
+
+#include "TemporalReprojection.h"
+#include "TestScene.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr uint32_t Width = 160u;
+	constexpr uint32_t Height = 90u;
+	// Orbit of the renderer's camera, see DX12Renderer::UpdateCamera().
+	constexpr float OrbitRadiansPerFrame = 2.0f * 3.14159265f / (20.0f * 60.0f);
+
+	struct OrbitFrame
+	{
+		TemporalCamera camera;
+		RTAOGBuffer gBuffer;
+	};
+
+	OrbitFrame CreateOrbitFrame(uint32_t frameIndex)
+	{
+		const float angle = frameIndex * OrbitRadiansPerFrame;
+		const DirectX::XMFLOAT3 eye = {
+			TestCameraEye.x * std::cos(angle) + TestCameraEye.z * std::sin(angle),
+			TestCameraEye.y,
+			-TestCameraEye.x * std::sin(angle) + TestCameraEye.z * std::cos(angle)
+		};
+
+		OrbitFrame frame;
+		frame.camera = CreateTemporalCamera(eye, TestCameraTarget, TestCameraFov, (float)Width / (float)Height);
+		frame.gBuffer = CreateSyntheticGBuffer(GetTestScene(), Width, Height, eye, TestCameraTarget, TestCameraFov);
+		return frame;
+	}
+
+	uint32_t GetSurfacePixelCount(const TemporalAccumulationStats& stats)
+	{
+		return stats.reprojectedPixelCount + stats.disoccludedPixelCount;
+	}
+}
+
+TEST_CASE(ConstantsMatchTheShader)
+{
+	CHECK_EQ((float)ReadShaderDefine("TemporalHistory.hlsli", "MAX_HISTORY_LENGTH"), TemporalMaxHistoryLength);
+	CHECK_EQ((float)ReadShaderDefine("TemporalHistory.hlsli", "DEPTH_TOLERANCE"), TemporalDepthTolerance);
+	CHECK_EQ((float)ReadShaderDefine("TemporalHistory.hlsli", "NORMAL_THRESHOLD"), TemporalNormalThreshold);
+	CHECK_EQ((float)ReadShaderDefine("TemporalHistory.hlsli", "MIN_HISTORY_WEIGHT"), TemporalMinHistoryWeight);
+}
+
+TEST_CASE(StaticCameraReprojectsEverySurfacePixel)
+{
+	const OrbitFrame frame = CreateOrbitFrame(0u);
+	const std::vector<float> ao(Width * Height, 0.5f);
+
+	TemporalHistory first;
+	const TemporalAccumulationStats firstStats = AccumulateTemporal(frame.gBuffer, ao, frame.camera, frame.camera, nullptr, first);
+	REQUIRE(GetSurfacePixelCount(firstStats) > 0u);
+	CHECK_EQ(firstStats.reprojectedPixelCount, 0u);
+	CHECK_NEAR(firstStats.averageHistoryLength, 1.0f, 1e-6f);
+
+	TemporalHistory second;
+	const TemporalAccumulationStats secondStats = AccumulateTemporal(frame.gBuffer, ao, frame.camera, frame.camera, &first, second);
+	CHECK_EQ(secondStats.disoccludedPixelCount, 0u);
+	CHECK_EQ(secondStats.reprojectedPixelCount, GetSurfacePixelCount(firstStats));
+	CHECK_EQ(secondStats.backgroundPixelCount, firstStats.backgroundPixelCount);
+	CHECK_NEAR(secondStats.averageHistoryLength, 2.0f, 1e-6f);
+
+	for (size_t pixel = 0; pixel < second.values.size(); pixel++)
+	{
+		CHECK_NEAR(second.values[pixel].x, 0.5f, 1e-6f);
+	}
+}
+
+TEST_CASE(OrbitingCameraKeepsTheHistory)
+{
+	// Forty frames of the renderer's orbit. Only the pixels that come into view at the edges and behind the silhouettes
+	// of the spheres lose their history, which is about one in a hundred.
+	constexpr uint32_t FrameCount = 40u;
+	const std::vector<float> ao(Width * Height, 0.5f);
+
+	OrbitFrame previousFrame = CreateOrbitFrame(0u);
+	TemporalHistory previous;
+	AccumulateTemporal(previousFrame.gBuffer, ao, previousFrame.camera, previousFrame.camera, nullptr, previous);
+
+	uint64_t reprojectedPixelCount = 0;
+	uint64_t surfacePixelCount = 0;
+	TemporalAccumulationStats lastStats;
+	for (uint32_t frameIndex = 1; frameIndex < FrameCount; frameIndex++)
+	{
+		OrbitFrame frame = CreateOrbitFrame(frameIndex);
+		TemporalHistory next;
+		lastStats = AccumulateTemporal(frame.gBuffer, ao, frame.camera, previousFrame.camera, &previous, next);
+
+		reprojectedPixelCount += lastStats.reprojectedPixelCount;
+		surfacePixelCount += GetSurfacePixelCount(lastStats);
+		previous = std::move(next);
+		previousFrame = std::move(frame);
+	}
+
+	REQUIRE(surfacePixelCount > 0u);
+	CHECK((double)reprojectedPixelCount / surfacePixelCount >= 0.98);
+	// The pixels that were disoccluded on the way start over, so the average stays below the frame count.
+	CHECK(lastStats.averageHistoryLength >= 0.75f * FrameCount);
+}
+
+TEST_CASE(ChangedSurfacesAreDisoccluded)
+{
+	const OrbitFrame frame = CreateOrbitFrame(0u);
+	const std::vector<float> ao(Width * Height, 0.5f);
+
+	TemporalHistory history;
+	const TemporalAccumulationStats stats = AccumulateTemporal(frame.gBuffer, ao, frame.camera, frame.camera, nullptr, history);
+
+	// Surfaces that were further away than the tolerance allows.
+	TemporalHistory fartherHistory = history;
+	for (DirectX::XMFLOAT4& surface : fartherHistory.surfaces)
+	{
+		surface.w *= 1.0f + 2.0f * TemporalDepthTolerance;
+	}
+	TemporalHistory next;
+	TemporalAccumulationStats nextStats = AccumulateTemporal(frame.gBuffer, ao, frame.camera, frame.camera, &fartherHistory, next);
+	CHECK_EQ(nextStats.reprojectedPixelCount, 0u);
+	CHECK_EQ(nextStats.disoccludedPixelCount, GetSurfacePixelCount(stats));
+	CHECK_NEAR(nextStats.averageHistoryLength, 1.0f, 1e-6f);
+
+	// Surfaces that faced the other way.
+	TemporalHistory flippedHistory = history;
+	for (DirectX::XMFLOAT4& surface : flippedHistory.surfaces)
+	{
+		surface = { -surface.x, -surface.y, -surface.z, surface.w };
+	}
+	nextStats = AccumulateTemporal(frame.gBuffer, ao, frame.camera, frame.camera, &flippedHistory, next);
+	CHECK_EQ(nextStats.reprojectedPixelCount, 0u);
+	CHECK_EQ(nextStats.disoccludedPixelCount, GetSurfacePixelCount(stats));
+}
+
+TEST_CASE(UnsampledPixelsHoldTheirHistory)
+{
+	const OrbitFrame frame = CreateOrbitFrame(0u);
+	const std::vector<float> firstAO(Width * Height, 0.25f);
+	const std::vector<float> secondAO(Width * Height, 1.0f);
+	const std::vector<uint8_t> sampleCounts(Width * Height, 0u);
+
+	TemporalHistory first;
+	AccumulateTemporal(frame.gBuffer, firstAO, frame.camera, frame.camera, nullptr, first);
+	TemporalHistory second;
+	const TemporalAccumulationStats stats = AccumulateTemporal(frame.gBuffer, secondAO, frame.camera, frame.camera, &first, second, sampleCounts);
+
+	CHECK_EQ(stats.heldPixelCount, stats.reprojectedPixelCount);
+	CHECK_NEAR(stats.averageHistoryLength, 1.0f, 1e-6f);
+	for (size_t pixel = 0; pixel < second.values.size(); pixel++)
+	{
+		if (second.values[pixel].y > 0.0f)
+		{
+			CHECK_NEAR(second.values[pixel].x, 0.25f, 1e-6f);
+		}
+	}
+}
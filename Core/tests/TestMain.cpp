@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+
+#include "TestUtils.h"
+
+namespace
+{
+	int sFailureCount = 0;
+}
+
+std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void ReportTestFailure(const char* file, int line, const std::string& message)
+{
+	printf("%s(%d): %s\n", file, line, message.c_str());
+	sFailureCount++;
+}
+
+std::string ReadShaderSource(const std::string& shaderFileName)
+{
+	const std::string path = std::string(RTAO_SHADER_DIR) + "/" + shaderFileName;
+	std::ifstream file(path);
+	if (!file)
+	{
+		throw std::runtime_error("Failed to open " + path + ".");
+	}
+
+	std::ostringstream source;
+	source << file.rdbuf();
+	return source.str();
+}
+
+double ReadShaderDefine(const std::string& shaderFileName, const std::string& name)
+{
+	std::istringstream file(ReadShaderSource(shaderFileName));
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string directive;
+		std::string defineName;
+		std::string value;
+		if (stream >> directive >> defineName >> value && directive == "#define" && defineName == name)
+		{
+			// strtod stops at the suffix and reads hexadecimal values as well.
+			return strtod(value.c_str(), nullptr);
+		}
+	}
+
+	throw std::runtime_error(shaderFileName + " doesn't define " + name + ".");
+}
+
+// Runs every registered test, or only the ones whose name is passed on the command line.
+int main(int argc, char** argv)
+{
+	int failedTestCount = 0;
+	int runTestCount = 0;
+	for (const TestCase& testCase : GetTestCases())
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; i++)
+		{
+			selected = selected || std::string(argv[i]) == testCase.name;
+		}
+		if (!selected)
+		{
+			continue;
+		}
+
+		const int previousFailureCount = sFailureCount;
+		try
+		{
+			testCase.function();
+		}
+		catch (const TestAbort&)
+		{
+		}
+		catch (const std::exception& exception)
+		{
+			ReportTestFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + exception.what());
+		}
+
+		const bool passed = sFailureCount == previousFailureCount;
+		printf("[%s] %s\n", passed ? "pass" : "FAIL", testCase.name);
+		failedTestCount += passed ? 0 : 1;
+		runTestCount++;
+	}
+
+	printf("%d of %d tests passed\n", runTestCount - failedTestCount, runTestCount);
+	return failedTestCount == 0 && runTestCount > 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "ObjImporter.h"
+#include "RTAOReference.h"
+#include "RaytracingScene.h"
+#include "SceneUtils.h"
+
+/*
+	The ray traced part of the default scene for the tests of the AO reference code, seen through the renderer's camera.
+*/
+
+// Field of view and start position of the renderer's camera, see DX12Renderer::CreateCamera() and DX12Renderer::UpdateCamera().
+constexpr float TestCameraFov = 3.14159265f * 0.5f;
+constexpr DirectX::XMFLOAT3 TestCameraEye = { 11.0f, 16.0f, -35.0f };
+constexpr DirectX::XMFLOAT3 TestCameraTarget = { 0.0f, 0.0f, 0.0f };
+
+// Built once and shared by every test of the executable.
+inline const RaytracingScene& GetTestScene()
+{
+	static const RaytracingScene scene = []()
+	{
+		MeshData mesh;
+		ImportOBJ(std::string(RTAO_ASSET_DIR) + "/Sphere.obj", mesh);
+
+		// The instance grid is randomized, fix the seed so that every run tests the same scene.
+		srand(0u);
+		RenderInstanceMap renderInstancesByID;
+		CreateSceneRenderInstances(renderInstancesByID);
+
+		RaytracingScene builtScene;
+		builtScene.Build(CreateBVHGeometryDesc(mesh.vertices, mesh.indices), renderInstancesByID[RTRenderObjectID]);
+		return builtScene;
+	}();
+	return scene;
+}
+
+inline RTAOGBuffer CreateTestGBuffer(uint32_t width, uint32_t height)
+{
+	return CreateSyntheticGBuffer(GetTestScene(), width, height, TestCameraEye, TestCameraTarget, TestCameraFov);
+}
+
+// Built once per size and shared by every test of the executable.
+inline const RTAOGBuffer& GetTestGBuffer(uint32_t width, uint32_t height)
+{
+	static std::map<std::pair<uint32_t, uint32_t>, RTAOGBuffer> gBuffers;
+	auto gBuffer = gBuffers.find({ width, height });
+	if (gBuffer == gBuffers.end())
+	{
+		gBuffer = gBuffers.emplace(std::make_pair(width, height), CreateTestGBuffer(width, height)).first;
+	}
+	return gBuffer->second;
+}
+
+// Pixels that see a surface rather than the background.
+inline uint32_t CountSurfacePixels(const RTAOGBuffer& gBuffer)
+{
+	uint32_t surfacePixelCount = 0;
+	for (const DirectX::XMFLOAT4& position : gBuffer.positions)
+	{
+		surfacePixelCount += position.w != 0.0f ? 1u : 0u;
+	}
+	return surfacePixelCount;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+	Minimal unit test helpers for the headless core library.
+
+	Every test executable links TestMain.cpp, which runs all tests declared with TEST_CASE() and returns a non zero exit code
+	if any check failed. A failed CHECK() reports and carries on, a failed REQUIRE() ends the current test.
+*/
+
+struct TestCase
+{
+	const char* name;
+	void (*function)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportTestFailure(const char* file, int line, const std::string& message);
+
+// Value of a #define in a file of the shader directory, with its f or u suffix dropped. Throws if the file doesn't define
+// it, so that tests can check that CPU code and shaders agree on their constants.
+double ReadShaderDefine(const std::string& shaderFileName, const std::string& name);
+// Whole text of a file of the shader directory, for checks that go beyond constants. Throws if it can't be read.
+std::string ReadShaderSource(const std::string& shaderFileName);
+
+// Thrown by REQUIRE() to leave the current test.
+struct TestAbort {};
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*function)())
+	{
+		GetTestCases().push_back({ name, function });
+	}
+};
+
+template<typename T>
+std::string FormatTestValue(const T& value)
+{
+	std::ostringstream stream;
+	if constexpr (requires { stream << value; })
+	{
+		stream << value;
+	}
+	else
+	{
+		stream << "<value>";
+	}
+	return stream.str();
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) { ReportTestFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); } } while (false)
+
+#define REQUIRE(condition) \
+	do { if (!(condition)) { ReportTestFailure(__FILE__, __LINE__, "REQUIRE(" #condition ")"); throw TestAbort{}; } } while (false)
+
+#define CHECK_EQ(a, b) \
+	do \
+	{ \
+		const auto checkA = (a); \
+		const auto checkB = (b); \
+		if (!(checkA == checkB)) \
+		{ \
+			ReportTestFailure(__FILE__, __LINE__, "CHECK_EQ(" #a ", " #b "): " + FormatTestValue(checkA) + " != " + FormatTestValue(checkB)); \
+		} \
+	} while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do \
+	{ \
+		const double checkA = double(a); \
+		const double checkB = double(b); \
+		if (!(std::abs(checkA - checkB) <= double(tolerance))) \
+		{ \
+			ReportTestFailure(__FILE__, __LINE__, "CHECK_NEAR(" #a ", " #b ", " #tolerance "): " + FormatTestValue(checkA) + " vs " + FormatTestValue(checkB)); \
+		} \
+	} while (false)
@@ -0,0 +1,105 @@
+#include <stdexcept>
+#include <string>
+
+#include "AppDefines.h"
+#include "TestUtils.h"
+#include "TopLevelUpdateTracker.h"
+
+namespace
+{
+	// Prepares every copy once, in frame order, and checks that each one took the given path.
+	void CheckFrames(TopLevelUpdateTracker& tracker, uint32_t instanceCount, TopLevelBuildType expectedType)
+	{
+		for (uint32_t copyIndex = 0; copyIndex < BackBufferCount; copyIndex++)
+		{
+			CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(copyIndex, instanceCount)), GetTopLevelBuildTypeName(expectedType));
+		}
+	}
+}
+
+TEST_CASE(EveryCopyIsBuiltOnceAndThenSkipped)
+{
+	TopLevelUpdateTracker tracker(BackBufferCount);
+
+	CheckFrames(tracker, 344u, TopLevelBuildType::Rebuild);
+	CheckFrames(tracker, 344u, TopLevelBuildType::Skip);
+	CheckFrames(tracker, 344u, TopLevelBuildType::Skip);
+
+	CHECK_EQ(tracker.GetStats().rebuildCount, (uint64_t)BackBufferCount);
+	CHECK_EQ(tracker.GetStats().skipCount, 2u * BackBufferCount);
+	CHECK_EQ(tracker.GetStats().updateCount, 0u);
+}
+
+TEST_CASE(TransformChangesRefitEveryCopyOnce)
+{
+	TopLevelUpdateTracker tracker(BackBufferCount);
+	CheckFrames(tracker, 344u, TopLevelBuildType::Rebuild);
+
+	tracker.MarkTransformsDirty();
+	CHECK_EQ(tracker.GetTransformVersion(), 1u);
+	CheckFrames(tracker, 344u, TopLevelBuildType::Update);
+	CheckFrames(tracker, 344u, TopLevelBuildType::Skip);
+
+	// Several changes before a copy comes around again still need only one refit.
+	tracker.MarkTransformsDirty();
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(0, 344u)), GetTopLevelBuildTypeName(TopLevelBuildType::Update));
+	tracker.MarkTransformsDirty();
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(1, 344u)), GetTopLevelBuildTypeName(TopLevelBuildType::Update));
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(0, 344u)), GetTopLevelBuildTypeName(TopLevelBuildType::Update));
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(1, 344u)), GetTopLevelBuildTypeName(TopLevelBuildType::Skip));
+
+	// A transform that moves every frame, as with AnimateRaytracedInstance, refits every frame.
+	for (uint32_t frame = 0; frame < 8u; frame++)
+	{
+		tracker.MarkTransformsDirty();
+		CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(frame % BackBufferCount, 344u)), GetTopLevelBuildTypeName(TopLevelBuildType::Update));
+	}
+	CHECK_EQ(tracker.GetStats().lastBuildType, TopLevelBuildType::Update);
+}
+
+TEST_CASE(InstanceCountChangesRebuildEveryCopy)
+{
+	TopLevelUpdateTracker tracker(BackBufferCount);
+	CheckFrames(tracker, 344u, TopLevelBuildType::Rebuild);
+
+	// The tree can't be refit with another number of instances, even when the transforms changed as well.
+	tracker.MarkTransformsDirty();
+	CheckFrames(tracker, 345u, TopLevelBuildType::Rebuild);
+	CheckFrames(tracker, 345u, TopLevelBuildType::Skip);
+
+	// A copy that was built before the count changed is rebuilt, even if the count changed back in the meantime.
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(0, 344u)), GetTopLevelBuildTypeName(TopLevelBuildType::Rebuild));
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(0, 345u)), GetTopLevelBuildTypeName(TopLevelBuildType::Rebuild));
+	CHECK_EQ(GetTopLevelBuildTypeName(tracker.PrepareCopy(1, 345u)), GetTopLevelBuildTypeName(TopLevelBuildType::Rebuild));
+	CheckFrames(tracker, 345u, TopLevelBuildType::Skip);
+
+	CHECK_EQ(tracker.GetStats().updateCount, 0u);
+	CHECK_EQ(tracker.GetStats().rebuildCount, 2u * BackBufferCount + 3u);
+}
+
+TEST_CASE(InvalidCopiesThrow)
+{
+	TopLevelUpdateTracker tracker(BackBufferCount);
+
+	bool throws = false;
+	try
+	{
+		tracker.PrepareCopy(BackBufferCount, 1u);
+	}
+	catch (const std::runtime_error&)
+	{
+		throws = true;
+	}
+	CHECK(throws);
+}
+
+TEST_CASE(StatsAreFormatted)
+{
+	TopLevelUpdateTracker tracker(BackBufferCount);
+	CheckFrames(tracker, 3u, TopLevelBuildType::Rebuild);
+	tracker.MarkTransformsDirty();
+	tracker.PrepareCopy(0, 3u);
+
+	const std::string text = FormatTopLevelUpdateStats(tracker.GetStats());
+	CHECK_EQ(text, "TLAS: 0 skipped, 1 updated, " + std::to_string(BackBufferCount) + " rebuilt, last Update\n");
+}
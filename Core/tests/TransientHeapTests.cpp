@@ -0,0 +1,215 @@
+#include <stdexcept>
+
+#include "FrameGraph.h"
+#include "TestUtils.h"
+#include "TransientHeap.h"
+
+namespace
+{
+	constexpr uint64_t KB = 1024u;
+	constexpr uint64_t MB = 1024u * KB;
+	constexpr uint64_t PlacementAlignment = 64u * KB;
+
+	struct MockAccess
+	{
+		uint32_t resource;
+		D3D12_RESOURCE_STATES state;
+		bool isWrite;
+	};
+
+	struct MockPass
+	{
+		const char* name;
+		FrameGraphQueue queue;
+		std::vector<MockAccess> accesses;
+	};
+
+	MockAccess Read(uint32_t resource, D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+	{
+		return { resource, state, false };
+	}
+
+	MockAccess Write(uint32_t resource, D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_RENDER_TARGET)
+	{
+		return { resource, state, true };
+	}
+
+	// Adds transient resources and the passes that use them, and compiles the graph.
+	void BuildGraph(FrameGraph& graph, uint32_t transientCount, const std::vector<MockPass>& passes)
+	{
+		for (uint32_t resource = 0; resource < transientCount; resource++)
+		{
+			graph.AddResource("Transient" + std::to_string(resource), D3D12_RESOURCE_STATE_RENDER_TARGET);
+			graph.SetTransient(resource);
+		}
+
+		for (const MockPass& mockPass : passes)
+		{
+			const uint32_t pass = graph.AddPass(mockPass.name, mockPass.queue);
+			for (const MockAccess& access : mockPass.accesses)
+			{
+				if (access.isWrite)
+				{
+					graph.Write(pass, access.resource, access.state);
+				}
+				else
+				{
+					graph.Read(pass, access.resource, access.state);
+				}
+			}
+		}
+
+		graph.Compile();
+	}
+
+	// Resources that can't alias must not share any bytes.
+	bool HasOverlappingConflicts(const FrameGraph& graph, const TransientHeapLayout& layout)
+	{
+		for (const TransientResourcePlacement& a : layout.placements)
+		{
+			for (const TransientResourcePlacement& b : layout.placements)
+			{
+				const bool overlaps = a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+				if (a.resource != b.resource && overlaps && !graph.CanAlias(a.resource, b.resource))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+}
+
+TEST_CASE(ResourcesWithDisjointLifetimesShareMemory)
+{
+	enum : uint32_t { Large, Small, Medium };
+
+	FrameGraph graph;
+	BuildGraph(graph, 3u, {
+		{ "First", FrameGraphQueue::Direct, { Write(Large) } },
+		{ "Second", FrameGraphQueue::Direct, { Read(Large), Write(Small) } },
+		{ "Third", FrameGraphQueue::Direct, { Read(Small), Write(Medium) } },
+		{ "Fourth", FrameGraphQueue::Direct, { Read(Medium) } },
+	});
+
+	const TransientHeapLayout layout = PackTransientResources(graph, {
+		{ Large, 4u * MB, PlacementAlignment },
+		{ Small, 1u * MB, PlacementAlignment },
+		{ Medium, 2u * MB, PlacementAlignment },
+	});
+
+	// Large and Medium are never used at the same time, Small overlaps both of them.
+	CHECK_EQ(layout.GetPlacement(Large).offset, 0u);
+	CHECK_EQ(layout.GetPlacement(Medium).offset, 0u);
+	CHECK_EQ(layout.GetPlacement(Small).offset, 4u * MB);
+	CHECK_EQ(layout.heapSize, 5u * MB);
+	CHECK_EQ(layout.unaliasedSize, 7u * MB);
+	CHECK_EQ(layout.GetSavedBytes(), 2u * MB);
+	CHECK_EQ(layout.heapAlignment, PlacementAlignment);
+	CHECK(!HasOverlappingConflicts(graph, layout));
+
+	// Placements are in request order.
+	REQUIRE(layout.placements.size() == 3u);
+	CHECK_EQ(layout.placements[1].resource, uint32_t(Small));
+	CHECK_EQ(layout.placements[1].size, 1u * MB);
+}
+
+TEST_CASE(OffsetsAndSizesAreAligned)
+{
+	FrameGraph graph;
+	BuildGraph(graph, 2u, {
+		{ "Both", FrameGraphQueue::Direct, { Write(0u), Write(1u) } },
+	});
+
+	const TransientHeapLayout layout = PackTransientResources(graph, {
+		{ 0u, 100u, 256u },
+		{ 1u, 5000u, 4096u },
+	});
+
+	// The larger one goes first, the smaller one at the next 256 byte boundary behind it.
+	CHECK_EQ(layout.GetPlacement(1u).offset, 0u);
+	CHECK_EQ(layout.GetPlacement(0u).offset, 5120u);
+	CHECK_EQ(layout.heapAlignment, 4096u);
+	CHECK_EQ(layout.heapSize, 8192u);
+	// 100 bytes, then 5000 bytes at 4096, rounded up to the heap alignment.
+	CHECK_EQ(layout.unaliasedSize, 12288u);
+	CHECK_EQ(layout.GetSavedBytes(), 4096u);
+}
+
+TEST_CASE(AsyncComputeKeepsOverlappingResourcesApart)
+{
+	// The transient G-buffer, lighting and AO targets of the renderer, with the AO filtered on the compute queue.
+	enum : uint32_t { Albedo, Normal, Depth, Lighting, AO, Filtered, Composite, Count };
+
+	FrameGraph graph;
+	BuildGraph(graph, Count, {
+		{ "GBuffer", FrameGraphQueue::Direct, { Write(Albedo), Write(Normal), Write(Depth, D3D12_RESOURCE_STATE_DEPTH_WRITE) } },
+		{ "AO", FrameGraphQueue::Direct, { Read(Normal, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE), Read(Depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE), Write(AO, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) } },
+		{ "Filter", FrameGraphQueue::Compute, { Read(AO, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE), Write(Filtered, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) } },
+		{ "Lighting", FrameGraphQueue::Direct, { Read(Albedo), Write(Lighting) } },
+		{ "Composite", FrameGraphQueue::Direct, { Read(Lighting), Read(Filtered), Write(Composite) } },
+	});
+
+	std::vector<TransientResourceRequest> requests;
+	for (uint32_t resource = 0; resource < Count; resource++)
+	{
+		requests.push_back({ resource, 8u * MB, PlacementAlignment });
+	}
+	const TransientHeapLayout layout = PackTransientResources(graph, requests);
+
+	// The filter runs while the direct queue lights the image, so their targets must not share memory.
+	CHECK(!graph.CanAlias(Filtered, Lighting));
+	CHECK(!graph.CanAlias(AO, Lighting));
+	CHECK(graph.CanAlias(Normal, Lighting));
+	CHECK(!HasOverlappingConflicts(graph, layout));
+
+	CHECK_EQ(layout.unaliasedSize, 7u * 8u * MB);
+	CHECK(layout.heapSize < layout.unaliasedSize);
+	CHECK_EQ(layout.GetSavedBytes(), layout.unaliasedSize - layout.heapSize);
+	for (const TransientResourcePlacement& placement : layout.placements)
+	{
+		CHECK_EQ(placement.offset % PlacementAlignment, 0u);
+		CHECK(placement.offset + placement.size <= layout.heapSize);
+	}
+}
+
+TEST_CASE(InvalidRequestsThrow)
+{
+	FrameGraph graph;
+	BuildGraph(graph, 1u, {
+		{ "Pass", FrameGraphQueue::Direct, { Write(0u) } },
+	});
+	const uint32_t persistent = graph.AddResource("Persistent", D3D12_RESOURCE_STATE_COMMON);
+
+	const auto throws = [&](const std::vector<TransientResourceRequest>& requests)
+	{
+		try
+		{
+			PackTransientResources(graph, requests);
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	};
+
+	CHECK(throws({ { persistent, MB, PlacementAlignment } }));
+	CHECK(throws({ { 0u, MB, PlacementAlignment }, { 0u, MB, PlacementAlignment } }));
+	CHECK(throws({ { 0u, MB, 3u } }));
+	CHECK(throws({ { 0u, MB, 0u } }));
+
+	const TransientHeapLayout layout = PackTransientResources(graph, { { 0u, MB, PlacementAlignment } });
+	CHECK_EQ(layout.heapSize, MB);
+	CHECK_EQ(layout.GetSavedBytes(), 0u);
+	bool unknownThrows = false;
+	try
+	{
+		layout.GetPlacement(persistent);
+	}
+	catch (const std::runtime_error&)
+	{
+		unknownThrows = true;
+	}
+	CHECK(unknownThrows);
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "MathUtils.h"
+#include "TestUtils.h"
+#include "VertexLayout.h"
+
+namespace
+{
+	// Worst angle between a normal and its 16 bit octahedral encoding, in radians.
+	constexpr float MaxOctahedralError = 1e-4f;
+	// Half a step of the encoding, plus the rounding of the float math.
+	constexpr float Snorm16Tolerance = 0.5f / 32767.0f + 1e-7f;
+	constexpr float Unorm8Tolerance = 0.5f / 255.0f + 1e-6f;
+
+	float GetAngle(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		// acos() of the dot product loses most of its precision at the small angles that matter here.
+		return std::atan2(MathUtils::Length(MathUtils::Cross(a, b)), MathUtils::Dot(a, b));
+	}
+
+	// The axes, the poles and the folds of the lower hemisphere, followed by a spiral over the whole sphere.
+	std::vector<DirectX::XMFLOAT3> CreateTestNormals()
+	{
+		std::vector<DirectX::XMFLOAT3> normals = {
+			{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+			{ 1e-4f, -1e-4f, -1.0f }, { -1e-4f, 1e-4f, 1.0f },
+			{ 1.0f, 1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { -1.0f, -1.0f, -1.0f },
+			{ 1.0f, 0.0f, -1e-3f }, { 0.0f, -1.0f, -1e-3f }
+		};
+
+		constexpr uint32_t SpiralCount = 4096u;
+		const float goldenAngle = 3.14159265f * (3.0f - std::sqrt(5.0f));
+		for (uint32_t i = 0; i < SpiralCount; i++)
+		{
+			const float z = 1.0f - 2.0f * (i + 0.5f) / SpiralCount;
+			const float radius = std::sqrt(1.0f - z * z);
+			normals.push_back({ radius * std::cos(goldenAngle * i), radius * std::sin(goldenAngle * i), z });
+		}
+
+		for (DirectX::XMFLOAT3& normal : normals)
+		{
+			normal = MathUtils::Normalize(normal);
+		}
+		return normals;
+	}
+
+	// DecodeOctahedral() of DeferredRenderVS.hlsl, one statement per line of ShaderDecodeLines.
+	const char* ShaderDecodeLines[] = {
+		"float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));",
+		"float t = saturate(-normal.z);",
+		"normal.xy -= t * (step(0.0f, normal.xy) * 2.0f - 1.0f);",
+		"return normalize(normal);"
+	};
+
+	DirectX::XMFLOAT3 DecodeOctahedralLikeTheShader(float encodedX, float encodedY)
+	{
+		DirectX::XMFLOAT3 normal = { encodedX, encodedY, 1.0f - std::abs(encodedX) - std::abs(encodedY) };
+		const float t = std::clamp(-normal.z, 0.0f, 1.0f);
+		normal.x -= t * ((normal.x >= 0.0f ? 1.0f : 0.0f) * 2.0f - 1.0f);
+		normal.y -= t * ((normal.y >= 0.0f ? 1.0f : 0.0f) * 2.0f - 1.0f);
+		return MathUtils::Normalize(normal);
+	}
+
+	UINT GetFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32_FLOAT:		return 12;
+		case DXGI_FORMAT_R16G16B16A16_SNORM:	return 8;
+		case DXGI_FORMAT_R16G16_SNORM:			return 4;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:		return 4;
+		default:								return 0;
+		}
+	}
+}
+
+TEST_CASE(Snorm16ClampsAndRoundTrips)
+{
+	CHECK_EQ(EncodeSnorm16(-1.0f), (int16_t)-32767);
+	CHECK_EQ(EncodeSnorm16(0.0f), (int16_t)0);
+	CHECK_EQ(EncodeSnorm16(1.0f), (int16_t)32767);
+	CHECK_EQ(EncodeSnorm16(-2.0f), (int16_t)-32767);
+	CHECK_EQ(EncodeSnorm16(2.0f), (int16_t)32767);
+
+	CHECK_EQ(DecodeSnorm16(-32768), -1.0f);
+	CHECK_EQ(DecodeSnorm16(-32767), -1.0f);
+	CHECK_EQ(DecodeSnorm16(0), 0.0f);
+	CHECK_EQ(DecodeSnorm16(32767), 1.0f);
+
+	for (int32_t value = -32767; value <= 32767; value++)
+	{
+		REQUIRE(EncodeSnorm16(DecodeSnorm16((int16_t)value)) == (int16_t)value);
+	}
+}
+
+TEST_CASE(Unorm8ClampsAndRoundTrips)
+{
+	CHECK_EQ(EncodeUnorm8(-1.0f), (uint8_t)0);
+	CHECK_EQ(EncodeUnorm8(0.0f), (uint8_t)0);
+	CHECK_EQ(EncodeUnorm8(1.0f), (uint8_t)255);
+	CHECK_EQ(EncodeUnorm8(2.0f), (uint8_t)255);
+
+	CHECK_EQ(DecodeUnorm8(0), 0.0f);
+	CHECK_EQ(DecodeUnorm8(255), 1.0f);
+
+	for (uint32_t value = 0; value <= 255u; value++)
+	{
+		REQUIRE(EncodeUnorm8(DecodeUnorm8((uint8_t)value)) == (uint8_t)value);
+	}
+}
+
+TEST_CASE(OctahedralRoundTripsTheSphere)
+{
+	float maxError = 0.0f;
+	for (const DirectX::XMFLOAT3& normal : CreateTestNormals())
+	{
+		int16_t encoded[2];
+		EncodeOctahedral(normal, encoded);
+		const DirectX::XMFLOAT3 decoded = DecodeOctahedral(encoded);
+
+		CHECK_NEAR(MathUtils::Length(decoded), 1.0f, 1e-5f);
+		maxError = std::max(maxError, GetAngle(normal, decoded));
+	}
+	CHECK(maxError < MaxOctahedralError);
+
+	// The poles land on the center and on the corners of the square.
+	int16_t encoded[2];
+	EncodeOctahedral({ 0.0f, 0.0f, 1.0f }, encoded);
+	CHECK_EQ(encoded[0], (int16_t)0);
+	CHECK_EQ(encoded[1], (int16_t)0);
+	EncodeOctahedral({ 0.0f, 0.0f, -1.0f }, encoded);
+	CHECK_EQ(std::abs(encoded[0]), 32767);
+	CHECK_EQ(std::abs(encoded[1]), 32767);
+
+	// A zero normal doesn't divide by zero.
+	EncodeOctahedral({ 0.0f, 0.0f, 0.0f }, encoded);
+	CHECK_EQ(encoded[0], (int16_t)0);
+	CHECK_EQ(encoded[1], (int16_t)0);
+}
+
+TEST_CASE(OctahedralDecodeMatchesTheShader)
+{
+	const std::string source = ReadShaderSource("DeferredRenderVS.hlsl");
+	for (const char* line : ShaderDecodeLines)
+	{
+		if (source.find(line) == std::string::npos)
+		{
+			ReportTestFailure(__FILE__, __LINE__, std::string("DeferredRenderVS.hlsl doesn't contain \"") + line + "\"");
+		}
+	}
+
+	for (const DirectX::XMFLOAT3& normal : CreateTestNormals())
+	{
+		int16_t encoded[2];
+		EncodeOctahedral(normal, encoded);
+		const DirectX::XMFLOAT3 cpu = DecodeOctahedral(encoded);
+		const DirectX::XMFLOAT3 gpu = DecodeOctahedralLikeTheShader(DecodeSnorm16(encoded[0]), DecodeSnorm16(encoded[1]));
+		CHECK_NEAR(cpu.x, gpu.x, 1e-6f);
+		CHECK_NEAR(cpu.y, gpu.y, 1e-6f);
+		CHECK_NEAR(cpu.z, gpu.z, 1e-6f);
+	}
+}
+
+TEST_CASE(LayoutDescsMatchTheStride)
+{
+	CHECK_EQ(GetVertexStride(FullVertexLayout), (UINT)sizeof(Vertex));
+	CHECK_EQ(GetVertexStride(CompactVertexLayout), 16u);
+
+	for (uint32_t index = 0; index < VertexLayoutCount; index++)
+	{
+		const VertexLayout layout = GetVertexLayoutFromIndex(index);
+		CHECK_EQ(GetVertexLayoutIndex(layout), index);
+
+		const VertexLayoutDesc desc = GetVertexLayoutDesc(layout);
+		CHECK_EQ(desc.stride, GetVertexStride(layout));
+		CHECK_EQ(desc.elements.size(), layout.colorEncoding == VertexColorEncoding::None ? 2u : 3u);
+		REQUIRE(!desc.elements.empty());
+		CHECK_EQ(std::string(desc.elements[0].semanticName), std::string("POSITION"));
+		CHECK_EQ(desc.elements[0].offset, 0u);
+
+		// The elements are packed back to back and fill the whole stride.
+		UINT offset = 0;
+		for (const VertexElement& element : desc.elements)
+		{
+			CHECK_EQ(element.offset, offset);
+			REQUIRE(GetFormatSize(element.format) > 0u);
+			offset += GetFormatSize(element.format);
+		}
+		CHECK_EQ(offset, desc.stride);
+
+		const std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs = CreateInputElementDescs(desc);
+		REQUIRE(inputElementDescs.size() == desc.elements.size());
+		for (size_t i = 0; i < inputElementDescs.size(); i++)
+		{
+			CHECK_EQ(std::string(inputElementDescs[i].SemanticName), std::string(desc.elements[i].semanticName));
+			CHECK_EQ(inputElementDescs[i].Format, desc.elements[i].format);
+			CHECK_EQ(inputElementDescs[i].AlignedByteOffset, desc.elements[i].offset);
+			CHECK_EQ(inputElementDescs[i].InputSlot, 0u);
+		}
+	}
+}
+
+TEST_CASE(VerticesRoundTripEveryLayout)
+{
+	std::vector<Vertex> vertices;
+	const std::vector<DirectX::XMFLOAT3> normals = CreateTestNormals();
+	for (size_t i = 0; i < normals.size(); i++)
+	{
+		const float value = (float)i / normals.size();
+		vertices.push_back({ { value * 10.0f, -value, 3.0f }, normals[i], { value, 1.0f - value, 0.5f } });
+	}
+
+	for (uint32_t index = 0; index < VertexLayoutCount; index++)
+	{
+		const VertexLayout layout = GetVertexLayoutFromIndex(index);
+
+		std::vector<uint8_t> encoded;
+		EncodeVertices(vertices, layout, encoded);
+		REQUIRE(encoded.size() == vertices.size() * GetVertexStride(layout));
+
+		std::vector<Vertex> decoded;
+		DecodeVertices(encoded, layout, decoded);
+		REQUIRE(decoded.size() == vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& vertex = vertices[i];
+			const Vertex& result = decoded[i];
+			REQUIRE(std::memcmp(&vertex.position, &result.position, sizeof(vertex.position)) == 0);
+
+			switch (layout.normalEncoding)
+			{
+			case VertexNormalEncoding::Float3:
+				REQUIRE(std::memcmp(&vertex.normal, &result.normal, sizeof(vertex.normal)) == 0);
+				break;
+			case VertexNormalEncoding::Snorm16:
+				REQUIRE(std::abs(vertex.normal.x - result.normal.x) <= Snorm16Tolerance);
+				REQUIRE(std::abs(vertex.normal.y - result.normal.y) <= Snorm16Tolerance);
+				REQUIRE(std::abs(vertex.normal.z - result.normal.z) <= Snorm16Tolerance);
+				break;
+			default:
+				REQUIRE(GetAngle(vertex.normal, result.normal) < MaxOctahedralError);
+				break;
+			}
+
+			switch (layout.colorEncoding)
+			{
+			case VertexColorEncoding::Float3:
+				REQUIRE(std::memcmp(&vertex.color, &result.color, sizeof(vertex.color)) == 0);
+				break;
+			case VertexColorEncoding::Unorm8:
+				REQUIRE(std::abs(vertex.color.x - result.color.x) <= Unorm8Tolerance);
+				REQUIRE(std::abs(vertex.color.y - result.color.y) <= Unorm8Tolerance);
+				REQUIRE(std::abs(vertex.color.z - result.color.z) <= Unorm8Tolerance);
+				break;
+			default:
+				REQUIRE(result.color.x == 1.0f && result.color.y == 1.0f && result.color.z == 1.0f);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,43 @@
+// The resolution that the AO is traced at and the pixels each frame traces. The CPU version is in AOUpsampler.cpp.
+
+// Matches AOResolutionMode in AOUpsampler.h.
+#define RESOLUTION_MODE_FULL 0
+#define RESOLUTION_MODE_HALF 1
+#define RESOLUTION_MODE_QUARTER 2
+#define RESOLUTION_MODE_CHECKERBOARD 3
+
+// Width and height of the block of pixels that one pixel of the trace stands for.
+uint GetAOBlockSize(uint mode)
+{
+    return mode == RESOLUTION_MODE_HALF ? 2 : (mode == RESOLUTION_MODE_QUARTER ? 4 : 1);
+}
+
+// The full resolution pixel that a pixel of the trace is traced at in the frame.
+uint2 GetAOTracePixel(uint mode, uint2 tracePixel, uint frameCount, uint2 screenSize)
+{
+    uint2 pixel = tracePixel;
+
+    if (mode == RESOLUTION_MODE_HALF || mode == RESOLUTION_MODE_QUARTER)
+    {
+        // Each base four digit of the frame index picks a quadrant, from the whole block down to single pixels, so every
+        // pixel of the block is traced once in blockSize^2 frames.
+        uint blockSize = GetAOBlockSize(mode);
+        uint index = frameCount % (blockSize * blockSize);
+        uint2 offset = uint2(0, 0);
+        for (uint step = blockSize / 2; step > 0; step /= 2)
+        {
+            uint digit = index & 3;
+            offset += step * uint2((digit & 1) ^ (digit >> 1), digit & 1);
+            index >>= 2;
+        }
+
+        pixel = tracePixel * blockSize + offset;
+    }
+    else if (mode == RESOLUTION_MODE_CHECKERBOARD)
+    {
+        pixel.x = tracePixel.x * 2 + ((tracePixel.y + frameCount) & 1);
+    }
+
+    // Blocks on the right and bottom edges may stick out of the screen.
+    return min(pixel, screenSize - 1);
+}
@@ -0,0 +1,139 @@
+// Joint bilateral upsample of the AO traced at a reduced resolution. Every pixel blends the traced samples around it,
+// weighted by distance and by how well their normals and positions match the surface of the pixel in the full resolution
+// G-buffer. The CPU version is in AOUpsampler.cpp.
+
+#include "AOResolution.hlsli"
+
+// Matches AOUpsampleConstants in AOUpsampleRenderPass.h.
+struct AOUpsampleConstants
+{
+    uint width;
+    uint height;
+    uint traceWidth;
+    uint traceHeight;
+    uint resolutionMode;
+    uint frameCount;
+};
+
+// Constants of the CPU version in AOUpsampler.h. Keep them in sync.
+#define NORMAL_POWER 32.0f
+#define PLANE_THRESHOLD 0.2f
+#define MIN_WEIGHT 0.0001f
+
+ConstantBuffer<AOUpsampleConstants> upsample : register(b0);
+
+Texture2D<float4> gNorm : register(t1);
+Texture2D<float4> gPos : register(t2);
+// The AO of the traced pixels, packed in the top left corner.
+Texture2D<float> traceTexture : register(t3);
+
+RWTexture2D<float> aoTexture : register(u0);
+
+float GetGeometryWeight(float3 normal, float3 position, uint2 samplePixel)
+{
+    float4 samplePosition = gPos[samplePixel];
+    if (samplePosition.w == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    float normalWeight = pow(max(0.0f, dot(normal, normalize(gNorm[samplePixel].xyz))), NORMAL_POWER);
+
+    float3 offset = samplePosition.xyz - position;
+    float distance = length(offset);
+    float planeRatio = distance > 0.0f ? abs(dot(normal, offset)) / distance : 0.0f;
+
+    return normalWeight * saturate(1.0f - planeRatio / PLANE_THRESHOLD);
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint2 pixel = dispatchThreadID.xy;
+    uint2 screenSize = uint2(upsample.width, upsample.height);
+    if (any(pixel >= screenSize))
+    {
+        return;
+    }
+
+    float4 worldPos = gPos[pixel];
+    if (worldPos.w == 0.0f)
+    {
+        aoTexture[pixel] = 1.0f;
+        return;
+    }
+
+    uint2 tracePixels[4];
+    uint2 samplePixels[4];
+    float spatialWeights[4];
+    uint sampleCount = 0;
+
+    if (upsample.resolutionMode == RESOLUTION_MODE_CHECKERBOARD)
+    {
+        // A pixel traced in the frame keeps its own AO, the others are rebuilt from the four pixels next to them.
+        uint2 ownTracePixel = uint2(pixel.x / 2, pixel.y);
+        if (all(GetAOTracePixel(upsample.resolutionMode, ownTracePixel, upsample.frameCount, screenSize) == pixel))
+        {
+            aoTexture[pixel] = traceTexture[ownTracePixel];
+            return;
+        }
+
+        const int2 neighborOffsets[4] = { int2(-1, 0), int2(1, 0), int2(0, -1), int2(0, 1) };
+        [unroll]
+        for (uint i = 0; i < 4; i++)
+        {
+            int2 neighbor = int2(pixel) + neighborOffsets[i];
+            if (any(neighbor < 0) || any(neighbor >= int2(screenSize)))
+            {
+                continue;
+            }
+
+            tracePixels[sampleCount] = uint2(neighbor.x / 2, neighbor.y);
+            samplePixels[sampleCount] = GetAOTracePixel(upsample.resolutionMode, tracePixels[sampleCount], upsample.frameCount, screenSize);
+            spatialWeights[sampleCount] = 1.0f;
+            sampleCount++;
+        }
+    }
+    else
+    {
+        // The 2x2 blocks whose centers are closest to the pixel. One of them is the block of the pixel, whose sample is less
+        // than a block away, so the tent weights never all go to zero.
+        float scale = 1.0f / (float)GetAOBlockSize(upsample.resolutionMode);
+        int2 firstTracePixel = (int2)floor((float2(pixel) + 0.5f) * scale - 0.5f);
+        [unroll]
+        for (uint i = 0; i < 4; i++)
+        {
+            int2 tracePixel = firstTracePixel + int2(i & 1, i >> 1);
+            if (any(tracePixel < 0) || tracePixel.x >= (int)upsample.traceWidth || tracePixel.y >= (int)upsample.traceHeight)
+            {
+                continue;
+            }
+
+            tracePixels[sampleCount] = uint2(tracePixel);
+            samplePixels[sampleCount] = GetAOTracePixel(upsample.resolutionMode, uint2(tracePixel), upsample.frameCount, screenSize);
+            float2 distance = abs(float2(samplePixels[sampleCount]) - float2(pixel));
+            float2 tent = saturate(1.0f - distance * scale);
+            spatialWeights[sampleCount] = tent.x * tent.y;
+            sampleCount++;
+        }
+    }
+
+    float3 normal = normalize(gNorm[pixel].xyz);
+
+    float weightSum = 0.0f;
+    float aoSum = 0.0f;
+    float spatialWeightSum = 0.0f;
+    float spatialAOSum = 0.0f;
+    for (uint i = 0; i < sampleCount; i++)
+    {
+        float sampleAO = traceTexture[tracePixels[i]];
+        float weight = spatialWeights[i] * GetGeometryWeight(normal, worldPos.xyz, samplePixels[i]);
+        weightSum += weight;
+        aoSum += weight * sampleAO;
+        spatialWeightSum += spatialWeights[i];
+        spatialAOSum += spatialWeights[i] * sampleAO;
+    }
+
+    // When no sample is on the surface of the pixel, they are blended by distance alone.
+    aoTexture[pixel] = weightSum >= MIN_WEIGHT ? aoSum / weightSum : spatialAOSum / spatialWeightSum;
+}
@@ -1,3 +1,5 @@
+#include "TemporalHistory.hlsli"
+
 struct VSQuadOut
 {
     float4 position : SV_Position;
@@ -9,44 +11,73 @@ struct GlobalFrameData
     uint frameCount;
     uint accumulatedFrames;
     float time;
+    // Which of the two accumulation and reprojection textures this frame writes, the other one holds the history.
+    uint historyIndex;
+    matrix previousViewProjection;
+    float3 cameraPosition;
+    float3 previousCameraPosition;
+    // Nonzero when the AO was traced with the sample counts of the adaptive sampling pass.
+    uint adaptiveSampling;
 };
 
 ConstantBuffer<GlobalFrameData> frameData : register(b1);
 
-Texture2D<float4> currentFrame : register(t3);
-
-RWTexture2D<float4> accumilationTexture : register(u0);
+Texture2D<float4> gNorm : register(t1);
+Texture2D<float4> gPos : register(t2);
 
-SamplerState textureSampler : register(s0);
+// Accumulated AO, the history length and the accumulated squared AO.
+RWTexture2D<float4> accumulationTextures[2] : register(u0);
+// Normal of the surface with its distance to the camera in w, zero for the background.
+RWTexture2D<float4> reprojectionTextures[2] : register(u2);
+// The AO of the frame, which is replaced by the accumulated AO for the composite pass.
+RWTexture2D<float> aoTexture : register(u4);
+// How many rays the pixels traced, only written when adaptive sampling is on.
+RWTexture2D<uint> sampleCountTexture : register(u5);
 
-uint2 GetPixelIndex(const in float2 uv)
+void main(VSQuadOut input)
 {
-    uint width, height;
-    accumilationTexture.GetDimensions(width, height);
-    int xPos = uv.x * width;
-    int yPos = uv.y * height;
-    uint2 pixelIndex = uint2(xPos, yPos);
-    
-    return pixelIndex;
-}
+    const uint2 pixelIndex = (uint2)input.position.xy;
+    const uint currentIndex = frameData.historyIndex;
 
-float4 main(VSQuadOut input) : SV_TARGET0
-{
-    const uint accumulatedFrames = clamp(frameData.accumulatedFrames, 0, 150);
-    
-    uint2 pixelIndex = GetPixelIndex(input.texcoord);
-    
-    // Read from accumilation and save the original color.
-    float4 prevColor = accumilationTexture[pixelIndex];
-    // Read form the current frame that was just created.
-    float4 currentColor = currentFrame.Sample(textureSampler, input.texcoord);
-    
-    // Save the final color as a weighted sum.
-    float4 finalColor = (accumulatedFrames * prevColor + currentColor) / (accumulatedFrames + 1);
-    
-    // Read back to accumilation texture.
-    accumilationTexture[pixelIndex] = finalColor;
-    
-    // Write the same color to the render target.
-    return finalColor;
-}
\ No newline at end of file
+    // Read the AO of the frame that was just traced.
+    float currentAO = aoTexture[pixelIndex];
+    float4 worldPos = gPos[pixelIndex];
+
+    // The background has no surface to reproject and never gets a history.
+    if (worldPos.w == 0.0f)
+    {
+        accumulationTextures[currentIndex][pixelIndex] = float4(currentAO, 0.0f, 0.0f, 0.0f);
+        reprojectionTextures[currentIndex][pixelIndex] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+        return;
+    }
+
+    float3 normal = normalize(gNorm[pixelIndex].xyz);
+
+    // The textures hold nothing before the first accumulated frame.
+    const uint previousIndex = 1 - currentIndex;
+    float4 history;
+    float historyLength = 1.0f;
+    float finalAO = currentAO;
+    float finalAOSquared = currentAO * currentAO;
+    if (frameData.accumulatedFrames > 0 && ReprojectHistory(accumulationTextures[previousIndex], reprojectionTextures[previousIndex],
+        frameData.previousViewProjection, frameData.previousCameraPosition, worldPos.xyz, normal, history))
+    {
+        // Pixels that got no rays keep their history.
+        if (frameData.adaptiveSampling != 0 && sampleCountTexture[pixelIndex] == 0)
+        {
+            historyLength = history.y;
+            finalAO = history.x;
+            finalAOSquared = history.z;
+        }
+        else
+        {
+            historyLength = min(history.y + 1.0f, MAX_HISTORY_LENGTH);
+            finalAO = lerp(history.x, currentAO, 1.0f / historyLength);
+            finalAOSquared = lerp(history.z, currentAO * currentAO, 1.0f / historyLength);
+        }
+    }
+
+    accumulationTextures[currentIndex][pixelIndex] = float4(finalAO, historyLength, finalAOSquared, 0.0f);
+    reprojectionTextures[currentIndex][pixelIndex] = float4(normal, length(worldPos.xyz - frameData.cameraPosition));
+    aoTexture[pixelIndex] = finalAO;
+}
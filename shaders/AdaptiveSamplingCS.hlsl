@@ -0,0 +1,220 @@
+// Decides how many AO rays every pixel traces in the frame, from the variance of its reprojected history. The first
+// dispatch clears the counters, the second one writes how many rays every pixel asks for and counts them, and the last one
+// scales the requests down to fit the ray budget. The CPU version is in AdaptiveSampling.cpp.
+
+#include "TemporalHistory.hlsli"
+
+// Matches AdaptiveSamplingConstants in AdaptiveSamplingRenderPass.h.
+struct AdaptiveSamplingConstants
+{
+    uint width;
+    uint height;
+    uint frameCount;
+    uint passType;
+    uint maxSamplesPerPixel;
+    uint rayBudget;
+    uint refreshInterval;
+    float noisyStdDev;
+    float convergedError;
+};
+
+// Matches GlobalFrameData in AppDefines.h.
+struct GlobalFrameData
+{
+    uint frameCount;
+    uint accumulatedFrames;
+    float time;
+    uint historyIndex;
+    matrix previousViewProjection;
+    float3 cameraPosition;
+    float3 previousCameraPosition;
+    uint adaptiveSampling;
+};
+
+#define PASS_TYPE_CLEAR 0
+#define PASS_TYPE_ESTIMATE 1
+#define PASS_TYPE_DISTRIBUTE 2
+
+// Matches AdaptiveSamplingCounter in AdaptiveSamplingRenderPass.h.
+#define COUNTER_REQUIRED_PIXELS 0
+#define COUNTER_OPTIONAL_RAYS 1
+#define COUNTER_REQUESTED_RAYS 2
+#define COUNTER_RAYS 3
+#define COUNTER_GRANTED_OPTIONAL_RAYS 4
+#define COUNTER_RAY_BUDGET 5
+#define COUNTER_HISTOGRAM 6
+
+// Constants of the CPU version in AdaptiveSampling.h. Keep them in sync.
+#define MAX_SAMPLES_PER_PIXEL 8
+#define VARIANCE_PRIOR_WEIGHT 1.0f
+#define MAX_VARIANCE 0.25f
+// Marks the pixels without a history between the estimate and distribute dispatches, as their first ray can't be taken away.
+#define REQUIRED_SAMPLE_FLAG 0x80
+
+#define COUNTER_COUNT (COUNTER_HISTOGRAM + MAX_SAMPLES_PER_PIXEL + 1)
+
+// 4x4 Bayer matrix that the scaled sample counts are rounded with.
+static const uint DitherMatrix[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+
+ConstantBuffer<AdaptiveSamplingConstants> adaptive : register(b0);
+ConstantBuffer<GlobalFrameData> frameData : register(b1);
+
+Texture2D<float4> gNorm : register(t1);
+Texture2D<float4> gPos : register(t2);
+
+// Pixels that get no rays are given their history AO here, the ray traced AO pass overwrites the others.
+RWTexture2D<float> aoTexture : register(u0);
+RWTexture2D<uint> sampleCountTexture : register(u2);
+RWTexture2D<float4> accumulationTextures[2] : register(u3);
+RWTexture2D<float4> reprojectionTextures[2] : register(u5);
+RWStructuredBuffer<uint> counters : register(u7);
+
+uint GetRequestedSampleCount(bool hasHistory, float4 history, uint2 pixel)
+{
+    uint maxSamples = clamp(adaptive.maxSamplesPerPixel, 1, MAX_SAMPLES_PER_PIXEL);
+    if (!hasHistory)
+    {
+        return maxSamples;
+    }
+
+    // A few frames of equal AO say little about the variance, so it starts out at the largest one there is.
+    float variance = max(0.0f, history.z - history.x * history.x);
+    float stdDev = sqrt((variance * history.y + MAX_VARIANCE * VARIANCE_PRIOR_WEIGHT) / (history.y + VARIANCE_PRIOR_WEIGHT));
+
+    // Converged pixels still get a ray now and then, so they notice when their AO changes.
+    if (stdDev < adaptive.convergedError * sqrt(history.y))
+    {
+        bool isRefreshed = adaptive.refreshInterval > 0 && (pixel.x + pixel.y * adaptive.width + adaptive.frameCount) % adaptive.refreshInterval == 0;
+        return isRefreshed ? 1 : 0;
+    }
+
+    return clamp((uint)ceil(maxSamples * stdDev / adaptive.noisyStdDev), 1, maxSamples);
+}
+
+// Scales the rays of a pixel by budget / requestedRays. Rounding every pixel down would starve a screen of pixels that all ask
+// for the same few rays, so the fraction is rounded up or down by a dither threshold that moves every frame. It only rounds
+// up for the thresholds that the fraction reaches in full, so a 4x4 block asking for equal rays never gets more than its
+// share. The products fit in 32 bits for up to AdaptiveMaxSamplesPerPixel rays on every pixel of a 4K screen.
+uint ScaleSampleCount(uint sampleCount, uint budget, uint requestedRays, uint2 pixel)
+{
+    uint scaled = sampleCount * budget;
+    uint remainder = scaled % requestedRays;
+
+    // Adding a step coprime to 16 every frame moves every pixel through all the thresholds, and keeps them a Bayer pattern.
+    uint threshold = (DitherMatrix[(pixel.y & 3) * 4 + (pixel.x & 3)] + adaptive.frameCount * 7) & 15;
+    bool roundsUp = remainder * 16 >= (threshold + 1) * requestedRays;
+    return scaled / requestedRays + (roundsUp ? 1 : 0);
+}
+
+void Estimate(uint2 pixel)
+{
+    float4 worldPos = gPos[pixel];
+    if (worldPos.w == 0.0f)
+    {
+        sampleCountTexture[pixel] = 0;
+        return;
+    }
+
+    float3 normal = normalize(gNorm[pixel].xyz);
+
+    const uint previousIndex = 1 - frameData.historyIndex;
+    float4 history;
+    bool hasHistory = frameData.accumulatedFrames > 0 && ReprojectHistory(accumulationTextures[previousIndex], reprojectionTextures[previousIndex],
+        frameData.previousViewProjection, frameData.previousCameraPosition, worldPos.xyz, normal, history);
+    if (hasHistory)
+    {
+        aoTexture[pixel] = history.x;
+    }
+
+    uint requested = GetRequestedSampleCount(hasHistory, history, pixel);
+    uint required = hasHistory ? 0 : 1;
+    sampleCountTexture[pixel] = requested | (required ? REQUIRED_SAMPLE_FLAG : 0);
+
+    // One atomic per wave.
+    uint requiredPixels = WaveActiveSum(required);
+    uint optionalRays = WaveActiveSum(requested - required);
+    uint requestedRays = WaveActiveSum(requested);
+    if (WaveIsFirstLane())
+    {
+        InterlockedAdd(counters[COUNTER_REQUIRED_PIXELS], requiredPixels);
+        InterlockedAdd(counters[COUNTER_OPTIONAL_RAYS], optionalRays);
+        InterlockedAdd(counters[COUNTER_REQUESTED_RAYS], requestedRays);
+    }
+}
+
+void Distribute(uint2 pixel)
+{
+    if (gPos[pixel].w == 0.0f)
+    {
+        return;
+    }
+
+    uint requestedWithFlag = sampleCountTexture[pixel];
+    uint required = (requestedWithFlag & REQUIRED_SAMPLE_FLAG) ? 1 : 0;
+    uint optional = (requestedWithFlag & ~REQUIRED_SAMPLE_FLAG) - required;
+
+    uint budgetLeft = adaptive.rayBudget - min(adaptive.rayBudget, counters[COUNTER_REQUIRED_PIXELS]);
+    uint optionalRays = counters[COUNTER_OPTIONAL_RAYS];
+    if (optionalRays > budgetLeft)
+    {
+        optional = ScaleSampleCount(optional, budgetLeft, optionalRays, pixel);
+
+        // The dither can still round a frame over the budget, so the rays are handed out from a running total that stops
+        // at it. Which pixels lose their rays then depends on the order the waves run in.
+        uint waveOptional = WaveActiveSum(optional);
+        uint waveOffset = 0;
+        if (WaveIsFirstLane())
+        {
+            InterlockedAdd(counters[COUNTER_GRANTED_OPTIONAL_RAYS], waveOptional, waveOffset);
+        }
+        uint offset = WaveReadLaneFirst(waveOffset) + WavePrefixSum(optional);
+        optional = min(optional, budgetLeft - min(budgetLeft, offset));
+    }
+
+    uint sampleCount = required + optional;
+    sampleCountTexture[pixel] = sampleCount;
+
+    uint rays = WaveActiveSum(sampleCount);
+    if (WaveIsFirstLane())
+    {
+        InterlockedAdd(counters[COUNTER_RAYS], rays);
+    }
+
+    for (uint bin = 0; bin <= MAX_SAMPLES_PER_PIXEL; bin++)
+    {
+        uint binCount = WaveActiveCountBits(sampleCount == bin);
+        if (WaveIsFirstLane() && binCount > 0)
+        {
+            InterlockedAdd(counters[COUNTER_HISTOGRAM + bin], binCount);
+        }
+    }
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    if (adaptive.passType == PASS_TYPE_CLEAR)
+    {
+        // The budget is stored along with the counters, so the stats read back with them are complete.
+        if (groupIndex < COUNTER_COUNT)
+        {
+            counters[groupIndex] = groupIndex == COUNTER_RAY_BUDGET ? adaptive.rayBudget : 0;
+        }
+        return;
+    }
+
+    uint2 pixel = dispatchThreadID.xy;
+    if (pixel.x >= adaptive.width || pixel.y >= adaptive.height)
+    {
+        return;
+    }
+
+    if (adaptive.passType == PASS_TYPE_ESTIMATE)
+    {
+        Estimate(pixel);
+    }
+    else
+    {
+        Distribute(pixel);
+    }
+}
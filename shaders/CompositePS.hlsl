@@ -0,0 +1,16 @@
+struct VSQuadOut
+{
+    float4 position : SV_Position;
+    float2 texcoord : UV;
+};
+
+// The lit color of the lighting pass and the AO that the passes after it traced, denoised and accumulated.
+Texture2D<float4> litColor : register(t3);
+Texture2D<float> ambientOcclusion : register(t4);
+
+float4 main(VSQuadOut input) : SV_TARGET0
+{
+    const uint2 pixelIndex = (uint2)input.position.xy;
+
+    return float4(litColor[pixelIndex].rgb * ambientOcclusion[pixelIndex], 1.0f);
+}
@@ -0,0 +1,93 @@
+// Frustum culling of the instances of one render object for one of its draw args. Every visible instance appends an
+// indirect draw command for itself, which ExecuteIndirect in the G-buffer pass consumes. The test is the same as the CPU
+// reference in FrustumCulling.cpp.
+
+struct ModelTransform
+{
+    matrix transform;
+};
+
+// Matches the command signature created by DeferredGBufferRenderPass: the first instance root constant followed by
+// D3D12_DRAW_INDEXED_ARGUMENTS.
+struct IndirectCommand
+{
+    uint firstInstance;
+    uint indexCountPerInstance;
+    uint instanceCount;
+    uint startIndexLocation;
+    int baseVertexLocation;
+    uint startInstanceLocation;
+};
+
+// Matches CullConstants in DeferredGBufferRenderPass.h.
+struct CullConstants
+{
+    float4 frustumPlanes[6];
+    float3 boundsMin;
+    uint firstInstance;
+    float3 boundsMax;
+    uint instanceCount;
+    uint indexCount;
+    uint startIndex;
+    int baseVertex;
+    uint firstCommand;
+    uint countIndex;
+};
+
+ConstantBuffer<CullConstants> cull : register(b0);
+StructuredBuffer<ModelTransform> instanceTransforms : register(t0);
+RWStructuredBuffer<IndirectCommand> commands : register(u0);
+RWByteAddressBuffer commandCounts : register(u1);
+
+bool IsBoxInFrustum(float3 center, float3 extents)
+{
+    [unroll]
+    for (uint i = 0; i < 6; i++)
+    {
+        float4 plane = cull.frustumPlanes[i];
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        float radius = abs(plane.x) * extents.x + abs(plane.y) * extents.y + abs(plane.z) * extents.z;
+        if (distance + radius < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    if (dispatchThreadID.x >= cull.instanceCount)
+    {
+        return;
+    }
+
+    uint instance = cull.firstInstance + dispatchThreadID.x;
+
+    // Same transpose as DeferredRenderVS, which gives the row vector model matrix.
+    matrix model = transpose(instanceTransforms[instance].transform);
+
+    float3 objectCenter = (cull.boundsMin + cull.boundsMax) * 0.5f;
+    float3 objectExtents = (cull.boundsMax - cull.boundsMin) * 0.5f;
+
+    float3 center = objectCenter.x * model[0].xyz + objectCenter.y * model[1].xyz + objectCenter.z * model[2].xyz + model[3].xyz;
+    float3 extents = objectExtents.x * abs(model[0].xyz) + objectExtents.y * abs(model[1].xyz) + objectExtents.z * abs(model[2].xyz);
+
+    if (!IsBoxInFrustum(center, extents))
+    {
+        return;
+    }
+
+    uint commandIndex;
+    commandCounts.InterlockedAdd(cull.countIndex * 4, 1, commandIndex);
+
+    IndirectCommand command;
+    command.firstInstance = instance;
+    command.indexCountPerInstance = cull.indexCount;
+    command.instanceCount = 1;
+    command.startIndexLocation = cull.startIndex;
+    command.baseVertexLocation = cull.baseVertex;
+    command.startInstanceLocation = 0;
+    commands[cull.firstCommand + commandIndex] = command;
+}
@@ -7,11 +7,18 @@ struct VSOut
     float4 worldNormal : WORLD_NORMAL;
 };
 
+// The vertex layout permutations are selected with VERTEX_OCT_NORMAL and VERTEX_NO_COLOR, see VertexLayout.h.
 struct VSIn
 {
     float3 pos : POSITION;
+#ifdef VERTEX_OCT_NORMAL
+    float2 normal : NORMAL;
+#else
     float3 normal : NORMAL;
+#endif
+#ifndef VERTEX_NO_COLOR
     float3 color : COLOR;
+#endif
 };
 
 struct ModelTransform
@@ -33,11 +40,37 @@ struct CameraInfo
 
 ConstantBuffer<CameraInfo> camInfo : register(b0);
 ConstantBuffer<GlobalFrameData> frameData : register(b1);
+// INSTANCE_BUFFER selects the permutation that reads the transforms of all instances from one structured buffer, which
+// lets a render object be drawn with a single instanced draw. See InstanceDataMode in AppDefines.h.
+#ifdef INSTANCE_BUFFER
+struct FirstInstance
+{
+    uint index;
+};
+
+// SV_InstanceID starts at zero for every draw, this is where the instances of the draw start in the buffer.
+ConstantBuffer<FirstInstance> firstInstance : register(b3);
+StructuredBuffer<ModelTransform> instanceTransforms : register(t0, space1);
+#else
 ConstantBuffer<ModelTransform> transf : register(b2);
+#endif
 
-VSOut main(VSIn input)
+// Matches DecodeOctahedral() in VertexLayout.cpp.
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-normal.z);
+    normal.xy -= t * (step(0.0f, normal.xy) * 2.0f - 1.0f);
+    return normalize(normal);
+}
+
+VSOut main(VSIn input, uint instanceID : SV_InstanceID)
 {
     VSOut output = (VSOut) 0;
+
+#ifdef INSTANCE_BUFFER
+    ModelTransform transf = instanceTransforms[firstInstance.index + instanceID];
+#endif
     
     // TODO: Remove the need to do transpose in shader.
     matrix transposedTransform = transpose(transf.transform);
@@ -47,12 +80,20 @@ VSOut main(VSIn input)
     output.pos = mul(inputPosition, mvpMatrix);
     output.worldPos = mul(inputPosition, transposedTransform);
    
+#ifdef VERTEX_OCT_NORMAL
+    float4 inputNormal = float4(DecodeOctahedral(input.normal), 0.0f);
+#else
     float4 inputNormal = float4(normalize(input.normal), 0.0f);
+#endif
     output.normal = mul(inputNormal, mvpMatrix);    
     float3 worldNormal = mul(inputNormal, transposedTransform).xyz;
     output.worldNormal = float4(normalize(worldNormal), 0.0f);
     
+#ifdef VERTEX_NO_COLOR
+    output.color = float4(1.0f, 1.0f, 1.0f, 1.0f);
+#else
     output.color = float4(input.color, 1.0f);
+#endif
 
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+// Edge-aware à-trous wavelet filter for the ray traced AO. The first dispatch estimates the variance of the AO, every
+// iteration then filters the AO and its variance, and the last one writes the filtered AO back to the AO texture. The CPU
+// version is in AtrousDenoiser.cpp.
+
+// Matches DenoiseConstants in DenoiseRenderPass.h.
+struct DenoiseConstants
+{
+    uint width;
+    uint height;
+    // Distance in pixels between the taps of the iteration.
+    uint stepSize;
+    uint passType;
+    // Which of the two denoise textures the iteration reads, it writes the other one.
+    uint sourceIndex;
+    float phiColor;
+    float phiPosition;
+};
+
+#define PASS_TYPE_VARIANCE 0
+#define PASS_TYPE_ITERATION 1
+#define PASS_TYPE_LAST_ITERATION 2
+
+// Constants of the CPU version in AtrousDenoiser.h. Keep them in sync.
+#define NORMAL_POWER 128.0f
+#define COLOR_EPSILON 0.0001f
+
+ConstantBuffer<DenoiseConstants> denoise : register(b0);
+
+Texture2D<float4> gNorm : register(t1);
+Texture2D<float4> gPos : register(t2);
+
+RWTexture2D<float> aoTexture : register(u0);
+// The AO with its variance in y.
+RWTexture2D<float2> denoiseTextures[2] : register(u1);
+
+static const float kernelWeights[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+bool IsInside(int2 pixel)
+{
+    return all(pixel >= 0) && pixel.x < (int)denoise.width && pixel.y < (int)denoise.height;
+}
+
+// max(0, 1 - x / 256)^256, which stands in for exp(-x) on the CPU as well.
+float Falloff(float x)
+{
+    float base = saturate(1.0f - x / 256.0f);
+    [unroll]
+    for (uint i = 0; i < 8; i++)
+    {
+        base *= base;
+    }
+    return base;
+}
+
+void EstimateVariance(int2 pixel)
+{
+    float sum = 0.0f;
+    float sumOfSquares = 0.0f;
+    float count = 0.0f;
+    for (int offsetY = -1; offsetY <= 1; offsetY++)
+    {
+        for (int offsetX = -1; offsetX <= 1; offsetX++)
+        {
+            int2 tap = pixel + int2(offsetX, offsetY);
+            if (!IsInside(tap) || gPos[tap].w == 0.0f)
+            {
+                continue;
+            }
+
+            float ao = aoTexture[tap];
+            sum += ao;
+            sumOfSquares += ao * ao;
+            count += 1.0f;
+        }
+    }
+
+    float mean = sum / count;
+    denoiseTextures[0][pixel] = float2(aoTexture[pixel], max(0.0f, sumOfSquares / count - mean * mean));
+}
+
+void FilterIteration(int2 pixel)
+{
+    float3 normal = normalize(gNorm[pixel].xyz);
+    float3 position = gPos[pixel].xyz;
+    float2 center = denoiseTextures[denoise.sourceIndex][pixel];
+    float aoScale = 1.0f / (denoise.phiColor * sqrt(max(0.0f, center.y)) + COLOR_EPSILON);
+
+    float weightSum = 0.0f;
+    float aoSum = 0.0f;
+    float varianceSum = 0.0f;
+    for (int offsetY = -2; offsetY <= 2; offsetY++)
+    {
+        for (int offsetX = -2; offsetX <= 2; offsetX++)
+        {
+            int2 tap = pixel + int2(offsetX, offsetY) * (int)denoise.stepSize;
+            if (!IsInside(tap))
+            {
+                continue;
+            }
+
+            float4 tapPosition = gPos[tap];
+            if (tapPosition.w == 0.0f)
+            {
+                continue;
+            }
+
+            float2 tapValue = denoiseTextures[denoise.sourceIndex][tap];
+
+            float normalWeight = pow(max(0.0f, dot(normal, normalize(gNorm[tap].xyz))), NORMAL_POWER);
+            float planeDistance = abs(dot(normal, tapPosition.xyz - position)) / denoise.phiPosition;
+            float aoDistance = abs(center.x - tapValue.x) * aoScale;
+
+            float weight = kernelWeights[offsetX + 2] * kernelWeights[offsetY + 2] * normalWeight * Falloff(planeDistance + aoDistance);
+            weightSum += weight;
+            aoSum += weight * tapValue.x;
+            varianceSum += weight * weight * tapValue.y;
+        }
+    }
+
+    // The center tap always has a weight, so the sum isn't zero.
+    float2 filtered = float2(aoSum / weightSum, varianceSum / (weightSum * weightSum));
+
+    if (denoise.passType == PASS_TYPE_LAST_ITERATION)
+    {
+        aoTexture[pixel] = filtered.x;
+    }
+    else
+    {
+        denoiseTextures[1 - denoise.sourceIndex][pixel] = filtered;
+    }
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    int2 pixel = (int2)dispatchThreadID.xy;
+
+    // The background keeps its AO and is never a tap.
+    if (!IsInside(pixel) || gPos[pixel].w == 0.0f)
+    {
+        return;
+    }
+
+    if (denoise.passType == PASS_TYPE_VARIANCE)
+    {
+        EstimateVariance(pixel);
+    }
+    else
+    {
+        FilterIteration(pixel);
+    }
+}
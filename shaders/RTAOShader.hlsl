@@ -1,19 +1,32 @@
+#include "AOResolution.hlsli"
+
 RaytracingAccelerationStructure gRtScene : register(t0);
 
 Texture2D<float4> gDiffuse : register(t1);
 Texture2D<float4> gNorm : register(t2);
 Texture2D<float4> gPos : register(t3);
 
-RWTexture2D<float4> gOutput : register(u0);
+// The AO on its own, which the composite pass multiplies into the lit color.
+RWTexture2D<float> gOutput : register(u0);
+// The AO traced at a reduced resolution, which the upsample pass rebuilds the AO texture from.
+RWTexture2D<float> gTraceOutput : register(u1);
+// How many rays every pixel traces when adaptive sampling is on.
+RWTexture2D<uint> gSampleCounts : register(u2);
 
 struct RayPayload
 {
 	float aoVal;
 };
 
+// Matches RaytracedAOConstants in RaytracedAORenderPass.h.
 struct GlobalData
 {
     uint frameCount;
+    uint resolutionMode;
+    uint screenWidth;
+    uint screenHeight;
+    // Nonzero to trace the sample counts of the adaptive sampling pass instead of NUM_SAMPLES.
+    uint adaptiveSampling;
 };
 
 ConstantBuffer<GlobalData> globalData : register(b0);
@@ -85,16 +98,26 @@ void raygen()
     uint randSeed = initRand(launchIndex.x + launchIndex.y * launchDim.x, globalData.frameCount);
     //uint randSeed = 30125012;
 	
-	uint2 pixelIndex = launchIndex.xy;
+	// The launch covers the trace, which is smaller than the screen outside of the full resolution mode.
+	uint2 pixelIndex = GetAOTracePixel(globalData.resolutionMode, launchIndex.xy, globalData.frameCount, uint2(globalData.screenWidth, globalData.screenHeight));
 	float4 worldPos = gPos[pixelIndex];
 	float3 worldNormal = gNorm[pixelIndex].xyz;
     float diffuseAlpha = gDiffuse[pixelIndex].a;
 	
+    // Adaptive sampling is only on at full resolution.
+    uint sampleCount = globalData.adaptiveSampling != 0 ? gSampleCounts[pixelIndex] : NUM_SAMPLES;
+
+    // The adaptive sampling pass already wrote the history AO of the pixels that get no rays.
+    if (worldPos.w != 0.0f && sampleCount == 0)
+    {
+        return;
+    }
+
     float aoVal = 1.0;
     if (worldPos.w != 0.0f)
 	{
         float accumulatedAOVal = 0.0f;
-        for (uint i = 0; i < NUM_SAMPLES; i++)
+        for (uint i = 0; i < sampleCount; i++)
         {
             float3 worldDir = getCosHemisphereSample(randSeed, worldNormal);
 		
@@ -108,10 +131,17 @@ void raygen()
         }
         
         
-        aoVal = (accumulatedAOVal / (float)NUM_SAMPLES);
+        aoVal = (accumulatedAOVal / (float)sampleCount);
     }
     
-    gOutput[pixelIndex] = gOutput[pixelIndex] * aoVal;
+    if (globalData.resolutionMode == RESOLUTION_MODE_FULL)
+    {
+        gOutput[pixelIndex] = aoVal;
+    }
+    else
+    {
+        gTraceOutput[launchIndex.xy] = aoVal;
+    }
 }
 
 [shader("miss")]
@@ -0,0 +1,74 @@
+// Reprojection of the accumulated AO, shared by the accumulation and the adaptive sampling passes. The CPU version is in
+// TemporalReprojection.cpp.
+
+// Constants of the CPU reference in TemporalReprojection.h. Keep them in sync.
+#define MAX_HISTORY_LENGTH 64.0f
+#define DEPTH_TOLERANCE 0.05f
+#define NORMAL_THRESHOLD 0.9f
+#define MIN_HISTORY_WEIGHT 0.001f
+
+bool IsHistoryTapValid(float4 surface, float3 normal, float expectedDistance)
+{
+    if (surface.w <= 0.0f)
+    {
+        return false;
+    }
+
+    bool isSameOrientation = dot(surface.xyz, normal) >= NORMAL_THRESHOLD;
+    bool isSameDistance = abs(surface.w - expectedDistance) <= DEPTH_TOLERANCE * expectedDistance;
+    return isSameOrientation && isSameDistance;
+}
+
+// Finds where the surface was in the previous frame and filters the history around it with the bilinear taps that
+// still see the same surface. Returns false when none does.
+bool ReprojectHistory(RWTexture2D<float4> accumulationHistory, RWTexture2D<float4> reprojectionHistory, matrix previousViewProjection, float3 previousCameraPosition, float3 worldPos, float3 normal, out float4 history)
+{
+    history = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    float4 previousClip = mul(float4(worldPos, 1.0f), transpose(previousViewProjection));
+    if (previousClip.w <= 0.0f)
+    {
+        return false;
+    }
+
+    uint width, height;
+    accumulationHistory.GetDimensions(width, height);
+
+    float2 previousUV = previousClip.xy / previousClip.w * float2(0.5f, -0.5f) + 0.5f;
+    float2 previousPixel = previousUV * float2(width, height) - 0.5f;
+    float2 basePixel = floor(previousPixel);
+    float2 fraction = previousPixel - basePixel;
+
+    const float expectedDistance = length(worldPos - previousCameraPosition);
+
+    float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float totalWeight = 0.0f;
+    [unroll]
+    for (int tap = 0; tap < 4; tap++)
+    {
+        int2 offset = int2(tap & 1, tap >> 1);
+        int2 pixel = int2(basePixel) + offset;
+        if (any(pixel < 0) || pixel.x >= (int)width || pixel.y >= (int)height)
+        {
+            continue;
+        }
+
+        if (!IsHistoryTapValid(reprojectionHistory[pixel], normal, expectedDistance))
+        {
+            continue;
+        }
+
+        float2 weights = lerp(1.0f - fraction, fraction, float2(offset));
+        float weight = weights.x * weights.y;
+        sum += accumulationHistory[pixel] * weight;
+        totalWeight += weight;
+    }
+
+    if (totalWeight < MIN_HISTORY_WEIGHT)
+    {
+        return false;
+    }
+
+    history = sum / totalWeight;
+    return true;
+}